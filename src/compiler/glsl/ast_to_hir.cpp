@@ -5733,6 +5733,21 @@ ast_function::hir(exec_list *instructions,
    sig->replace_parameters(&hir_parameters);
    signature = sig;
 
+   /* Calls take the precision of their result from here, see
+    * propagate_precision().  A missing default precision is not an error
+    * until a value of that type is declared.
+    */
+   if (state->es_shader) {
+      sig->return_precision = this->return_type->qualifier.precision;
+      if (sig->return_precision == ast_precision_none &&
+          precision_qualifier_allowed(return_type)) {
+         const char *type_name =
+            get_type_name_for_precision_qualifier(return_type->without_array());
+         sig->return_precision =
+            state->symbols->get_default_precision_qualifier(type_name);
+      }
+   }
+
    if (this->return_type->qualifier.subroutine_list) {
       int idx;
 
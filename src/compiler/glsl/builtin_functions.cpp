@@ -1030,7 +1030,10 @@ builtin_builder::initialize()
    if (mem_ctx != NULL)
       return;
 
-   mem_ctx = ralloc_context(NULL);
+   /* The builtins are thousands of small IR nodes that all live until
+    * release(), so bump-allocate them out of an arena.
+    */
+   mem_ctx = ralloc_arena_context(NULL);
    create_shader();
    create_intrinsics();
    create_builtins();
@@ -1054,7 +1057,8 @@ builtin_builder::create_shader()
     * arbitrarily pick GL_VERTEX_SHADER.
     */
    shader = _mesa_new_shader(0, MESA_SHADER_VERTEX);
-   shader->symbols = new(mem_ctx) glsl_symbol_table;
+   shader->symbols =
+      new(mem_ctx) glsl_symbol_table(_mesa_string_pool_create(mem_ctx));
 }
 
 /** @} */
@@ -0,0 +1,92 @@
+#
+# Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+"""Generate large fragment shaders for the compiler benchmarks.
+
+The shader is a chain of data-dependent if/else statements over a small
+pool of locals, so the optimizer can neither fold the branches nor drop
+the variables.  Every statement nests --depth levels deep, and every
+--loop-every'th statement is wrapped in a loop, which gives the control
+flow graph both long dominator chains and back edges.
+
+Usage: gen_bench_shader.py [--statements N] [--depth D] [--loop-every L]
+"""
+
+import argparse
+import sys
+
+NUM_LOCALS = 8
+
+
+def statement(out, i, depth, indent):
+    a = 'a{}'.format(i % NUM_LOCALS)
+    b = 'a{}'.format((i * 3 + 1) % NUM_LOCALS)
+    pad = '   ' * indent
+
+    out.append('{}if ({}.x > {}.y + {:.1f}) {{'.format(pad, a, b, i % 7))
+    out.append('{}   {} = {} * {}.yzwx + vec4({:.1f});'.format(
+        pad, a, a, b, i * 0.5))
+    if depth > 1:
+        statement(out, i + 1, depth - 1, indent + 1)
+    out.append('{}}} else {{'.format(pad))
+    out.append('{}   {} -= {}.wzyx * {:.1f};'.format(pad, b, a, 0.25 + i % 3))
+    out.append('{}}}'.format(pad))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--statements', type=int, default=256,
+                        help='top-level if statements (default 256)')
+    parser.add_argument('--depth', type=int, default=2,
+                        help='if/else nesting depth of each statement')
+    parser.add_argument('--loop-every', type=int, default=16,
+                        help='wrap every Nth statement in a loop, 0 for none')
+    args = parser.parse_args()
+
+    out = [
+        '#version 300 es',
+        'precision highp float;',
+        'flat in int vi;',
+        'in vec4 vc;',
+        'out vec4 o;',
+        'void main() {',
+    ]
+    for j in range(NUM_LOCALS):
+        out.append('   vec4 a{} = vc * {:.1f};'.format(j, j + 1))
+
+    for i in range(args.statements):
+        if args.loop_every and i % args.loop_every == args.loop_every - 1:
+            out.append('   for (int l = 0; l < vi; l++) {')
+            statement(out, i, args.depth, 2)
+            out.append('   }')
+        else:
+            statement(out, i, args.depth, 1)
+
+    out.append('   o = {};'.format(
+        ' + '.join('a{}'.format(j) for j in range(NUM_LOCALS))))
+    out.append('}')
+
+    sys.stdout.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
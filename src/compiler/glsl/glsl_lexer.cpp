@@ -1286,9 +1286,9 @@ static int classify_identifier(struct _mesa_glsl_parse_state *, const char *);
 			  "illegal use of reserved word `%s'", yytext);	\
 	 return ERROR_TOK;						\
       } else {								\
-	 void *mem_ctx = yyextra->linalloc;					\
-	 yylval->identifier = linear_strdup(mem_ctx, yytext);		\
-	 return classify_identifier(yyextra, yytext);			\
+	 yylval->identifier = _mesa_string_pool_intern_len(yyextra->strings, \
+							   yytext, yyleng); \
+	 return classify_identifier(yyextra, yylval->identifier);	\
       }									\
    } while (0)
 
@@ -1869,8 +1869,9 @@ case 18:
 YY_RULE_SETUP
 #line 263 "./glsl/glsl_lexer.ll"
 {
-				   void *mem_ctx = yyextra->linalloc;
-				   yylval->identifier = linear_strdup(mem_ctx, yytext);
+				   yylval->identifier =
+				      _mesa_string_pool_intern_len(yyextra->strings,
+				                                   yytext, yyleng);
 				   return IDENTIFIER;
 				}
 	YY_BREAK
@@ -2595,9 +2596,10 @@ YY_RULE_SETUP
                       || yyextra->ARB_tessellation_shader_enable) {
 		      return LAYOUT_TOK;
 		   } else {
-		      void *mem_ctx = yyextra->linalloc;
-		      yylval->identifier = linear_strdup(mem_ctx, yytext);
-		      return classify_identifier(yyextra, yytext);
+		      yylval->identifier =
+		         _mesa_string_pool_intern_len(yyextra->strings,
+		                                      yytext, yyleng);
+		      return classify_identifier(yyextra, yylval->identifier);
 		   }
 		}
 	YY_BREAK
@@ -3197,15 +3199,15 @@ YY_RULE_SETUP
 #line 621 "./glsl/glsl_lexer.ll"
 {
 			    struct _mesa_glsl_parse_state *state = yyextra;
-			    void *ctx = state->linalloc;
-			    if (state->es_shader && strlen(yytext) > 1024) {
+			    if (state->es_shader && yyleng > 1024) {
 			       _mesa_glsl_error(yylloc, state,
 			                        "Identifier `%s' exceeds 1024 characters",
 			                        yytext);
-			    } else {
-			      yylval->identifier = linear_strdup(ctx, yytext);
+			       return classify_identifier(state, yytext);
 			    }
-			    return classify_identifier(state, yytext);
+			    yylval->identifier =
+			       _mesa_string_pool_intern_len(state->strings, yytext, yyleng);
+			    return classify_identifier(state, yylval->identifier);
 			}
 	YY_BREAK
 case 273:
@@ -80,9 +80,9 @@ static int classify_identifier(struct _mesa_glsl_parse_state *, const char *);
 			  "illegal use of reserved word `%s'", yytext);	\
 	 return ERROR_TOK;						\
       } else {								\
-	 void *mem_ctx = yyextra->linalloc;					\
-	 yylval->identifier = linear_strdup(mem_ctx, yytext);		\
-	 return classify_identifier(yyextra, yytext);			\
+	 yylval->identifier = _mesa_string_pool_intern_len(yyextra->strings, \
+							   yytext, yyleng); \
+	 return classify_identifier(yyextra, yylval->identifier);	\
       }									\
    } while (0)
 
@@ -260,8 +260,9 @@ HASH		^{SPC}#{SPC}
 <PP>[ \t\r]*			{ }
 <PP>:				return COLON;
 <PP>[_a-zA-Z][_a-zA-Z0-9]*	{
-				   void *mem_ctx = yyextra->linalloc;
-				   yylval->identifier = linear_strdup(mem_ctx, yytext);
+				   yylval->identifier =
+				      _mesa_string_pool_intern_len(yyextra->strings,
+				                                   yytext, yyleng);
 				   return IDENTIFIER;
 				}
 <PP>[1-9][0-9]*			{
@@ -448,9 +449,10 @@ layout		{
                       || yyextra->ARB_tessellation_shader_enable) {
 		      return LAYOUT_TOK;
 		   } else {
-		      void *mem_ctx = yyextra->linalloc;
-		      yylval->identifier = linear_strdup(mem_ctx, yytext);
-		      return classify_identifier(yyextra, yytext);
+		      yylval->identifier =
+		         _mesa_string_pool_intern_len(yyextra->strings,
+		                                      yytext, yyleng);
+		      return classify_identifier(yyextra, yylval->identifier);
 		   }
 		}
 
@@ -619,15 +621,15 @@ u64vec4		KEYWORD_WITH_ALT(0, 0, 0, 0, yyextra->ARB_gpu_shader_int64_enable, U64V
 
 [_a-zA-Z][_a-zA-Z0-9]*	{
 			    struct _mesa_glsl_parse_state *state = yyextra;
-			    void *ctx = state->linalloc;
-			    if (state->es_shader && strlen(yytext) > 1024) {
+			    if (state->es_shader && yyleng > 1024) {
 			       _mesa_glsl_error(yylloc, state,
 			                        "Identifier `%s' exceeds 1024 characters",
 			                        yytext);
-			    } else {
-			      yylval->identifier = linear_strdup(ctx, yytext);
+			       return classify_identifier(state, yytext);
 			    }
-			    return classify_identifier(state, yytext);
+			    yylval->identifier =
+			       _mesa_string_pool_intern_len(state->strings, yytext, yyleng);
+			    return classify_identifier(state, yylval->identifier);
 			}
 
 \.			{ struct _mesa_glsl_parse_state *state = yyextra;
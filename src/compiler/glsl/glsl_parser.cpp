@@ -3358,7 +3358,7 @@ yyreduce:
 #line 317 "./glsl/glsl_parser.yy" /* yacc.c:1646  */
     {
       delete state->symbols;
-      state->symbols = new(ralloc_parent(state)) glsl_symbol_table;
+      state->symbols = new(ralloc_parent(state)) glsl_symbol_table(state->strings);
       if (state->es_shader) {
          if (state->stage == MESA_SHADER_FRAGMENT) {
             state->symbols->add_default_precision_qualifier("int", ast_precision_medium);
@@ -316,7 +316,7 @@ translation_unit:
    external_declaration_list
    {
       delete state->symbols;
-      state->symbols = new(ralloc_parent(state)) glsl_symbol_table;
+      state->symbols = new(ralloc_parent(state)) glsl_symbol_table(state->strings);
       if (state->es_shader) {
          if (state->stage == MESA_SHADER_FRAGMENT) {
             state->symbols->add_default_precision_qualifier("int", ast_precision_medium);
@@ -67,7 +67,8 @@ _mesa_glsl_parse_state::_mesa_glsl_parse_state(struct gl_context *_ctx,
 
    this->scanner = NULL;
    this->translation_unit.make_empty();
-   this->symbols = new(mem_ctx) glsl_symbol_table;
+   this->strings = _mesa_string_pool_create(this);
+   this->symbols = new(mem_ctx) glsl_symbol_table(this->strings);
 
    this->linalloc = linear_alloc_parent(this, 0);
 
@@ -2137,7 +2138,7 @@ do_common_optimization(exec_list *ir, bool linked,
    OPT(lower_instructions, ir, SUB_TO_ADD_NEG);
 
    if (linked) {
-      OPT(do_function_inlining, ir);
+      OPT(do_function_inlining, ir, options);
       OPT(do_dead_functions, ir);
       OPT(do_structure_splitting, ir);
    }
@@ -2155,11 +2156,15 @@ do_common_optimization(exec_list *ir, bool linked,
       OPT(do_vectorize, ir);
    }
 
+   if (linked)
+      OPT(do_slp_vectorize, ir);
+
    if (linked)
       OPT(do_dead_code, ir, uniform_locations_assigned);
    else
       OPT(do_dead_code_unlinked, ir);
    OPT(do_dead_code_local, ir);
+   OPT(do_dead_stores, ir);
    OPT(do_tree_grafting, ir);
    OPT(do_constant_propagation, ir);
    if (linked)
@@ -2170,12 +2175,11 @@ do_common_optimization(exec_list *ir, bool linked,
    OPT(do_minmax_prune, ir);
    OPT(do_rebalance_tree, ir);
    OPT(do_algebraic, ir, native_integers, options);
+   OPT(do_strength_reduction, ir, native_integers);
    OPT(do_lower_jumps, ir, true, true, options->EmitNoMainReturn,
        options->EmitNoCont, options->EmitNoLoops);
-   OPT(do_vec_index_to_swizzle, ir);
    OPT(lower_vector_insert, ir, false);
-   OPT(do_swizzle_swizzle, ir);
-   OPT(do_noop_swizzle, ir);
+   OPT(do_swizzle_peephole, ir);
 
    OPT(optimize_split_arrays, ir, linked);
    OPT(optimize_redundant_jumps, ir);
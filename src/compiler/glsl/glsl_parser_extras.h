@@ -32,6 +32,7 @@
 
 #include <stdlib.h>
 #include "glsl_symbol_table.h"
+#include "util/string_pool.h"
 
 struct gl_context;
 
@@ -342,6 +343,12 @@ struct _mesa_glsl_parse_state {
    exec_list translation_unit;
    glsl_symbol_table *symbols;
 
+   /**
+    * Identifiers seen by the lexer, interned so that the symbol table can
+    * look them up without rehashing them.
+    */
+   struct string_pool *strings;
+
    void *linalloc;
 
    unsigned num_supported_versions;
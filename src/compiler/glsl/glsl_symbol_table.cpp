@@ -101,10 +101,10 @@ public:
    const class ast_type_specifier *a;
 };
 
-glsl_symbol_table::glsl_symbol_table()
+glsl_symbol_table::glsl_symbol_table(struct string_pool *strings)
 {
    this->separate_function_namespace = false;
-   this->table = _mesa_symbol_table_ctor();
+   this->table = _mesa_symbol_table_ctor_with_pool(strings);
    this->mem_ctx = ralloc_context(NULL);
    this->linalloc = linear_alloc_parent(this->mem_ctx, 0);
 }
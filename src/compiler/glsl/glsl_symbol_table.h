@@ -42,7 +42,11 @@ struct glsl_type;
 struct glsl_symbol_table {
    DECLARE_RALLOC_CXX_OPERATORS(glsl_symbol_table)
 
-   glsl_symbol_table();
+   /**
+    * \param strings  Optional pool to intern symbol names in.  It must
+    *                 outlive the symbol table.
+    */
+   glsl_symbol_table(struct string_pool *strings = NULL);
    ~glsl_symbol_table();
 
    /* In 1.10, functions and variables have separate namespaces. */
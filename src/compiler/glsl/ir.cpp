@@ -201,6 +201,7 @@ ir_expression::ir_expression(int op, const struct glsl_type *type,
    this->operands[1] = op1;
    this->operands[2] = op2;
    this->operands[3] = op3;
+   this->precision = GLSL_PRECISION_NONE;
 #ifndef NDEBUG
    int num_operands = get_num_operands(this->operation);
    for (int i = num_operands; i < 4; i++) {
@@ -217,6 +218,7 @@ ir_expression::ir_expression(int op, ir_rvalue *op0)
    this->operands[1] = NULL;
    this->operands[2] = NULL;
    this->operands[3] = NULL;
+   this->precision = GLSL_PRECISION_NONE;
 
    assert(op <= ir_last_unop);
 
@@ -426,6 +428,7 @@ ir_expression::ir_expression(int op, ir_rvalue *op0, ir_rvalue *op1)
    this->operands[1] = op1;
    this->operands[2] = NULL;
    this->operands[3] = NULL;
+   this->precision = GLSL_PRECISION_NONE;
 
    assert(op > ir_last_unop);
 
@@ -524,6 +527,7 @@ ir_expression::ir_expression(int op, ir_rvalue *op0, ir_rvalue *op1,
    this->operands[1] = op1;
    this->operands[2] = op2;
    this->operands[3] = NULL;
+   this->precision = GLSL_PRECISION_NONE;
 
    assert(op > ir_last_binop && op <= ir_last_triop);
 
@@ -1806,8 +1810,8 @@ ir_variable::get_extension_warning() const
 ir_function_signature::ir_function_signature(const glsl_type *return_type,
                                              builtin_available_predicate b)
    : ir_instruction(ir_type_function_signature),
-     return_type(return_type), is_defined(false),
-     intrinsic_id(ir_intrinsic_invalid), builtin_avail(b), _function(NULL)
+     return_type(return_type), return_precision(GLSL_PRECISION_NONE),
+     is_defined(false), intrinsic_id(ir_intrinsic_invalid), builtin_avail(b), _function(NULL)
 {
    this->origin = NULL;
 }
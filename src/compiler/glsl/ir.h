@@ -90,14 +90,15 @@ class ir_instruction : public exec_node {
 public:
    enum ir_node_type ir_type;
 
-   unsigned int ir_value;
-   unsigned int ir_pointer;
-   unsigned int ir_label;
-   unsigned int ir_label_break;
-   unsigned int ir_uniform;
-   unsigned int ir_initialized;
-
-   struct exec_node *parent;
+   /**
+    * Index of this node in the side tables of the most recent pass that
+    * numbered it
+    *
+    * Only a hint: the owner of the table checks that the entry points back
+    * at this node before trusting it, so stale values are harmless.  It
+    * fills the padding after \c ir_type, so only ir_loop_jump grows.
+    */
+   unsigned table_index;
 
    /**
     * GCC 4.7+ and clang warn when deleting an ir_instruction unless
@@ -210,7 +211,7 @@ public:
 
 protected:
    ir_instruction(enum ir_node_type t)
-      : ir_type(t)
+      : ir_type(t), table_index(0)
    {
    }
 
@@ -1190,10 +1191,18 @@ public:
    /**
     * Function return type.
     *
-    * \note This discards the optional precision qualifier.
+    * \note This discards the optional precision qualifier, which is kept in
+    * \c return_precision instead.
     */
    const struct glsl_type *return_type;
 
+   /**
+    * Precision of the return value in GLSL ES, from its qualifier or the
+    * default precision in scope.  GLSL_PRECISION_NONE for built-ins, whose
+    * results take the precision of their arguments.
+    */
+   unsigned return_precision:2;
+
    /**
     * List of ir_variable of function parameters.
     *
@@ -1560,6 +1569,13 @@ public:
 
    ir_expression_operation operation;
    ir_rvalue *operands[4];
+
+   /**
+    * Precision the expression is evaluated at, one of the GLSL_PRECISION_*
+    * values.  This is \c GLSL_PRECISION_NONE until propagate_precision()
+    * infers it from the operands and the destination.
+    */
+   unsigned precision:2;
 };
 
 
@@ -1612,8 +1628,13 @@ public:
    /**
     * Generates an inline version of the function before @ir,
     * storing the return value in return_deref.
+    *
+    * If @steal_body is set the callee's body is moved into place instead of
+    * being cloned.  The caller must know that this is the last reference to
+    * the callee; its signature is left with an empty body for
+    * do_dead_functions() to remove.
     */
-   void generate_inline(ir_instruction *ir);
+   void generate_inline(ir_instruction *ir, bool steal_body = false);
 
    /**
     * Storage for the function's return value.
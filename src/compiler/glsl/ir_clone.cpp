@@ -164,8 +164,12 @@ ir_expression::clone(void *mem_ctx, struct hash_table *ht) const
       op[i] = this->operands[i]->clone(mem_ctx, ht);
    }
 
-   return new(mem_ctx) ir_expression(this->operation, this->type,
-				     op[0], op[1], op[2], op[3]);
+   ir_expression *expr =
+      new(mem_ctx) ir_expression(this->operation, this->type,
+                                 op[0], op[1], op[2], op[3]);
+   expr->precision = this->precision;
+
+   return expr;
 }
 
 ir_dereference_variable *
@@ -310,6 +314,7 @@ ir_function_signature::clone_prototype(void *mem_ctx, struct hash_table *ht) con
    ir_function_signature *copy =
       new(mem_ctx) ir_function_signature(this->return_type);
 
+   copy->return_precision = this->return_precision;
    copy->is_defined = false;
    copy->builtin_avail = this->builtin_avail;
    copy->origin = this;
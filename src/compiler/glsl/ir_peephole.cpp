@@ -0,0 +1,167 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_peephole.cpp
+ *
+ * Single-walk driver for the rules registered with ir_peephole.
+ */
+
+#include "ir_peephole.h"
+#include "ir_rvalue_visitor.h"
+
+/* A rule that keeps undoing another one would otherwise loop forever. */
+#define MAX_ROUNDS 16
+
+namespace {
+
+class ir_peephole_visitor : public ir_rvalue_visitor {
+public:
+   ir_peephole_visitor(ir_peephole *peephole)
+      : peephole(peephole), progress(false)
+   {
+   }
+
+   virtual void handle_rvalue(ir_rvalue **rvalue)
+   {
+      if (*rvalue != NULL && peephole->rewrite(rvalue))
+         progress = true;
+   }
+
+   virtual ir_visitor_status visit(ir_variable *ir)
+   {
+      peephole->visit(ir);
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      peephole->visit(ir);
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit(ir_constant *ir)
+   {
+      peephole->visit(ir);
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit(ir_loop_jump *ir)
+   {
+      peephole->visit(ir);
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit(ir_barrier *ir)
+   {
+      peephole->visit(ir);
+      return visit_continue;
+   }
+
+   ir_peephole *peephole;
+   bool progress;
+};
+
+} /* anonymous namespace */
+
+ir_peephole::ir_peephole()
+{
+   memset(num_rewrites, 0, sizeof(num_rewrites));
+   memset(num_visits, 0, sizeof(num_visits));
+}
+
+void
+ir_peephole::add_rewrite(enum ir_node_type type, ir_peephole_rewrite fn,
+                         void *data)
+{
+   assert(num_rewrites[type] < IR_PEEPHOLE_MAX_RULES);
+
+   struct rule *r = &rewrites[type][num_rewrites[type]++];
+   r->fn.rewrite = fn;
+   r->data = data;
+}
+
+void
+ir_peephole::add_visit(enum ir_node_type type, ir_peephole_visit fn,
+                       void *data)
+{
+   assert(type == ir_type_variable ||
+          type == ir_type_dereference_variable ||
+          type == ir_type_constant ||
+          type == ir_type_loop_jump ||
+          type == ir_type_barrier);
+   assert(num_visits[type] < IR_PEEPHOLE_MAX_RULES);
+
+   struct rule *r = &visits[type][num_visits[type]++];
+   r->fn.visit = fn;
+   r->data = data;
+}
+
+bool
+ir_peephole::rewrite(ir_rvalue **rvalue)
+{
+   bool progress = false;
+
+   for (unsigned round = 0; round < MAX_ROUNDS; round++) {
+      const enum ir_node_type type = (*rvalue)->ir_type;
+      bool changed = false;
+
+      for (unsigned i = 0; i < num_rewrites[type]; i++) {
+         const struct rule *r = &rewrites[type][i];
+
+         if (r->fn.rewrite(rvalue, r->data)) {
+            changed = true;
+
+            /* The slot may now hold a different kind of node. */
+            if ((*rvalue)->ir_type != type)
+               break;
+         }
+      }
+
+      if (!changed)
+         break;
+
+      progress = true;
+   }
+
+   return progress;
+}
+
+void
+ir_peephole::visit(ir_instruction *ir)
+{
+   const enum ir_node_type type = ir->ir_type;
+
+   for (unsigned i = 0; i < num_visits[type]; i++)
+      visits[type][i].fn.visit(ir, visits[type][i].data);
+}
+
+bool
+ir_peephole::run(exec_list *instructions)
+{
+   ir_peephole_visitor v(this);
+
+   visit_list_elements(&v, instructions);
+
+   return v.progress;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_peephole.h
+ *
+ * Framework for local rewrites that share a single walk of the IR.
+ *
+ * Passes register rewrite rules per rvalue node type.  ir_peephole::run()
+ * visits every rvalue slot once, children before parents, and keeps
+ * applying the rules registered for the node currently in the slot until
+ * none of them fires.  Several peephole passes can therefore be folded into
+ * one traversal that leaves each subtree at its local fixed point.
+ *
+ * Passes that only need to observe leaf nodes, such as dead variable
+ * detection, can register visit hooks that run during the same walk.
+ */
+
+#ifndef GLSL_IR_PEEPHOLE_H
+#define GLSL_IR_PEEPHOLE_H
+
+#include "ir.h"
+
+struct set;
+
+/**
+ * Rewrite the rvalue in \p rvalue in place or replace it
+ *
+ * \return true if anything changed.
+ */
+typedef bool (*ir_peephole_rewrite)(ir_rvalue **rvalue, void *data);
+
+/** Observe a leaf node */
+typedef void (*ir_peephole_visit)(ir_instruction *ir, void *data);
+
+#define IR_PEEPHOLE_MAX_RULES 4
+
+class ir_peephole {
+public:
+   ir_peephole();
+
+   /** Apply \p fn to every rvalue of type \p type */
+   void add_rewrite(enum ir_node_type type, ir_peephole_rewrite fn,
+                    void *data = NULL);
+
+   /**
+    * Call \p fn for every node of type \p type
+    *
+    * Only leaf types are supported: variables, variable dereferences,
+    * constants, loop jumps and barriers.
+    */
+   void add_visit(enum ir_node_type type, ir_peephole_visit fn,
+                  void *data = NULL);
+
+   /**
+    * Apply the rules to \p rvalue until none fires
+    *
+    * \return true if anything changed.
+    */
+   bool rewrite(ir_rvalue **rvalue);
+
+   void visit(ir_instruction *ir);
+
+   /** Walk \p instructions once, applying all rules and hooks */
+   bool run(exec_list *instructions);
+
+private:
+   struct rule {
+      union {
+         ir_peephole_rewrite rewrite;
+         ir_peephole_visit visit;
+      } fn;
+      void *data;
+   };
+
+   struct rule rewrites[ir_type_max][IR_PEEPHOLE_MAX_RULES];
+   uint8_t num_rewrites[ir_type_max];
+
+   struct rule visits[ir_type_max][IR_PEEPHOLE_MAX_RULES];
+   uint8_t num_visits[ir_type_max];
+};
+
+/**
+ * \name Rewrite rules provided by individual passes
+ */
+/*@{*/
+bool rewrite_vec_index_to_swizzle(ir_rvalue **rvalue, void *data);
+bool rewrite_swizzle_swizzle(ir_rvalue **rvalue, void *data);
+bool rewrite_noop_swizzle(ir_rvalue **rvalue, void *data);
+/*@}*/
+
+/**
+ * Tracks auto and temporary variables that are never dereferenced
+ *
+ * Registers hooks on \p peephole; once it has run, remove() deletes the
+ * declarations of the variables found to be unused.
+ */
+class ir_dead_variables {
+public:
+   ir_dead_variables(ir_peephole *peephole);
+   ~ir_dead_variables();
+
+   void remove();
+
+private:
+   struct set *variables;
+};
+
+#endif /* GLSL_IR_PEEPHOLE_H */
@@ -26,6 +26,7 @@
 #include "glsl_parser_extras.h"
 #include "main/macros.h"
 #include "util/hash_table.h"
+#include "util/half_float.h"
 #include "compiler/spirv/spirv.h"
 #include "compiler/spirv/GLSL.std.450.h"
 
@@ -65,53 +66,65 @@ static const unsigned int stage_type[] = {
 };
 
 binary_buffer::binary_buffer()
+   : buffer(inline_words), words(0), capacity(ARRAY_SIZE(inline_words))
 {
-   u_vector_init(&vector_buffer, sizeof(int), 1024);
 }
 
 binary_buffer::~binary_buffer()
 {
-   u_vector_finish(&vector_buffer);
+   if (buffer != inline_words)
+      free(buffer);
 }
 
-void binary_buffer::push(unsigned int value)
+void binary_buffer::grow(unsigned int n)
 {
-   int* buf = (int*)u_vector_add(&vector_buffer);
-   (*buf) = value;
+   unsigned int new_capacity = MAX2(capacity * 2, n);
+   unsigned int *new_buffer;
+
+   if (buffer == inline_words) {
+      new_buffer = (unsigned int *) malloc(new_capacity * sizeof(unsigned int));
+      if (new_buffer != NULL)
+         memcpy(new_buffer, inline_words, words * sizeof(unsigned int));
+   } else {
+      new_buffer = (unsigned int *) realloc(buffer, new_capacity * sizeof(unsigned int));
+   }
+
+   if (new_buffer == NULL) {
+      _mesa_error_no_memory(__func__);
+      abort();
+   }
+
+   buffer = new_buffer;
+   capacity = new_capacity;
 }
 
 void binary_buffer::push(const char* text)
 {
+   /* The terminator always gets a word of its own, or shares the last one. */
    size_t len = strlen(text);
-   while (len >= sizeof(int)) {
-      unsigned int value = 0;
-      memcpy(&value, text, sizeof(int));
-      push(value);
-      text += sizeof(int);
-      len -= sizeof(int);
-   }
-   unsigned int value = 0;
-   memcpy(&value, text, len);
-   push(value);
-}
+   unsigned int n = len / sizeof(unsigned int) + 1;
 
-unsigned int binary_buffer::count()
-{
-   return u_vector_length(&vector_buffer);
+   reserve(words + n);
+   buffer[words + n - 1] = 0;
+   memcpy(buffer + words, text, len);
+   words += n;
 }
 
-unsigned int* binary_buffer::data()
+void binary_buffer::push(const binary_buffer &other)
 {
-   return (unsigned int*)u_vector_tail(&vector_buffer);
+   push(other.buffer, other.words);
 }
 
-unsigned int binary_buffer::operator[] (size_t i)
+void binary_buffer::push(const unsigned int *values, unsigned int n)
 {
-   return data()[i];
+   reserve(words + n);
+   memcpy(buffer + words, values, n * sizeof(unsigned int));
+   words += n;
 }
 
 spirv_buffer::spirv_buffer()
 {
+   native_16bit = false;
 }
 
 spirv_buffer::~spirv_buffer()
@@ -137,6 +150,8 @@ _mesa_print_spirv(spirv_buffer *f, exec_list *instructions, gl_shader_stage stag
    f->bool_id = 0;
    memset(f->float_id, 0, sizeof(f->float_id));
    memset(f->int_id, 0, sizeof(f->int_id));
+   memset(f->float16_id, 0, sizeof(f->float16_id));
+   memset(f->int16_id, 0, sizeof(f->int16_id));
    memset(f->const_float_id, 0, sizeof(f->const_float_id));
    memset(f->const_int_id, 0, sizeof(f->const_int_id));
    memset(f->sampler_id, 0, sizeof(f->sampler_id));
@@ -150,6 +165,8 @@ _mesa_print_spirv(spirv_buffer *f, exec_list *instructions, gl_shader_stage stag
    f->input_loc = 0;
    f->output_loc = 0;
    f->descript_set_definition = descript_set_def;
+   f->float16_used = false;
+   f->int16_used = false;
 
    if (es) {
       if (stage == MESA_SHADER_FRAGMENT) {
@@ -198,9 +215,7 @@ _mesa_print_spirv(spirv_buffer *f, exec_list *instructions, gl_shader_stage stag
    if (uniforms_count != 0) {
       f->types.push(SpvOpTypeStruct | ((uniforms_count + 2) << SpvWordCountShift));
       f->types.push(f->uniform_struct_id);
-      for (unsigned int i = 0; i < f->uniforms.count(); ++i) {
-         f->types.push(f->uniforms[i]);
-      }
+      f->types.push(f->uniforms);
 
       f->types.push(SpvOpTypePointer | (4 << SpvWordCountShift));
       f->types.push(f->uniform_pointer_id);
@@ -228,6 +243,10 @@ _mesa_print_spirv(spirv_buffer *f, exec_list *instructions, gl_shader_stage stag
 
    // Header - Mesa-IR/SPIR-V Translator
    unsigned int bound_id = f->id++;
+   f->reserve(64 + f->extensions.count() + f->inouts.count() +
+              f->names.count() + f->decorates.count() + f->types.count() +
+              f->per_vertices.count() + f->builtins.count() +
+              f->functions.count());
    f->push(SpvMagicNumber);
    f->push(0x00010000);
    f->push(0x00100000);
@@ -237,19 +256,23 @@ _mesa_print_spirv(spirv_buffer *f, exec_list *instructions, gl_shader_stage stag
    // Capability
    f->push(SpvOpCapability | (2 << SpvWordCountShift));
    f->push(SpvCapabilityShader);
-
-   for (unsigned int i = 0; i < f->extensions.count(); ++i) {
-      f->push(f->extensions[i]);
+   if (f->float16_used) {
+      f->push(SpvOpCapability | (2 << SpvWordCountShift));
+      f->push(SpvCapabilityFloat16);
+   }
+   if (f->int16_used) {
+      f->push(SpvOpCapability | (2 << SpvWordCountShift));
+      f->push(SpvCapabilityInt16);
    }
 
+   f->push(f->extensions);
+
    // EntryPoint Fragment 4  "main" 20 22 37 43 46 49
    f->push(SpvOpEntryPoint | ((5 + f->inouts.count()) << SpvWordCountShift));
    f->push(stage_type[stage]);
    f->push(f->main_id);
    f->push("main");
-   for (unsigned int i = 0; i < f->inouts.count(); ++i) {
-      f->push(f->inouts[i]);
-   }
+   f->push(f->inouts);
 
    // ExecutionMode 4 OriginUpperLeft
    if (stage == MESA_SHADER_FRAGMENT) {
@@ -263,36 +286,24 @@ _mesa_print_spirv(spirv_buffer *f, exec_list *instructions, gl_shader_stage stag
    f->push(es ? SpvSourceLanguageESSL : SpvSourceLanguageGLSL);
    f->push(version);
 
-   for (unsigned int i = 0; i < f->names.count(); ++i) {
-      f->push(f->names[i]);
-   }
+   f->push(f->names);
 
-   for (unsigned int i = 0; i < f->decorates.count(); ++i) {
-      f->push(f->decorates[i]);
-   }
+   f->push(f->decorates);
 
-   for (unsigned int i = 0; i < f->types.count(); ++i) {
-      f->push(f->types[i]);
-   }
+   f->push(f->types);
 
    // gl_PerVertex
    unsigned int per_vertices_count = f->per_vertices.count();
    if (per_vertices_count != 0) {
       f->push(SpvOpTypeStruct | ((2 + per_vertices_count) << SpvWordCountShift));
       f->push(f->gl_per_vertex_id);
-      for (unsigned int i = 0; i < f->per_vertices.count(); ++i) {
-         f->push(f->per_vertices[i]);
-      }
+      f->push(f->per_vertices);
    }
 
    // Built-in
-   for (unsigned int i = 0; i < f->builtins.count(); ++i) {
-      f->push(f->builtins[i]);
-   }
+   f->push(f->builtins);
 
-   for (unsigned int i = 0; i < f->functions.count(); ++i) {
-      f->push(f->functions[i]);
-   }
+   f->push(f->functions);
 }
 
 } /* extern "C" */
@@ -302,10 +313,18 @@ ir_print_spirv_visitor::ir_print_spirv_visitor(spirv_buffer *f)
 {
    indentation = 0;
    unique_name_number = 0;
+   want_16bit = false;
+   loop_continue_id = 0;
+   loop_break_id = 0;
    printable_names =
       _mesa_hash_table_create(NULL, _mesa_hash_pointer, _mesa_key_pointer_equal);
    symbols = _mesa_symbol_table_ctor();
    mem_ctx = ralloc_context(NULL);
+
+   // Index 0 is never handed out, so freshly constructed nodes always miss
+   state_blocks = ralloc_array(mem_ctx, ir_state *, 1);
+   state_blocks[0] = rzalloc_array(mem_ctx, ir_state, STATE_BLOCK_SIZE);
+   state_count = 1;
 }
 
 ir_print_spirv_visitor::~ir_print_spirv_visitor()
@@ -315,6 +334,30 @@ ir_print_spirv_visitor::~ir_print_spirv_visitor()
    ralloc_free(mem_ctx);
 }
 
+ir_print_spirv_visitor::ir_state &
+ir_print_spirv_visitor::state(ir_instruction *ir)
+{
+   unsigned int index = ir->table_index;
+   if (index < state_count) {
+      ir_state &s = state_blocks[index / STATE_BLOCK_SIZE][index % STATE_BLOCK_SIZE];
+      if (s.node == ir)
+         return s;
+   }
+
+   // First touch during this emission: number the node
+   index = state_count++;
+   if (index % STATE_BLOCK_SIZE == 0) {
+      state_blocks = reralloc(mem_ctx, state_blocks, ir_state *, index / STATE_BLOCK_SIZE + 1);
+      state_blocks[index / STATE_BLOCK_SIZE] = rzalloc_array(mem_ctx, ir_state, STATE_BLOCK_SIZE);
+   }
+   ir->table_index = index;
+
+   // Blocks never move, so references stay valid while new nodes are added
+   ir_state &s = state_blocks[index / STATE_BLOCK_SIZE][index % STATE_BLOCK_SIZE];
+   s.node = ir;
+   return s;
+}
+
 unsigned int
 ir_print_spirv_visitor::unique_name(ir_variable *var)
 {
@@ -350,7 +393,7 @@ ir_print_spirv_visitor::unique_name(ir_variable *var)
    f->names.push(SpvOpName | ((count + 2) << SpvWordCountShift));
    f->names.push(name_id);
    f->names.push(name);
-   var->ir_pointer = name_id;
+   state(var).pointer = name_id;
 
    _mesa_hash_table_insert(this->printable_names, var, (void *)(intptr_t) name_id);
    _mesa_symbol_table_add_symbol(this->symbols, name, var);
@@ -433,7 +476,6 @@ unsigned int ir_print_spirv_visitor::visit_type(const struct glsl_type *type)
    } else if (type->is_array()) {
 
       ir_constant ir_array_size(type->array_size());
-      ir_array_size.ir_value = 0;
       visit(&ir_array_size);
 
       unsigned int base_type_id = visit_type(type->fields.array);
@@ -441,7 +483,7 @@ unsigned int ir_print_spirv_visitor::visit_type(const struct glsl_type *type)
       f->types.push(SpvOpTypeArray | (4 << SpvWordCountShift));
       f->types.push(vector_id);
       f->types.push(base_type_id);
-      f->types.push(ir_array_size.ir_value);
+      f->types.push(state(&ir_array_size).value);
 
       f->decorates.push(SpvOpDecorate | (4 << SpvWordCountShift));
       f->decorates.push(vector_id);
@@ -611,10 +653,10 @@ unsigned int ir_print_spirv_visitor::visit_type_pointer(const struct glsl_type *
 
 void ir_print_spirv_visitor::visit_value(ir_rvalue *ir)
 {
-   if (ir->ir_value == 0) {
-      if (ir->ir_pointer == 0 && ir->ir_uniform) {
-         ir_constant ir_uniform(ir->ir_uniform - 1);
-         ir_uniform.ir_value = 0;
+   ir_state &ir_st = state(ir);
+   if (ir_st.value == 0) {
+      if (ir_st.pointer == 0 && ir_st.uniform) {
+         ir_constant ir_uniform(ir_st.uniform - 1);
          visit(&ir_uniform);
 
          unsigned int uniform_type = visit_type(ir->type);
@@ -625,19 +667,20 @@ void ir_print_spirv_visitor::visit_value(ir_rvalue *ir)
          f->functions.push(type_pointer_id);
          f->functions.push(pointer_id);
          f->functions.push(f->uniform_id);
-         f->functions.push(ir_uniform.ir_value);
+         f->functions.push(state(&ir_uniform).value);
 
-         ir->ir_pointer = pointer_id;
+         ir_st.pointer = pointer_id;
       }
-      if (ir->ir_pointer != 0) {
+      if (ir_st.pointer != 0) {
          unsigned int type_id = visit_type(ir->type);
          unsigned int value_id = f->id++;
          f->functions.push(SpvOpLoad | (4 << SpvWordCountShift));
          f->functions.push(type_id);
          f->functions.push(value_id);
-         f->functions.push(ir->ir_pointer);
-         ir->ir_value = value_id;
-         visit_precision(ir->ir_value, ir->type->base_type, GLSL_PRECISION_NONE);
+         f->functions.push(ir_st.pointer);
+         ir_st.value = value_id;
+         ir_variable *var = ir->variable_referenced();
+         visit_precision(value_id, ir->type->base_type, var ? (glsl_precision) var->data.precision : GLSL_PRECISION_NONE);
       }
    }
 }
@@ -649,14 +692,18 @@ void ir_print_spirv_visitor::visit_precision(unsigned int id, unsigned int type,
       break;
    case GLSL_TYPE_UINT:
    case GLSL_TYPE_INT:
-      if (precision == GLSL_PRECISION_MEDIUM || f->precision_int == GLSL_PRECISION_MEDIUM) {
+      if (precision == GLSL_PRECISION_NONE)
+         precision = f->precision_int;
+      if (precision == GLSL_PRECISION_MEDIUM || precision == GLSL_PRECISION_LOW) {
          f->decorates.push(SpvOpDecorate | (3 << SpvWordCountShift));
          f->decorates.push(id);
          f->decorates.push(SpvDecorationRelaxedPrecision);
       }
       break;
    case GLSL_TYPE_FLOAT:
-      if (precision == GLSL_PRECISION_MEDIUM || f->precision_float == GLSL_PRECISION_MEDIUM) {
+      if (precision == GLSL_PRECISION_NONE)
+         precision = f->precision_float;
+      if (precision == GLSL_PRECISION_MEDIUM || precision == GLSL_PRECISION_LOW) {
          f->decorates.push(SpvOpDecorate | (3 << SpvWordCountShift));
          f->decorates.push(id);
          f->decorates.push(SpvDecorationRelaxedPrecision);
@@ -665,8 +712,202 @@ void ir_print_spirv_visitor::visit_precision(unsigned int id, unsigned int type,
    }
 }
 
+unsigned int ir_print_spirv_visitor::visit_type_16bit(const struct glsl_type *type)
+{
+   unsigned int* ids;
+   if (type->is_float()) {
+      ids = f->float16_id;
+   } else if (type->base_type == GLSL_TYPE_INT) {
+      ids = f->int16_id;
+   } else {
+      unreachable("no 16-bit type");
+   }
+
+   if (ids[0] == 0) {
+      ids[0] = f->id++;
+      if (type->is_float()) {
+         f->types.push(SpvOpTypeFloat | (3 << SpvWordCountShift));
+         f->types.push(ids[0]);
+         f->types.push(16u);
+         f->float16_used = true;
+      } else {
+         f->types.push(SpvOpTypeInt | (4 << SpvWordCountShift));
+         f->types.push(ids[0]);
+         f->types.push(16u);
+         f->types.push(1u);
+         f->int16_used = true;
+      }
+   }
+   unsigned int component = type->vector_elements;
+   if (component > 1 && ids[component - 1] == 0) {
+      ids[component - 1] = f->id++;
+      f->types.push(SpvOpTypeVector | (4 << SpvWordCountShift));
+      f->types.push(ids[component - 1]);
+      f->types.push(ids[0]);
+      f->types.push(component);
+   }
+   return ids[component - 1];
+}
+
+static bool
+fits_16bit(ir_constant *ir)
+{
+   for (unsigned int i = 0; i < ir->type->components(); ++i) {
+      switch (ir->type->base_type) {
+      case GLSL_TYPE_FLOAT:
+         if (!(fabsf(ir->value.f[i]) <= 65504.0f))
+            return false;
+         break;
+      case GLSL_TYPE_INT:
+         if (ir->value.i[i] < -32768 || ir->value.i[i] > 32767)
+            return false;
+         break;
+      default:
+         return false;
+      }
+   }
+   return true;
+}
+
+// Whether the expression is evaluated with float16/int16 types
+bool ir_print_spirv_visitor::is_16bit(ir_expression *ir)
+{
+   if (!f->native_16bit)
+      return false;
+
+   if (!ir->type->is_scalar() && !ir->type->is_vector())
+      return false;
+
+   unsigned int precision = ir->precision;
+   switch (ir->type->base_type) {
+   default:
+      return false;
+   case GLSL_TYPE_FLOAT:
+      if (precision == GLSL_PRECISION_NONE)
+         precision = f->precision_float;
+      switch (ir->operation) {
+      default:
+         return false;
+      case ir_unop_neg:
+      case ir_unop_abs:
+      case ir_unop_sign:
+      case ir_unop_rsq:
+      case ir_unop_sqrt:
+      case ir_unop_normalize:
+      case ir_unop_exp:
+      case ir_unop_log:
+      case ir_unop_exp2:
+      case ir_unop_log2:
+      case ir_unop_trunc:
+      case ir_unop_ceil:
+      case ir_unop_floor:
+      case ir_unop_fract:
+      case ir_unop_round_even:
+      case ir_unop_sin:
+      case ir_unop_cos:
+      case ir_binop_add:
+      case ir_binop_sub:
+      case ir_binop_mul:
+      case ir_binop_div:
+      case ir_binop_min:
+      case ir_binop_max:
+      case ir_binop_pow:
+      case ir_binop_dot:
+      case ir_triop_fma:
+      case ir_triop_lrp:
+         break;
+      }
+      break;
+   case GLSL_TYPE_INT:
+      if (precision == GLSL_PRECISION_NONE)
+         precision = f->precision_int;
+      switch (ir->operation) {
+      default:
+         return false;
+      case ir_unop_neg:
+      case ir_unop_abs:
+      case ir_unop_sign:
+      case ir_binop_add:
+      case ir_binop_sub:
+      case ir_binop_mul:
+      case ir_binop_min:
+      case ir_binop_max:
+         break;
+      }
+      break;
+   }
+
+   if (precision != GLSL_PRECISION_MEDIUM && precision != GLSL_PRECISION_LOW)
+      return false;
+
+   for (unsigned int i = 0; i < ir->get_num_operands(); ++i) {
+      const glsl_type *type = ir->operands[i]->type;
+      if (type->base_type != ir->type->base_type)
+         return false;
+      if (!type->is_scalar() && !type->is_vector())
+         return false;
+      ir_constant *constant = ir->operands[i]->as_constant();
+      if (constant && !fits_16bit(constant))
+         return false;
+   }
+
+   return true;
+}
+
+unsigned int ir_print_spirv_visitor::convert_16bit(unsigned int value_id, const struct glsl_type *type, bool to_16bit)
+{
+   unsigned int type_id = to_16bit ? visit_type_16bit(type) : visit_type(type);
+   unsigned int convert_id = f->id++;
+   f->functions.push((type->is_float() ? SpvOpFConvert : SpvOpSConvert) | (4 << SpvWordCountShift));
+   f->functions.push(type_id);
+   f->functions.push(convert_id);
+   f->functions.push(value_id);
+   return convert_id;
+}
+
+// 16-bit value of an operand of a 16-bit expression
+unsigned int ir_print_spirv_visitor::value_16bit(ir_rvalue *ir)
+{
+   ir_state &ir_st = state(ir);
+
+   ir_expression *expr = ir->as_expression();
+   if (expr && is_16bit(expr))
+      return ir_st.value;
+
+   ir_constant *constant = ir->as_constant();
+   if (constant == NULL)
+      return convert_16bit(ir_st.value, ir->type, true);
+
+   unsigned int scalar_type_id = visit_type_16bit(constant->type->get_scalar_type());
+   binary_buffer ids;
+   for (unsigned int i = 0; i < constant->type->components(); ++i) {
+      unsigned int constant_id = f->id++;
+      f->types.push(SpvOpConstant | (4 << SpvWordCountShift));
+      f->types.push(scalar_type_id);
+      f->types.push(constant_id);
+      if (constant->type->is_float()) {
+         f->types.push((unsigned int)_mesa_float_to_half(constant->value.f[i]));
+      } else {
+         // Signed literals narrower than 32 bits are sign-extended
+         f->types.push((unsigned int)(int)(int16_t)constant->value.i[i]);
+      }
+      ids.push(constant_id);
+   }
+   if (ids.count() == 1)
+      return ids[0];
+
+   unsigned int value_id = f->id++;
+   f->types.push(SpvOpConstantComposite | ((3 + ids.count()) << SpvWordCountShift));
+   f->types.push(visit_type_16bit(constant->type));
+   f->types.push(value_id);
+   f->types.push(ids);
+   return value_id;
+}
+
 void ir_print_spirv_visitor::visit(ir_variable *ir)
 {
+   ir_state &ir_st = state(ir);
+
    if (is_gl_identifier(ir->name))
       return;
 
@@ -787,7 +1028,7 @@ void ir_print_spirv_visitor::visit(ir_variable *ir)
             f->decorates.push(ir->type->vector_elements * 4);
          }
 
-         ir->ir_uniform = f->uniforms.count();
+         ir_st.uniform = f->uniforms.count();
 
          f->uniforms.push(type_id);
          
@@ -920,7 +1161,7 @@ void ir_print_spirv_visitor::visit(ir_variable *ir)
          f->decorates.push(SpvDecorationBinding);
          f->decorates.push(f->binding_id);
 
-         ir->ir_pointer = pointer_id;
+         ir_st.pointer = pointer_id;
       }
 
    } else {
@@ -965,23 +1206,57 @@ void ir_print_spirv_visitor::visit(ir_variable *ir)
    }
 }
 
+unsigned int ir_print_spirv_visitor::visit_function_type(ir_function_signature *ir)
+{
+   binary_buffer signature_id;
+   signature_id.push(visit_type(ir->return_type));
+   foreach_in_list(ir_variable, param, &ir->parameters) {
+      signature_id.push(visit_type(param->type));
+   }
+
+   const unsigned int count = signature_id.count();
+   const unsigned int *types = f->function_types.data();
+   for (unsigned int i = 0; i < f->function_types.count(); i += 2 + types[i + 1]) {
+      if (types[i + 1] == count &&
+          memcmp(&types[i + 2], signature_id.data(), count * sizeof(unsigned int)) == 0) {
+         return types[i];
+      }
+   }
+
+   unsigned int type_id = f->id++;
+   f->types.push(SpvOpTypeFunction | ((2 + count) << SpvWordCountShift));
+   f->types.push(type_id);
+   f->types.push(signature_id);
+
+   f->function_types.push(type_id);
+   f->function_types.push(count);
+   f->function_types.push(signature_id);
+
+   return type_id;
+}
+
+unsigned int ir_print_spirv_visitor::function_id(ir_function_signature *ir)
+{
+   // Calls may reference a function before its definition is visited
+   ir_state &ir_st = state(ir);
+   if (ir_st.value == 0) {
+      ir_st.value = f->id++;
+   }
+   return ir_st.value;
+}
+
 void ir_print_spirv_visitor::visit(ir_function_signature *ir)
 {
    // TypeVoid
    unsigned int type_id = visit_type(ir->return_type);
 
    // TypeFunction
-   unsigned int function_id = f->id++;
-   f->types.push(SpvOpTypeFunction | (3 << SpvWordCountShift));
-   f->types.push(function_id);
-   f->types.push(type_id);
+   unsigned int function_type_id = visit_function_type(ir);
 
    // TypeName
-   unsigned int function_name_id = 0;
+   unsigned int function_name_id = function_id(ir);
    if (stricmp(ir->function_name(), "main") == 0) {
-      function_name_id = f->main_id = f->id++;
-   } else {
-      function_name_id = f->id++;
+      f->main_id = function_name_id;
    }
    unsigned int len = (int)strlen(ir->function_name());
    unsigned int count = (len + sizeof(int)) / sizeof(int);
@@ -992,15 +1267,34 @@ void ir_print_spirv_visitor::visit(ir_function_signature *ir)
    f->functions.push(type_id);
    f->functions.push(function_name_id);
    f->functions.push(SpvFunctionControlMaskNone);
-   f->functions.push(function_id);
+   f->functions.push(function_type_id);
+
+   // FunctionParameter
+   foreach_in_list(ir_variable, param, &ir->parameters) {
+      unsigned int param_id = f->id++;
+      state(param).value = param_id;
+      f->functions.push(SpvOpFunctionParameter | (3 << SpvWordCountShift));
+      f->functions.push(visit_type(param->type));
+      f->functions.push(param_id);
+   }
 
    // Label
    unsigned int label_id = f->id++;
    f->functions.push(SpvOpLabel | (2 << SpvWordCountShift));
    f->functions.push(label_id);
 
-   foreach_in_list(ir_variable, inst, &ir->parameters) {
-      inst->accept(this);
+   // Parameters are copied into function variables, so the body can load
+   // and store them like any other local.
+   foreach_in_list(ir_variable, param, &ir->parameters) {
+      unsigned int param_type_id = visit_type(param->type);
+      unsigned int pointer_id = visit_type_pointer(param->type, ir_var_auto, param_type_id);
+      unsigned int name_id = unique_name(param);
+
+      f->functions.push(SpvOpVariable | (4 << SpvWordCountShift));
+      f->functions.push(pointer_id);
+      f->functions.push(name_id);
+      f->functions.push(SpvStorageClassFunction);
+      visit_precision(name_id, param->type->base_type, param->data.precision);
    }
 
    // Variable
@@ -1010,6 +1304,13 @@ void ir_print_spirv_visitor::visit(ir_function_signature *ir)
       }
    }
 
+   foreach_in_list(ir_variable, param, &ir->parameters) {
+      const ir_state &param_st = state(param);
+      f->functions.push(SpvOpStore | (3 << SpvWordCountShift));
+      f->functions.push(param_st.pointer);
+      f->functions.push(param_st.value);
+   }
+
    foreach_in_list(ir_instruction, inst, &ir->body) {
       if (inst->as_variable() == NULL) {
          inst->accept(this);
@@ -1017,7 +1318,11 @@ void ir_print_spirv_visitor::visit(ir_function_signature *ir)
    }
 
    // Return
-   f->functions.push(SpvOpReturn | (1 << SpvWordCountShift));
+   if (ir->return_type->is_void()) {
+      f->functions.push(SpvOpReturn | (1 << SpvWordCountShift));
+   } else {
+      f->functions.push(SpvOpUnreachable | (1 << SpvWordCountShift));
+   }
 
    // FunctionEnd
    f->functions.push(SpvOpFunctionEnd | (1 << SpvWordCountShift));
@@ -1032,17 +1337,26 @@ void ir_print_spirv_visitor::visit(ir_function *ir)
 
 void ir_print_spirv_visitor::visit(ir_expression *ir)
 {
+   ir_state &ir_st = state(ir);
+
    unsigned int operands[4] = {};
 
+   // The consumer takes a 16-bit result if this is evaluated in 16-bit
+   bool result_16bit = want_16bit;
+   bool half = is_16bit(ir);
+   want_16bit = false;
+
    for (unsigned int i = 0; i < ir->get_num_operands(); ++i) {
       if (ir->operands[i] == NULL)
          return;
+      want_16bit = half && ir->operands[i]->as_expression();
       ir->operands[i]->accept(this);
+      want_16bit = false;
       visit_value(ir->operands[i]);
-      operands[i] = ir->operands[i]->ir_value;
+      operands[i] = half ? value_16bit(ir->operands[i]) : state(ir->operands[i]).value;
    }
 
-   unsigned int type_id = visit_type(ir->type);
+   unsigned int type_id = half ? visit_type_16bit(ir->type) : visit_type(ir->type);
    bool float_type;
    bool signed_type;
    switch (ir->type->base_type)
@@ -1071,8 +1385,6 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
 
       ir_constant zero_ir(0.0f);
       ir_constant one_ir(1.0f);
-      zero_ir.ir_value = 0;
-      one_ir.ir_value = 0;
       visit(&zero_ir);
       visit(&one_ir);
 
@@ -1083,9 +1395,9 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
       f->functions.push(f->import_id);
       f->functions.push(float_type ? GLSLstd450FClamp : signed_type ? GLSLstd450SClamp : GLSLstd450UClamp);
       f->functions.push(operands[0]);
-      f->functions.push(zero_ir.ir_value);
-      f->functions.push(one_ir.ir_value);
-      ir->ir_value = value_id;
+      f->functions.push(state(&zero_ir).value);
+      f->functions.push(state(&one_ir).value);
+      ir_st.value = value_id;
    } else if (ir->operation == ir_binop_mul) {
       if (ir->get_num_operands() != 2)
          return;
@@ -1096,12 +1408,14 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
             f->functions.push((float_type ? SpvOpFMul : SpvOpIMul) | (5 << SpvWordCountShift));
          } else if (ir->operands[1]->type->is_vector()) {
             f->functions.push(SpvOpVectorTimesScalar | (5 << SpvWordCountShift));
-            operands[0] = ir->operands[1]->ir_value;
-            operands[1] = ir->operands[0]->ir_value;
+            unsigned int scalar_id = operands[0];
+            operands[0] = operands[1];
+            operands[1] = scalar_id;
          } else if (ir->operands[1]->type->is_matrix()) {
             f->functions.push(SpvOpMatrixTimesScalar | (5 << SpvWordCountShift));
-            operands[0] = ir->operands[1]->ir_value;
-            operands[1] = ir->operands[0]->ir_value;
+            unsigned int scalar_id = operands[0];
+            operands[0] = operands[1];
+            operands[1] = scalar_id;
          } else {
             unreachable("unknown multiply operation");
          }
@@ -1132,7 +1446,7 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
       f->functions.push(value_id);
       f->functions.push(operands[0]);
       f->functions.push(operands[1]);
-      ir->ir_value = value_id;
+      ir_st.value = value_id;
    } else if (ir->operation >= ir_unop_bit_not && ir->operation <= ir_unop_vote_eq) {
       if (ir->get_num_operands() != 1)
          return;
@@ -1148,13 +1462,12 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
          break;
       case ir_unop_rcp: {
          ir_constant ir(1.0f);
-         ir.ir_value = 0;
          visit(&ir);
 
          f->functions.push((float_type ? SpvOpFDiv : signed_type ? SpvOpSDiv : SpvOpUDiv) | (5 << SpvWordCountShift));
          f->functions.push(type_id);
          f->functions.push(value_id);
-         f->functions.push(ir.ir_value);
+         f->functions.push(state(&ir).value);
          break;
       }
       case ir_unop_abs:
@@ -1217,7 +1530,46 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
          break;
       }
       f->functions.push(operands[0]);
-      ir->ir_value = value_id;
+      ir_st.value = value_id;
+   } else if (ir->operation == ir_binop_lshift || ir->operation == ir_binop_rshift ||
+              ir->operation == ir_binop_bit_and || ir->operation == ir_binop_bit_xor ||
+              ir->operation == ir_binop_bit_or) {
+      if (ir->get_num_operands() != 2)
+         return;
+
+      // SPIR-V wants both operands with the component count of the result
+      for (unsigned int i = 0; i < 2; ++i) {
+         if (ir->operands[i]->type->components() == ir->type->components())
+            continue;
+         if (ir->operands[i]->type->components() != 1)
+            unreachable("operands must match result or be scalar");
+
+         const glsl_type *vector_type = glsl_type::get_instance(ir->operands[i]->type->base_type, ir->type->vector_elements, 1);
+         unsigned int vector_type_id = visit_type(vector_type);
+         unsigned int scalar_id = operands[i];
+         operands[i] = f->id++;
+         f->functions.push(SpvOpCompositeConstruct | ((3 + ir->type->components()) << SpvWordCountShift));
+         f->functions.push(vector_type_id);
+         f->functions.push(operands[i]);
+         for (unsigned int j = 0; j < ir->type->components(); ++j) {
+            f->functions.push(scalar_id);
+         }
+      }
+
+      unsigned int value_id = f->id++;
+      switch (ir->operation) {
+      default:
+      case ir_binop_lshift:  f->functions.push(SpvOpShiftLeftLogical | (5 << SpvWordCountShift));                                              break;
+      case ir_binop_rshift:  f->functions.push((signed_type ? SpvOpShiftRightArithmetic : SpvOpShiftRightLogical) | (5 << SpvWordCountShift));  break;
+      case ir_binop_bit_and: f->functions.push(SpvOpBitwiseAnd | (5 << SpvWordCountShift));                                                    break;
+      case ir_binop_bit_xor: f->functions.push(SpvOpBitwiseXor | (5 << SpvWordCountShift));                                                    break;
+      case ir_binop_bit_or:  f->functions.push(SpvOpBitwiseOr | (5 << SpvWordCountShift));                                                     break;
+      }
+      f->functions.push(type_id);
+      f->functions.push(value_id);
+      f->functions.push(operands[0]);
+      f->functions.push(operands[1]);
+      ir_st.value = value_id;
    } else if (ir->operation >= ir_binop_add && ir->operation <= ir_binop_interpolate_at_sample) {
       if (ir->get_num_operands() != 2)
          return;
@@ -1273,21 +1625,22 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
       }
       f->functions.push(operands[0]);
       f->functions.push(operands[1]);
-      ir->ir_value = value_id;
+      ir_st.value = value_id;
    } else if (ir->operation >= ir_triop_fma && ir->operation <= ir_triop_vector_insert) {
       if (ir->get_num_operands() != 3)
          return;
 
       for (unsigned int i = 0; i < 3; ++i) {
          if (ir->operands[i]->type == ir->type) {
-            operands[i] = ir->operands[i]->ir_value;
+            continue;
          } else if (ir->operands[i]->type->components() == 1) {
+            unsigned int scalar_id = operands[i];
             operands[i] = f->id++;
             f->functions.push(SpvOpCompositeConstruct | ((3 + ir->type->components()) << SpvWordCountShift));
             f->functions.push(type_id);
             f->functions.push(operands[i]);
             for (unsigned int j = 0; j < ir->type->components(); ++j) {
-               f->functions.push(ir->operands[i]->ir_value);
+               f->functions.push(scalar_id);
             }
          } else {
             unreachable("operands must match result or be scalar");
@@ -1314,10 +1667,17 @@ void ir_print_spirv_visitor::visit(ir_expression *ir)
       f->functions.push(operands[0]);
       f->functions.push(operands[1]);
       f->functions.push(operands[2]);
-      ir->ir_value = value_id;
+      ir_st.value = value_id;
+   }
+
+   if (half) {
+      // 16-bit values are reduced precision by construction
+      if (result_16bit)
+         return;
+      ir_st.value = convert_16bit(ir_st.value, ir->type, false);
    }
 
-   visit_precision(ir->ir_value, ir->type->base_type, GLSL_PRECISION_NONE);
+   visit_precision(ir_st.value, ir->type->base_type, ir->precision);
 }
 
 void ir_print_spirv_visitor::visit(ir_texture *ir)
@@ -1332,18 +1692,18 @@ void ir_print_spirv_visitor::visit(ir_texture *ir)
 
    ir->sampler->accept(this);
    visit_value(ir->sampler);
-   ids.push(ir->sampler->ir_value);
+   ids.push(state(ir->sampler).value);
 
    if (ir->op != ir_txs && ir->op != ir_query_levels && ir->op != ir_texture_samples) {
 
       ir->coordinate->accept(this);
       visit_value(ir->coordinate);
-      ids.push(ir->coordinate->ir_value);
+      ids.push(state(ir->coordinate).value);
 
       if (ir->offset != NULL) {
          ir->offset->accept(this);
          visit_value(ir->offset);
-         ids.push(ir->offset->ir_value);
+         ids.push(state(ir->offset).value);
       }
    }
 
@@ -1352,7 +1712,7 @@ void ir_print_spirv_visitor::visit(ir_texture *ir)
       if (ir->projector) {
          ir->projector->accept(this);
          visit_value(ir->projector);
-         ids.push(ir->projector->ir_value);
+         ids.push(state(ir->projector).value);
       }
    }
 
@@ -1366,32 +1726,32 @@ void ir_print_spirv_visitor::visit(ir_texture *ir)
    case ir_txb:
       ir->lod_info.bias->accept(this);
       visit_value(ir->lod_info.bias);
-      ids.push(ir->lod_info.bias->ir_value);
+      ids.push(state(ir->lod_info.bias).value);
       break;
    case ir_txl:
    case ir_txf:
    case ir_txs:
       ir->lod_info.lod->accept(this);
       visit_value(ir->lod_info.lod);
-      ids.push(ir->lod_info.lod->ir_value);
+      ids.push(state(ir->lod_info.lod).value);
       break;
    case ir_txf_ms:
       ir->lod_info.sample_index->accept(this);
       visit_value(ir->lod_info.sample_index);
-      ids.push(ir->lod_info.sample_index->ir_value);
+      ids.push(state(ir->lod_info.sample_index).value);
       break;
    case ir_txd:
       ir->lod_info.grad.dPdx->accept(this);
       ir->lod_info.grad.dPdy->accept(this);
       visit_value(ir->lod_info.grad.dPdx);
       visit_value(ir->lod_info.grad.dPdy);
-      ids.push(ir->lod_info.grad.dPdx->ir_value);
-      ids.push(ir->lod_info.grad.dPdy->ir_value);
+      ids.push(state(ir->lod_info.grad.dPdx).value);
+      ids.push(state(ir->lod_info.grad.dPdy).value);
       break;
    case ir_tg4:
       ir->lod_info.component->accept(this);
       visit_value(ir->lod_info.component);
-      ids.push(ir->lod_info.component->ir_value);
+      ids.push(state(ir->lod_info.component).value);
       break;
    case ir_samples_identical:
       unreachable("ir_samples_identical was already handled");
@@ -1407,10 +1767,8 @@ void ir_print_spirv_visitor::visit(ir_texture *ir)
       f->functions.push(op_id | ((3 + ids.count()) << SpvWordCountShift));
       f->functions.push(type_id);
       f->functions.push(result_id);
-      for (unsigned int i = 0; i < ids.count(); ++i) {
-         f->functions.push(ids[i]);
-      }
-      ir->ir_value = result_id;
+      f->functions.push(ids);
+      state(ir).value = result_id;
 #if 0
       const ir_dereference_variable* var = ir->sampler->as_dereference_variable();
       if (var && var->var->data.precision == GLSL_PRECISION_MEDIUM) {
@@ -1435,13 +1793,32 @@ void ir_print_spirv_visitor::visit(ir_texture *ir)
 
 void ir_print_spirv_visitor::visit(ir_swizzle *ir)
 {
+   ir_state &ir_st = state(ir);
+
    ir->val->accept(this);
 
    visit_value(ir->val);
 
+   unsigned int source_id = state(ir->val).value;
+   if (ir->val->type->is_scalar() && ir->mask.num_components == 1) {
+      ir_st.value = source_id;
+      return;
+   }
+
    unsigned int type_id = visit_type(ir->type);
    unsigned int value_id = f->id++;
-   unsigned int source_id = ir->val->ir_value;
+
+   if (ir->val->type->is_scalar()) {
+      // Broadcast a scalar
+      f->functions.push(SpvOpCompositeConstruct | ((3 + ir->mask.num_components) << SpvWordCountShift));
+      f->functions.push(type_id);
+      f->functions.push(value_id);
+      for (unsigned int i = 0; i < ir->mask.num_components; ++i) {
+         f->functions.push(source_id);
+      }
+      ir_st.value = value_id;
+      return;
+   }
 
    if (ir->mask.num_components == 1) {
       f->functions.push(SpvOpCompositeExtract | 5 << SpvWordCountShift);
@@ -1449,7 +1826,7 @@ void ir_print_spirv_visitor::visit(ir_swizzle *ir)
       f->functions.push(value_id);
       f->functions.push(source_id);
       f->functions.push(ir->mask.x);
-      ir->ir_value = value_id;
+      ir_st.value = value_id;
       return;
    }
 
@@ -1466,21 +1843,23 @@ void ir_print_spirv_visitor::visit(ir_swizzle *ir)
       f->functions.push(ir->mask.z);
    if (ir->mask.num_components >= 4)
       f->functions.push(ir->mask.w);
-   ir->ir_value = value_id;
+   ir_st.value = value_id;
 }
 
 void ir_print_spirv_visitor::visit(ir_dereference_variable *ir)
 {
    ir_variable *var = ir->variable_referenced();
+   ir_state &ir_st = state(ir);
+   ir_state &var_st = state(var);
 
    switch (var->data.mode) {
    case ir_var_uniform:
       unique_name(var);
       if (var->type->is_sampler() == false) {
-         ir->ir_uniform = var->ir_uniform + 1;
+         ir_st.uniform = var_st.uniform + 1;
          break;
       }
-      ir->ir_pointer = var->ir_pointer;
+      ir_st.pointer = var_st.pointer;
       break;
    case ir_var_shader_out:
       if (f->shader_stage != MESA_SHADER_FRAGMENT && is_gl_identifier(var->name)) {
@@ -1498,7 +1877,7 @@ void ir_print_spirv_visitor::visit(ir_dereference_variable *ir)
             f->decorates.push(SpvDecorationBlock);
          }
 
-         if (var->ir_initialized == 0) {
+         if (var_st.initialized == 0) {
 
             const glsl_type* type;
             SpvBuiltIn built_in;
@@ -1556,18 +1935,18 @@ void ir_print_spirv_visitor::visit(ir_dereference_variable *ir)
             f->functions.push(variable_id);
             f->functions.push(constant_id);
 
-            var->ir_initialized = pointer_id;
+            var_st.initialized = pointer_id;
          }
 
-         ir->ir_pointer = var->ir_initialized;
+         ir_st.pointer = var_st.initialized;
          break;
       }
       unique_name(var);
-      ir->ir_pointer = var->ir_pointer;
+      ir_st.pointer = var_st.pointer;
       break;
    case ir_var_system_value:
       unique_name(var);
-      if (var->ir_initialized == 0) {
+      if (var_st.initialized == 0) {
 
          SpvBuiltIn built_in;
          if (strcmp(var->name, "gl_VertexIndex") == 0) {
@@ -1579,45 +1958,48 @@ void ir_print_spirv_visitor::visit(ir_dereference_variable *ir)
          }
 
          f->decorates.push(SpvOpDecorate | (4 << SpvWordCountShift));
-         f->decorates.push(var->ir_pointer);
+         f->decorates.push(var_st.pointer);
          f->decorates.push(SpvDecorationBuiltIn);
          f->decorates.push(built_in);
 
          unsigned int type_id = visit_type(var->type);
          unsigned int type_pointer_id = visit_type_pointer(var->type, var->data.mode, type_id);
-         unsigned int pointer_id = var->ir_pointer;
+         unsigned int pointer_id = var_st.pointer;
          f->types.push(SpvOpVariable | (4 << SpvWordCountShift));
          f->types.push(type_pointer_id);
          f->types.push(pointer_id);
          f->types.push(SpvStorageClassInput);
 
-         var->ir_initialized = pointer_id;
+         var_st.initialized = pointer_id;
       }
-      ir->ir_pointer = var->ir_initialized;
+      ir_st.pointer = var_st.initialized;
       break;
    case ir_var_shader_storage:
       unique_name(var);
-      if (var->ir_initialized == 0) {
+      if (var_st.initialized == 0) {
 
          unsigned int pointer_id = f->id++;
          f->types.push(SpvOpVariable | (4 << SpvWordCountShift));
-         f->types.push(var->ir_pointer);
+         f->types.push(var_st.pointer);
          f->types.push(pointer_id);
          f->types.push(storage_mode[var->data.mode]);
 
-         var->ir_initialized = pointer_id;
+         var_st.initialized = pointer_id;
       }
-      ir->ir_pointer = var->ir_initialized;
+      ir_st.pointer = var_st.initialized;
       break;
    default:
       unique_name(var);
-      ir->ir_pointer = var->ir_pointer;
+      ir_st.pointer = var_st.pointer;
       break;
    }
 }
 
 void ir_print_spirv_visitor::visit(ir_dereference_array *ir)
 {
+   ir_state &array_st = state(ir->array);
+   ir_state &index_st = state(ir->array_index);
+
    const ir_dereference_variable* deref = ir->array->as_dereference_variable();
    const ir_variable* var = deref->variable_referenced();
    const glsl_type* interface_type = var->get_interface_type();
@@ -1641,19 +2023,17 @@ void ir_print_spirv_visitor::visit(ir_dereference_array *ir)
       }
 
       ir_constant ir_uniform(index);
-      ir_uniform.ir_value = 0;
       visit(&ir_uniform);
 
       unsigned int type_id_pointer = visit_type_pointer(ir->type, ir_var_shader_storage, type_id);
       f->functions.push(SpvOpAccessChain | (6 << SpvWordCountShift));
       f->functions.push(type_id_pointer);
       f->functions.push(pointer_id);
-      f->functions.push(ir->array->ir_pointer);
-      f->functions.push(ir_uniform.ir_value);
-      f->functions.push(ir->array_index->ir_value);
-   } else if (ir->array->ir_uniform) {
-      ir_constant ir_uniform(ir->array->ir_uniform - 1);
-      ir_uniform.ir_value = 0;
+      f->functions.push(array_st.pointer);
+      f->functions.push(state(&ir_uniform).value);
+      f->functions.push(index_st.value);
+   } else if (array_st.uniform) {
+      ir_constant ir_uniform(array_st.uniform - 1);
       visit(&ir_uniform);
 
       unsigned int type_id_pointer = visit_type_pointer(ir->type, ir_var_uniform, type_id);
@@ -1661,18 +2041,18 @@ void ir_print_spirv_visitor::visit(ir_dereference_array *ir)
       f->functions.push(type_id_pointer);
       f->functions.push(pointer_id);
       f->functions.push(f->uniform_id);
-      f->functions.push(ir_uniform.ir_value);
-      f->functions.push(ir->array_index->ir_value);
+      f->functions.push(state(&ir_uniform).value);
+      f->functions.push(index_st.value);
    } else {
       unsigned int type_id_pointer = visit_type_pointer(ir->type, ir_var_auto, type_id);
       f->functions.push(SpvOpAccessChain | (5 << SpvWordCountShift));
       f->functions.push(type_id_pointer);
       f->functions.push(pointer_id);
-      f->functions.push(ir->array->ir_pointer);
-      f->functions.push(ir->array_index->ir_value);
+      f->functions.push(array_st.pointer);
+      f->functions.push(index_st.value);
    }
 
-   ir->ir_pointer = pointer_id;
+   state(ir).pointer = pointer_id;
 }
 
 void ir_print_spirv_visitor::visit(ir_dereference_record *ir)
@@ -1690,9 +2070,9 @@ void ir_print_spirv_visitor::visit(ir_dereference_record *ir)
          f->functions.push(SpvOpCompositeExtract | 5 << SpvWordCountShift);
          f->functions.push(type_id);
          f->functions.push(value_id);
-         f->functions.push(ir->record->ir_value);
+         f->functions.push(state(ir->record).value);
          f->functions.push(i);
-         ir->ir_value = value_id;
+         state(ir).value = value_id;
 
          break;
       }
@@ -1701,6 +2081,9 @@ void ir_print_spirv_visitor::visit(ir_dereference_record *ir)
 
 void ir_print_spirv_visitor::visit(ir_assignment *ir)
 {
+   ir_state &lhs_st = state(ir->lhs);
+   ir_state &rhs_st = state(ir->rhs);
+
    if (ir->condition)
       ir->condition->accept(this);
 
@@ -1712,7 +2095,7 @@ void ir_print_spirv_visitor::visit(ir_assignment *ir)
    bool full_write = (_mesa_bitcount(ir->write_mask) == ir->lhs->type->components());
    if (full_write && (ir->lhs->type->components() == ir->rhs->type->components())) {
 
-      value_id = ir->rhs->ir_value;
+      value_id = rhs_st.value;
 
    } else if (ir->rhs->type->components() == 1) {
 
@@ -1724,13 +2107,13 @@ void ir_print_spirv_visitor::visit(ir_assignment *ir)
          f->functions.push(type_id);
          f->functions.push(value_id);
          for (unsigned int i = 0; i < ir->lhs->type->components(); ++i) {
-            f->functions.push(ir->rhs->ir_value);
+            f->functions.push(rhs_st.value);
          }
 
       } else {
 
          visit_value(ir->lhs);
-         value_id = ir->lhs->ir_value;
+         value_id = lhs_st.value;
 
          unsigned int type_id = visit_type(ir->lhs->type);
          for (unsigned int i = 0; i < ir->lhs->type->components(); ++i) {
@@ -1739,7 +2122,7 @@ void ir_print_spirv_visitor::visit(ir_assignment *ir)
                f->functions.push(SpvOpCompositeInsert | (6 << SpvWordCountShift));
                f->functions.push(type_id);
                f->functions.push(result_id);
-               f->functions.push(ir->rhs->ir_value);
+               f->functions.push(rhs_st.value);
                f->functions.push(value_id);
                f->functions.push(i);
                value_id = result_id;
@@ -1756,8 +2139,8 @@ void ir_print_spirv_visitor::visit(ir_assignment *ir)
       f->functions.push(SpvOpVectorShuffle | ((5 + ir->lhs->type->components()) << SpvWordCountShift));
       f->functions.push(type_id);
       f->functions.push(value_id);
-      f->functions.push(ir->lhs->ir_value);
-      f->functions.push(ir->rhs->ir_value);
+      f->functions.push(lhs_st.value);
+      f->functions.push(rhs_st.value);
 
       for (unsigned int i = 0, j = 0; i < ir->lhs->type->components(); ++i) {
          if (ir->write_mask & (1 << i)) {
@@ -1768,17 +2151,19 @@ void ir_print_spirv_visitor::visit(ir_assignment *ir)
       }
    }
 
-   if (ir->lhs->ir_pointer != 0) {
+   if (lhs_st.pointer != 0) {
       f->functions.push(SpvOpStore | (3 << SpvWordCountShift));
-      f->functions.push(ir->lhs->ir_pointer);
+      f->functions.push(lhs_st.pointer);
       f->functions.push(value_id);
    }
 
-   ir->lhs->ir_value = value_id;
+   lhs_st.value = value_id;
 }
 
 void ir_print_spirv_visitor::visit(ir_constant *ir)
 {
+   ir_state &ir_st = state(ir);
+
    if (ir->type->is_array()) {
       for (unsigned i = 0; i < ir->type->length; i++)
          ir->get_array_element(i)->accept(this);
@@ -1793,20 +2178,20 @@ void ir_print_spirv_visitor::visit(ir_constant *ir)
          switch (ir->type->base_type) {
          case GLSL_TYPE_UINT:
             if (ir->value.u[0] <= 15)
-               ir->ir_value = f->const_int_id[ir->value.u[0]];
+               ir_st.value = f->const_int_id[ir->value.u[0]];
             break;
          case GLSL_TYPE_INT:
             if (ir->value.i[0] >= 0 && ir->value.i[0] <= 15)
-               ir->ir_value = f->const_int_id[ir->value.i[0]];
+               ir_st.value = f->const_int_id[ir->value.i[0]];
             break;
          case GLSL_TYPE_FLOAT:
             if (ir->value.f[0] >= 0.0f && ir->value.f[0] <= 15.0f && fmodf(ir->value.f[0], 1.0f) == 0.0f)
-               ir->ir_value = f->const_float_id[(int)ir->value.f[0]];
+               ir_st.value = f->const_float_id[(int)ir->value.f[0]];
             break;
          default:
             break;
          }
-         if (ir->ir_value)
+         if (ir_st.value)
             return;
 
          unsigned int type_id = visit_type(ir->type);
@@ -1822,20 +2207,20 @@ void ir_print_spirv_visitor::visit(ir_constant *ir)
             f->types.push(0u);
             unreachable("Invalid constant type");
          }
-         ir->ir_value = constant_id;
+         ir_st.value = constant_id;
 
          switch (ir->type->base_type) {
          case GLSL_TYPE_UINT:
             if (ir->value.u[0] <= 15)
-               f->const_int_id[ir->value.u[0]] = ir->ir_value;
+               f->const_int_id[ir->value.u[0]] = ir_st.value;
             break;
          case GLSL_TYPE_INT:
             if (ir->value.i[0] >= 0 && ir->value.i[0] <= 15)
-               f->const_int_id[ir->value.i[0]] = ir->ir_value;
+               f->const_int_id[ir->value.i[0]] = ir_st.value;
             break;
          case GLSL_TYPE_FLOAT:
             if (ir->value.f[0] >= 0.0f && ir->value.f[0] <= 15.0f && fmodf(ir->value.f[0], 1.0f) == 0.0f)
-               f->const_float_id[(int)ir->value.f[0]] = ir->ir_value;
+               f->const_float_id[(int)ir->value.f[0]] = ir_st.value;
             break;
          default:
             break;
@@ -1846,23 +2231,20 @@ void ir_print_spirv_visitor::visit(ir_constant *ir)
             switch (ir->type->base_type) {
             case GLSL_TYPE_UINT: {
                ir_constant ir_const(ir->value.u[i]);
-               ir_const.ir_value = 0;
                visit(&ir_const);
-               ids.push(ir_const.ir_value);
+               ids.push(state(&ir_const).value);
                break;
             }
             case GLSL_TYPE_INT: {
                ir_constant ir_const(ir->value.i[i]);
-               ir_const.ir_value = 0;
                visit(&ir_const);
-               ids.push(ir_const.ir_value);
+               ids.push(state(&ir_const).value);
                break;
             }
             case GLSL_TYPE_FLOAT:  {
                ir_constant ir_const(ir->value.f[i]);
-               ir_const.ir_value = 0;
                visit(&ir_const);
-               ids.push(ir_const.ir_value);
+               ids.push(state(&ir_const).value);
                break;
             }
             default:
@@ -1874,13 +2256,11 @@ void ir_print_spirv_visitor::visit(ir_constant *ir)
          f->types.push(SpvOpConstantComposite | ((3 + ids.count()) << SpvWordCountShift));
          f->types.push(type_id);
          f->types.push(value_id);
-         for (unsigned i = 0; i < ids.count(); i++) {
-            f->types.push(ids[i]);
-         }
-         ir->ir_value = value_id;
+         f->types.push(ids);
+         ir_st.value = value_id;
       }
 #if 0
-      visit_precision(ir->ir_value, ir->type->base_type, GLSL_PRECISION_NONE);
+      visit_precision(ir_st.value, ir->type->base_type, GLSL_PRECISION_NONE);
 #endif
    }
 }
@@ -1888,28 +2268,48 @@ void ir_print_spirv_visitor::visit(ir_constant *ir)
 void
 ir_print_spirv_visitor::visit(ir_call *ir)
 {
-   //if (ir->return_deref) {
-   //   ir->return_deref->accept(this);
-   //   fprintf(f, " = ");
-   //}
-   //fprintf(f, "%s", ir->callee_name());
-   //fprintf(f, "(");
-   //foreach_in_list(ir_rvalue, param, &ir->actual_parameters) {
-   //   if (param != ir->actual_parameters.head_sentinel.next)
-   //      fprintf(f, ", ");
-   //   param->accept(this);
-   //}
-   //fprintf(f, ")");
+   binary_buffer arguments;
+   foreach_in_list(ir_rvalue, param, &ir->actual_parameters) {
+      param->accept(this);
+      visit_value(param);
+      arguments.push(state(param).value);
+   }
+
+   unsigned int type_id = visit_type(ir->callee->return_type);
+   unsigned int value_id = f->id++;
+   f->functions.push(SpvOpFunctionCall | ((4 + arguments.count()) << SpvWordCountShift));
+   f->functions.push(type_id);
+   f->functions.push(value_id);
+   f->functions.push(function_id(ir->callee));
+   f->functions.push(arguments);
+   state(ir).value = value_id;
+
+   if (ir->return_deref) {
+      ir->return_deref->accept(this);
+      if (state(ir->return_deref).pointer != 0) {
+         f->functions.push(SpvOpStore | (3 << SpvWordCountShift));
+         f->functions.push(state(ir->return_deref).pointer);
+         f->functions.push(value_id);
+      }
+   }
 }
 
 void
 ir_print_spirv_visitor::visit(ir_return *ir)
 {
-   //ir_rvalue *const value = ir->get_value();
-   //if (value) {
-   //   fprintf(f, "return ");
-   //   value->accept(this);
-   //}
+   ir_rvalue *const value = ir->get_value();
+   if (value) {
+      value->accept(this);
+      visit_value(value);
+      f->functions.push(SpvOpReturnValue | (2 << SpvWordCountShift));
+      f->functions.push(state(value).value);
+   } else {
+      f->functions.push(SpvOpReturn | (1 << SpvWordCountShift));
+   }
+
+   unsigned int label_id = f->id++;
+   f->functions.push(SpvOpLabel | (2 << SpvWordCountShift));
+   f->functions.push(label_id);
 }
 
 void
@@ -1924,7 +2324,7 @@ ir_print_spirv_visitor::visit(ir_discard *ir)
       f->functions.push(SpvSelectionControlMaskNone);
 
       f->functions.push(SpvOpBranchConditional | (4 << SpvWordCountShift));
-      f->functions.push(ir->condition->ir_value);
+      f->functions.push(state(ir->condition).value);
       f->functions.push(label_begin_id);
       f->functions.push(label_end_id);
 
@@ -1957,7 +2357,7 @@ ir_print_spirv_visitor::visit(ir_if *ir)
    }
 
    f->functions.push(SpvOpBranchConditional | (4 << SpvWordCountShift));
-   f->functions.push(ir->condition->ir_value);
+   f->functions.push(state(ir->condition).value);
    f->functions.push(label_then_id);
    f->functions.push(label_else_id);
 
@@ -1965,7 +2365,6 @@ ir_print_spirv_visitor::visit(ir_if *ir)
    f->functions.push(label_then_id);
 
    foreach_in_list(ir_instruction, inst, &ir->then_instructions) {
-      inst->parent = ir;
       inst->accept(this);
    }
 
@@ -1977,7 +2376,6 @@ ir_print_spirv_visitor::visit(ir_if *ir)
       f->functions.push(label_else_id);
 
       foreach_in_list(ir_instruction, inst, &ir->else_instructions) {
-         inst->parent = ir;
          inst->accept(this);
       }
    }
@@ -2011,14 +2409,18 @@ ir_print_spirv_visitor::visit(ir_loop *ir)
    f->functions.push(SpvOpLabel | (2 << SpvWordCountShift));
    f->functions.push(label_inner_id);
 
-   ir->ir_label = label_id;
-   ir->ir_label_break = label_outer_id;
+   unsigned int outer_continue_id = loop_continue_id;
+   unsigned int outer_break_id = loop_break_id;
+   loop_continue_id = label_id;
+   loop_break_id = label_outer_id;
 
    foreach_in_list(ir_instruction, inst, &ir->body_instructions) {
-      inst->parent = ir;
       inst->accept(this);
    }
 
+   loop_continue_id = outer_continue_id;
+   loop_break_id = outer_break_id;
+
    f->functions.push(SpvOpBranch | (2 << SpvWordCountShift));
    f->functions.push(label_id);
    f->functions.push(SpvOpLabel | (2 << SpvWordCountShift));
@@ -2028,20 +2430,12 @@ ir_print_spirv_visitor::visit(ir_loop *ir)
 void
 ir_print_spirv_visitor::visit(ir_loop_jump *ir)
 {
-   const ir_loop *loop = NULL;
-   ir_instruction *parent = (ir_instruction *)ir->parent;
-   while (parent) {
-      loop = parent->as_loop();
-      if (loop)
-         break;
-      parent = (ir_instruction*)parent->parent;
-   }
-   if (loop == NULL)
+   if (loop_break_id == 0)
       return;
    unsigned int label_id = f->id++;
 
    f->functions.push(SpvOpBranch | (2 << SpvWordCountShift));
-   f->functions.push(ir->is_break() ? loop->ir_label_break : loop->ir_label);
+   f->functions.push(ir->is_break() ? loop_break_id : loop_continue_id);
    f->functions.push(SpvOpLabel | (2 << SpvWordCountShift));
    f->functions.push(label_id);
 }
@@ -31,20 +31,57 @@
 
 extern "C" {
 #include "program/symbol_table.h"
-#include "util/u_vector.h"
 }
 
+/**
+ * A growable, contiguous array of SPIR-V words.
+ *
+ * The first few words live inside the object itself, so short-lived buffers
+ * collecting operand ids don't touch the heap at all.
+ */
 class binary_buffer {
 public:
    binary_buffer();
    virtual ~binary_buffer();
-   void push(unsigned int value);
+
+   void push(unsigned int value)
+   {
+      if (unlikely(words == capacity))
+         grow(words + 1);
+      buffer[words++] = value;
+   }
+
+   /** Appends a nul-terminated literal string, padded to whole words. */
    void push(const char* text);
-   unsigned int count();
-   unsigned int* data();
-   unsigned int operator[] (size_t i);
+
+   /** Appends all of the words of another buffer. */
+   void push(const binary_buffer &other);
+
+   void push(const unsigned int *values, unsigned int n);
+
+   /** Makes room for at least n words in total. */
+   void reserve(unsigned int n)
+   {
+      if (n > capacity)
+         grow(n);
+   }
+
+   unsigned int count() const { return words; }
+   unsigned int* data() { return buffer; }
+   const unsigned int* data() const { return buffer; }
+   unsigned int operator[] (size_t i) const { return buffer[i]; }
+
 protected:
-   struct u_vector vector_buffer;
+   void grow(unsigned int n);
+
+   unsigned int *buffer;
+   unsigned int words;
+   unsigned int capacity;
+   unsigned int inline_words[16];
+
+private:
+   binary_buffer(const binary_buffer &);
+   binary_buffer &operator=(const binary_buffer &);
 };
 
 class spirv_buffer : public binary_buffer {
@@ -63,9 +100,23 @@ public:
    binary_buffer functions;
    binary_buffer reflections;
 
+   /**
+    * OpTypeFunction ids already declared, as records of
+    * { type id, operand count, return type id, parameter type ids... }.
+    */
+   binary_buffer function_types;
+
    unsigned int precision_float;
    unsigned int precision_int;
 
+   /**
+    * Evaluate mediump and lowp arithmetic with 16-bit float16/int16 types
+    * instead of only decorating it with RelaxedPrecision.
+    */
+   bool native_16bit;
+   bool float16_used;
+   bool int16_used;
+
    unsigned int id;
    unsigned int binding_id;
    unsigned int binding_start_id;
@@ -84,6 +135,8 @@ public:
    unsigned int bool_id;
    unsigned int float_id[4*4];
    unsigned int int_id[4*4];
+   unsigned int float16_id[4];
+   unsigned int int16_id[4];
    unsigned int const_float_id[16];
    unsigned int const_int_id[16];
    unsigned int sampler_id[16];
@@ -143,11 +196,32 @@ public:
    /*@}*/
 
 public:
+   /**
+    * Emission state of an IR node.  It lives in side tables owned by the
+    * visitor rather than in ir_instruction, so the IR does not grow with
+    * fields only the SPIR-V emitter uses.
+    */
+   struct ir_state {
+      const ir_instruction *node; /**< Node owning the record */
+      unsigned int value;        /**< Result id of an rvalue */
+      unsigned int pointer;      /**< Pointer id of a variable or dereference */
+      unsigned int uniform;      /**< Uniform block member, plus one on dereferences */
+      unsigned int initialized;  /**< Cached access chain of a built-in */
+   };
+
+   ir_state &state(ir_instruction *ir);
+
    unsigned int visit_type(const struct glsl_type *type);
+   unsigned int visit_type_16bit(const struct glsl_type *type);
    char check_point_to_type(const struct glsl_type *type, unsigned int point_to);
    unsigned int visit_type_pointer(const struct glsl_type *type, unsigned int mode, unsigned int point_to);
    void visit_value(ir_rvalue *ir);
    void visit_precision(unsigned int id, unsigned int type, unsigned int precision);
+   unsigned int visit_function_type(ir_function_signature *ir);
+   unsigned int function_id(ir_function_signature *ir);
+   bool is_16bit(ir_expression *ir);
+   unsigned int value_16bit(ir_rvalue *ir);
+   unsigned int convert_16bit(unsigned int value_id, const struct glsl_type *type, bool to_16bit);
 
 private:
    /**
@@ -166,6 +240,21 @@ private:
    void *mem_ctx;
    spirv_buffer *f;
 
+   /** Set while visiting an operand of an expression evaluated in 16-bit. */
+   bool want_16bit;
+
+   /** Labels of the innermost loop, 0 outside of loops. */
+   unsigned int loop_continue_id;
+   unsigned int loop_break_id;
+
+   /**
+    * Emission state, in blocks of STATE_BLOCK_SIZE records.  A node's
+    * ir_instruction::table_index addresses its record directly.
+    */
+   enum { STATE_BLOCK_SIZE = 256 };
+   ir_state **state_blocks;
+   unsigned int state_count;
+
    int indentation;
 };
 
@@ -30,45 +30,23 @@
  */
 
 #include "ir.h"
-#include "ir_rvalue_visitor.h"
+#include "ir_peephole.h"
 #include "ir_optimization.h"
 #include "compiler/glsl_types.h"
 #include "main/macros.h"
 
-namespace {
-
-class ir_vec_index_to_swizzle_visitor : public ir_rvalue_visitor {
-public:
-   ir_vec_index_to_swizzle_visitor()
-   {
-      progress = false;
-   }
-
-   ir_rvalue *convert_vector_extract_to_swizzle(ir_rvalue *val);
-
-   virtual void handle_rvalue(ir_rvalue **);
-
-   bool progress;
-};
-
-} /* anonymous namespace */
-
-void
-ir_vec_index_to_swizzle_visitor::handle_rvalue(ir_rvalue **rv)
+bool
+rewrite_vec_index_to_swizzle(ir_rvalue **rv, void *)
 {
-   if (*rv == NULL)
-      return;
-
    ir_expression *const expr = (*rv)->as_expression();
    if (expr == NULL || expr->operation != ir_binop_vector_extract)
-      return;
+      return false;
 
    ir_constant *const idx = expr->operands[1]->constant_expression_value();
    if (idx == NULL)
-      return;
+      return false;
 
    void *ctx = ralloc_parent(expr);
-   this->progress = true;
 
    /* Page 40 of the GLSL 1.20 spec says:
     *
@@ -88,14 +66,15 @@ ir_vec_index_to_swizzle_visitor::handle_rvalue(ir_rvalue **rv)
                        (int) expr->operands[0]->type->vector_elements - 1);
 
    *rv = new(ctx) ir_swizzle(expr->operands[0], i, 0, 0, 0, 1);
+   return true;
 }
 
 bool
 do_vec_index_to_swizzle(exec_list *instructions)
 {
-   ir_vec_index_to_swizzle_visitor v;
+   ir_peephole peephole;
 
-   v.run(instructions);
+   peephole.add_rewrite(ir_type_expression, rewrite_vec_index_to_swizzle);
 
-   return v.progress;
+   return peephole.run(instructions);
 }
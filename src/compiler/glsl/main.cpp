@@ -35,6 +35,7 @@
 
 #include "main/mtypes.h"
 #include "standalone.h"
+#include "util/ralloc.h"
 
 static struct standalone_options options;
 
@@ -45,9 +46,16 @@ const struct option compiler_opts[] = {
    { "dump-builder", no_argument, &options.dump_builder, 1 },
    { "dump-spirv", no_argument, &options.dump_spirv, 1 },
    { "dump-spirv-glsl", no_argument, &options.dump_spirv_glsl, 1 },
+   { "minify-spirv-glsl", no_argument, &options.minify_spirv_glsl, 1 },
+   { "dump-spirv-cpp", no_argument, &options.dump_spirv_cpp, 1 },
+   { "spirv-16bit", no_argument, &options.spirv_16bit, 1 },
+   { "arena", no_argument, &options.arena, 1 },
+   { "ralloc-stats", no_argument, &options.ralloc_stats, 1 },
    { "link",     no_argument, &options.do_link,  1 },
    { "just-log", no_argument, &options.just_log, 1 },
    { "version",  required_argument, NULL, 'v' },
+   { "inline-budget", required_argument, NULL, 'b' },
+   { "simd-width", required_argument, NULL, 's' },
    { NULL, 0, NULL, 0 }
 };
 
@@ -81,6 +89,12 @@ main(int argc, char * const* argv)
       case 'v':
          options.glsl_version = strtol(optarg, NULL, 10);
          break;
+      case 'b':
+         options.inline_budget = strtol(optarg, NULL, 10);
+         break;
+      case 's':
+         options.simd_width = strtol(optarg, NULL, 10);
+         break;
       default:
          break;
       }
@@ -89,6 +103,8 @@ main(int argc, char * const* argv)
    if (argc <= optind)
       usage_fail(argv[0]);
 
+   ralloc_enable_stats(options.ralloc_stats);
+
    struct gl_shader_program *whole_program;
 
    whole_program = standalone_compile_shader(&options, argc - optind, &argv[optind]);
@@ -98,6 +114,19 @@ main(int argc, char * const* argv)
 
    standalone_compiler_cleanup(whole_program);
 
+   if (options.ralloc_stats) {
+      struct ralloc_stats stats;
+      ralloc_get_stats(&stats);
+      fprintf(stderr,
+              "ralloc: %llu allocations, %llu bytes, %llu mallocs, "
+              "%llu frees, %llu slabs\n",
+              (unsigned long long) stats.allocations,
+              (unsigned long long) stats.bytes,
+              (unsigned long long) stats.mallocs,
+              (unsigned long long) stats.frees,
+              (unsigned long long) stats.slabs);
+   }
+
    return status;
 }
 
@@ -0,0 +1,491 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file opt_dead_store.cpp
+ *
+ * Eliminates dead assignments to function-local variables using a backward
+ * liveness analysis over the structured IR.
+ *
+ * do_dead_code_local() only sees one basic block at a time, and
+ * do_dead_code() only removes assignments to variables that are never read
+ * at all.  Neither catches a store that is overwritten on every path after
+ * an if-statement, or a channel of a vector that is written before a loop
+ * but never read again.  This pass walks each function body backwards,
+ * tracking which channels of each local variable may still be read, and
+ * removes (or narrows the write mask of) assignments whose written channels
+ * are not live.
+ *
+ * Like ir_basic_block.cpp, it relies on our lack of unstructured control
+ * flow: the live set flowing out of an ir_if is the union of its two arms,
+ * an ir_loop is iterated until the live set at its head stops growing, a
+ * break takes the live set following the loop and a continue takes the one
+ * at the loop head.
+ *
+ * Only auto/temporary variables declared inside the function and "in"
+ * parameters are considered.  Globals, outputs and "out"/"inout" parameters
+ * are observable after the function returns and are left alone.
+ */
+
+#include "ir.h"
+#include "ir_optimization.h"
+#include "compiler/glsl_types.h"
+#include "util/hash_table.h"
+
+static bool debug = false;
+
+namespace {
+
+/**
+ * Per-loop state needed to resolve break and continue.
+ */
+struct loop_targets {
+   const uint8_t *break_live;
+   const uint8_t *continue_live;
+   loop_targets *prev;
+};
+
+class dead_store_pass {
+public:
+   dead_store_pass(ir_function_signature *sig);
+   ~dead_store_pass();
+
+   bool run();
+
+   /* Liveness helpers, one byte of xyzw channel bits per candidate. */
+   uint8_t *new_live_set();
+   void copy_live_set(uint8_t *dst, const uint8_t *src);
+   bool union_live_set(uint8_t *dst, const uint8_t *src);
+   void clear_live_set(uint8_t *live);
+
+   int candidate_index(const ir_variable *var) const;
+   void add_candidate(ir_variable *var);
+
+   void add_uses(ir_instruction *ir, uint8_t *live);
+   void add_lhs_uses(ir_dereference *lhs, uint8_t *live);
+
+   void process_list(exec_list *list, uint8_t *live, bool transform);
+   void process_instruction(ir_instruction *ir, uint8_t *live, bool transform);
+   void process_assignment(ir_assignment *ir, uint8_t *live, bool transform);
+   void process_loop(ir_loop *ir, uint8_t *live, bool transform);
+
+   ir_function_signature *sig;
+   void *mem_ctx;
+   hash_table *candidates;
+   unsigned num_candidates;
+   loop_targets *loops;
+   bool progress;
+};
+
+/**
+ * Marks every channel read by an rvalue tree as live.
+ */
+class use_visitor : public ir_hierarchical_visitor {
+public:
+   use_visitor(dead_store_pass *pass, uint8_t *live)
+      : pass(pass), live(live)
+   {
+   }
+
+   void use_channels(const ir_variable *var, unsigned channels)
+   {
+      int index = pass->candidate_index(var);
+      if (index >= 0)
+         live[index] |= channels;
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      use_channels(ir->var, 0xf);
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_swizzle *ir)
+   {
+      ir_dereference_variable *deref = ir->val->as_dereference_variable();
+      if (!deref || !deref->var->type->is_vector())
+         return visit_continue;
+
+      unsigned used = 1 << ir->mask.x;
+      if (ir->mask.num_components > 1)
+         used |= 1 << ir->mask.y;
+      if (ir->mask.num_components > 2)
+         used |= 1 << ir->mask.z;
+      if (ir->mask.num_components > 3)
+         used |= 1 << ir->mask.w;
+
+      use_channels(deref->var, used);
+
+      return visit_continue_with_parent;
+   }
+
+   dead_store_pass *pass;
+   uint8_t *live;
+};
+
+/**
+ * Collects the variables whose stores this pass is allowed to remove.
+ */
+class candidate_visitor : public ir_hierarchical_visitor {
+public:
+   candidate_visitor(dead_store_pass *pass)
+      : pass(pass)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_variable *ir)
+   {
+      if (ir->data.mode == ir_var_auto || ir->data.mode == ir_var_temporary)
+         pass->add_candidate(ir);
+
+      return visit_continue;
+   }
+
+   dead_store_pass *pass;
+};
+
+} /* unnamed namespace */
+
+dead_store_pass::dead_store_pass(ir_function_signature *sig)
+   : sig(sig), num_candidates(0), loops(NULL), progress(false)
+{
+   mem_ctx = ralloc_context(NULL);
+   candidates = _mesa_hash_table_create(mem_ctx, _mesa_hash_pointer,
+                                        _mesa_key_pointer_equal);
+}
+
+dead_store_pass::~dead_store_pass()
+{
+   ralloc_free(mem_ctx);
+}
+
+uint8_t *
+dead_store_pass::new_live_set()
+{
+   return rzalloc_array(mem_ctx, uint8_t, num_candidates);
+}
+
+void
+dead_store_pass::copy_live_set(uint8_t *dst, const uint8_t *src)
+{
+   memcpy(dst, src, num_candidates);
+}
+
+bool
+dead_store_pass::union_live_set(uint8_t *dst, const uint8_t *src)
+{
+   bool changed = false;
+
+   for (unsigned i = 0; i < num_candidates; i++) {
+      const uint8_t merged = dst[i] | src[i];
+      if (merged != dst[i]) {
+         dst[i] = merged;
+         changed = true;
+      }
+   }
+
+   return changed;
+}
+
+void
+dead_store_pass::clear_live_set(uint8_t *live)
+{
+   memset(live, 0, num_candidates);
+}
+
+int
+dead_store_pass::candidate_index(const ir_variable *var) const
+{
+   hash_entry *entry = _mesa_hash_table_search(candidates, var);
+   return entry ? (int)(intptr_t) entry->data : -1;
+}
+
+void
+dead_store_pass::add_candidate(ir_variable *var)
+{
+   _mesa_hash_table_insert(candidates, var,
+                           (void *)(intptr_t) num_candidates++);
+}
+
+void
+dead_store_pass::add_uses(ir_instruction *ir, uint8_t *live)
+{
+   use_visitor v(this, live);
+   ir->accept(&v);
+}
+
+/**
+ * The dereference being assigned is not itself a read, but any array
+ * indices along the way are.
+ */
+void
+dead_store_pass::add_lhs_uses(ir_dereference *lhs, uint8_t *live)
+{
+   ir_rvalue *deref = lhs;
+
+   while (deref != NULL) {
+      if (ir_dereference_array *array = deref->as_dereference_array()) {
+         add_uses(array->array_index, live);
+         deref = array->array;
+      } else if (ir_dereference_record *record = deref->as_dereference_record()) {
+         deref = record->record;
+      } else {
+         break;
+      }
+   }
+}
+
+void
+dead_store_pass::process_assignment(ir_assignment *ir, uint8_t *live,
+                                    bool transform)
+{
+   ir_variable *var = ir->lhs->variable_referenced();
+   int index = candidate_index(var);
+
+   if (index >= 0) {
+      ir_dereference_variable *deref_var = ir->lhs->as_dereference_variable();
+      const bool channelwise = deref_var &&
+         (var->type->is_scalar() || var->type->is_vector());
+
+      if (transform) {
+         /* Whole-aggregate assignments (matrices, arrays, structures) have
+          * no write mask, so they are either entirely dead or not at all.
+          */
+         const unsigned dead = channelwise ?
+            (ir->write_mask & ~live[index]) : 0;
+         const bool all_dead = channelwise ?
+            (dead == ir->write_mask) : (live[index] == 0);
+
+         if (all_dead) {
+            if (debug) {
+               printf("removing dead store:\n  ");
+               ir->print();
+               printf("\n");
+            }
+
+            ir->remove();
+            progress = true;
+            return;
+         }
+
+         if (dead != 0) {
+            /* Reswizzle the RHS arguments according to the new write_mask,
+             * the same way do_dead_code_local() does.
+             */
+            void *ir_ctx = ralloc_parent(ir);
+            unsigned components[4];
+            unsigned channels = 0;
+            unsigned next = 0;
+
+            for (int i = 0; i < 4; i++) {
+               if (ir->write_mask & (1 << i)) {
+                  if (!(dead & (1 << i)))
+                     components[channels++] = next;
+                  next++;
+               }
+            }
+
+            if (debug) {
+               printf("narrowing dead channels 0x%01x of:\n  ", dead);
+               ir->print();
+               printf("\n");
+            }
+
+            ir->write_mask &= ~dead;
+            ir->rhs = new(ir_ctx) ir_swizzle(ir->rhs, components, channels);
+            progress = true;
+         }
+      }
+
+      /* A conditional assignment may not happen, so it kills nothing. */
+      if (!ir->condition) {
+         if (channelwise)
+            live[index] &= ~ir->write_mask;
+         else if (ir->whole_variable_written() != NULL)
+            live[index] = 0;
+      }
+   }
+
+   add_uses(ir->rhs, live);
+   if (ir->condition)
+      add_uses(ir->condition, live);
+   add_lhs_uses(ir->lhs, live);
+}
+
+void
+dead_store_pass::process_loop(ir_loop *ir, uint8_t *live, bool transform)
+{
+   uint8_t *after = new_live_set();
+   uint8_t *head = new_live_set();
+   uint8_t *body = new_live_set();
+
+   copy_live_set(after, live);
+
+   loop_targets targets;
+   targets.break_live = after;
+   targets.continue_live = head;
+   targets.prev = loops;
+   loops = &targets;
+
+   /* Falling off the end of the body goes back to the head, so iterate until
+    * the live set at the head reaches a fixed point.  It can only grow, and
+    * there are at most four channels per candidate, so this terminates.
+    */
+   do {
+      copy_live_set(body, head);
+      process_list(&ir->body_instructions, body, false);
+   } while (union_live_set(head, body));
+
+   if (transform) {
+      copy_live_set(body, head);
+      process_list(&ir->body_instructions, body, true);
+   }
+
+   loops = targets.prev;
+
+   copy_live_set(live, head);
+
+   ralloc_free(after);
+   ralloc_free(head);
+   ralloc_free(body);
+}
+
+void
+dead_store_pass::process_instruction(ir_instruction *ir, uint8_t *live,
+                                     bool transform)
+{
+   switch (ir->ir_type) {
+   case ir_type_assignment:
+      process_assignment((ir_assignment *) ir, live, transform);
+      break;
+
+   case ir_type_if: {
+      ir_if *iff = (ir_if *) ir;
+      uint8_t *else_live = new_live_set();
+
+      copy_live_set(else_live, live);
+      process_list(&iff->then_instructions, live, transform);
+      process_list(&iff->else_instructions, else_live, transform);
+      union_live_set(live, else_live);
+      add_uses(iff->condition, live);
+
+      ralloc_free(else_live);
+      break;
+   }
+
+   case ir_type_loop:
+      process_loop((ir_loop *) ir, live, transform);
+      break;
+
+   case ir_type_loop_jump: {
+      ir_loop_jump *jump = (ir_loop_jump *) ir;
+
+      assert(loops != NULL);
+      copy_live_set(live, jump->is_break() ? loops->break_live
+                                           : loops->continue_live);
+      break;
+   }
+
+   case ir_type_return:
+      /* Nothing local survives the return, except what computes its value. */
+      clear_live_set(live);
+      if (((ir_return *) ir)->value)
+         add_uses(((ir_return *) ir)->value, live);
+      break;
+
+   case ir_type_discard: {
+      ir_discard *discard = (ir_discard *) ir;
+
+      if (discard->condition)
+         add_uses(discard->condition, live);
+      else
+         clear_live_set(live);
+      break;
+   }
+
+   case ir_type_variable:
+      break;
+
+   default:
+      /* Calls, emit_vertex, end_primitive and barriers: anything they
+       * reference is conservatively treated as read.
+       */
+      add_uses(ir, live);
+      break;
+   }
+}
+
+void
+dead_store_pass::process_list(exec_list *list, uint8_t *live, bool transform)
+{
+   foreach_in_list_reverse_safe(ir_instruction, ir, list) {
+      process_instruction(ir, live, transform);
+   }
+}
+
+bool
+dead_store_pass::run()
+{
+   candidate_visitor v(this);
+
+   foreach_in_list(ir_variable, param, &sig->parameters) {
+      if (param->data.mode == ir_var_function_in ||
+          param->data.mode == ir_var_const_in)
+         add_candidate(param);
+   }
+   visit_list_elements(&v, &sig->body);
+
+   if (num_candidates == 0)
+      return false;
+
+   uint8_t *live = new_live_set();
+   process_list(&sig->body, live, true);
+
+   return progress;
+}
+
+/**
+ * Removes assignments to local variables that are not read on any path
+ * before being overwritten or going out of scope.
+ */
+bool
+do_dead_stores(exec_list *instructions)
+{
+   bool progress = false;
+
+   foreach_in_list(ir_instruction, ir, instructions) {
+      ir_function *f = ir->as_function();
+      if (!f)
+         continue;
+
+      foreach_in_list(ir_function_signature, sig, &f->signatures) {
+         if (!sig->is_defined)
+            continue;
+
+         dead_store_pass pass(sig);
+         progress = pass.run() || progress;
+      }
+   }
+
+   return progress;
+}
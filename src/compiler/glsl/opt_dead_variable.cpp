@@ -27,75 +27,76 @@
  * Eliminates unused variables.
  */
 
-#include "util/string_to_uint_map.h"
+#include "util/hash_table.h"
 #include "util/set.h"
 #include "ir.h"
+#include "ir_peephole.h"
 
-namespace {
-
-class dead_variable_visitor : public ir_hierarchical_visitor {
-public:
-   dead_variable_visitor()
-   {
-      variables = _mesa_set_create(NULL,
-                                   _mesa_hash_pointer,
-                                   _mesa_key_pointer_equal);
-   }
-
-   virtual ~dead_variable_visitor()
-   {
-      _mesa_set_destroy(variables, NULL);
-   }
+static void
+add_variable(ir_instruction *ir, void *data)
+{
+   struct set *variables = (struct set *) data;
+   ir_variable *var = (ir_variable *) ir;
 
-   virtual ir_visitor_status visit(ir_variable *ir)
-   {
-      /* If the variable is auto or temp, add it to the set of variables that
-       * are candidates for removal.
-       */
-      if (ir->data.mode != ir_var_auto && ir->data.mode != ir_var_temporary)
-         return visit_continue;
+   /* If the variable is auto or temp, add it to the set of variables that
+    * are candidates for removal.
+    */
+   if (var->data.mode != ir_var_auto && var->data.mode != ir_var_temporary)
+      return;
 
-      _mesa_set_add(variables, ir);
+   _mesa_set_add(variables, var);
+}
 
-      return visit_continue;
-   }
+static void
+remove_variable(ir_instruction *ir, void *data)
+{
+   struct set *variables = (struct set *) data;
+   ir_dereference_variable *deref = (ir_dereference_variable *) ir;
+   struct set_entry *entry = _mesa_set_search(variables, deref->var);
+
+   /* If a variable is dereferenced at all, remove it from the set of
+    * variables that are candidates for removal.
+    */
+   if (entry != NULL)
+      _mesa_set_remove(variables, entry);
+}
 
-   virtual ir_visitor_status visit(ir_dereference_variable *ir)
-   {
-      struct set_entry *entry = _mesa_set_search(variables, ir->var);
+ir_dead_variables::ir_dead_variables(ir_peephole *peephole)
+{
+   variables = _mesa_set_create(NULL,
+                                _mesa_hash_pointer,
+                                _mesa_key_pointer_equal);
 
-      /* If a variable is dereferenced at all, remove it from the set of
-       * variables that are candidates for removal.
-       */
-      if (entry != NULL)
-         _mesa_set_remove(variables, entry);
+   peephole->add_visit(ir_type_variable, add_variable, variables);
+   peephole->add_visit(ir_type_dereference_variable, remove_variable,
+                       variables);
+}
 
-      return visit_continue;
-   }
+ir_dead_variables::~ir_dead_variables()
+{
+   _mesa_set_destroy(variables, NULL);
+}
 
-   void remove_dead_variables()
-   {
-      struct set_entry *entry;
+void
+ir_dead_variables::remove()
+{
+   struct set_entry *entry;
 
-      set_foreach(variables, entry) {
-         ir_variable *ir = (ir_variable *) entry->key;
+   set_foreach(variables, entry) {
+      ir_variable *ir = (ir_variable *) entry->key;
 
-         assert(ir->ir_type == ir_type_variable);
-         ir->remove();
-      }
+      assert(ir->ir_type == ir_type_variable);
+      ir->remove();
    }
-
-private:
-   set *variables;
-};
-
-} /* unnamed namespace */
+}
 
 bool
 do_dead_variables(exec_list *instructions)
 {
-   dead_variable_visitor v;
-   visit_list_elements(&v, instructions);
-   v.remove_dead_variables();
+   ir_peephole peephole;
+   ir_dead_variables dead(&peephole);
+
+   peephole.run(instructions);
+   dead.remove();
    return true;
 }
@@ -25,14 +25,30 @@
  * \file opt_function_inlining.cpp
  *
  * Replaces calls to functions with the body of the function.
+ *
+ * Functions are processed bottom-up through the call graph, so that a
+ * callee's own calls are already inlined by the time its body gets cloned
+ * into each of its callers.
+ *
+ * When the driver can consume real function calls (\c EmitNoFunctions is
+ * not set) and \c InlineGrowthBudget is non-zero, large functions with
+ * several call sites are left as calls instead of being duplicated at every
+ * site.  See \c ir_function_inlining_visitor::should_inline.
+ *
+ * Bodies are only copied while other references to them remain.  The last
+ * call site to be inlined takes the callee's body itself, which is dead from
+ * then on, so a function with a single caller is never cloned at all.
  */
 
 #include "ir.h"
 #include "ir_visitor.h"
 #include "ir_function_inlining.h"
 #include "ir_expression_flattening.h"
+#include "ir_optimization.h"
 #include "compiler/glsl_types.h"
+#include "main/mtypes.h"
 #include "util/hash_table.h"
+#include "util/set.h"
 
 static void
 do_variable_replacement(exec_list *instructions,
@@ -43,14 +59,31 @@ namespace {
 
 class ir_function_inlining_visitor : public ir_hierarchical_visitor {
 public:
-   ir_function_inlining_visitor()
+   ir_function_inlining_visitor(const struct gl_shader_compiler_options *options)
    {
       progress = false;
+      this->options = options;
+      this->call_counts = NULL;
+      this->sizes = NULL;
+      this->refs = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                           _mesa_key_pointer_equal);
+
+      if (options != NULL && !options->EmitNoFunctions &&
+          options->InlineGrowthBudget != 0) {
+         this->call_counts = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                                     _mesa_key_pointer_equal);
+         this->sizes = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                               _mesa_key_pointer_equal);
+      }
    }
 
    virtual ~ir_function_inlining_visitor()
    {
-      /* empty */
+      _mesa_hash_table_destroy(this->refs, NULL);
+      if (this->call_counts)
+         _mesa_hash_table_destroy(this->call_counts, NULL);
+      if (this->sizes)
+         _mesa_hash_table_destroy(this->sizes, NULL);
    }
 
    virtual ir_visitor_status visit_enter(ir_expression *);
@@ -59,6 +92,27 @@ public:
    virtual ir_visitor_status visit_enter(ir_texture *);
    virtual ir_visitor_status visit_enter(ir_swizzle *);
 
+   bool should_inline(ir_call *call);
+   unsigned signature_size(ir_function_signature *sig);
+
+   const struct gl_shader_compiler_options *options;
+
+   /**
+    * ir_function_signature * -> number of call sites.  NULL when every
+    * call is inlined unconditionally.
+    */
+   struct hash_table *call_counts;
+
+   /** ir_function_signature * -> cached body size in IR nodes. */
+   struct hash_table *sizes;
+
+   /**
+    * ir_function_signature * -> number of calls not inlined yet.  Once it
+    * drops to zero nothing else can observe the body, so the last call site
+    * moves it instead of cloning it.
+    */
+   struct hash_table *refs;
+
    bool progress;
 };
 
@@ -67,18 +121,239 @@ public:
    virtual ir_visitor_status visit_enter(ir_dereference_array *);
 };
 
+/**
+ * Counts the call sites of each function signature.
+ */
+class ir_call_count_visitor : public ir_hierarchical_visitor {
+public:
+   ir_call_count_visitor(struct hash_table *call_counts)
+   {
+      this->call_counts = call_counts;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_call *ir)
+   {
+      struct hash_entry *entry =
+         _mesa_hash_table_search(this->call_counts, ir->callee);
+      if (entry)
+         entry->data = (void *) ((intptr_t) entry->data + 1);
+      else
+         _mesa_hash_table_insert(this->call_counts, ir->callee, (void *) 1);
+
+      return visit_continue_with_parent;
+   }
+
+   struct hash_table *call_counts;
+};
+
+/**
+ * Determines whether a signature may be kept as a real function.
+ *
+ * Parameters must be plain by-value inputs, and the body may not touch
+ * built-in outputs, whose access chains the SPIR-V backend creates once at
+ * first use.
+ */
+class ir_function_keepable_visitor : public ir_hierarchical_visitor {
+public:
+   ir_function_keepable_visitor()
+   {
+      this->keepable = true;
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      const ir_variable *var = ir->var;
+
+      if (var->data.mode == ir_var_shader_out && is_gl_identifier(var->name)) {
+         this->keepable = false;
+         return visit_stop;
+      }
+
+      return visit_continue;
+   }
+
+   bool keepable;
+};
+
+/**
+ * Processes the functions of a shader callees-first.
+ */
+class ir_call_graph_visitor : public ir_hierarchical_visitor {
+public:
+   ir_call_graph_visitor(ir_function_inlining_visitor *inliner)
+   {
+      this->inliner = inliner;
+      this->done = _mesa_set_create(NULL, _mesa_hash_pointer,
+                                    _mesa_key_pointer_equal);
+   }
+
+   virtual ~ir_call_graph_visitor()
+   {
+      _mesa_set_destroy(this->done, NULL);
+   }
+
+   virtual ir_visitor_status visit_enter(ir_call *ir)
+   {
+      process(ir->callee);
+      return visit_continue_with_parent;
+   }
+
+   void process(ir_function_signature *sig)
+   {
+      /* Recursion is a compile error in GLSL, so the only cycle we can see
+       * here is revisiting a signature that has already been handled.
+       */
+      if (_mesa_set_search(this->done, sig))
+         return;
+
+      _mesa_set_add(this->done, sig);
+
+      visit_list_elements(this, &sig->body);
+      visit_list_elements(this->inliner, &sig->body);
+   }
+
+   ir_function_inlining_visitor *inliner;
+   struct set *done;
+};
+
 } /* unnamed namespace */
 
+static bool
+signature_is_keepable(const ir_function_signature *sig)
+{
+   if (sig->is_builtin() || sig->return_type->contains_opaque())
+      return false;
+
+   foreach_in_list(const ir_variable, param, &sig->parameters) {
+      if (param->data.mode != ir_var_function_in &&
+          param->data.mode != ir_var_const_in)
+         return false;
+
+      if (param->type->contains_opaque())
+         return false;
+   }
+
+   ir_function_keepable_visitor v;
+   v.run((exec_list *) &sig->body);
+
+   return v.keepable;
+}
+
+static void
+count_node(ir_instruction *ir, void *data)
+{
+   (void) ir;
+   (*(unsigned *) data)++;
+}
+
+unsigned
+ir_function_inlining_visitor::signature_size(ir_function_signature *sig)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(this->sizes, sig);
+   if (entry)
+      return (unsigned) (intptr_t) entry->data;
+
+   unsigned size = 0;
+   foreach_in_list(ir_instruction, ir, &sig->body) {
+      visit_tree(ir, count_node, &size);
+   }
+
+   _mesa_hash_table_insert(this->sizes, sig, (void *) (intptr_t) size);
+   return size;
+}
+
+/**
+ * Decides whether a call is inlined.
+ *
+ * Without a growth budget every call that \c can_inline accepts is inlined.
+ * Otherwise a call is inlined if its callee is small (at most
+ * \c InlineAlwaysSize IR nodes), has a single call site, or cannot be
+ * emitted as a function; larger callees are only inlined if duplicating the
+ * body at every other call site adds no more than \c InlineGrowthBudget
+ * nodes.  The decision depends only on the callee, so all of its call sites
+ * agree and repeated runs of the pass do not creep past the budget.
+ */
 bool
-do_function_inlining(exec_list *instructions)
+ir_function_inlining_visitor::should_inline(ir_call *call)
 {
-   ir_function_inlining_visitor v;
+   if (!can_inline(call))
+      return false;
+
+   if (this->call_counts == NULL)
+      return true;
 
-   v.run(instructions);
+   ir_function_signature *callee = call->callee;
+
+   unsigned size = signature_size(callee);
+   if (size <= this->options->InlineAlwaysSize)
+      return true;
+
+   struct hash_entry *entry = _mesa_hash_table_search(this->call_counts, callee);
+   uint64_t calls = entry ? (intptr_t) entry->data : 1;
+   if (calls <= 1)
+      return true;
+
+   if (!signature_is_keepable(callee))
+      return true;
+
+   return (calls - 1) * size <= this->options->InlineGrowthBudget;
+}
+
+bool
+do_function_inlining(exec_list *instructions,
+                     const struct gl_shader_compiler_options *options)
+{
+   ir_function_inlining_visitor v(options);
+
+   ir_call_count_visitor counter(v.refs);
+   counter.run(instructions);
+
+   if (v.call_counts) {
+      struct hash_entry *entry;
+
+      hash_table_foreach(v.refs, entry)
+         _mesa_hash_table_insert(v.call_counts, entry->key, entry->data);
+   }
+
+   ir_call_graph_visitor graph(&v);
+
+   foreach_in_list(ir_instruction, ir, instructions) {
+      ir_function *const f = ir->as_function();
+
+      if (f == NULL)
+         continue;
+
+      foreach_in_list(ir_function_signature, sig, &f->signatures) {
+         graph.process(sig);
+      }
+   }
+
+   /* Calls can also appear outside of any function, e.g. in the
+    * initializers of globals before linking moves them into main().
+    */
+   foreach_in_list_safe(ir_instruction, ir, instructions) {
+      if (ir->as_function() == NULL) {
+         v.base_ir = ir;
+         ir->accept(&v);
+      }
+   }
 
    return v.progress;
 }
 
+static void
+remap_variable(ir_instruction *ir, void *data)
+{
+   struct hash_table *ht = (struct hash_table *) data;
+   ir_dereference_variable *deref = ir->as_dereference_variable();
+
+   if (deref) {
+      hash_entry *entry = _mesa_hash_table_search(ht, deref->var);
+      if (entry)
+         deref->var = (ir_variable *) entry->data;
+   }
+}
+
 static void
 replace_return_with_assignment(ir_instruction *ir, void *data)
 {
@@ -132,7 +407,7 @@ ir_save_lvalue_visitor::visit_enter(ir_dereference_array *deref)
 }
 
 void
-ir_call::generate_inline(ir_instruction *next_ir)
+ir_call::generate_inline(ir_instruction *next_ir, bool steal_body)
 {
    void *ctx = ralloc_parent(this);
    ir_variable **parameters;
@@ -226,12 +501,24 @@ ir_call::generate_inline(ir_instruction *next_ir)
 
    exec_list new_instructions;
 
-   /* Generate the inlined body of the function to a new list */
-   foreach_in_list(ir_instruction, ir, &callee->body) {
-      ir_instruction *new_ir = ir->clone(ctx, ht);
+   /* Generate the inlined body of the function to a new list.  A stolen
+    * body keeps its own locals; only the references to the parameters need
+    * to be pointed at our copies.
+    */
+   if (steal_body) {
+      callee->body.move_nodes_to(&new_instructions);
+
+      foreach_in_list_safe(ir_instruction, ir, &new_instructions) {
+         visit_tree(ir, remap_variable, ht);
+         visit_tree(ir, replace_return_with_assignment, this->return_deref);
+      }
+   } else {
+      foreach_in_list(ir_instruction, ir, &callee->body) {
+         ir_instruction *new_ir = ir->clone(ctx, ht);
 
-      new_instructions.push_tail(new_ir);
-      visit_tree(new_ir, replace_return_with_assignment, this->return_deref);
+         new_instructions.push_tail(new_ir);
+         visit_tree(new_ir, replace_return_with_assignment, this->return_deref);
+      }
    }
 
    /* If any opaque types were passed in, replace any deref of the
@@ -317,8 +604,16 @@ ir_function_inlining_visitor::visit_enter(ir_swizzle *ir)
 ir_visitor_status
 ir_function_inlining_visitor::visit_enter(ir_call *ir)
 {
-   if (can_inline(ir)) {
-      ir->generate_inline(ir);
+   if (should_inline(ir)) {
+      struct hash_entry *entry = _mesa_hash_table_search(this->refs, ir->callee);
+      bool last = false;
+
+      if (entry) {
+         entry->data = (void *) ((intptr_t) entry->data - 1);
+         last = entry->data == NULL;
+      }
+
+      ir->generate_inline(ir, last);
       ir->remove();
       this->progress = true;
    }
@@ -25,52 +25,49 @@
 #define OPT_MUL_ADD_TO_FMA_H
 
 #include "ir.h"
-#include "ir_hierarchical_visitor.h"
 
-class mul_add_to_fma_visitor : public ir_hierarchical_visitor {
-public:
-   mul_add_to_fma_visitor()
-   {
-      /* empty */
-   }
+/**
+ * ir_peephole rule for expressions: fuses a * b + c into fma(a, b, c)
+ */
+static inline bool
+rewrite_mul_add_to_fma(ir_rvalue **rvalue, void *)
+{
+   ir_expression *const ir = (ir_expression *) *rvalue;
 
-   ir_visitor_status visit_leave(ir_expression *ir)
-   {
-      if (ir->operation != ir_binop_add)
-         return visit_continue;
+   if (ir->operation != ir_binop_add)
+      return false;
 
-      ir_expression const *op0 = ir->operands[0]->as_expression();
-      if (op0 != NULL && op0->operation == ir_binop_mul) {
-         if (op0->operands[0]->type->is_matrix() || op0->operands[0]->type->is_array()) {
-            return visit_continue;
-         }
-         if (op0->operands[1]->type->is_matrix() || op0->operands[1]->type->is_array()) {
-            return visit_continue;
-         }
-         ir->operation = ir_triop_fma;
-         ir->operands[2] = ir->operands[1];
-         ir->operands[1] = op0->operands[1];
-         ir->operands[0] = op0->operands[0];
-         return visit_continue;
+   ir_expression const *op0 = ir->operands[0]->as_expression();
+   if (op0 != NULL && op0->operation == ir_binop_mul) {
+      if (op0->operands[0]->type->is_matrix() || op0->operands[0]->type->is_array()) {
+         return false;
       }
-
-      ir_expression const *op1 = ir->operands[1]->as_expression();
-      if (op1 != NULL && op1->operation == ir_binop_mul) {
-         if (op1->operands[0]->type->is_matrix() || op1->operands[0]->type->is_array()) {
-            return visit_continue;
-         }
-         if (op1->operands[1]->type->is_matrix() || op1->operands[1]->type->is_array()) {
-            return visit_continue;
-         }
-         ir->operation = ir_triop_fma;
-         ir->operands[2] = ir->operands[0];
-         ir->operands[1] = op1->operands[1];
-         ir->operands[0] = op1->operands[0];
-         return visit_continue;
+      if (op0->operands[1]->type->is_matrix() || op0->operands[1]->type->is_array()) {
+         return false;
       }
+      ir->operation = ir_triop_fma;
+      ir->operands[2] = ir->operands[1];
+      ir->operands[1] = op0->operands[1];
+      ir->operands[0] = op0->operands[0];
+      return true;
+   }
 
-      return visit_continue;
+   ir_expression const *op1 = ir->operands[1]->as_expression();
+   if (op1 != NULL && op1->operation == ir_binop_mul) {
+      if (op1->operands[0]->type->is_matrix() || op1->operands[0]->type->is_array()) {
+         return false;
+      }
+      if (op1->operands[1]->type->is_matrix() || op1->operands[1]->type->is_array()) {
+         return false;
+      }
+      ir->operation = ir_triop_fma;
+      ir->operands[2] = ir->operands[0];
+      ir->operands[1] = op1->operands[1];
+      ir->operands[0] = op1->operands[0];
+      return true;
    }
-};
+
+   return false;
+}
 
 #endif /* OPT_MUL_ADD_TO_FMA_H */
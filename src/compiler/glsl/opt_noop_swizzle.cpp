@@ -30,54 +30,37 @@
  */
 
 #include "ir.h"
-#include "ir_visitor.h"
-#include "ir_rvalue_visitor.h"
+#include "ir_peephole.h"
+#include "ir_optimization.h"
 #include "compiler/glsl_types.h"
 
-namespace {
-
-class ir_noop_swizzle_visitor : public ir_rvalue_visitor {
-public:
-   ir_noop_swizzle_visitor()
-   {
-      this->progress = false;
-   }
-
-   void handle_rvalue(ir_rvalue **rvalue);
-   bool progress;
-};
-
-} /* unnamed namespace */
-
-void
-ir_noop_swizzle_visitor::handle_rvalue(ir_rvalue **rvalue)
+bool
+rewrite_noop_swizzle(ir_rvalue **rvalue, void *)
 {
-   if (!*rvalue)
-      return;
-
    ir_swizzle *swiz = (*rvalue)->as_swizzle();
    if (!swiz || swiz->type != swiz->val->type)
-      return;
+      return false;
 
    int elems = swiz->val->type->vector_elements;
    if (swiz->mask.x != 0)
-      return;
+      return false;
    if (elems >= 2 && swiz->mask.y != 1)
-      return;
+      return false;
    if (elems >= 3 && swiz->mask.z != 2)
-      return;
+      return false;
    if (elems >= 4 && swiz->mask.w != 3)
-      return;
+      return false;
 
-   this->progress = true;
    *rvalue = swiz->val;
+   return true;
 }
 
 bool
 do_noop_swizzle(exec_list *instructions)
 {
-   ir_noop_swizzle_visitor v;
-   visit_list_elements(&v, instructions);
+   ir_peephole peephole;
+
+   peephole.add_rewrite(ir_type_swizzle, rewrite_noop_swizzle);
 
-   return v.progress;
+   return peephole.run(instructions);
 }
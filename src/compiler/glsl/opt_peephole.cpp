@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file opt_peephole.cpp
+ *
+ * Fused pipelines of local rewrites that share a single walk of the IR.
+ */
+
+#include "ir.h"
+#include "ir_peephole.h"
+#include "ir_optimization.h"
+#include "opt_add_neg_to_sub.h"
+#include "opt_mul_add_to_fma.h"
+
+/**
+ * Equivalent to do_vec_index_to_swizzle(), do_swizzle_swizzle() and
+ * do_noop_swizzle() run back to back.
+ */
+bool
+do_swizzle_peephole(exec_list *instructions)
+{
+   ir_peephole peephole;
+
+   peephole.add_rewrite(ir_type_expression, rewrite_vec_index_to_swizzle);
+   peephole.add_rewrite(ir_type_swizzle, rewrite_swizzle_swizzle);
+   peephole.add_rewrite(ir_type_swizzle, rewrite_noop_swizzle);
+
+   return peephole.run(instructions);
+}
+
+/**
+ * Final cleanup of a linked shader: forms subtractions and fused
+ * multiply-adds, then drops the variables that are no longer referenced.
+ */
+bool
+do_post_link_peephole(exec_list *instructions)
+{
+   ir_peephole peephole;
+   ir_dead_variables dead(&peephole);
+
+   peephole.add_rewrite(ir_type_expression, rewrite_add_neg_to_sub);
+   peephole.add_rewrite(ir_type_expression, rewrite_mul_add_to_fma);
+
+   bool progress = peephole.run(instructions);
+   dead.remove();
+
+   return progress;
+}
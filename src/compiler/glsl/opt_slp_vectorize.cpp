@@ -0,0 +1,546 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file opt_slp_vectorize.cpp
+ *
+ * Superword-level parallelism (SLP) vectorizer.
+ *
+ * Packs isomorphic scalar computations that write different variables into
+ * one vector computation.  For instance
+ *
+ * (assign (x) (var_ref a) (expression float * (swiz x (var_ref v)) (var_ref s)))
+ * (assign (x) (var_ref t) (expression float sin (var_ref u)))
+ * (assign (x) (var_ref b) (expression float * (swiz y (var_ref v)) (var_ref s)))
+ *
+ * becomes
+ *
+ * (declare (temporary) vec2 slp_vec)
+ * (assign (xy) (var_ref slp_vec) (expression vec2 * (swiz xy (var_ref v))
+ *                                                   (swiz xx (var_ref s))))
+ * (assign (x) (var_ref a) (swiz x (var_ref slp_vec)))
+ * (assign (x) (var_ref b) (swiz y (var_ref slp_vec)))
+ * (assign (x) (var_ref t) (expression float sin (var_ref u)))
+ *
+ * Unlike opt_vectorize.cpp, the packed assignments may write unrelated
+ * variables and need not be adjacent.  The pack is placed at the first
+ * assignment of the group and the others are hoisted up to it, so the
+ * statements they are hoisted above must not read or write their
+ * destinations, nor write anything they read.  Packing never crosses a
+ * basic block boundary.
+ *
+ * Each leaf of the packed trees has to be cheap to gather: a channel of one
+ * common vector, a constant, or one common scalar that gets broadcast.
+ * Anything else would need a per-channel construction that costs more than
+ * the vector operation saves.
+ */
+
+#include "ir.h"
+#include "ir_visitor.h"
+#include "ir_optimization.h"
+#include "compiler/glsl_types.h"
+
+/** How far past the first member of a group to look for more members. */
+#define SLP_WINDOW 32
+
+namespace {
+
+struct slp_statement {
+   ir_instruction *ir;
+
+   /** The assignment, if it is a candidate for packing. */
+   ir_assignment *candidate;
+
+   /** Number of expression nodes in the candidate's right-hand side. */
+   unsigned ops;
+
+   /** Variable written by the statement, if it is an assignment. */
+   ir_variable *write;
+
+   /** Channels of ::write that are written. */
+   unsigned write_mask;
+
+   /** Variables read by the statement. */
+   ir_variable **reads;
+   unsigned num_reads;
+
+   /** The statement ends the region that may be scanned. */
+   bool barrier;
+
+   /** Hoisted into an earlier group, so no longer at this position. */
+   bool moved;
+};
+
+class variable_collector : public ir_hierarchical_visitor {
+public:
+   variable_collector(void *mem_ctx)
+   {
+      this->mem_ctx = mem_ctx;
+      this->vars = NULL;
+      this->num_vars = 0;
+      this->size = 0;
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      for (unsigned i = 0; i < this->num_vars; i++) {
+         if (this->vars[i] == ir->var)
+            return visit_continue;
+      }
+
+      if (this->num_vars == this->size) {
+         this->size = this->size ? this->size * 2 : 4;
+         this->vars = reralloc(this->mem_ctx, this->vars, ir_variable *,
+                               this->size);
+      }
+
+      this->vars[this->num_vars++] = ir->var;
+      return visit_continue;
+   }
+
+   void *mem_ctx;
+   ir_variable **vars;
+   unsigned num_vars;
+   unsigned size;
+};
+
+class ir_slp_vectorize_visitor : public ir_hierarchical_visitor {
+public:
+   ir_slp_vectorize_visitor()
+   {
+      this->progress = false;
+   }
+
+   virtual ir_visitor_status visit_leave(ir_function_signature *);
+   virtual ir_visitor_status visit_leave(ir_if *);
+   virtual ir_visitor_status visit_leave(ir_loop *);
+
+   void process_block(exec_list *instructions);
+
+   bool progress;
+};
+
+} /* unnamed namespace */
+
+static bool
+packable_type(const glsl_type *type)
+{
+   /* Boolean vectors are not worth the trouble: comparisons that produce
+    * them are usually consumed by an if-statement one at a time anyway.
+    */
+   return type->is_scalar() &&
+          (type->base_type == GLSL_TYPE_FLOAT ||
+           type->base_type == GLSL_TYPE_INT ||
+           type->base_type == GLSL_TYPE_UINT);
+}
+
+/**
+ * Returns the number of expression nodes in the tree, or 0 if the tree
+ * contains something that cannot be packed.
+ */
+static unsigned
+count_packable_ops(ir_rvalue *ir)
+{
+   if (!packable_type(ir->type))
+      return 0;
+
+   switch (ir->ir_type) {
+   case ir_type_expression: {
+      ir_expression *expr = (ir_expression *) ir;
+
+      if (expr->is_horizontal())
+         return 0;
+
+      switch (expr->operation) {
+      case ir_unop_noise:
+      case ir_unop_subroutine_to_int:
+      case ir_unop_interpolate_at_centroid:
+      case ir_unop_get_buffer_size:
+      case ir_unop_ssbo_unsized_array_length:
+      case ir_binop_interpolate_at_offset:
+      case ir_binop_interpolate_at_sample:
+         return 0;
+      default:
+         break;
+      }
+
+      unsigned ops = 1;
+      for (unsigned i = 0; i < expr->get_num_operands(); i++) {
+         unsigned operand_ops = count_packable_ops(expr->operands[i]);
+         if (operand_ops == 0)
+            return 0;
+         if (expr->operands[i]->as_expression())
+            ops += operand_ops;
+      }
+      return ops;
+   }
+   case ir_type_swizzle:
+   case ir_type_constant:
+   case ir_type_dereference_variable:
+      /* Leaves are gathered for free. */
+      return 1;
+   default:
+      return 0;
+   }
+}
+
+/**
+ * Returns whether two trees compute the same operations on leaves that can
+ * be gathered into one vector.
+ */
+static bool
+isomorphic(ir_rvalue *a, ir_rvalue *b)
+{
+   if (a->ir_type != b->ir_type || a->type != b->type)
+      return false;
+
+   switch (a->ir_type) {
+   case ir_type_expression: {
+      ir_expression *ea = (ir_expression *) a;
+      ir_expression *eb = (ir_expression *) b;
+
+      if (ea->operation != eb->operation)
+         return false;
+
+      for (unsigned i = 0; i < ea->get_num_operands(); i++) {
+         if (!isomorphic(ea->operands[i], eb->operands[i]))
+            return false;
+      }
+      return true;
+   }
+   case ir_type_swizzle:
+      /* Any channel of the same value. */
+      return ((ir_swizzle *) a)->val->equals(((ir_swizzle *) b)->val);
+   case ir_type_constant:
+      return true;
+   case ir_type_dereference_variable:
+      return ((ir_dereference_variable *) a)->var ==
+             ((ir_dereference_variable *) b)->var;
+   default:
+      return false;
+   }
+}
+
+/**
+ * Builds the vector form of \c n isomorphic scalar trees.
+ */
+static ir_rvalue *
+pack_trees(void *mem_ctx, ir_rvalue **trees, unsigned n)
+{
+   const glsl_type *type =
+      glsl_type::get_instance(trees[0]->type->base_type, n, 1);
+
+   switch (trees[0]->ir_type) {
+   case ir_type_expression: {
+      ir_expression *expr = (ir_expression *) trees[0];
+      ir_rvalue *operands[4] = { NULL, NULL, NULL, NULL };
+
+      for (unsigned i = 0; i < expr->get_num_operands(); i++) {
+         ir_rvalue *sub[4];
+         for (unsigned k = 0; k < n; k++)
+            sub[k] = ((ir_expression *) trees[k])->operands[i];
+         operands[i] = pack_trees(mem_ctx, sub, n);
+      }
+
+      return new(mem_ctx) ir_expression(expr->operation, type,
+                                        operands[0], operands[1],
+                                        operands[2], operands[3]);
+   }
+   case ir_type_swizzle: {
+      unsigned comp[4] = { 0, 0, 0, 0 };
+      for (unsigned k = 0; k < n; k++)
+         comp[k] = ((ir_swizzle *) trees[k])->mask.x;
+
+      ir_rvalue *val = ((ir_swizzle *) trees[0])->val;
+      return new(mem_ctx) ir_swizzle(val->clone(mem_ctx, NULL),
+                                     comp[0], comp[1], comp[2], comp[3], n);
+   }
+   case ir_type_constant: {
+      ir_constant_data data;
+      memset(&data, 0, sizeof(data));
+
+      for (unsigned k = 0; k < n; k++) {
+         const ir_constant *c = (ir_constant *) trees[k];
+         switch (type->base_type) {
+         case GLSL_TYPE_FLOAT: data.f[k] = c->value.f[0]; break;
+         case GLSL_TYPE_INT:   data.i[k] = c->value.i[0]; break;
+         case GLSL_TYPE_UINT:  data.u[k] = c->value.u[0]; break;
+         default:
+            unreachable("not a packable type");
+         }
+      }
+
+      return new(mem_ctx) ir_constant(type, &data);
+   }
+   case ir_type_dereference_variable:
+      return new(mem_ctx) ir_swizzle(trees[0]->clone(mem_ctx, NULL),
+                                     0, 0, 0, 0, n);
+   default:
+      unreachable("not a packable tree");
+   }
+}
+
+static bool
+reads_variable(const slp_statement *s, const ir_variable *var)
+{
+   for (unsigned i = 0; i < s->num_reads; i++) {
+      if (s->reads[i] == var)
+         return true;
+   }
+   return false;
+}
+
+static bool
+writes_overlap(const slp_statement *a, const slp_statement *b)
+{
+   return a->write == b->write && (a->write_mask & b->write_mask) != 0;
+}
+
+/**
+ * Returns whether \c member can be moved across \c s.
+ */
+static bool
+independent(const slp_statement *member, const slp_statement *s)
+{
+   if (s->write && reads_variable(member, s->write))
+      return false;
+
+   return !reads_variable(s, member->write) && !writes_overlap(member, s);
+}
+
+static void
+analyze_statement(void *mem_ctx, ir_instruction *ir, slp_statement *s)
+{
+   memset(s, 0, sizeof(*s));
+   s->ir = ir;
+
+   switch (ir->ir_type) {
+   case ir_type_variable:
+      /* Declarations are hoisted along with the members that use them. */
+      return;
+   case ir_type_assignment:
+      break;
+   default:
+      /* Control flow, calls, jumps and emits end the scan. */
+      s->barrier = true;
+      return;
+   }
+
+   ir_assignment *assign = (ir_assignment *) ir;
+   variable_collector v(mem_ctx);
+
+   /* A plain variable on the left-hand side is only written, and only in
+    * the channels of the write mask.
+    */
+   assign->rhs->accept(&v);
+   if (assign->condition)
+      assign->condition->accept(&v);
+
+   s->write = assign->lhs->variable_referenced();
+   if (assign->lhs->ir_type == ir_type_dereference_variable &&
+       (assign->lhs->type->is_scalar() || assign->lhs->type->is_vector())) {
+      s->write_mask = assign->write_mask;
+   } else {
+      assign->lhs->accept(&v);
+      s->write_mask = ~0u;
+   }
+
+   s->reads = v.vars;
+   s->num_reads = v.num_vars;
+
+   if (assign->condition ||
+       assign->lhs->ir_type != ir_type_dereference_variable ||
+       assign->rhs->ir_type != ir_type_expression)
+      return;
+
+   /* Either a scalar variable or a single channel of a vector. */
+   unsigned mask = assign->write_mask;
+   if (mask == 0 || (mask & (mask - 1)) != 0)
+      return;
+
+   s->ops = count_packable_ops(assign->rhs);
+   if (s->ops != 0)
+      s->candidate = assign;
+}
+
+void
+ir_slp_vectorize_visitor::process_block(exec_list *instructions)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   unsigned count = instructions->length();
+   slp_statement *stmts = ralloc_array(mem_ctx, slp_statement, count);
+
+   unsigned n = 0;
+   foreach_in_list(ir_instruction, ir, instructions) {
+      analyze_statement(mem_ctx, ir, &stmts[n++]);
+   }
+
+   for (unsigned i = 0; i < count; i++) {
+      if (stmts[i].candidate == NULL || stmts[i].moved)
+         continue;
+
+      unsigned group[4] = { i, 0, 0, 0 };
+      unsigned size = 1;
+      ir_assignment *seed = stmts[i].candidate;
+      unsigned precision = stmts[i].write->data.precision;
+
+      /* Statements between the seed and the last member found so far, which
+       * any further member would have to be hoisted above.
+       */
+      unsigned skipped[SLP_WINDOW];
+      unsigned num_skipped = 0;
+
+      for (unsigned j = i + 1; j < count && j <= i + SLP_WINDOW && size < 4; j++) {
+         slp_statement *s = &stmts[j];
+
+         if (s->barrier)
+            break;
+
+         if (s->moved)
+            continue;
+
+         bool join = s->candidate != NULL &&
+                     isomorphic(seed->rhs, s->candidate->rhs);
+
+         /* Everything is computed before any member is written, so a member
+          * may not read what an earlier member writes.
+          */
+         for (unsigned k = 0; join && k < size; k++) {
+            const slp_statement *m = &stmts[group[k]];
+            if (reads_variable(s, m->write) || writes_overlap(s, m))
+               join = false;
+         }
+
+         for (unsigned k = 0; join && k < num_skipped; k++) {
+            if (!independent(s, &stmts[skipped[k]]))
+               join = false;
+         }
+
+         if (join) {
+            group[size++] = j;
+            if (s->write->data.precision != precision)
+               precision = GLSL_PRECISION_NONE;
+         } else {
+            skipped[num_skipped++] = j;
+         }
+      }
+
+      /* Packing n trees of k operations saves k * (n - 1) operations, but
+       * adds a temporary and n extracts.  Single operations are only worth
+       * it for three or more channels.
+       */
+      if (size < 2 || stmts[i].ops * (size - 1) < 2)
+         continue;
+
+      ir_rvalue *trees[4];
+      for (unsigned k = 0; k < size; k++)
+         trees[k] = stmts[group[k]].candidate->rhs;
+
+      void *ir_ctx = ralloc_parent(seed);
+      const glsl_type *type =
+         glsl_type::get_instance(seed->rhs->type->base_type, size, 1);
+
+      ir_variable *vec = new(ir_ctx) ir_variable(type, "slp_vec",
+                                                 ir_var_temporary);
+      vec->data.precision = precision;
+      seed->insert_before(vec);
+      seed->insert_before(new(ir_ctx) ir_assignment(
+         new(ir_ctx) ir_dereference_variable(vec),
+         pack_trees(ir_ctx, trees, size)));
+
+      /* Hoist the other members up to the seed, keeping their order, and
+       * the declarations they need along with them.
+       */
+      for (unsigned k = 0; k < num_skipped; k++) {
+         ir_variable *var = stmts[skipped[k]].ir->as_variable();
+         if (var == NULL)
+            continue;
+
+         for (unsigned m = 1; m < size; m++) {
+            const slp_statement *member = &stmts[group[m]];
+            if (group[m] > skipped[k] &&
+                (member->write == var || reads_variable(member, var))) {
+               var->remove();
+               vec->insert_before(var);
+               stmts[skipped[k]].moved = true;
+               break;
+            }
+         }
+      }
+
+      ir_instruction *insert_point = seed;
+      for (unsigned k = 0; k < size; k++) {
+         ir_assignment *member = stmts[group[k]].candidate;
+
+         member->rhs = new(ir_ctx) ir_swizzle(
+            new(ir_ctx) ir_dereference_variable(vec), k, 0, 0, 0, 1);
+
+         if (member != seed) {
+            member->remove();
+            insert_point->insert_after(member);
+            insert_point = member;
+            stmts[group[k]].moved = true;
+         }
+      }
+
+      this->progress = true;
+   }
+
+   ralloc_free(mem_ctx);
+}
+
+ir_visitor_status
+ir_slp_vectorize_visitor::visit_leave(ir_function_signature *ir)
+{
+   process_block(&ir->body);
+   return visit_continue;
+}
+
+ir_visitor_status
+ir_slp_vectorize_visitor::visit_leave(ir_if *ir)
+{
+   process_block(&ir->then_instructions);
+   process_block(&ir->else_instructions);
+   return visit_continue;
+}
+
+ir_visitor_status
+ir_slp_vectorize_visitor::visit_leave(ir_loop *ir)
+{
+   process_block(&ir->body_instructions);
+   return visit_continue;
+}
+
+/**
+ * Packs isomorphic scalar assignments within each basic block into vector
+ * operations.
+ */
+bool
+do_slp_vectorize(exec_list *instructions)
+{
+   ir_slp_vectorize_visitor v;
+
+   v.run(instructions);
+
+   return v.progress;
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file opt_strength_reduction.cpp
+ *
+ * Replaces arithmetic with cheaper equivalents when one of the operands is
+ * a constant:
+ *
+ *    x / c          ->  x * (1 / c)              (float, double)
+ *    pow(x, 3)      ->  x * x * x
+ *    pow(x, 0.5)    ->  sqrt(x),  pow(x, -0.5)  ->  rsq(x)
+ *    pow(x, -1)     ->  rcp(x),   pow(x, -2)    ->  rcp(x * x)
+ *    x * 2^n        ->  x << n                   (int, uint)
+ *    x / 2^n        ->  x >> n                   (uint)
+ *    x % 2^n        ->  x & (2^n - 1)            (uint)
+ *
+ * Signed division and modulo by a power of two round towards zero and would
+ * need a sign fixup, so they are left alone.
+ *
+ * Like opt_algebraic, trees assigned to invariant or precise variables are
+ * skipped; propagate_invariance marks everything such a value depends on.
+ */
+
+#include <math.h>
+#include "util/bitscan.h"
+#include "ir.h"
+#include "ir_rvalue_visitor.h"
+#include "ir_optimization.h"
+#include "ir_builder.h"
+#include "compiler/glsl_types.h"
+
+using namespace ir_builder;
+
+namespace {
+
+class ir_strength_reduction_visitor : public ir_rvalue_visitor {
+public:
+   ir_strength_reduction_visitor(bool native_integers)
+   {
+      this->progress = false;
+      this->native_integers = native_integers;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_assignment *ir);
+
+   ir_rvalue *handle_expression(ir_expression *ir);
+   void handle_rvalue(ir_rvalue **rvalue);
+
+   ir_variable *make_temporary(ir_rvalue *value, const char *name);
+
+   bool native_integers;
+   bool progress;
+};
+
+} /* unnamed namespace */
+
+ir_visitor_status
+ir_strength_reduction_visitor::visit_enter(ir_assignment *ir)
+{
+   ir_variable *var = ir->lhs->variable_referenced();
+   if (var->data.invariant || var->data.precise)
+      return visit_continue_with_parent;
+
+   return visit_continue;
+}
+
+/**
+ * Returns true if every component of \c ir is the same float value, which
+ * is stored in \c value.
+ */
+static bool
+is_splat_float(ir_constant *ir, float *value)
+{
+   if (ir == NULL || ir->type->base_type != GLSL_TYPE_FLOAT ||
+       !(ir->type->is_scalar() || ir->type->is_vector()))
+      return false;
+
+   *value = ir->value.f[0];
+   for (unsigned c = 1; c < ir->type->vector_elements; c++) {
+      if (ir->value.f[c] != *value)
+         return false;
+   }
+
+   return true;
+}
+
+/**
+ * Returns the reciprocal of a float or double constant, or NULL if some
+ * component is zero or not finite.
+ */
+static ir_constant *
+reciprocal(ir_constant *ir)
+{
+   if (ir->type->is_matrix())
+      return NULL;
+
+   ir_constant_data data;
+   memset(&data, 0, sizeof(data));
+
+   for (unsigned c = 0; c < ir->type->vector_elements; c++) {
+      switch (ir->type->base_type) {
+      case GLSL_TYPE_FLOAT:
+         if (ir->value.f[c] == 0.0f || !isfinite(ir->value.f[c]))
+            return NULL;
+         data.f[c] = 1.0f / ir->value.f[c];
+         if (!isfinite(data.f[c]))
+            return NULL;
+         break;
+      case GLSL_TYPE_DOUBLE:
+         if (ir->value.d[c] == 0.0 || !isfinite(ir->value.d[c]))
+            return NULL;
+         data.d[c] = 1.0 / ir->value.d[c];
+         if (!isfinite(data.d[c]))
+            return NULL;
+         break;
+      default:
+         return NULL;
+      }
+   }
+
+   return new(ralloc_parent(ir)) ir_constant(ir->type, &data);
+}
+
+/**
+ * If every component of an int or uint constant is a positive power of two,
+ * returns a constant of \c components components holding log2 of each
+ * component (or, for \c mask, the power of two minus one).  Returns NULL
+ * otherwise.
+ */
+static ir_constant *
+power_of_two_operand(ir_constant *ir, unsigned components, bool mask)
+{
+   if (ir == NULL || ir->type->is_matrix() ||
+       (ir->type->base_type != GLSL_TYPE_INT &&
+        ir->type->base_type != GLSL_TYPE_UINT))
+      return NULL;
+
+   ir_constant_data data;
+   memset(&data, 0, sizeof(data));
+
+   for (unsigned c = 0; c < components; c++) {
+      unsigned src = ir->type->is_scalar() ? 0 : c;
+      unsigned value = ir->value.u[src];
+
+      if (ir->type->base_type == GLSL_TYPE_INT && ir->value.i[src] <= 0)
+         return NULL;
+      if (value == 0 || (value & (value - 1)) != 0)
+         return NULL;
+
+      data.u[c] = mask ? value - 1 : ffs(value) - 1;
+   }
+
+   const glsl_type *type =
+      glsl_type::get_instance(ir->type->base_type, components, 1);
+   return new(ralloc_parent(ir)) ir_constant(type, &data);
+}
+
+ir_variable *
+ir_strength_reduction_visitor::make_temporary(ir_rvalue *value,
+                                              const char *name)
+{
+   ir_variable *var = new(ralloc_parent(value)) ir_variable(value->type, name,
+                                                            ir_var_temporary);
+   base_ir->insert_before(var);
+   base_ir->insert_before(assign(var, value));
+   return var;
+}
+
+ir_rvalue *
+ir_strength_reduction_visitor::handle_expression(ir_expression *ir)
+{
+   if (ir->get_num_operands() != 2)
+      return ir;
+
+   ir_constant *op_const[2];
+   op_const[0] = ir->operands[0]->as_constant();
+   op_const[1] = ir->operands[1]->as_constant();
+
+   const unsigned base_type = ir->type->base_type;
+   const bool is_float = base_type == GLSL_TYPE_FLOAT ||
+                         base_type == GLSL_TYPE_DOUBLE;
+
+   switch (ir->operation) {
+   case ir_binop_div:
+      if (!op_const[1] || op_const[0])
+         break;
+
+      if (is_float) {
+         ir_constant *rcp_const = reciprocal(op_const[1]);
+         if (rcp_const)
+            return mul(ir->operands[0], rcp_const);
+      } else if (base_type == GLSL_TYPE_UINT && native_integers) {
+         ir_constant *shift =
+            power_of_two_operand(op_const[1], ir->type->vector_elements, false);
+         if (shift)
+            return rshift(ir->operands[0], shift);
+      }
+      break;
+
+   case ir_binop_mod:
+      if (base_type != GLSL_TYPE_UINT || !native_integers ||
+          !op_const[1] || op_const[0])
+         break;
+
+      {
+         ir_constant *mask =
+            power_of_two_operand(op_const[1], ir->type->vector_elements, true);
+         if (mask)
+            return bit_and(ir->operands[0], mask);
+      }
+      break;
+
+   case ir_binop_mul:
+      if ((base_type != GLSL_TYPE_INT && base_type != GLSL_TYPE_UINT) ||
+          !native_integers)
+         break;
+
+      for (int i = 0; i < 2; i++) {
+         if (!op_const[i] || op_const[1 - i])
+            continue;
+
+         ir_rvalue *other = ir->operands[1 - i];
+         if (other->type != ir->type)
+            continue;
+
+         ir_constant *shift =
+            power_of_two_operand(op_const[i], ir->type->vector_elements, false);
+         if (shift)
+            return lshift(other, shift);
+      }
+      break;
+
+   case ir_binop_pow: {
+      float exponent;
+      if (!is_splat_float(op_const[1], &exponent) || op_const[0])
+         break;
+
+      /* pow(x, 2) and pow(x, 4) are already handled by opt_algebraic. */
+      if (exponent == 3.0f) {
+         ir_variable *x = make_temporary(ir->operands[0], "x");
+         return mul(mul(x, x), x);
+      }
+
+      if (exponent == 0.5f)
+         return sqrt(ir->operands[0]);
+
+      if (exponent == -0.5f)
+         return rsq(ir->operands[0]);
+
+      if (exponent == -1.0f)
+         return expr(ir_unop_rcp, ir->operands[0]);
+
+      if (exponent == -2.0f) {
+         ir_variable *x = make_temporary(ir->operands[0], "x");
+         return expr(ir_unop_rcp, mul(x, x));
+      }
+      break;
+   }
+
+   default:
+      break;
+   }
+
+   return ir;
+}
+
+void
+ir_strength_reduction_visitor::handle_rvalue(ir_rvalue **rvalue)
+{
+   if (!*rvalue)
+      return;
+
+   ir_expression *expr = (*rvalue)->as_expression();
+   if (!expr || expr->operation == ir_quadop_vector)
+      return;
+
+   ir_rvalue *new_rvalue = handle_expression(expr);
+   if (new_rvalue == *rvalue)
+      return;
+
+   *rvalue = new_rvalue;
+   this->progress = true;
+}
+
+bool
+do_strength_reduction(exec_list *instructions, bool native_integers)
+{
+   ir_strength_reduction_visitor v(native_integers);
+
+   visit_list_elements(&v, instructions);
+
+   return v.progress;
+}
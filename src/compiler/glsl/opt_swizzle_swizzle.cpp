@@ -28,34 +28,19 @@
  */
 
 #include "ir.h"
-#include "ir_visitor.h"
+#include "ir_peephole.h"
 #include "ir_optimization.h"
 #include "compiler/glsl_types.h"
 
-namespace {
-
-class ir_swizzle_swizzle_visitor : public ir_hierarchical_visitor {
-public:
-   ir_swizzle_swizzle_visitor()
-   {
-      progress = false;
-   }
-
-   virtual ir_visitor_status visit_enter(ir_swizzle *);
-
-   bool progress;
-};
-
-} /* unnamed namespace */
-
-ir_visitor_status
-ir_swizzle_swizzle_visitor::visit_enter(ir_swizzle *ir)
+bool
+rewrite_swizzle_swizzle(ir_rvalue **rvalue, void *)
 {
+   ir_swizzle *const ir = (ir_swizzle *) *rvalue;
    int mask2[4];
 
    ir_swizzle *swiz2 = ir->val->as_swizzle();
    if (!swiz2)
-      return visit_continue;
+      return false;
 
    memset(&mask2, 0, sizeof(mask2));
    if (swiz2->mask.num_components >= 1)
@@ -78,9 +63,7 @@ ir_swizzle_swizzle_visitor::visit_enter(ir_swizzle *ir)
 
    ir->val = swiz2->val;
 
-   this->progress = true;
-
-   return visit_continue;
+   return true;
 }
 
 /**
@@ -89,9 +72,9 @@ ir_swizzle_swizzle_visitor::visit_enter(ir_swizzle *ir)
 bool
 do_swizzle_swizzle(exec_list *instructions)
 {
-   ir_swizzle_swizzle_visitor v;
+   ir_peephole peephole;
 
-   v.run(instructions);
+   peephole.add_rewrite(ir_type_swizzle, rewrite_swizzle_swizzle);
 
-   return v.progress;
+   return peephole.run(instructions);
 }
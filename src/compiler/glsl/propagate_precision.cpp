@@ -0,0 +1,282 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file propagate_precision.cpp
+ * Infer the precision each expression is evaluated at.
+ *
+ * Section 4.5.2 (Precision Qualifiers) of the GLSL ES 3.00 spec says:
+ *
+ *    "The precision used to internally evaluate an operation, and the
+ *    precision qualification subsequently associated with any resulting
+ *    intermediate values, must be at least as high as the highest precision
+ *    qualification of the operands consumed by the operation.
+ *
+ *    In cases where operands do not have a precision qualifier, the
+ *    precision qualification will come from the other operands. If no
+ *    operands have a precision qualifier, then the precision qualifications
+ *    of the operands of the next consuming operation in the expression will
+ *    be used. This rule can be applied recursively until a precision
+ *    qualified operand is found. If necessary, it will also include the
+ *    precision qualification of l-values for assignments [...]"
+ *
+ * Each expression tree is walked bottom-up to take the highest precision of
+ * its operands, then top-down to hand the precision of the consumer (or of
+ * the assigned variable) to sub-expressions that have none, such as
+ * operations on literal constants.
+ *
+ * Compiler-generated temporaries carry no precision qualifier.  They are
+ * given the highest precision of the values assigned to them, which in turn
+ * feeds the expressions that read them, so the walk is repeated until no
+ * temporary changes.  A call assigns to its return value temporary and to
+ * its out parameters, at the precision of the callee's return value and
+ * formal parameters.
+ */
+
+#include "ir.h"
+#include "ir_visitor.h"
+#include "ir_optimization.h"
+#include "compiler/glsl_types.h"
+#include "util/hash_table.h"
+#include "util/set.h"
+
+namespace {
+
+class ir_precision_propagation_visitor : public ir_hierarchical_visitor {
+public:
+   ir_precision_propagation_visitor()
+   {
+      this->progress = false;
+      this->resolved = NULL;
+      this->inferred = _mesa_set_create(NULL, _mesa_hash_pointer,
+                                        _mesa_key_pointer_equal);
+   }
+
+   virtual ~ir_precision_propagation_visitor()
+   {
+      _mesa_set_destroy(this->inferred, NULL);
+   }
+
+   virtual ir_visitor_status visit_enter(ir_assignment *ir);
+   virtual ir_visitor_status visit_enter(ir_expression *ir);
+   virtual ir_visitor_status visit_enter(ir_call *ir);
+
+   unsigned rvalue_precision(ir_rvalue *ir);
+   void resolve(ir_rvalue *ir, unsigned precision);
+   void assign(ir_variable *var, unsigned precision);
+
+   /** Expressions whose precision has been set during this walk. */
+   struct set *resolved;
+
+   /** Temporaries whose precision is inferred from their assignments. */
+   struct set *inferred;
+
+   bool progress;
+};
+
+} /* unnamed namespace */
+
+static unsigned
+precision_rank(unsigned precision)
+{
+   switch (precision) {
+   case GLSL_PRECISION_LOW:    return 1;
+   case GLSL_PRECISION_MEDIUM: return 2;
+   case GLSL_PRECISION_HIGH:   return 3;
+   default:                    return 0;
+   }
+}
+
+static unsigned
+highest_precision(unsigned a, unsigned b)
+{
+   return precision_rank(a) >= precision_rank(b) ? a : b;
+}
+
+static bool
+precision_allowed(const glsl_type *type)
+{
+   type = type->without_array();
+   return type->base_type == GLSL_TYPE_FLOAT ||
+          type->base_type == GLSL_TYPE_INT ||
+          type->base_type == GLSL_TYPE_UINT;
+}
+
+/**
+ * Computes the precision of the expressions in the tree bottom-up and
+ * returns the precision of \c ir, or GLSL_PRECISION_NONE if it has none.
+ */
+unsigned
+ir_precision_propagation_visitor::rvalue_precision(ir_rvalue *ir)
+{
+   ir_expression *expr = ir->as_expression();
+   if (expr) {
+      unsigned precision = GLSL_PRECISION_NONE;
+      for (unsigned i = 0; i < expr->get_num_operands(); i++) {
+         precision = highest_precision(precision,
+                                       rvalue_precision(expr->operands[i]));
+      }
+      expr->precision = precision;
+
+      /* Booleans carry no precision of their own, so a comparison does not
+       * raise the precision of the expression consuming it.
+       */
+      return expr->type->is_boolean() ? GLSL_PRECISION_NONE : (glsl_precision) precision;
+   }
+
+   ir_swizzle *swiz = ir->as_swizzle();
+   if (swiz)
+      return rvalue_precision(swiz->val);
+
+   ir_texture *tex = ir->as_texture();
+   if (tex)
+      return tex->sampler->variable_referenced()->data.precision;
+
+   ir_dereference *deref = ir->as_dereference();
+   if (deref) {
+      ir_variable *var = deref->variable_referenced();
+      return var ? (glsl_precision) var->data.precision : GLSL_PRECISION_NONE;
+   }
+
+   return GLSL_PRECISION_NONE;
+}
+
+/**
+ * Hands \c precision down to the expressions in the tree that have none.
+ */
+void
+ir_precision_propagation_visitor::resolve(ir_rvalue *ir, unsigned precision)
+{
+   ir_swizzle *swiz = ir->as_swizzle();
+   if (swiz) {
+      resolve(swiz->val, precision);
+      return;
+   }
+
+   ir_expression *expr = ir->as_expression();
+   if (!expr)
+      return;
+
+   if (expr->precision == GLSL_PRECISION_NONE)
+      expr->precision = precision;
+
+   _mesa_set_add(this->resolved, expr);
+
+   for (unsigned i = 0; i < expr->get_num_operands(); i++)
+      resolve(expr->operands[i], expr->precision);
+}
+
+/**
+ * Raises the precision of a temporary to that of a value assigned to it.
+ */
+void
+ir_precision_propagation_visitor::assign(ir_variable *var, unsigned precision)
+{
+   if (var->data.mode != ir_var_temporary || !precision_allowed(var->type))
+      return;
+
+   if (var->data.precision == GLSL_PRECISION_NONE)
+      _mesa_set_add(this->inferred, var);
+
+   if (_mesa_set_search(this->inferred, var)) {
+      unsigned highest = highest_precision(var->data.precision, precision);
+      if (highest != var->data.precision) {
+         var->data.precision = highest;
+         this->progress = true;
+      }
+   }
+}
+
+ir_visitor_status
+ir_precision_propagation_visitor::visit_enter(ir_assignment *ir)
+{
+   ir_variable *var = ir->lhs->variable_referenced();
+
+   assign(var, rvalue_precision(ir->rhs));
+   resolve(ir->rhs, var->data.precision);
+
+   return visit_continue;
+}
+
+ir_visitor_status
+ir_precision_propagation_visitor::visit_enter(ir_expression *ir)
+{
+   /* Sub-expressions of a tree already handled from its root. */
+   if (_mesa_set_search(this->resolved, ir))
+      return visit_continue;
+
+   rvalue_precision(ir);
+   resolve(ir, GLSL_PRECISION_NONE);
+
+   return visit_continue;
+}
+
+ir_visitor_status
+ir_precision_propagation_visitor::visit_enter(ir_call *ir)
+{
+   /* Built-ins have no declared precision; their result is as precise as
+    * the most precise argument.
+    */
+   unsigned precision = ir->callee->return_precision;
+   bool from_arguments = precision == GLSL_PRECISION_NONE;
+
+   foreach_two_lists(formal_node, &ir->callee->parameters,
+                     actual_node, &ir->actual_parameters) {
+      ir_variable *formal = (ir_variable *) formal_node;
+      ir_rvalue *actual = (ir_rvalue *) actual_node;
+
+      if (formal->data.mode == ir_var_function_out ||
+          formal->data.mode == ir_var_function_inout) {
+         ir_variable *var = actual->variable_referenced();
+         if (var)
+            assign(var, formal->data.precision);
+      }
+
+      if (formal->data.mode != ir_var_function_out) {
+         unsigned actual_precision = rvalue_precision(actual);
+         if (from_arguments)
+            precision = highest_precision(precision, actual_precision);
+         resolve(actual, formal->data.precision != GLSL_PRECISION_NONE ?
+                         formal->data.precision : actual_precision);
+      }
+   }
+
+   if (ir->return_deref)
+      assign(ir->return_deref->var, precision);
+
+   return visit_continue;
+}
+
+void
+propagate_precision(exec_list *instructions)
+{
+   ir_precision_propagation_visitor visitor;
+
+   do {
+      visitor.progress = false;
+      visitor.resolved = _mesa_set_create(NULL, _mesa_hash_pointer,
+                                          _mesa_key_pointer_equal);
+      visit_list_elements(&visitor, instructions);
+      _mesa_set_destroy(visitor.resolved, NULL);
+   } while (visitor.progress);
+}
@@ -44,9 +44,8 @@
 #include "ir_print_spirv_visitor.h"
 #include "compiler/spirv/disassemble.h"
 #include "compiler/spirv/spirv_glsl.hpp"
+#include "compiler/spirv/spirv_cpp.hpp"
 #include "builtin_functions.h"
-#include "opt_add_neg_to_sub.h"
-#include "opt_mul_add_to_fma.h"
 
 void
 init_gl_program(struct gl_program *prog, GLenum target, bool is_arb_asm)
@@ -88,6 +87,8 @@ initialize_context(struct gl_context *ctx, gl_api api)
     */
    ctx->Const.GLSLVersion = options->glsl_version;
    ctx->Extensions.ARB_ES3_compatibility = true;
+   for (int sh = 0; sh < MESA_SHADER_STAGES; ++sh)
+      ctx->Const.ShaderCompilerOptions[sh].InlineGrowthBudget = options->inline_budget;
    ctx->Const.MaxComputeWorkGroupCount[0] = 65535;
    ctx->Const.MaxComputeWorkGroupCount[1] = 65535;
    ctx->Const.MaxComputeWorkGroupCount[2] = 65535;
@@ -343,6 +344,44 @@ compile_shader(struct gl_context *ctx, struct gl_shader *shader)
    return;
 }
 
+/* With --arena, everything hanging off the program is bump-allocated out of
+ * an arena context that is thrown away in one go with the program.
+ */
+static struct gl_shader_program *
+create_shader_program(void)
+{
+   void *mem_ctx = options->arena ? ralloc_arena_context(NULL) : NULL;
+
+   return rzalloc(mem_ctx, struct gl_shader_program);
+}
+
+static void
+destroy_shader_program(struct gl_shader_program *prog)
+{
+   void *mem_ctx = ralloc_parent(prog);
+
+   ralloc_free(mem_ctx != NULL ? mem_ctx : prog);
+}
+
+/**
+ * Print the C++ which spirv-cross generates for a SPIR-V module, with
+ * options->simd_width invocations per call (0 for the scalar output).
+ *
+ * The SIMD output rejects what its runtime cannot run, so failing to
+ * compile is reported rather than fatal.
+ */
+static void
+print_spirv_cpp(const unsigned int *spirv, size_t word_count)
+{
+   try {
+      spirv_cross::CompilerCPP cpp(spirv, word_count);
+      cpp.set_simd_width(options->simd_width);
+      std::cout << cpp.compile();
+   } catch (const std::exception &e) {
+      fprintf(stderr, "SPIR-V to C++ failed: %s\n", e.what());
+   }
+}
+
 extern "C" struct gl_shader_program *
 standalone_compile_shader(const struct standalone_options *_options,
       unsigned num_files, char* const* files)
@@ -386,7 +425,7 @@ standalone_compile_shader(const struct standalone_options *_options,
 
    struct gl_shader_program *whole_program;
 
-   whole_program = rzalloc (NULL, struct gl_shader_program);
+   whole_program = create_shader_program();
    assert(whole_program != NULL);
    whole_program->data = rzalloc(whole_program, struct gl_shader_program_data);
    assert(whole_program->data != NULL);
@@ -485,7 +524,7 @@ standalone_compile_shader(const struct standalone_options *_options,
 
             bool progress;
             do {
-               progress = do_function_inlining(ir);
+               progress = do_function_inlining(ir, compiler_options);
 
                progress = do_common_optimization(ir,
                                                  true,
@@ -514,13 +553,8 @@ standalone_compile_shader(const struct standalone_options *_options,
          if (!shader)
             continue;
 
-         add_neg_to_sub_visitor av;
-         visit_list_elements(&av, shader->ir);
-
-         mul_add_to_fma_visitor mv;
-         visit_list_elements(&mv, shader->ir);
-
-         do_dead_variables(shader->ir);
+         do_post_link_peephole(shader->ir);
+         propagate_precision(shader->ir);
       }
 
       if (options->dump_lir) {
@@ -553,6 +587,7 @@ standalone_compile_shader(const struct standalone_options *_options,
                continue;
 
             spirv_buffer buffer;
+            buffer.native_16bit = options->spirv_16bit;
             _mesa_print_spirv(&buffer, shader->ir, gl_shader_stage(i), whole_program->Shaders[0]->Version, whole_program->IsES, 0, 0);
 
             std::vector<unsigned int> spirv_data(buffer.data(), buffer.data() + buffer.count());
@@ -560,19 +595,24 @@ standalone_compile_shader(const struct standalone_options *_options,
 
             if (options->dump_spirv_glsl) {
 
-               // Read SPIR-V from.
-               spirv_cross::CompilerGLSL glsl(spirv_data);
+               // Read SPIR-V from the buffer in place.
+               auto module = spirv_cross::ParsedIR::parse(buffer.data(), buffer.count());
+               spirv_cross::CompilerGLSL glsl(module);
 
                // Set some options.
-               spirv_cross::CompilerGLSL::Options options;
-               options.version = whole_program->Shaders[0]->Version;
-               options.es = whole_program->IsES;
-               glsl.set_options(options);
+               spirv_cross::CompilerGLSL::Options glsl_options;
+               glsl_options.version = whole_program->Shaders[0]->Version;
+               glsl_options.es = whole_program->IsES;
+               glsl_options.minify = options->minify_spirv_glsl;
+               glsl.set_options(glsl_options);
 
                // Compile to GLSL, ready to give to GL driver.
                std::string source = glsl.compile();
                std::cout << source;
             }
+
+            if (options->dump_spirv_cpp)
+               print_spirv_cpp(buffer.data(), buffer.count());
          }
       }
    }
@@ -585,7 +625,7 @@ fail:
          ralloc_free(whole_program->_LinkedShaders[i]->Program);
    }
 
-   ralloc_free(whole_program);
+   destroy_shader_program(whole_program);
    return NULL;
 }
 
@@ -633,7 +673,7 @@ standalone_generate_spirv(const struct standalone_options *_options,
 
    struct gl_shader_program *whole_program;
 
-   whole_program = rzalloc (NULL, struct gl_shader_program);
+   whole_program = create_shader_program();
    assert(whole_program != NULL);
    whole_program->data = rzalloc(whole_program, struct gl_shader_program_data);
    assert(whole_program->data != NULL);
@@ -724,7 +764,7 @@ standalone_generate_spirv(const struct standalone_options *_options,
 
             bool progress;
             do {
-               progress = do_function_inlining(ir);
+               progress = do_function_inlining(ir, compiler_options);
 
                progress = do_common_optimization(ir,
                                                  true,
@@ -752,13 +792,8 @@ standalone_generate_spirv(const struct standalone_options *_options,
       if (!shader)
          goto fail;
 
-      add_neg_to_sub_visitor av;
-      visit_list_elements(&av, shader->ir);
-
-      mul_add_to_fma_visitor mv;
-      visit_list_elements(&mv, shader->ir);
-
-      do_dead_variables(shader->ir);
+      do_post_link_peephole(shader->ir);
+      propagate_precision(shader->ir);
 
       if (options->dump_lir) {
 
@@ -773,31 +808,37 @@ standalone_generate_spirv(const struct standalone_options *_options,
          goto fail;
 
       spirv_buffer buffer;
+      buffer.native_16bit = options->spirv_16bit;
       _mesa_print_spirv(&buffer, shader->ir, stage, whole_program->Shaders[0]->Version, whole_program->IsES, 0, 0);
 
-      std::vector<unsigned int> spirv_data(buffer.data(), buffer.data() + buffer.count());
       if (options->dump_spirv) {
+         std::vector<unsigned int> spirv_data(buffer.data(), buffer.data() + buffer.count());
          spv::Disassemble(std::cout, spirv_data);
       }
 
       if (options->dump_spirv_glsl) {
 
-         // Read SPIR-V from.
-         spirv_cross::CompilerGLSL glsl(spirv_data);
+         // Read SPIR-V from the buffer in place.
+         auto module = spirv_cross::ParsedIR::parse(buffer.data(), buffer.count());
+         spirv_cross::CompilerGLSL glsl(module);
 
          // Set some options.
-         spirv_cross::CompilerGLSL::Options options;
-         options.version = whole_program->Shaders[0]->Version;
-         options.es = whole_program->IsES;
-         glsl.set_options(options);
+         spirv_cross::CompilerGLSL::Options glsl_options;
+         glsl_options.version = whole_program->Shaders[0]->Version;
+         glsl_options.es = whole_program->IsES;
+         glsl_options.minify = options->minify_spirv_glsl;
+         glsl.set_options(glsl_options);
 
          // Compile to GLSL, ready to give to GL driver.
          std::string source = glsl.compile();
          std::cout << source;
       }
 
-      bin_size = (spirv_data.size() > buffer_len) ? buffer_len : spirv_data.size() * sizeof(unsigned int);
-      memcpy(out_buffer, spirv_data.data(), bin_size);
+      if (options->dump_spirv_cpp)
+         print_spirv_cpp(buffer.data(), buffer.count());
+
+      bin_size = (buffer.count() > buffer_len) ? buffer_len : buffer.count() * sizeof(unsigned int);
+      memcpy(out_buffer, buffer.data(), bin_size);
    }
 
    return bin_size;
@@ -808,7 +849,7 @@ fail:
          ralloc_free(whole_program->_LinkedShaders[i]->Program);
    }
 
-   ralloc_free(whole_program);
+   destroy_shader_program(whole_program);
    return -1;
 }
 
@@ -824,7 +865,7 @@ standalone_compiler_cleanup(struct gl_shader_program *whole_program)
    delete whole_program->FragDataBindings;
    delete whole_program->FragDataIndexBindings;
 
-   ralloc_free(whole_program);
+   destroy_shader_program(whole_program);
    _mesa_glsl_release_types();
    _mesa_glsl_release_builtin_functions();
 }
@@ -36,8 +36,15 @@ struct standalone_options {
    int dump_builder;
    int dump_spirv;
    int dump_spirv_glsl;
+   int minify_spirv_glsl;
+   int dump_spirv_cpp;
+   int simd_width;
    int do_link;
    int just_log;
+   int inline_budget;
+   int spirv_16bit;
+   int arena;
+   int ralloc_stats;
 };
 
 struct gl_shader_program;
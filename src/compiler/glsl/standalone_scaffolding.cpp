@@ -247,6 +247,7 @@ void initialize_context_to_defaults(struct gl_context *ctx, gl_api api)
    memset(&options, 0, sizeof(options));
    options.MaxUnrollIterations = 32;
    options.MaxIfDepth = UINT_MAX;
+   options.InlineAlwaysSize = 32;
 
    for (int sh = 0; sh < MESA_SHADER_STAGES; ++sh)
       memcpy(&ctx->Const.ShaderCompilerOptions[sh], &options, sizeof(options));
@@ -0,0 +1,254 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "ir.h"
+#include "ir_optimization.h"
+
+class opt_dead_store : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   ir_constant *matrix_constant(float value);
+   ir_assignment *assign_matrix(ir_variable *var, ir_rvalue *value);
+   ir_assignment *assign_vector(ir_variable *var, float value,
+                                unsigned write_mask);
+   ir_assignment *read_xy(ir_variable *var);
+
+   void *mem_ctx;
+   exec_list instructions;
+   ir_function_signature *main_sig;
+   ir_variable *m;
+   ir_variable *v;
+   ir_variable *cond;
+   ir_variable *out;
+};
+
+void
+opt_dead_store::SetUp()
+{
+   mem_ctx = ralloc_context(NULL);
+
+   instructions.make_empty();
+
+   cond = new(mem_ctx) ir_variable(glsl_type::bool_type, "cond",
+                                   ir_var_uniform);
+   out = new(mem_ctx) ir_variable(glsl_type::vec2_type, "out",
+                                  ir_var_shader_out);
+   instructions.push_tail(cond);
+   instructions.push_tail(out);
+
+   ir_function *main_func = new(mem_ctx) ir_function("main");
+   main_sig = new(mem_ctx) ir_function_signature(glsl_type::void_type);
+   main_sig->is_defined = true;
+   main_func->add_signature(main_sig);
+   instructions.push_tail(main_func);
+
+   m = new(mem_ctx) ir_variable(glsl_type::mat2_type, "m",
+                                ir_var_temporary);
+   main_sig->body.push_tail(m);
+
+   /* Declared by the tests that use it. */
+   v = new(mem_ctx) ir_variable(glsl_type::vec4_type, "v",
+                                ir_var_temporary);
+}
+
+void
+opt_dead_store::TearDown()
+{
+   ralloc_free(mem_ctx);
+   mem_ctx = NULL;
+}
+
+ir_constant *
+opt_dead_store::matrix_constant(float value)
+{
+   ir_constant_data data;
+
+   memset(&data, 0, sizeof(data));
+   for (unsigned i = 0; i < 4; i++)
+      data.f[i] = value;
+
+   return new(mem_ctx) ir_constant(glsl_type::mat2_type, &data);
+}
+
+ir_assignment *
+opt_dead_store::assign_matrix(ir_variable *var, ir_rvalue *value)
+{
+   return new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(var),
+                                     value);
+}
+
+/**
+ * Stores \c value to the channels of \c var in \c write_mask.
+ */
+ir_assignment *
+opt_dead_store::assign_vector(ir_variable *var, float value,
+                              unsigned write_mask)
+{
+   unsigned channels = 0;
+   for (unsigned i = 0; i < 4; i++) {
+      if (write_mask & (1 << i))
+         channels++;
+   }
+
+   return new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(var),
+                                     new(mem_ctx) ir_constant(value, channels),
+                                     NULL, write_mask);
+}
+
+/**
+ * Copies var.xy to the output.
+ */
+ir_assignment *
+opt_dead_store::read_xy(ir_variable *var)
+{
+   ir_rvalue *xy =
+      new(mem_ctx) ir_swizzle(new(mem_ctx) ir_dereference_variable(var),
+                              0, 1, 0, 0, 2);
+   return new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(out),
+                                     xy);
+}
+
+/**
+ * A whole-matrix store that is overwritten on both arms of an if-statement
+ * is dead, even though matrix assignments carry no write mask.
+ */
+TEST_F(opt_dead_store, matrix_overwritten_on_both_arms)
+{
+   main_sig->body.push_tail(assign_matrix(m, matrix_constant(1.0f)));
+
+   ir_if *iff = new(mem_ctx) ir_if(new(mem_ctx) ir_dereference_variable(cond));
+   iff->then_instructions.push_tail(assign_matrix(m, matrix_constant(2.0f)));
+   iff->else_instructions.push_tail(assign_matrix(m, matrix_constant(3.0f)));
+   main_sig->body.push_tail(iff);
+
+   ir_rvalue *column =
+      new(mem_ctx) ir_dereference_array(m, new(mem_ctx) ir_constant(0));
+   main_sig->body.push_tail(
+      new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(out),
+                                 column));
+
+   EXPECT_TRUE(do_dead_stores(&instructions));
+
+   /* Only the declaration of m, the if-statement and the final store to the
+    * output remain at the top level.
+    */
+   EXPECT_EQ(3u, main_sig->body.length());
+   ir_instruction *after_decl =
+      (ir_instruction *) main_sig->body.get_head()->get_next();
+   EXPECT_EQ(ir_type_if, after_decl->ir_type);
+   EXPECT_FALSE(do_dead_stores(&instructions));
+}
+
+/**
+ * A matrix store that is overwritten on only one arm stays live.
+ */
+TEST_F(opt_dead_store, matrix_overwritten_on_one_arm)
+{
+   main_sig->body.push_tail(assign_matrix(m, matrix_constant(1.0f)));
+
+   ir_if *iff = new(mem_ctx) ir_if(new(mem_ctx) ir_dereference_variable(cond));
+   iff->then_instructions.push_tail(assign_matrix(m, matrix_constant(2.0f)));
+   main_sig->body.push_tail(iff);
+
+   ir_rvalue *column =
+      new(mem_ctx) ir_dereference_array(m, new(mem_ctx) ir_constant(0));
+   main_sig->body.push_tail(
+      new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(out),
+                                 column));
+
+   EXPECT_FALSE(do_dead_stores(&instructions));
+   EXPECT_EQ(4u, main_sig->body.length());
+}
+
+/**
+ * A store in one arm of an if-statement is dead when every path leaving the
+ * if-statement overwrites it before it is read.
+ */
+TEST_F(opt_dead_store, vector_overwritten_after_if)
+{
+   main_sig->body.push_tail(v);
+
+   ir_assignment *in_then = assign_vector(v, 1.0f, 0xf);
+   ir_if *iff = new(mem_ctx) ir_if(new(mem_ctx) ir_dereference_variable(cond));
+   iff->then_instructions.push_tail(in_then);
+   main_sig->body.push_tail(iff);
+
+   main_sig->body.push_tail(assign_vector(v, 2.0f, 0xf));
+   main_sig->body.push_tail(read_xy(v));
+
+   EXPECT_TRUE(do_dead_stores(&instructions));
+   EXPECT_TRUE(iff->then_instructions.is_empty());
+   EXPECT_FALSE(do_dead_stores(&instructions));
+}
+
+/**
+ * Only .xy of a vec4 store is read, so its write mask is narrowed and its
+ * value reswizzled to match.
+ */
+TEST_F(opt_dead_store, write_mask_narrowed)
+{
+   main_sig->body.push_tail(v);
+
+   ir_assignment *store = assign_vector(v, 1.0f, 0xf);
+   main_sig->body.push_tail(store);
+   main_sig->body.push_tail(read_xy(v));
+
+   EXPECT_TRUE(do_dead_stores(&instructions));
+   EXPECT_EQ(0x3u, store->write_mask);
+   EXPECT_EQ(glsl_type::vec2_type, store->rhs->type);
+   EXPECT_FALSE(do_dead_stores(&instructions));
+}
+
+/**
+ * A store at the end of a loop body is only read by the next iteration.
+ * The live set at the loop head has to be iterated to a fixed point to see
+ * that, while the .zw channels stored before the loop are still dead.
+ */
+TEST_F(opt_dead_store, loop_fixed_point)
+{
+   main_sig->body.push_tail(v);
+
+   ir_assignment *before = assign_vector(v, 0.0f, 0xf);
+   main_sig->body.push_tail(before);
+
+   ir_loop *loop = new(mem_ctx) ir_loop();
+   ir_if *exit = new(mem_ctx) ir_if(new(mem_ctx) ir_dereference_variable(cond));
+   exit->then_instructions.push_tail(
+      new(mem_ctx) ir_loop_jump(ir_loop_jump::jump_break));
+   loop->body_instructions.push_tail(exit);
+   loop->body_instructions.push_tail(read_xy(v));
+   ir_assignment *in_body = assign_vector(v, 1.0f, 0x3);
+   loop->body_instructions.push_tail(in_body);
+   main_sig->body.push_tail(loop);
+
+   EXPECT_TRUE(do_dead_stores(&instructions));
+   EXPECT_EQ(0x3u, before->write_mask);
+   EXPECT_EQ(0x3u, in_body->write_mask);
+   EXPECT_EQ(3u, loop->body_instructions.length());
+   EXPECT_FALSE(do_dead_stores(&instructions));
+}
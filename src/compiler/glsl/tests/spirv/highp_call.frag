@@ -0,0 +1,43 @@
+#version 300 es
+precision highp float;
+precision highp int;
+
+// options: --inline-budget 20 --spirv-16bit
+
+// shade() and tint() are called twice and are too large to be inlined.
+// The result of shade() is highp, so the temporaries that receive it at
+// the call sites must not fall back to the mediump default of the rebuilt
+// GLSL. The result of tint() stays mediump.
+
+in vec4 vc;
+flat in int vi;
+out vec4 o;
+
+vec3 shade(vec3 n, vec3 l, float k)
+{
+   vec3 r = vec3(0.0);
+   for (int i = 0; i < vi; i++) {
+      r += max(dot(n, l), 0.0) * k * vec3(float(i), 1.0, 2.0);
+      r = r * r + n * 0.25 - l * 0.125;
+      r = normalize(r + vec3(k));
+   }
+   return r;
+}
+
+mediump vec3 tint(mediump vec3 c, mediump float s)
+{
+   mediump vec3 t = c;
+   for (int i = 0; i < vi; i++) {
+      t = t * s + c * 0.5;
+      t = clamp(t * t - vec3(s), 0.0, 1.0);
+      t = mix(t, c, 0.25);
+   }
+   return t;
+}
+
+void main()
+{
+   vec3 a = shade(vc.xyz, vc.wzy, vc.w);
+   vec3 b = shade(vc.zyx, vc.xyz, 2.0);
+   o = vec4(a * b + tint(vc.zyx, 2.0) * tint(vc.xyz, vc.w), 1.0);
+}
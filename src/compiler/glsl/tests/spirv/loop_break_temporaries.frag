@@ -0,0 +1,27 @@
+#version 300 es
+precision highp float;
+precision highp int;
+
+// Both calls are inlined. The locals of the second one are first written
+// after the loop of the first one, so they must be declared there, not in
+// the branch which breaks out of that loop.
+
+in vec4 vc;
+flat in int vi;
+out vec4 o;
+
+vec3 scale(vec3 a, vec3 b, int n)
+{
+   vec3 r = a;
+   for (int i = 0; i < n; i++) {
+      r = r * b + vec3(float(i));
+      if (r.x > 3.0)
+         r.z -= 1.0;
+   }
+   return r;
+}
+
+void main()
+{
+   o = vec4(scale(vc.xyz, vc.wzy, vi) + scale(vc.zyx, vc.xyz, 2), 1.0);
+}
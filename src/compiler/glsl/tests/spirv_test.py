@@ -0,0 +1,117 @@
+#
+# Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+"""Compare the GLSL rebuilt from SPIR-V against the expected output.
+
+Every shader in tests/spirv is compiled with
+
+   glsl_compiler --version <V> --dump-spirv --dump-spirv-glsl <options> <file>
+
+where V comes from the #version line and <options> from an optional
+"// options:" comment in the shader.  Everything from the #version line
+of the output on is compared with <file>.expected; the SPIR-V disassembly
+before it is not.
+
+Usage: spirv_test.py [--update] <glsl_compiler>
+"""
+
+import argparse
+import difflib
+import os
+import re
+import subprocess
+import sys
+
+TEST_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'spirv')
+EXTENSIONS = ('.vert', '.frag')
+
+
+def compile_shader(compiler, path):
+    with open(path) as f:
+        source = f.read()
+
+    version = re.search(r'^#version\s+(\d+)', source, re.MULTILINE)
+    args = [compiler, '--version', version.group(1) if version else '450',
+            '--dump-spirv', '--dump-spirv-glsl']
+    options = re.search(r'^//\s*options:(.*)$', source, re.MULTILINE)
+    if options:
+        args += options.group(1).split()
+    args.append(path)
+
+    proc = subprocess.Popen(args, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    output = proc.communicate()[0]
+    if proc.returncode != 0:
+        return None, output
+
+    lines = output.splitlines(True)
+    for i, line in enumerate(lines):
+        if line.startswith('#version'):
+            return ''.join(lines[i:]), output
+    return '', output
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--update', action='store_true',
+                        help='rewrite the .expected files')
+    parser.add_argument('compiler', help='path to glsl_compiler')
+    args = parser.parse_args()
+
+    passed = 0
+    failed = 0
+    for name in sorted(os.listdir(TEST_DIR)):
+        if not name.endswith(EXTENSIONS):
+            continue
+        path = os.path.join(TEST_DIR, name)
+        result, output = compile_shader(args.compiler, path)
+
+        if result is None:
+            print('FAIL {}: compiler failed\n{}'.format(name, output))
+            failed += 1
+            continue
+
+        if args.update:
+            with open(path + '.expected', 'w') as f:
+                f.write(result)
+            passed += 1
+            continue
+
+        with open(path + '.expected') as f:
+            expected = f.read()
+        if result == expected:
+            print('PASS {}'.format(name))
+            passed += 1
+        else:
+            print('FAIL {}'.format(name))
+            sys.stdout.writelines(difflib.unified_diff(
+                expected.splitlines(True), result.splitlines(True),
+                name + '.expected', name))
+            failed += 1
+
+    print('{} passed, {} failed'.format(passed, failed))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
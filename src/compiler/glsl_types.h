@@ -116,7 +116,7 @@ enum glsl_matrix_layout {
    GLSL_MATRIX_LAYOUT_ROW_MAJOR
 };
 
-enum {
+enum glsl_precision {
    GLSL_PRECISION_NONE = 0,
    GLSL_PRECISION_HIGH,
    GLSL_PRECISION_MEDIUM,
@@ -39,10 +39,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
-#include <iomanip>
 #include <stack>
-#include <sstream>
-#include <cstring>
+#include <string>
 
 #include "disassemble.h"
 #include "doc.h"
@@ -59,10 +57,11 @@ namespace spv {
 #endif
     }
 }
-const char* GlslStd450DebugNames[spv::GLSLstd450Count];
 
 namespace spv {
 
+static const char* const* GlslStd450DebugNames();
+
 #ifdef AMD_EXTENSIONS
 static const char* GLSLextAMDGetDebugNames(const char*, unsigned);
 #endif
@@ -71,10 +70,27 @@ static const char* GLSLextAMDGetDebugNames(const char*, unsigned);
 static const char* GLSLextNVGetDebugNames(const char*, unsigned);
 #endif
 
-static void Kill(std::ostream& out, const char* message)
+// Thrown on a malformed stream, and caught again in Disassemble().
+struct DisassemblyError {
+    explicit DisassemblyError(const char* message) : message(message) { }
+    const char* message;
+};
+
+static void Kill(const char* message)
+{
+    throw DisassemblyError(message);
+}
+
+// Write the decimal digits of value so they end just before 'end', and return
+// where they start.  Ten characters are always enough.
+static char* FormatDecimal(char* end, unsigned int value)
 {
-    out << std::endl << "Disassembly failed: " << message << std::endl;
-    exit(1);
+    do {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    return end;
 }
 
 // used to identify the extended instruction library imported when printing
@@ -90,9 +106,10 @@ enum ExtInstSet {
 };
 
 // Container class for a single instance of a SPIR-V stream, with methods for disassembly.
+// All state is per instance, so separate streams can be disassembled on separate threads.
 class SpirvStream {
 public:
-    SpirvStream(std::ostream& out, const std::vector<unsigned int>& stream) : out(out), stream(stream), word(0), nextNestedControl(0) { }
+    SpirvStream(std::string& out, const unsigned int* stream, int size) : out(out), stream(stream), size(size), word(0), nextNestedControl(0) { }
     virtual ~SpirvStream() { }
 
     void validate();
@@ -104,8 +121,10 @@ protected:
     Op getOpCode(int id) const { return idInstruction[id] ? (Op)(stream[idInstruction[id]] & OpCodeMask) : OpNop; }
 
     // Output methods
+    void outputNumber(unsigned int value);
+    void outputHex(unsigned int value);
     void outputIndent();
-    void formatId(Id id, std::stringstream&);
+    void outputPaddedId(Id id, int width);
     void outputResultId(Id id);
     void outputTypeId(Id id);
     void outputId(Id id);
@@ -116,8 +135,8 @@ protected:
     void disassembleInstruction(Id resultId, Id typeId, Op opCode, int numOperands);
 
     // Data
-    std::ostream& out;                       // where to write the disassembly
-    const std::vector<unsigned int>& stream; // the actual word stream
+    std::string& out;                        // where to append the disassembly
+    const unsigned int* stream;              // the actual word stream
     int size;                                // the size of the word stream
     int word;                                // the next word of the stream to read
 
@@ -137,33 +156,35 @@ protected:
 
 void SpirvStream::validate()
 {
-    size = (int)stream.size();
-    if (size < 4)
-        Kill(out, "stream is too short");
+    if (size < 5)
+        Kill("stream is too short");
 
     // Magic number
-    if (stream[word++] != MagicNumber) {
-        out << "Bad magic number";
-        return;
-    }
+    if (stream[word++] != MagicNumber)
+        Kill("Bad magic number");
 
     // Version
-    out << "// Module Version " << std::hex << stream[word++] << std::endl;
+    out += "// Module Version ";
+    outputHex(stream[word++]);
+    out += '\n';
 
     // Generator's magic number
-    out << "// Generated by (magic number): " << std::hex << stream[word++] << std::dec << std::endl;
+    out += "// Generated by (magic number): ";
+    outputHex(stream[word++]);
+    out += '\n';
 
     // Result <id> bound
     bound = stream[word++];
     idInstruction.resize(bound);
     idDescriptor.resize(bound);
-    out << "// Id's are bound by " << bound << std::endl;
-    out << std::endl;
+    out += "// Id's are bound by ";
+    outputNumber(bound);
+    out += "\n\n";
 
     // Reserved schema, must be 0 for now
     schema = stream[word++];
     if (schema != 0)
-        Kill(out, "bad schema, must be 0");
+        Kill("bad schema, must be 0");
 }
 
 // Loop over all the instructions, in order, processing each.
@@ -182,8 +203,10 @@ void SpirvStream::processInstructions()
         ++word;
 
         // Presence of full instruction
+        if (wordCount == 0)
+            Kill("stream instruction has a word count of 0");
         if (nextInst > size)
-            Kill(out, "stream instruction terminated too early");
+            Kill("stream instruction terminated too early");
 
         // Base for computing number of operands; will be updated as more is learned
         unsigned numOperands = wordCount - 1;
@@ -191,6 +214,8 @@ void SpirvStream::processInstructions()
         // Type <id>
         Id typeId = 0;
         if (InstructionDesc[opCode].hasType()) {
+            if (word >= nextInst)
+                Kill("stream instruction is missing its type <id>");
             typeId = stream[word++];
             --numOperands;
         }
@@ -198,8 +223,12 @@ void SpirvStream::processInstructions()
         // Result <id>
         Id resultId = 0;
         if (InstructionDesc[opCode].hasResult()) {
+            if (word >= nextInst)
+                Kill("stream instruction is missing its result <id>");
             resultId = stream[word++];
             --numOperands;
+            if (resultId >= bound)
+                Kill("Bad <id>");
 
             // save instruction for future reference
             idInstruction[resultId] = instructionStart;
@@ -212,43 +241,77 @@ void SpirvStream::processInstructions()
         // Hand off the Op and all its operands
         disassembleInstruction(resultId, typeId, opCode, numOperands);
         if (word != nextInst) {
-            out << " ERROR, incorrect number of operands consumed.  At " << word << " instead of " << nextInst << " instruction start was " << instructionStart;
+            out += " ERROR, incorrect number of operands consumed.  At ";
+            outputNumber(word);
+            out += " instead of ";
+            outputNumber(nextInst);
+            out += " instruction start was ";
+            outputNumber(instructionStart);
             word = nextInst;
         }
-        out << std::endl;
+        out += '\n';
     }
 }
 
+void SpirvStream::outputNumber(unsigned int value)
+{
+    char digits[10];
+    char* end = digits + sizeof(digits);
+    out.append(FormatDecimal(end, value), end);
+}
+
+void SpirvStream::outputHex(unsigned int value)
+{
+    char digits[8];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    do {
+        *--start = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    out.append(start, end);
+}
+
 void SpirvStream::outputIndent()
 {
-    for (int i = 0; i < (int)nestedControl.size(); ++i)
-        out << "  ";
+    out.append(2 * nestedControl.size(), ' ');
 }
 
-void SpirvStream::formatId(Id id, std::stringstream& idStream)
+// Right-align the id and its descriptor in a field of the given width.
+void SpirvStream::outputPaddedId(Id id, int width)
 {
-    if (id != 0) {
-        // On instructions with no IDs, this is called with "0", which does not
-        // have to be within ID bounds on null shaders.
-        if (id >= bound)
-            Kill(out, "Bad <id>");
-
-        idStream << id;
-        if (idDescriptor[id].size() > 0)
-            idStream << "(" << idDescriptor[id] << ")";
+    // On instructions with no IDs, this is called with "0", which does not
+    // have to be within ID bounds on null shaders.
+    if (id == 0) {
+        out.append(width, ' ');
+        return;
+    }
+
+    if (id >= bound)
+        Kill("Bad <id>");
+
+    char digits[10];
+    char* end = digits + sizeof(digits);
+    char* start = FormatDecimal(end, id);
+    const std::string& descriptor = idDescriptor[id];
+    int length = (int)(end - start);
+    if (descriptor.size() > 0)
+        length += (int)descriptor.size() + 2;
+
+    if (length < width)
+        out.append(width - length, ' ');
+    out.append(start, end);
+    if (descriptor.size() > 0) {
+        out += '(';
+        out += descriptor;
+        out += ')';
     }
 }
 
 void SpirvStream::outputResultId(Id id)
 {
-    const int width = 16;
-    std::stringstream idStream;
-    formatId(id, idStream);
-    out << std::setw(width) << std::right << idStream.str();
-    if (id != 0)
-        out << ":";
-    else
-        out << " ";
+    outputPaddedId(id, 16);
+    out += id != 0 ? ':' : ' ';
 
     if (nestedControl.size() && id == nestedControl.top())
         nestedControl.pop();
@@ -256,30 +319,33 @@ void SpirvStream::outputResultId(Id id)
 
 void SpirvStream::outputTypeId(Id id)
 {
-    const int width = 12;
-    std::stringstream idStream;
-    formatId(id, idStream);
-    out << std::setw(width) << std::right << idStream.str() << " ";
+    outputPaddedId(id, 12);
+    out += ' ';
 }
 
 void SpirvStream::outputId(Id id)
 {
     if (id >= bound)
-        Kill(out, "Bad <id>");
+        Kill("Bad <id>");
 
-    out << id;
-    if (idDescriptor[id].size() > 0)
-        out << "(" << idDescriptor[id] << ")";
+    outputNumber(id);
+    if (idDescriptor[id].size() > 0) {
+        out += '(';
+        out += idDescriptor[id];
+        out += ')';
+    }
 }
 
 void SpirvStream::outputMask(OperandClass operandClass, unsigned mask)
 {
     if (mask == 0)
-        out << "None";
+        out += "None";
     else {
         for (int m = 0; m < OperandClassParams[operandClass].ceiling; ++m) {
-            if (mask & (1 << m))
-                out << OperandClassParams[operandClass].getName(m) << " ";
+            if (mask & (1 << m)) {
+                out += OperandClassParams[operandClass].getName(m);
+                out += ' ';
+            }
         }
     }
 }
@@ -287,9 +353,9 @@ void SpirvStream::outputMask(OperandClass operandClass, unsigned mask)
 void SpirvStream::disassembleImmediates(int numOperands)
 {
     for (int i = 0; i < numOperands; ++i) {
-        out << stream[word++];
+        outputNumber(stream[word++]);
         if (i < numOperands - 1)
-            out << " ";
+            out += ' ';
     }
 }
 
@@ -298,7 +364,7 @@ void SpirvStream::disassembleIds(int numOperands)
     for (int i = 0; i < numOperands; ++i) {
         outputId(stream[word++]);
         if (i < numOperands - 1)
-            out << " ";
+            out += ' ';
     }
 }
 
@@ -307,24 +373,22 @@ int SpirvStream::disassembleString()
 {
     int startWord = word;
 
-    out << " \"";
+    out += " \"";
 
-    const char* wordString;
-    bool done = false;
+    int length;
     do {
+        if (word >= size)
+            Kill("string is not terminated");
+
         unsigned int content = stream[word];
-        wordString = (const char*)&content;
-        for (int charCount = 0; charCount < 4; ++charCount) {
-            if (*wordString == 0) {
-                done = true;
-                break;
-            }
-            out << *(wordString++);
-        }
+        const char* wordString = (const char*)&content;
+        for (length = 0; length < 4 && wordString[length] != 0; ++length)
+            ;
+        out.append(wordString, length);
         ++word;
-    } while (! done);
+    } while (length == 4);
 
-    out << "\"";
+    out += '"';
 
     return word - startWord;
 }
@@ -333,7 +397,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
 {
     // Process the opcode
 
-    out << (OpcodeString(opCode) + 2);  // leave out the "Op"
+    out += OpcodeString(opCode) + 2;  // leave out the "Op"
 
     if (opCode == OpLoopMerge || opCode == OpSelectionMerge)
         nextNestedControl = stream[word];
@@ -364,7 +428,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
                 idDescriptor[resultId] = "ptr";
                 break;
             case OpTypeVector:
-                if (idDescriptor[stream[word]].size() > 0)
+                if (stream[word] < bound && idDescriptor[stream[word]].size() > 0)
                     idDescriptor[resultId].append(idDescriptor[stream[word]].begin(), idDescriptor[stream[word]].begin() + 1);
                 idDescriptor[resultId].append("vec");
                 switch (stream[word + 1]) {
@@ -388,28 +452,31 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
 
     // Handle images specially, so can put out helpful strings.
     if (opCode == OpTypeImage) {
-        out << " ";
+        out += ' ';
         disassembleIds(1);
-        out << " " << DimensionString((Dim)stream[word++]);
-        out << (stream[word++] != 0 ? " depth" : "");
-        out << (stream[word++] != 0 ? " array" : "");
-        out << (stream[word++] != 0 ? " multi-sampled" : "");
+        out += ' ';
+        out += DimensionString((Dim)stream[word++]);
+        out += stream[word++] != 0 ? " depth" : "";
+        out += stream[word++] != 0 ? " array" : "";
+        out += stream[word++] != 0 ? " multi-sampled" : "";
         switch (stream[word++]) {
-        case 0: out << " runtime";    break;
-        case 1: out << " sampled";    break;
-        case 2: out << " nonsampled"; break;
+        case 0: out += " runtime";    break;
+        case 1: out += " sampled";    break;
+        case 2: out += " nonsampled"; break;
         }
-        out << " format:" << ImageFormatString((ImageFormat)stream[word++]);
+        out += " format:";
+        out += ImageFormatString((ImageFormat)stream[word++]);
 
         if (numOperands == 8) {
-            out << " " << AccessQualifierString(stream[word++]);
+            out += ' ';
+            out += AccessQualifierString(stream[word++]);
         }
         return;
     }
 
     // Handle all the parameterized operands
     for (int op = 0; op < InstructionDesc[opCode].operands.getNum() && numOperands > 0; ++op) {
-        out << " ";
+        out += ' ';
         OperandClass operandClass = InstructionDesc[opCode].operands.getClass(op);
         switch (operandClass) {
         case OperandId:
@@ -433,7 +500,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
         case OperandVariableLiterals:
             if ((opCode == OpDecorate && stream[word - 1] == DecorationBuiltIn) ||
                 (opCode == OpMemberDecorate && stream[word - 1] == DecorationBuiltIn)) {
-                out << BuiltInString(stream[word++]);
+                out += BuiltInString(stream[word++]);
                 --numOperands;
                 ++op;
             }
@@ -441,26 +508,26 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
             return;
         case OperandVariableIdLiteral:
             while (numOperands > 0) {
-                out << std::endl;
+                out += '\n';
                 outputResultId(0);
                 outputTypeId(0);
                 outputIndent();
-                out << "     Type ";
+                out += "     Type ";
                 disassembleIds(1);
-                out << ", member ";
+                out += ", member ";
                 disassembleImmediates(1);
                 numOperands -= 2;
             }
             return;
         case OperandVariableLiteralId:
             while (numOperands > 0) {
-                out << std::endl;
+                out += '\n';
                 outputResultId(0);
                 outputTypeId(0);
                 outputIndent();
-                out << "     case ";
+                out += "     case ";
                 disassembleImmediates(1);
-                out << ": ";
+                out += ": ";
                 disassembleIds(1);
                 numOperands -= 2;
             }
@@ -491,16 +558,22 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
                 unsigned entrypoint = stream[word - 1];
                 if (extInstSet == GLSL450Inst) {
                     if (entrypoint < GLSLstd450Count) {
-                        out << "(" << GlslStd450DebugNames[entrypoint] << ")";
+                        out += '(';
+                        out += GlslStd450DebugNames()[entrypoint];
+                        out += ')';
                     }
 #ifdef AMD_EXTENSIONS
                 } else if (extInstSet == GLSLextAMDInst) {
-                    out << "(" << GLSLextAMDGetDebugNames(name, entrypoint) << ")";
+                    out += '(';
+                    out += GLSLextAMDGetDebugNames(name, entrypoint);
+                    out += ')';
 #endif
 #ifdef NV_EXTENSIONS
                 }
                 else if (extInstSet == GLSLextNVInst) {
-                    out << "(" << GLSLextNVGetDebugNames(name, entrypoint) << ")";
+                    out += '(';
+                    out += GLSLextNVGetDebugNames(name, entrypoint);
+                    out += ')';
 #endif
                 }
             }
@@ -515,7 +588,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
             if (OperandClassParams[operandClass].bitmask)
                 outputMask(operandClass, stream[word++]);
             else
-                out << OperandClassParams[operandClass].getName(stream[word++]);
+                out += OperandClassParams[operandClass].getName(stream[word++]);
             --numOperands;
 
             break;
@@ -609,6 +682,18 @@ static void GLSLstd450GetDebugNames(const char** names)
     names[GLSLstd450InterpolateAtOffset]     = "InterpolateAtOffset";
 }
 
+// The table is filled in on first use; function-local statics are initialized
+// exactly once even when several threads get here together.
+static const char* const* GlslStd450DebugNames()
+{
+    static const struct DebugNames {
+        DebugNames() { GLSLstd450GetDebugNames(names); }
+        const char* names[GLSLstd450Count];
+    } debugNames;
+
+    return debugNames.names;
+}
+
 #ifdef AMD_EXTENSIONS
 static const char* GLSLextAMDGetDebugNames(const char* name, unsigned entrypoint)
 {
@@ -683,13 +768,35 @@ static const char* GLSLextNVGetDebugNames(const char* name, unsigned entrypoint)
 }
 #endif
 
-void Disassemble(std::ostream& out, const std::vector<unsigned int>& stream)
+bool Disassemble(std::string& out, const unsigned int* stream, size_t size, std::string* errorMessage)
 {
-    SpirvStream SpirvStream(out, stream);
     spv::Parameterize();
-    GLSLstd450GetDebugNames(GlslStd450DebugNames);
-    SpirvStream.validate();
-    SpirvStream.processInstructions();
+
+    // Most instructions take well under 16 characters per word; reserving up
+    // front avoids regrowing the buffer while appending.
+    out.reserve(out.size() + size * 16);
+
+    SpirvStream SpirvStream(out, stream, (int)size);
+    try {
+        SpirvStream.validate();
+        SpirvStream.processInstructions();
+    } catch (const DisassemblyError& error) {
+        if (errorMessage)
+            *errorMessage = error.message;
+        return false;
+    }
+
+    return true;
+}
+
+void Disassemble(std::ostream& out, const std::vector<unsigned int>& stream)
+{
+    std::string text;
+    std::string errorMessage;
+    bool succeeded = Disassemble(text, stream.data(), stream.size(), &errorMessage);
+    out.write(text.data(), text.size());
+    if (! succeeded)
+        out << std::endl << "Disassembly failed: " << errorMessage << std::endl;
 }
 
 }; // end namespace spv
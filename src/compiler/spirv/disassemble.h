@@ -41,10 +41,19 @@
 #define disassembler_H
 
 #include <iostream>
+#include <string>
 #include <vector>
 
 namespace spv {
 
+    // Append the disassembly of 'size' words of SPIR-V to 'out', which can be
+    // cleared and reused across modules to keep its allocation.  Separate
+    // modules may be disassembled concurrently.  On a malformed stream, returns
+    // false with 'out' holding the text produced so far, and sets 'errorMessage'
+    // if given.
+    bool Disassemble(std::string& out, const unsigned int* stream, size_t size, std::string* errorMessage = nullptr);
+
+    // Write the disassembly to 'out', followed by a note if it failed.
     void Disassemble(std::ostream& out, const std::vector<unsigned int>&);
 
 };  // end namespace spv
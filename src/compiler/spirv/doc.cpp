@@ -1239,14 +1239,8 @@ EnumParameters KernelProfilingInfoParams[KernelProfilingInfoCeiling];
 EnumParameters CapabilityParams[CapabilityCeiling];
 
 // Set up all the parameterizing descriptions of the opcodes, operands, etc.
-void Parameterize()
+static void ParameterizeTables()
 {
-    // only do this once.
-    static bool initialized = false;
-    if (initialized)
-        return;
-    initialized = true;
-
     // Exceptions to having a result <id> and a resulting type <id>.
     // (Everything is initialized to have both).
 
@@ -2858,4 +2852,12 @@ void Parameterize()
 #endif
 }
 
+void Parameterize()
+{
+    // only do this once; the static's initializer is run exactly once, even
+    // with several threads disassembling at the same time.
+    static const bool initialized = (ParameterizeTables(), true);
+    (void)initialized;
+}
+
 }; // end spv namespace
@@ -0,0 +1,91 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPIRV_CROSS_SIMD_EXTERNAL_INTERFACE_H
+#define SPIRV_CROSS_SIMD_EXTERNAL_INTERFACE_H
+
+/* The C interface of a shader compiled by CompilerCPP with a SIMD width.
+ *
+ * Each compiled shader exports one function returning a pointer to a static
+ * struct spirv_cross_simd_interface. A shader instance runs width
+ * invocations at a time and is not thread safe; to use several threads,
+ * construct one instance per thread and give them all the same resources,
+ * which is what simd_thread_group.hpp does.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct spirv_cross_simd_shader spirv_cross_simd_shader_t;
+
+struct spirv_cross_simd_interface
+{
+	/* Invocations run together, 4, 8 or 16. */
+	unsigned width;
+
+	/* LocalSize of a compute shader, 1, 1, 1 for fragment shaders. */
+	unsigned workgroup_size[3];
+
+	spirv_cross_simd_shader_t *(*construct)(void);
+	void (*destruct)(spirv_cross_simd_shader_t *shader);
+
+	/* Binds a uniform or storage buffer. Reads past size return zero and
+	 * writes past it are dropped.
+	 */
+	void (*set_resource)(spirv_cross_simd_shader_t *shader, unsigned set, unsigned binding, void *data,
+	                     size_t size);
+	void (*set_push_constant)(spirv_cross_simd_shader_t *shader, void *data, size_t size);
+
+	/* Binds the values of a fragment shader input or output location, one
+	 * per fragment, stride bytes apart.
+	 */
+	void (*set_stage_input)(spirv_cross_simd_shader_t *shader, unsigned location, const void *data,
+	                        size_t stride);
+	void (*set_stage_output)(spirv_cross_simd_shader_t *shader, unsigned location, void *data, size_t stride);
+
+	/* Binds a fragment shader built-in the same way, where builtin is a
+	 * spv::BuiltIn value: FragCoord, FrontFacing (a 32-bit bool) or
+	 * FragDepth.
+	 */
+	void (*set_builtin)(spirv_cross_simd_shader_t *shader, unsigned builtin, void *data, size_t stride);
+
+	/* Runs the compute workgroup with the given ID. */
+	void (*dispatch)(spirv_cross_simd_shader_t *shader, const unsigned group[3], const unsigned num_groups[3]);
+
+	/* Runs the fragment shader for fragments [first, first + count). */
+	void (*shade)(spirv_cross_simd_shader_t *shader, size_t first, size_t count);
+};
+
+/* What a shader exports unless CompilerCPP::set_interface_name() chose
+ * another name.
+ */
+const struct spirv_cross_simd_interface *spirv_cross_simd_get_interface(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPIRV_CROSS_SIMD_FIBERS_HPP
+#define SPIRV_CROSS_SIMD_FIBERS_HPP
+
+// Runs the batches of one workgroup as fibers on the calling thread, which
+// is how shaders with barrier() are executed.
+//
+// Every batch gets its own stack. A pass resumes each batch which is ready
+// until it reaches barrier() or returns from main(), and the batches which
+// wait at the barrier become ready again once the pass is over, so no batch
+// gets past a barrier before the others reached it. A batch which returned
+// no longer holds the others up, and batches which never reach a barrier
+// just run to completion one after the other.
+//
+// Fibers never migrate between threads, but the thread_local execution
+// masks are shared by all fibers of a thread: barrier() in simd_width.inl
+// saves and restores them around the switch.
+
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <ucontext.h>
+#endif
+
+namespace spirv_cross
+{
+namespace simd
+{
+class workgroup_fibers
+{
+public:
+	typedef void (*batch_func)(void *arg, unsigned batch);
+
+	// Locals of the generated code are W lanes wide, so local arrays take
+	// W times the stack they would in scalar code.
+	static const size_t stack_size = 256 * 1024;
+
+	explicit workgroup_fibers(unsigned count)
+	    : fibers(count)
+	{
+	}
+
+	~workgroup_fibers()
+	{
+#ifdef _WIN32
+		for (auto &f : fibers)
+			if (f.handle)
+				DeleteFiber(f.handle);
+#endif
+	}
+
+	workgroup_fibers(const workgroup_fibers &) = delete;
+	workgroup_fibers &operator=(const workgroup_fibers &) = delete;
+
+	// Runs func(arg, i) for every batch i and returns when all of them
+	// returned. Stacks are allocated on first use and kept for later runs.
+	void run(batch_func func_, void *arg_)
+	{
+		func = func_;
+		arg = arg_;
+		workgroup_fibers *outer = current();
+		current() = this;
+
+#ifdef _WIN32
+		bool converted = !IsThreadAFiber();
+		scheduler = converted ? ConvertThreadToFiber(nullptr) : GetCurrentFiber();
+#endif
+
+		for (auto &f : fibers)
+			f.state = ready;
+
+		size_t remaining = fibers.size();
+		while (remaining)
+		{
+			for (size_t i = 0; i < fibers.size(); i++)
+			{
+				if (fibers[i].state != ready)
+					continue;
+				resume(i);
+				if (fibers[i].state == finished)
+					remaining--;
+			}
+
+			for (auto &f : fibers)
+				if (f.state == waiting)
+					f.state = ready;
+		}
+
+#ifdef _WIN32
+		if (converted)
+			ConvertFiberToThread();
+#endif
+		current() = outer;
+	}
+
+	// Suspends the running batch until the others reached a barrier too, or
+	// returned. Does nothing outside of run().
+	static void barrier()
+	{
+		workgroup_fibers *self = current();
+		if (!self)
+			return;
+		self->fibers[self->running].state = waiting;
+		self->suspend();
+	}
+
+private:
+	enum fiber_state
+	{
+		ready,
+		waiting,
+		finished
+	};
+
+	struct fiber
+	{
+		fiber_state state = finished;
+#ifdef _WIN32
+		void *handle = nullptr;
+#else
+		ucontext_t context;
+		std::unique_ptr<char[]> stack;
+#endif
+	};
+
+	std::vector<fiber> fibers;
+	batch_func func = nullptr;
+	void *arg = nullptr;
+	size_t running = 0;
+#ifdef _WIN32
+	void *scheduler = nullptr;
+#else
+	ucontext_t scheduler;
+#endif
+
+	static workgroup_fibers *&current()
+	{
+		static thread_local workgroup_fibers *self = nullptr;
+		return self;
+	}
+
+	// A fiber runs its batch once per run() and then hands control back.
+	static void entry()
+	{
+		workgroup_fibers *self = current();
+		size_t index = self->running;
+		for (;;)
+		{
+			self->func(self->arg, unsigned(index));
+			self->fibers[index].state = finished;
+			self->suspend();
+		}
+	}
+
+#ifdef _WIN32
+	static void CALLBACK fiber_entry(void *)
+	{
+		entry();
+	}
+
+	void resume(size_t index)
+	{
+		fiber &f = fibers[index];
+		if (!f.handle)
+		{
+			f.handle = CreateFiber(stack_size, fiber_entry, nullptr);
+			if (!f.handle)
+				throw std::bad_alloc();
+		}
+		running = index;
+		SwitchToFiber(f.handle);
+	}
+
+	void suspend()
+	{
+		SwitchToFiber(scheduler);
+	}
+#else
+	void resume(size_t index)
+	{
+		fiber &f = fibers[index];
+		if (!f.stack)
+		{
+			f.stack.reset(new char[stack_size]);
+			getcontext(&f.context);
+			f.context.uc_stack.ss_sp = f.stack.get();
+			f.context.uc_stack.ss_size = stack_size;
+			f.context.uc_link = nullptr;
+			makecontext(&f.context, entry, 0);
+		}
+		running = index;
+		swapcontext(&scheduler, &f.context);
+	}
+
+	void suspend()
+	{
+		swapcontext(&fibers[running].context, &scheduler);
+	}
+#endif
+};
+}
+}
+
+#endif
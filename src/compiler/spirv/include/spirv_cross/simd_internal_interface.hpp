@@ -0,0 +1,693 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPIRV_CROSS_SIMD_INTERNAL_INTERFACE_HPP
+#define SPIRV_CROSS_SIMD_INTERNAL_INTERFACE_HPP
+
+// The runtime which shaders compiled by CompilerCPP with a SIMD width are
+// written against. The generated Impl::Shader struct has a main() which
+// runs one batch of invocations under the current execution mask; the
+// ComputeShader and FragmentShader templates below cut dispatches and
+// fragment ranges into such batches and implement the C interface in
+// simd_external_interface.h.
+//
+// The output needs the instruction set its width was picked for: build it
+// with -mavx (or -march=haswell or later) for width 8 and -mavx512f for
+// width 16. Without those, GCC and Clang split the vectors up, and GCC
+// warns with -Wpsabi that functions passing them change their ABI.
+
+#include "simd_external_interface.h"
+#include "simd_fibers.hpp"
+#include "simd_types.hpp"
+
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+namespace spirv_cross
+{
+namespace simd
+{
+// A stage input or output location, copied between the caller's arrays and
+// the registers of one batch.
+struct stage_io
+{
+	uint8_t *data = nullptr;
+	size_t stride = 0;
+
+	virtual ~stage_io()
+	{
+	}
+
+	virtual void load(size_t first, size_t count) = 0;
+	virtual void store(size_t first, size_t count) = 0;
+};
+
+// How a value of type T is laid out in the caller's arrays: tightly packed,
+// with matrices as columns.
+template <typename T>
+struct packed_ref;
+
+template <typename T, unsigned W>
+struct packed_ref<lanes<T, W>>
+{
+	typedef scalar_ref<lanes<T, W>> type;
+};
+
+template <unsigned W>
+struct packed_ref<bool_lanes<W>>
+{
+	typedef scalar_ref<bool_lanes<W>> type;
+};
+
+template <typename T, unsigned N, unsigned W>
+struct packed_ref<tvec<T, N, W>>
+{
+	typedef vector_ref<tvec<T, N, W>, 4> type;
+};
+
+template <unsigned C, unsigned R, unsigned W>
+struct packed_ref<tmat<C, R, W>>
+{
+	typedef matrix_ref<tmat<C, R, W>, 4 * R, 4> type;
+};
+
+// Points lane i at element first + i of an array with elements stride
+// bytes apart and first + count elements in total.
+template <unsigned W>
+inline addr<W> batch_addr(uint8_t *data, size_t stride, size_t first, size_t count)
+{
+	addr<W> a = addr<W>::of_memory(data, (first + count) * stride);
+	a.offsets = (lane_index<W>() + uint32_t(first)) * uint32_t(stride);
+	a.uniform = false;
+	return a;
+}
+
+template <typename T, unsigned W>
+inline void load_batch(T &value, uint8_t *data, size_t stride, size_t first, size_t count)
+{
+	if (data)
+		copy_lanes(value, T(typename packed_ref<T>::type(batch_addr<W>(data, stride, first, count), 0)));
+	else
+		copy_lanes(value, T());
+}
+
+template <typename T, unsigned W>
+inline void store_batch(const T &value, uint8_t *data, size_t stride, size_t first, size_t count)
+{
+	if (data)
+		typename packed_ref<T>::type(batch_addr<W>(data, stride, first, count), 0) = value;
+}
+
+namespace internal
+{
+// A uniform or storage buffer. get() is the root of the access chains into
+// it, which are made of the _ref types CompilerCPP emits for its block.
+template <typename Ref>
+struct Resource
+{
+	void *data = nullptr;
+	size_t size = 0;
+
+	Ref get() const
+	{
+		return Ref(addr<Ref::W>::of_memory(data, size), 0);
+	}
+};
+
+template <typename Ref>
+using PushConstant = Resource<Ref>;
+
+// A shared variable, which points into the block its ComputeShader holds
+// for the workgroup.
+template <typename Ref>
+using Shared = Resource<Ref>;
+
+template <typename T>
+struct StageInput : stage_io
+{
+	static const unsigned W = T::width;
+	T value;
+
+	T &get()
+	{
+		return value;
+	}
+
+	void load(size_t first, size_t count) override
+	{
+		load_batch<T, W>(value, data, stride, first, count);
+	}
+
+	void store(size_t, size_t) override
+	{
+	}
+};
+
+template <typename T>
+struct StageOutput : stage_io
+{
+	static const unsigned W = T::width;
+	T value;
+
+	T &get()
+	{
+		return value;
+	}
+
+	void load(size_t, size_t) override
+	{
+		copy_lanes(value, T());
+	}
+
+	void store(size_t first, size_t count) override
+	{
+		store_batch<T, W>(value, data, stride, first, count);
+	}
+};
+}
+
+// Where the generated Resources::init() registers its bindings.
+class shader_state
+{
+public:
+	template <typename Ref>
+	void register_resource(internal::Resource<Ref> &r, uint32_t set, uint32_t binding)
+	{
+		resources.push_back({ set, binding, &r.data, &r.size });
+	}
+
+	template <typename Ref>
+	void register_push_constant(internal::Resource<Ref> &r)
+	{
+		push_constant = { 0, 0, &r.data, &r.size };
+	}
+
+	// Shared variables are placed by the compiler: size bytes at offset into
+	// the block passed to set_shared_memory().
+	template <typename Ref>
+	void register_shared(internal::Resource<Ref> &r, uint32_t offset, uint32_t size)
+	{
+		shared.push_back({ offset, size, &r.data, &r.size });
+	}
+
+	void register_stage_input(stage_io &io, uint32_t location)
+	{
+		inputs.push_back({ location, &io });
+	}
+
+	void register_stage_output(stage_io &io, uint32_t location)
+	{
+		outputs.push_back({ location, &io });
+	}
+
+	void set_resource(uint32_t set, uint32_t binding, void *data, size_t size)
+	{
+		for (auto &r : resources)
+		{
+			if (r.set == set && r.binding == binding)
+			{
+				*r.data = data;
+				*r.size = size;
+			}
+		}
+	}
+
+	void set_push_constant(void *data, size_t size)
+	{
+		if (push_constant.data)
+		{
+			*push_constant.data = data;
+			*push_constant.size = size;
+		}
+	}
+
+	void set_shared_memory(uint8_t *block)
+	{
+		for (auto &s : shared)
+		{
+			*s.data = block + s.offset;
+			*s.size = s.bytes;
+		}
+	}
+
+	void set_stage_input(uint32_t location, const void *data, size_t stride)
+	{
+		set_stage_io(inputs, location, const_cast<void *>(data), stride);
+	}
+
+	void set_stage_output(uint32_t location, void *data, size_t stride)
+	{
+		set_stage_io(outputs, location, data, stride);
+	}
+
+	void load_inputs(size_t first, size_t count)
+	{
+		for (auto &io : inputs)
+			io.io->load(first, count);
+		for (auto &io : outputs)
+			io.io->load(first, count);
+	}
+
+	void store_outputs(size_t first, size_t count)
+	{
+		for (auto &io : outputs)
+			io.io->store(first, count);
+	}
+
+private:
+	struct resource_binding
+	{
+		uint32_t set;
+		uint32_t binding;
+		void **data;
+		size_t *size;
+	};
+
+	struct shared_binding
+	{
+		uint32_t offset;
+		uint32_t bytes;
+		void **data;
+		size_t *size;
+	};
+
+	struct io_binding
+	{
+		uint32_t location;
+		stage_io *io;
+	};
+
+	std::vector<resource_binding> resources;
+	resource_binding push_constant = {};
+	std::vector<shared_binding> shared;
+	std::vector<io_binding> inputs;
+	std::vector<io_binding> outputs;
+
+	static void set_stage_io(std::vector<io_binding> &list, uint32_t location, void *data, size_t stride)
+	{
+		for (auto &io : list)
+		{
+			if (io.location == location)
+			{
+				io.io->data = static_cast<uint8_t *>(data);
+				io.io->stride = stride;
+			}
+		}
+	}
+};
+
+class shader_base
+{
+public:
+	virtual ~shader_base()
+	{
+	}
+
+	shader_state state;
+
+	virtual void set_builtin(uint32_t builtin, void *data, size_t stride)
+	{
+		(void)builtin;
+		(void)data;
+		(void)stride;
+	}
+
+	virtual void dispatch(const uint32_t group[3], const uint32_t num_groups[3])
+	{
+		(void)group;
+		(void)num_groups;
+	}
+
+	virtual void shade(size_t first, size_t count)
+	{
+		(void)first;
+		(void)count;
+	}
+};
+
+template <unsigned W>
+inline mask<W> first_lanes(size_t count)
+{
+	mask<W> m;
+	m.v = (ivector<W>)(lane_index<W>() < uint32_t(count < W ? count : W));
+	return m;
+}
+
+template <unsigned W>
+struct ComputeResources
+{
+	// Generated Resources which declare shared variables hide this.
+	static const uint32_t spv_shared_size = 0;
+
+	tvec<uint32_t, 3, W> gl_GlobalInvocationID;
+	tvec<uint32_t, 3, W> gl_LocalInvocationID;
+	tvec<uint32_t, 3, W> gl_WorkGroupID;
+	tvec<uint32_t, 3, W> gl_NumWorkGroups;
+	tvec<uint32_t, 3, W> gl_WorkGroupSize;
+	lanes<uint32_t, W> gl_LocalInvocationIndex;
+
+	void init(shader_state &)
+	{
+	}
+};
+
+// Runs X * Y * Z invocations per workgroup, W at a time. Without barriers,
+// the batches run one after the other on a single shader instance. With
+// them, every batch has an instance of its own and runs as a fiber of
+// workgroup_fibers, so barrier() can switch to the next batch. Shared
+// variables of all instances point at one block, which is reused for every
+// workgroup.
+template <typename Impl, typename Res, unsigned W, unsigned X, unsigned Y, unsigned Z, bool Barriers = false>
+class ComputeShader : public shader_base
+{
+public:
+	static const unsigned width = W;
+	static const unsigned workgroup_size[3];
+
+	ComputeShader()
+	    : shared_memory(Res::spv_shared_size)
+	    , fibers(Barriers ? batches : 0)
+	{
+		for (auto &instance : instances)
+		{
+			instance.impl.__res = &instance.resources;
+			instance.resources.init(state);
+		}
+		state.set_shared_memory(shared_memory.data());
+	}
+
+	void dispatch(const uint32_t group[3], const uint32_t num_groups[3]) override
+	{
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			current_group[i] = group[i];
+			current_num_groups[i] = num_groups[i];
+		}
+
+		if (Barriers)
+			fibers.run(&ComputeShader::run_batch, this);
+		else
+		{
+			for (unsigned batch = 0; batch < batches; batch++)
+				run_batch(this, batch);
+		}
+	}
+
+private:
+	static const unsigned batches = (X * Y * Z + W - 1) / W;
+
+	struct instance_data
+	{
+		Impl impl;
+		Res resources;
+	};
+
+	instance_data instances[Barriers ? batches : 1];
+	std::vector<uint8_t> shared_memory;
+	workgroup_fibers fibers;
+	uint32_t current_group[3] = {};
+	uint32_t current_num_groups[3] = {};
+
+	static void run_batch(void *self, unsigned batch)
+	{
+		auto &shader = *static_cast<ComputeShader *>(self);
+		auto &instance = shader.instances[Barriers ? batch : 0];
+		auto &resources = instance.resources;
+
+		const uint32_t total = X * Y * Z;
+		const uint32_t base = batch * W;
+		uvector<W> index = lane_index<W>() + base;
+		uvector<W> local[3] = { index % X, (index / X) % Y, index / (X * Y) };
+
+		resources.gl_LocalInvocationIndex.v = index;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			uint32_t group = shader.current_group[i];
+			resources.gl_WorkGroupID.data()[i].v = lanes<uint32_t, W>(group).v;
+			resources.gl_NumWorkGroups.data()[i].v = lanes<uint32_t, W>(shader.current_num_groups[i]).v;
+			resources.gl_WorkGroupSize.data()[i].v = lanes<uint32_t, W>(workgroup_size[i]).v;
+			resources.gl_LocalInvocationID.data()[i].v = local[i];
+			resources.gl_GlobalInvocationID.data()[i].v = group * workgroup_size[i] + local[i];
+		}
+
+		mask<W> m = first_lanes<W>(total - base);
+		exec_state<W>::active = m;
+		exec_state<W>::alive = m;
+		instance.impl.main();
+	}
+};
+
+template <typename Impl, typename Res, unsigned W, unsigned X, unsigned Y, unsigned Z, bool Barriers>
+const unsigned ComputeShader<Impl, Res, W, X, Y, Z, Barriers>::workgroup_size[3] = { X, Y, Z };
+
+template <unsigned W>
+struct FragmentResources
+{
+	tvec<float, 4, W> gl_FragCoord;
+	bool_lanes<W> gl_FrontFacing;
+	lanes<float, W> gl_FragDepth;
+
+	void init(shader_state &)
+	{
+	}
+};
+
+// Shades a range of fragments, W at a time. Discarded fragments keep the
+// previous contents of the output arrays.
+template <typename Impl, typename Res, unsigned W>
+class FragmentShader : public shader_base
+{
+public:
+	static const unsigned width = W;
+	static const unsigned workgroup_size[3];
+
+	FragmentShader()
+	{
+		impl.__res = &resources;
+		resources.init(state);
+	}
+
+	void set_builtin(uint32_t builtin, void *data, size_t stride) override
+	{
+		builtin_binding *b = nullptr;
+		if (builtin == 15) // spv::BuiltInFragCoord
+			b = &frag_coord;
+		else if (builtin == 17) // spv::BuiltInFrontFacing
+			b = &front_facing;
+		else if (builtin == 22) // spv::BuiltInFragDepth
+			b = &frag_depth;
+
+		if (b)
+		{
+			b->data = static_cast<uint8_t *>(data);
+			b->stride = stride;
+		}
+	}
+
+	void shade(size_t first, size_t count) override
+	{
+		for (size_t base = first; base < first + count; base += W)
+		{
+			size_t n = first + count - base;
+			mask<W> m = first_lanes<W>(n);
+			if (n > W)
+				n = W;
+
+			state.load_inputs(base, n);
+			load_builtins(base, n);
+
+			exec_state<W>::active = m;
+			exec_state<W>::alive = m;
+			impl.main();
+
+			exec_state<W>::active = exec_state<W>::alive;
+			state.store_outputs(base, n);
+			store_batch<lanes<float, W>, W>(resources.gl_FragDepth, frag_depth.data, frag_depth.stride, base, n);
+		}
+	}
+
+private:
+	struct builtin_binding
+	{
+		uint8_t *data = nullptr;
+		size_t stride = 0;
+	};
+
+	Impl impl;
+	Res resources;
+	builtin_binding frag_coord, front_facing, frag_depth;
+
+	// Without a FragCoord binding, fragments are numbered along x.
+	void load_builtins(size_t base, size_t n)
+	{
+		if (frag_coord.data)
+			load_batch<tvec<float, 4, W>, W>(resources.gl_FragCoord, frag_coord.data, frag_coord.stride, base, n);
+		else
+		{
+			lanes<float, W> x(lanes<uint32_t, W>::from(lane_index<W>() + uint32_t(base)));
+			copy_lanes(resources.gl_FragCoord, tvec<float, 4, W>(x + 0.5f, 0.5f, 0.0f, 1.0f));
+		}
+
+		if (front_facing.data)
+			load_batch<bool_lanes<W>, W>(resources.gl_FrontFacing, front_facing.data, front_facing.stride, base, n);
+		else
+			copy_lanes(resources.gl_FrontFacing, bool_lanes<W>(true));
+
+		copy_lanes(resources.gl_FragDepth, resources.gl_FragCoord.z);
+	}
+};
+
+template <typename Impl, typename Res, unsigned W>
+const unsigned FragmentShader<Impl, Res, W>::workgroup_size[3] = { 1, 1, 1 };
+
+// The C interface of shader type S.
+template <typename S>
+struct interface_table
+{
+	static shader_base *self(spirv_cross_simd_shader_t *shader)
+	{
+		return reinterpret_cast<shader_base *>(shader);
+	}
+
+	// S holds vector types, which need more alignment than new guarantees.
+	static spirv_cross_simd_shader_t *construct()
+	{
+		void *p = nullptr;
+#ifdef _WIN32
+		p = _aligned_malloc(sizeof(S), alignof(S));
+#else
+		if (posix_memalign(&p, alignof(S) < sizeof(void *) ? sizeof(void *) : alignof(S), sizeof(S)))
+			p = nullptr;
+#endif
+		if (!p)
+			return nullptr;
+		shader_base *shader = new (p) S();
+		return reinterpret_cast<spirv_cross_simd_shader_t *>(shader);
+	}
+
+	static void destruct(spirv_cross_simd_shader_t *shader)
+	{
+		if (!shader)
+			return;
+		S *s = static_cast<S *>(self(shader));
+		s->~S();
+#ifdef _WIN32
+		_aligned_free(s);
+#else
+		free(s);
+#endif
+	}
+
+	static void set_resource(spirv_cross_simd_shader_t *shader, unsigned set, unsigned binding, void *data,
+	                         size_t size)
+	{
+		self(shader)->state.set_resource(set, binding, data, size);
+	}
+
+	static void set_push_constant(spirv_cross_simd_shader_t *shader, void *data, size_t size)
+	{
+		self(shader)->state.set_push_constant(data, size);
+	}
+
+	static void set_stage_input(spirv_cross_simd_shader_t *shader, unsigned location, const void *data,
+	                            size_t stride)
+	{
+		self(shader)->state.set_stage_input(location, data, stride);
+	}
+
+	static void set_stage_output(spirv_cross_simd_shader_t *shader, unsigned location, void *data, size_t stride)
+	{
+		self(shader)->state.set_stage_output(location, data, stride);
+	}
+
+	static void set_builtin(spirv_cross_simd_shader_t *shader, unsigned builtin, void *data, size_t stride)
+	{
+		self(shader)->set_builtin(builtin, data, stride);
+	}
+
+	static void dispatch(spirv_cross_simd_shader_t *shader, const unsigned group[3], const unsigned num_groups[3])
+	{
+		self(shader)->dispatch(group, num_groups);
+	}
+
+	static void shade(spirv_cross_simd_shader_t *shader, size_t first, size_t count)
+	{
+		self(shader)->shade(first, count);
+	}
+};
+
+template <typename S>
+inline const spirv_cross_simd_interface *get_interface()
+{
+	typedef interface_table<S> table;
+	static const spirv_cross_simd_interface iface = {
+		S::width,
+		{ S::workgroup_size[0], S::workgroup_size[1], S::workgroup_size[2] },
+		table::construct,
+		table::destruct,
+		table::set_resource,
+		table::set_push_constant,
+		table::set_stage_input,
+		table::set_stage_output,
+		table::set_builtin,
+		table::dispatch,
+		table::shade,
+	};
+	return &iface;
+}
+}
+}
+
+// The names generated code uses, for each supported width.
+#define SPIRV_CROSS_SIMD_WIDTH 4
+#define SPIRV_CROSS_SIMD_NAMESPACE w4
+#include "simd_width.inl"
+#undef SPIRV_CROSS_SIMD_WIDTH
+#undef SPIRV_CROSS_SIMD_NAMESPACE
+
+#define SPIRV_CROSS_SIMD_WIDTH 8
+#define SPIRV_CROSS_SIMD_NAMESPACE w8
+#include "simd_width.inl"
+#undef SPIRV_CROSS_SIMD_WIDTH
+#undef SPIRV_CROSS_SIMD_NAMESPACE
+
+#define SPIRV_CROSS_SIMD_WIDTH 16
+#define SPIRV_CROSS_SIMD_NAMESPACE w16
+#include "simd_width.inl"
+#undef SPIRV_CROSS_SIMD_WIDTH
+#undef SPIRV_CROSS_SIMD_NAMESPACE
+
+// Built-ins live in the Resources struct of the generated shader, like the
+// resources themselves.
+#define gl_GlobalInvocationID __res->gl_GlobalInvocationID
+#define gl_LocalInvocationID __res->gl_LocalInvocationID
+#define gl_WorkGroupID __res->gl_WorkGroupID
+#define gl_NumWorkGroups __res->gl_NumWorkGroups
+#define gl_WorkGroupSize __res->gl_WorkGroupSize
+#define gl_LocalInvocationIndex __res->gl_LocalInvocationIndex
+#define gl_FragCoord __res->gl_FragCoord
+#define gl_FrontFacing __res->gl_FrontFacing
+#define gl_FragDepth __res->gl_FragDepth
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPIRV_CROSS_SIMD_THREAD_GROUP_HPP
+#define SPIRV_CROSS_SIMD_THREAD_GROUP_HPP
+
+// Runs a shader compiled by CompilerCPP with a SIMD width on a pool of
+// threads. Every thread owns one shader instance, and workgroups or chunks
+// of fragments are handed out from a shared counter, so uneven work
+// balances itself. The calling thread takes part and owns instance 0.
+//
+// Only the C interface is used, so this works with shaders loaded from a
+// shared library as well as linked ones.
+
+#include "simd_external_interface.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace spirv_cross
+{
+namespace simd
+{
+class ThreadGroup
+{
+public:
+	// A thread count of 0 uses one thread per hardware thread.
+	explicit ThreadGroup(const spirv_cross_simd_interface *iface_, unsigned threads = 0)
+	    : iface(iface_)
+	{
+		if (!threads)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+
+		for (unsigned i = 0; i < threads; i++)
+		{
+			spirv_cross_simd_shader_t *shader = iface->construct();
+			if (!shader)
+			{
+				release();
+				throw std::bad_alloc();
+			}
+			shaders.push_back(shader);
+		}
+
+		for (unsigned i = 1; i < threads; i++)
+			workers.emplace_back(&ThreadGroup::worker, this, i);
+	}
+
+	~ThreadGroup()
+	{
+		release();
+	}
+
+	ThreadGroup(const ThreadGroup &) = delete;
+	ThreadGroup &operator=(const ThreadGroup &) = delete;
+
+	unsigned thread_count() const
+	{
+		return unsigned(shaders.size());
+	}
+
+	void set_resource(unsigned set, unsigned binding, void *data, size_t size)
+	{
+		for (auto *s : shaders)
+			iface->set_resource(s, set, binding, data, size);
+	}
+
+	void set_push_constant(void *data, size_t size)
+	{
+		for (auto *s : shaders)
+			iface->set_push_constant(s, data, size);
+	}
+
+	void set_stage_input(unsigned location, const void *data, size_t stride)
+	{
+		for (auto *s : shaders)
+			iface->set_stage_input(s, location, data, stride);
+	}
+
+	void set_stage_output(unsigned location, void *data, size_t stride)
+	{
+		for (auto *s : shaders)
+			iface->set_stage_output(s, location, data, stride);
+	}
+
+	void set_builtin(unsigned builtin, void *data, size_t stride)
+	{
+		for (auto *s : shaders)
+			iface->set_builtin(s, builtin, data, stride);
+	}
+
+	// Runs x * y * z workgroups and returns when all of them are done.
+	void dispatch(unsigned x, unsigned y, unsigned z)
+	{
+		job.compute = true;
+		job.num_groups[0] = x;
+		job.num_groups[1] = y;
+		job.num_groups[2] = z;
+		run(size_t(x) * y * z);
+	}
+
+	// Shades fragments [0, count) and returns when all of them are done.
+	void shade(size_t count)
+	{
+		job.compute = false;
+		job.fragments = count;
+		job.chunk = 16 * iface->width;
+		run((count + job.chunk - 1) / job.chunk);
+	}
+
+private:
+	struct Job
+	{
+		bool compute = false;
+		unsigned num_groups[3] = {};
+		size_t fragments = 0;
+		size_t chunk = 0;
+	};
+
+	const spirv_cross_simd_interface *iface;
+	std::vector<spirv_cross_simd_shader_t *> shaders;
+	std::vector<std::thread> workers;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint64_t generation = 0;
+	unsigned busy = 0;
+	bool stopping = false;
+
+	Job job;
+	size_t items = 0;
+	std::atomic<size_t> next_item{ 0 };
+
+	void run(size_t count)
+	{
+		if (!count)
+			return;
+
+		{
+			std::lock_guard<std::mutex> holder(lock);
+			items = count;
+			next_item = 0;
+			busy = unsigned(workers.size());
+			generation++;
+		}
+		wake.notify_all();
+
+		work(0);
+
+		std::unique_lock<std::mutex> holder(lock);
+		done.wait(holder, [this] { return busy == 0; });
+	}
+
+	void work(unsigned instance)
+	{
+		spirv_cross_simd_shader_t *shader = shaders[instance];
+		for (;;)
+		{
+			size_t i = next_item.fetch_add(1);
+			if (i >= items)
+				break;
+
+			if (job.compute)
+			{
+				unsigned x = job.num_groups[0], y = job.num_groups[1];
+				unsigned group[3] = { unsigned(i % x), unsigned(i / x % y), unsigned(i / (size_t(x) * y)) };
+				iface->dispatch(shader, group, job.num_groups);
+			}
+			else
+			{
+				size_t first = i * job.chunk;
+				iface->shade(shader, first, std::min(job.chunk, job.fragments - first));
+			}
+		}
+	}
+
+	void worker(unsigned instance)
+	{
+		uint64_t seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> holder(lock);
+				wake.wait(holder, [&] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+
+			work(instance);
+
+			bool last;
+			{
+				std::lock_guard<std::mutex> holder(lock);
+				last = --busy == 0;
+			}
+			if (last)
+				done.notify_one();
+		}
+	}
+
+	void release()
+	{
+		{
+			std::lock_guard<std::mutex> holder(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto &t : workers)
+			t.join();
+		workers.clear();
+
+		for (auto *s : shaders)
+			iface->destruct(s);
+		shaders.clear();
+	}
+};
+}
+}
+
+#endif
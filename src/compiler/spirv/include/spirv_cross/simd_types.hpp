@@ -0,0 +1,2289 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPIRV_CROSS_SIMD_TYPES_HPP
+#define SPIRV_CROSS_SIMD_TYPES_HPP
+
+// Value types for shaders compiled by CompilerCPP with a SIMD width.
+//
+// Every GLSL value holds one lane per invocation of the batch: vfloat is W
+// floats, vec4 is four of those, and so on. The lanes are GCC/Clang vector
+// extension types, so the arithmetic compiles to whatever the target has
+// (SSE, AVX2, AVX-512 or NEON, depending on -march).
+//
+// Divergent control flow is handled with an execution mask: assignment only
+// writes the lanes which are active in exec_state<W>::active, and the
+// generated code narrows and widens that mask around branches and loops.
+// Construction and copy construction always copy every lane.
+
+#if !defined(__GNUC__)
+#error "The SIMD shader runtime needs the GCC or Clang vector extensions."
+#endif
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+namespace spirv_cross
+{
+namespace simd
+{
+template <typename T, unsigned W>
+struct vector_of
+{
+	typedef T type __attribute__((vector_size(sizeof(T) * W)));
+};
+
+template <unsigned W>
+using ivector = typename vector_of<int32_t, W>::type;
+
+template <unsigned W>
+using uvector = typename vector_of<uint32_t, W>::type;
+
+// All ones in the lanes which are on. A plain aggregate, so the thread_local
+// instances in exec_state need no initialization guard on access.
+template <unsigned W>
+struct mask
+{
+	ivector<W> v;
+
+	friend mask operator&(const mask &a, const mask &b)
+	{
+		mask r;
+		r.v = a.v & b.v;
+		return r;
+	}
+
+	friend mask operator|(const mask &a, const mask &b)
+	{
+		mask r;
+		r.v = a.v | b.v;
+		return r;
+	}
+
+	friend mask operator~(const mask &a)
+	{
+		mask r;
+		r.v = ~a.v;
+		return r;
+	}
+};
+
+template <unsigned W>
+inline bool any_lane(const mask<W> &m)
+{
+	int32_t bits = 0;
+	for (unsigned i = 0; i < W; i++)
+		bits |= m.v[i];
+	return bits != 0;
+}
+
+template <unsigned W>
+struct exec_state
+{
+	// Lanes which run the current statement.
+	static thread_local mask<W> active;
+	// Lanes which have not been discarded.
+	static thread_local mask<W> alive;
+};
+
+template <unsigned W>
+thread_local mask<W> exec_state<W>::active;
+template <unsigned W>
+thread_local mask<W> exec_state<W>::alive;
+
+template <typename V, unsigned W>
+inline V blend(const ivector<W> &m, const V &a, const V &b)
+{
+	return (V)((m & (ivector<W>)a) | (~m & (ivector<W>)b));
+}
+
+template <unsigned W>
+inline uvector<W> lane_index()
+{
+	uvector<W> r;
+	for (unsigned i = 0; i < W; i++)
+		r[i] = i;
+	return r;
+}
+
+template <typename T, unsigned W>
+struct lanes;
+template <unsigned W>
+struct bool_lanes;
+template <typename T, unsigned N, unsigned W>
+struct tvec;
+template <unsigned C, unsigned R, unsigned W>
+struct tmat;
+template <typename T, unsigned N>
+struct varray;
+template <unsigned W>
+struct addr;
+template <typename V>
+struct scalar_ref;
+template <typename V, uint32_t ElemStride>
+struct vector_ref;
+
+// Lane-wise helpers for the transcendental functions, which the vector
+// extensions do not cover. Compilers vectorize the loops where they can.
+#define SPIRV_CROSS_SIMD_MAP1(name, expr)                   \
+	friend lanes name(const lanes &a)                       \
+	{                                                       \
+		lanes r;                                            \
+		for (unsigned i = 0; i < W; i++)                    \
+		{                                                   \
+			T x = a.v[i];                                   \
+			r.v[i] = (expr);                                \
+		}                                                   \
+		return r;                                           \
+	}
+
+#define SPIRV_CROSS_SIMD_MAP2(name, expr)                   \
+	friend lanes name(const lanes &a, const lanes &b)       \
+	{                                                       \
+		lanes r;                                            \
+		for (unsigned i = 0; i < W; i++)                    \
+		{                                                   \
+			T x = a.v[i];                                   \
+			T y = b.v[i];                                   \
+			r.v[i] = (expr);                                \
+		}                                                   \
+		return r;                                           \
+	}
+
+// W lanes of a 32-bit scalar: float, int32_t or uint32_t.
+template <typename T, unsigned W>
+struct lanes
+{
+	typedef T element_type;
+	typedef typename vector_of<T, W>::type vector_type;
+	static const unsigned width = W;
+
+	vector_type v;
+
+	lanes()
+	    : v()
+	{
+	}
+
+	// Only the exact scalar type converts implicitly, so literals never
+	// pick the wrong overload.
+	template <typename U, typename std::enable_if<std::is_same<U, T>::value, int>::type = 0>
+	lanes(U s)
+	    : v(splat(s))
+	{
+	}
+
+	template <typename U,
+	          typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, T>::value, int>::type = 0>
+	explicit lanes(U s)
+	    : v(splat(T(s)))
+	{
+	}
+
+	template <typename U>
+	explicit lanes(const lanes<U, W> &o)
+	    : v(__builtin_convertvector(o.v, vector_type))
+	{
+	}
+
+	explicit lanes(const bool_lanes<W> &b)
+	    : v(__builtin_convertvector(b.v & 1, vector_type))
+	{
+	}
+
+	lanes(const lanes &) = default;
+
+	lanes &operator=(const lanes &o)
+	{
+		v = blend<vector_type, W>(exec_state<W>::active.v, o.v, v);
+		return *this;
+	}
+
+	lanes &operator++()
+	{
+		return *this = *this + lanes(T(1));
+	}
+
+	lanes &operator--()
+	{
+		return *this = *this - lanes(T(1));
+	}
+
+	lanes operator++(int)
+	{
+		lanes r = *this;
+		++*this;
+		return r;
+	}
+
+	lanes operator--(int)
+	{
+		lanes r = *this;
+		--*this;
+		return r;
+	}
+
+	static vector_type splat(T s)
+	{
+		vector_type r = {};
+		return r + s;
+	}
+
+	static lanes from(const vector_type &v)
+	{
+		lanes r;
+		r.v = v;
+		return r;
+	}
+
+	// Integer division by zero and INT_MIN / -1 are undefined in GLSL but
+	// trap on x86, so those lanes divide by one instead.
+	static vector_type divisor(const vector_type &a, const vector_type &b)
+	{
+		vector_type d = blend<vector_type, W>(b == 0, splat(1), b);
+		if (std::is_signed<T>::value)
+		{
+			T min_value = T(T(1) << (sizeof(T) * 8 - 1));
+			d = blend<vector_type, W>((a == min_value) & (b == T(-1)), splat(1), d);
+		}
+		return d;
+	}
+
+	static vector_type divide(const vector_type &a, const vector_type &b, std::true_type)
+	{
+		return a / divisor(a, b);
+	}
+
+	static vector_type divide(const vector_type &a, const vector_type &b, std::false_type)
+	{
+		return a / b;
+	}
+
+	friend lanes operator+(const lanes &a, const lanes &b)
+	{
+		return from(a.v + b.v);
+	}
+
+	friend lanes operator-(const lanes &a, const lanes &b)
+	{
+		return from(a.v - b.v);
+	}
+
+	friend lanes operator*(const lanes &a, const lanes &b)
+	{
+		return from(a.v * b.v);
+	}
+
+	friend lanes operator/(const lanes &a, const lanes &b)
+	{
+		return from(divide(a.v, b.v, std::is_integral<T>()));
+	}
+
+	friend lanes operator%(const lanes &a, const lanes &b)
+	{
+		return from(a.v % divisor(a.v, b.v));
+	}
+
+	friend lanes operator-(const lanes &a)
+	{
+		return from(-a.v);
+	}
+
+	friend lanes operator~(const lanes &a)
+	{
+		return from(~a.v);
+	}
+
+	friend lanes operator&(const lanes &a, const lanes &b)
+	{
+		return from(a.v & b.v);
+	}
+
+	friend lanes operator|(const lanes &a, const lanes &b)
+	{
+		return from(a.v | b.v);
+	}
+
+	friend lanes operator^(const lanes &a, const lanes &b)
+	{
+		return from(a.v ^ b.v);
+	}
+
+	// Shift counts are taken modulo 32, like the hardware does.
+	template <typename U>
+	friend lanes operator<<(const lanes &a, const lanes<U, W> &b)
+	{
+		return from(a.v << (vector_type)(b.v & U(31)));
+	}
+
+	template <typename U>
+	friend lanes operator>>(const lanes &a, const lanes<U, W> &b)
+	{
+		return from(a.v >> (vector_type)(b.v & U(31)));
+	}
+
+	friend lanes operator<<(const lanes &a, int32_t b)
+	{
+		return from(a.v << T(b & 31));
+	}
+
+	friend lanes operator<<(const lanes &a, uint32_t b)
+	{
+		return from(a.v << T(b & 31));
+	}
+
+	friend lanes operator>>(const lanes &a, int32_t b)
+	{
+		return from(a.v >> T(b & 31));
+	}
+
+	friend lanes operator>>(const lanes &a, uint32_t b)
+	{
+		return from(a.v >> T(b & 31));
+	}
+
+	friend bool_lanes<W> operator<(const lanes &a, const lanes &b)
+	{
+		return bool_lanes<W>::from(a.v < b.v);
+	}
+
+	friend bool_lanes<W> operator<=(const lanes &a, const lanes &b)
+	{
+		return bool_lanes<W>::from(a.v <= b.v);
+	}
+
+	friend bool_lanes<W> operator>(const lanes &a, const lanes &b)
+	{
+		return bool_lanes<W>::from(a.v > b.v);
+	}
+
+	friend bool_lanes<W> operator>=(const lanes &a, const lanes &b)
+	{
+		return bool_lanes<W>::from(a.v >= b.v);
+	}
+
+	friend bool_lanes<W> operator==(const lanes &a, const lanes &b)
+	{
+		return bool_lanes<W>::from(a.v == b.v);
+	}
+
+	friend bool_lanes<W> operator!=(const lanes &a, const lanes &b)
+	{
+		return bool_lanes<W>::from(a.v != b.v);
+	}
+
+	// GLSL built-in functions on scalars. The vector forms are in tvec.
+	friend lanes abs(const lanes &a)
+	{
+		return from(blend<vector_type, W>(a.v < 0, -a.v, a.v));
+	}
+
+	friend lanes sign(const lanes &a)
+	{
+		vector_type r = blend<vector_type, W>(a.v > 0, splat(1), vector_type{});
+		return from(blend<vector_type, W>(a.v < 0, splat(T(-1)), r));
+	}
+
+	friend lanes min(const lanes &a, const lanes &b)
+	{
+		return from(blend<vector_type, W>(b.v < a.v, b.v, a.v));
+	}
+
+	friend lanes max(const lanes &a, const lanes &b)
+	{
+		return from(blend<vector_type, W>(a.v < b.v, b.v, a.v));
+	}
+
+	friend lanes clamp(const lanes &x, const lanes &lo, const lanes &hi)
+	{
+		return min(max(x, lo), hi);
+	}
+
+	friend lanes mix(const lanes &x, const lanes &y, const lanes &a)
+	{
+		return from(x.v + (y.v - x.v) * a.v);
+	}
+
+	friend lanes mix(const lanes &x, const lanes &y, const bool_lanes<W> &a)
+	{
+		return from(blend<vector_type, W>(a.v, y.v, x.v));
+	}
+
+	friend lanes step(const lanes &edge, const lanes &x)
+	{
+		return from(blend<vector_type, W>(x.v < edge.v, vector_type{}, splat(1)));
+	}
+
+	friend lanes smoothstep(const lanes &e0, const lanes &e1, const lanes &x)
+	{
+		lanes t = clamp(from((x.v - e0.v) / (e1.v - e0.v)), T(0), T(1));
+		return from(t.v * t.v * (T(3) - T(2) * t.v));
+	}
+
+	friend lanes fma(const lanes &a, const lanes &b, const lanes &c)
+	{
+		return from(a.v * b.v + c.v);
+	}
+
+	friend lanes mod(const lanes &x, const lanes &y)
+	{
+		return from(x.v - y.v * floor(from(x.v / y.v)).v);
+	}
+
+	friend lanes fract(const lanes &a)
+	{
+		return from(a.v - floor(a).v);
+	}
+
+	friend lanes radians(const lanes &a)
+	{
+		return from(a.v * T(0.01745329251994329577));
+	}
+
+	friend lanes degrees(const lanes &a)
+	{
+		return from(a.v * T(57.2957795130823208768));
+	}
+
+	friend lanes inversesqrt(const lanes &a)
+	{
+		return from(T(1) / sqrt(a).v);
+	}
+
+	friend lanes length(const lanes &a)
+	{
+		return abs(a);
+	}
+
+	friend lanes distance(const lanes &a, const lanes &b)
+	{
+		return abs(a - b);
+	}
+
+	friend lanes dot(const lanes &a, const lanes &b)
+	{
+		return a * b;
+	}
+
+	friend lanes normalize(const lanes &a)
+	{
+		return sign(a);
+	}
+
+	friend lanes modf(const lanes &x, lanes &whole)
+	{
+		lanes t = trunc(x);
+		whole = t;
+		return from(x.v - t.v);
+	}
+
+	friend lanes frexp(const lanes &x, lanes<int32_t, W> &e)
+	{
+		lanes r;
+		lanes<int32_t, W> exponent;
+		for (unsigned i = 0; i < W; i++)
+		{
+			int ei;
+			r.v[i] = frexpf(x.v[i], &ei);
+			exponent.v[i] = ei;
+		}
+		e = exponent;
+		return r;
+	}
+
+	friend lanes ldexp(const lanes &x, const lanes<int32_t, W> &e)
+	{
+		lanes r;
+		for (unsigned i = 0; i < W; i++)
+			r.v[i] = ldexpf(x.v[i], e.v[i]);
+		return r;
+	}
+
+	SPIRV_CROSS_SIMD_MAP1(floor, floorf(x))
+	SPIRV_CROSS_SIMD_MAP1(ceil, ceilf(x))
+	SPIRV_CROSS_SIMD_MAP1(trunc, truncf(x))
+	SPIRV_CROSS_SIMD_MAP1(round, roundf(x))
+	SPIRV_CROSS_SIMD_MAP1(roundEven, rintf(x))
+	SPIRV_CROSS_SIMD_MAP1(sqrt, sqrtf(x))
+	SPIRV_CROSS_SIMD_MAP1(exp, expf(x))
+	SPIRV_CROSS_SIMD_MAP1(exp2, exp2f(x))
+	SPIRV_CROSS_SIMD_MAP1(log, logf(x))
+	SPIRV_CROSS_SIMD_MAP1(log2, log2f(x))
+	SPIRV_CROSS_SIMD_MAP1(sin, sinf(x))
+	SPIRV_CROSS_SIMD_MAP1(cos, cosf(x))
+	SPIRV_CROSS_SIMD_MAP1(tan, tanf(x))
+	SPIRV_CROSS_SIMD_MAP1(asin, asinf(x))
+	SPIRV_CROSS_SIMD_MAP1(acos, acosf(x))
+	SPIRV_CROSS_SIMD_MAP1(atan, atanf(x))
+	SPIRV_CROSS_SIMD_MAP1(sinh, sinhf(x))
+	SPIRV_CROSS_SIMD_MAP1(cosh, coshf(x))
+	SPIRV_CROSS_SIMD_MAP1(tanh, tanhf(x))
+	SPIRV_CROSS_SIMD_MAP1(asinh, asinhf(x))
+	SPIRV_CROSS_SIMD_MAP1(acosh, acoshf(x))
+	SPIRV_CROSS_SIMD_MAP1(atanh, atanhf(x))
+	SPIRV_CROSS_SIMD_MAP1(bitCount, T(__builtin_popcount(uint32_t(x))))
+	SPIRV_CROSS_SIMD_MAP1(findLSB, T(x ? __builtin_ctz(uint32_t(x)) : -1))
+	SPIRV_CROSS_SIMD_MAP1(findMSB, T(find_msb(x)))
+	SPIRV_CROSS_SIMD_MAP1(bitfieldReverse, T(reverse_bits(uint32_t(x))))
+	SPIRV_CROSS_SIMD_MAP2(pow, powf(x, y))
+	SPIRV_CROSS_SIMD_MAP2(atan, atan2f(x, y))
+
+	friend lanes bitfieldExtract(const lanes &a, const lanes<int32_t, W> &offset, const lanes<int32_t, W> &bits)
+	{
+		lanes r;
+		for (unsigned i = 0; i < W; i++)
+		{
+			int32_t o = offset.v[i] & 31, n = bits.v[i];
+			if (n <= 0 || n > 32 - o)
+				r.v[i] = 0;
+			else if (std::is_signed<T>::value)
+				r.v[i] = T(int32_t(uint32_t(a.v[i]) << (32 - o - n)) >> (32 - n));
+			else
+				r.v[i] = T((uint32_t(a.v[i]) >> o) & (n == 32 ? ~0u : (1u << n) - 1));
+		}
+		return r;
+	}
+
+	friend lanes bitfieldInsert(const lanes &base, const lanes &insert, const lanes<int32_t, W> &offset,
+	                            const lanes<int32_t, W> &bits)
+	{
+		lanes r;
+		for (unsigned i = 0; i < W; i++)
+		{
+			int32_t o = offset.v[i] & 31, n = bits.v[i];
+			uint32_t m = n <= 0 || n > 32 - o ? 0u : (n == 32 ? ~0u : ((1u << n) - 1) << o);
+			r.v[i] = T((uint32_t(base.v[i]) & ~m) | ((uint32_t(insert.v[i]) << o) & m));
+		}
+		return r;
+	}
+
+	friend bool_lanes<W> isnan(const lanes &a)
+	{
+		return bool_lanes<W>::from(a.v != a.v);
+	}
+
+	friend bool_lanes<W> isinf(const lanes &a)
+	{
+		return bool_lanes<W>::from(abs(a).v == T(INFINITY));
+	}
+
+	friend lanes<int32_t, W> floatBitsToInt(const lanes &a)
+	{
+		return lanes<int32_t, W>::from((ivector<W>)a.v);
+	}
+
+	friend lanes<uint32_t, W> floatBitsToUint(const lanes &a)
+	{
+		return lanes<uint32_t, W>::from((uvector<W>)a.v);
+	}
+
+	friend lanes<float, W> intBitsToFloat(const lanes &a)
+	{
+		return lanes<float, W>::from((typename vector_of<float, W>::type)a.v);
+	}
+
+	friend lanes<float, W> uintBitsToFloat(const lanes &a)
+	{
+		return lanes<float, W>::from((typename vector_of<float, W>::type)a.v);
+	}
+
+	static int32_t find_msb(T x)
+	{
+		uint32_t u = uint32_t(x);
+		if (std::is_signed<T>::value && int32_t(u) < 0)
+			u = ~u;
+		return u ? 31 - __builtin_clz(u) : -1;
+	}
+
+	static uint32_t reverse_bits(uint32_t x)
+	{
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+		x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	// Lanes which a dynamic index may address, clamped to [0, count).
+	uvector<W> clamped_index(uint32_t count) const
+	{
+		uvector<W> i = (uvector<W>)v;
+		if (std::is_signed<T>::value)
+			i = blend<uvector<W>, W>(v < 0, uvector<W>{}, i);
+		return blend<uvector<W>, W>(i >= count, uvector<W>{} + (count - 1), i);
+	}
+};
+
+#undef SPIRV_CROSS_SIMD_MAP1
+#undef SPIRV_CROSS_SIMD_MAP2
+
+// W lanes of bool, stored as all ones or zero.
+template <unsigned W>
+struct bool_lanes
+{
+	typedef int32_t element_type;
+	typedef ivector<W> vector_type;
+	static const unsigned width = W;
+
+	vector_type v;
+
+	bool_lanes()
+	    : v()
+	{
+	}
+
+	template <typename B, typename std::enable_if<std::is_same<B, bool>::value, int>::type = 0>
+	bool_lanes(B b)
+	    : v(vector_type{} + (b ? -1 : 0))
+	{
+	}
+
+	template <typename U, typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, bool>::value,
+	                                              int>::type = 0>
+	explicit bool_lanes(U s)
+	    : v(vector_type{} + (s != 0 ? -1 : 0))
+	{
+	}
+
+	template <typename U>
+	explicit bool_lanes(const lanes<U, W> &o)
+	    : v(o.v != 0)
+	{
+	}
+
+	bool_lanes(const bool_lanes &) = default;
+
+	bool_lanes &operator=(const bool_lanes &o)
+	{
+		v = blend<vector_type, W>(exec_state<W>::active.v, o.v, v);
+		return *this;
+	}
+
+	static bool_lanes from(const vector_type &v)
+	{
+		bool_lanes r;
+		r.v = v;
+		return r;
+	}
+
+	friend bool_lanes operator!(const bool_lanes &a)
+	{
+		return from(~a.v);
+	}
+
+	friend bool_lanes operator&&(const bool_lanes &a, const bool_lanes &b)
+	{
+		return from(a.v & b.v);
+	}
+
+	friend bool_lanes operator||(const bool_lanes &a, const bool_lanes &b)
+	{
+		return from(a.v | b.v);
+	}
+
+	friend bool_lanes operator&(const bool_lanes &a, const bool_lanes &b)
+	{
+		return from(a.v & b.v);
+	}
+
+	friend bool_lanes operator|(const bool_lanes &a, const bool_lanes &b)
+	{
+		return from(a.v | b.v);
+	}
+
+	friend bool_lanes operator^(const bool_lanes &a, const bool_lanes &b)
+	{
+		return from(a.v ^ b.v);
+	}
+
+	friend bool_lanes operator==(const bool_lanes &a, const bool_lanes &b)
+	{
+		return from(~(a.v ^ b.v));
+	}
+
+	friend bool_lanes operator!=(const bool_lanes &a, const bool_lanes &b)
+	{
+		return from(a.v ^ b.v);
+	}
+
+	friend bool_lanes mix(const bool_lanes &x, const bool_lanes &y, const bool_lanes &a)
+	{
+		return from(blend<vector_type, W>(a.v, y.v, x.v));
+	}
+};
+
+// Copies every lane, ignoring the execution mask. The runtime uses this to
+// fill in values it builds itself.
+template <typename T, unsigned W>
+inline void copy_lanes(lanes<T, W> &dst, const lanes<T, W> &src)
+{
+	dst.v = src.v;
+}
+
+template <unsigned W>
+inline void copy_lanes(bool_lanes<W> &dst, const bool_lanes<W> &src)
+{
+	dst.v = src.v;
+}
+
+template <typename T, unsigned N, unsigned W>
+inline void copy_lanes(tvec<T, N, W> &dst, const tvec<T, N, W> &src)
+{
+	for (unsigned i = 0; i < N; i++)
+		dst.data()[i].v = src.data()[i].v;
+}
+
+template <unsigned C, unsigned R, unsigned W>
+inline void copy_lanes(tmat<C, R, W> &dst, const tmat<C, R, W> &src)
+{
+	for (unsigned i = 0; i < C; i++)
+		copy_lanes(dst.c[i], src.c[i]);
+}
+
+template <typename T, unsigned N>
+inline void copy_lanes(varray<T, N> &dst, const varray<T, N> &src)
+{
+	for (unsigned i = 0; i < N; i++)
+		copy_lanes(dst.elems[i], src.elems[i]);
+}
+
+template <typename T, unsigned W>
+struct component
+{
+	typedef lanes<T, W> type;
+};
+
+template <unsigned W>
+struct component<bool, W>
+{
+	typedef bool_lanes<W> type;
+};
+
+// How many vector components a constructor argument supplies; zero for
+// anything which is not a GLSL value.
+template <typename A>
+struct arg_components : std::integral_constant<unsigned, std::is_arithmetic<A>::value ? 1 : 0>
+{
+};
+
+template <typename U, unsigned W>
+struct arg_components<lanes<U, W>> : std::integral_constant<unsigned, 1>
+{
+};
+
+template <unsigned W>
+struct arg_components<bool_lanes<W>> : std::integral_constant<unsigned, 1>
+{
+};
+
+template <typename V>
+struct arg_components<scalar_ref<V>> : std::integral_constant<unsigned, 1>
+{
+};
+
+template <typename U, unsigned M, unsigned W>
+struct arg_components<tvec<U, M, W>> : std::integral_constant<unsigned, M>
+{
+};
+
+template <typename... A>
+struct sum_components;
+
+template <>
+struct sum_components<> : std::integral_constant<unsigned, 0>
+{
+};
+
+template <typename A, typename... Rest>
+struct sum_components<A, Rest...>
+    : std::integral_constant<unsigned, arg_components<A>::value == 0 ?
+                                           0x10000u :
+                                           arg_components<A>::value + sum_components<Rest...>::value>
+{
+};
+
+template <typename C, unsigned N>
+struct vec_storage;
+
+template <typename C>
+struct vec_storage<C, 2>
+{
+	C x, y;
+};
+
+template <typename C>
+struct vec_storage<C, 3>
+{
+	C x, y, z;
+};
+
+template <typename C>
+struct vec_storage<C, 4>
+{
+	C x, y, z, w;
+};
+
+#define SPIRV_CROSS_SIMD_SWIZZLE2(a, b)            \
+	tvec<T, 2, W> a##b() const                     \
+	{                                              \
+		return tvec<T, 2, W>(this->a, this->b);    \
+	}
+#define SPIRV_CROSS_SIMD_SWIZZLE3(a, b, c)                  \
+	tvec<T, 3, W> a##b##c() const                           \
+	{                                                       \
+		return tvec<T, 3, W>(this->a, this->b, this->c);    \
+	}
+#define SPIRV_CROSS_SIMD_SWIZZLE4(a, b, c, d)                        \
+	tvec<T, 4, W> a##b##c##d() const                                 \
+	{                                                                \
+		return tvec<T, 4, W>(this->a, this->b, this->c, this->d);    \
+	}
+#define SPIRV_CROSS_SIMD_SWIZZLE2_ROW(a) \
+	SPIRV_CROSS_SIMD_SWIZZLE2(a, x)      \
+	SPIRV_CROSS_SIMD_SWIZZLE2(a, y)      \
+	SPIRV_CROSS_SIMD_SWIZZLE2(a, z)      \
+	SPIRV_CROSS_SIMD_SWIZZLE2(a, w)
+#define SPIRV_CROSS_SIMD_SWIZZLE3_COL(a, b) \
+	SPIRV_CROSS_SIMD_SWIZZLE3(a, b, x)      \
+	SPIRV_CROSS_SIMD_SWIZZLE3(a, b, y)      \
+	SPIRV_CROSS_SIMD_SWIZZLE3(a, b, z)      \
+	SPIRV_CROSS_SIMD_SWIZZLE3(a, b, w)
+#define SPIRV_CROSS_SIMD_SWIZZLE3_ROW(a)   \
+	SPIRV_CROSS_SIMD_SWIZZLE3_COL(a, x)    \
+	SPIRV_CROSS_SIMD_SWIZZLE3_COL(a, y)    \
+	SPIRV_CROSS_SIMD_SWIZZLE3_COL(a, z)    \
+	SPIRV_CROSS_SIMD_SWIZZLE3_COL(a, w)
+#define SPIRV_CROSS_SIMD_SWIZZLE4_LAST(a, b, c) \
+	SPIRV_CROSS_SIMD_SWIZZLE4(a, b, c, x)       \
+	SPIRV_CROSS_SIMD_SWIZZLE4(a, b, c, y)       \
+	SPIRV_CROSS_SIMD_SWIZZLE4(a, b, c, z)       \
+	SPIRV_CROSS_SIMD_SWIZZLE4(a, b, c, w)
+#define SPIRV_CROSS_SIMD_SWIZZLE4_COL(a, b)     \
+	SPIRV_CROSS_SIMD_SWIZZLE4_LAST(a, b, x)     \
+	SPIRV_CROSS_SIMD_SWIZZLE4_LAST(a, b, y)     \
+	SPIRV_CROSS_SIMD_SWIZZLE4_LAST(a, b, z)     \
+	SPIRV_CROSS_SIMD_SWIZZLE4_LAST(a, b, w)
+#define SPIRV_CROSS_SIMD_SWIZZLE4_ROW(a)   \
+	SPIRV_CROSS_SIMD_SWIZZLE4_COL(a, x)    \
+	SPIRV_CROSS_SIMD_SWIZZLE4_COL(a, y)    \
+	SPIRV_CROSS_SIMD_SWIZZLE4_COL(a, z)    \
+	SPIRV_CROSS_SIMD_SWIZZLE4_COL(a, w)
+
+// Component-wise forms of the scalar built-ins.
+#define SPIRV_CROSS_SIMD_VEC1(name)                        \
+	friend tvec name(const tvec &a)                        \
+	{                                                      \
+		tvec r;                                            \
+		for (unsigned i = 0; i < N; i++)                   \
+			r.data()[i].v = name(a.data()[i]).v;           \
+		return r;                                          \
+	}
+#define SPIRV_CROSS_SIMD_VEC1_TO(name, U)                              \
+	friend tvec<U, N, W> name(const tvec &a)                           \
+	{                                                                  \
+		tvec<U, N, W> r;                                               \
+		for (unsigned i = 0; i < N; i++)                               \
+			r.data()[i].v = name(a.data()[i]).v;                       \
+		return r;                                                      \
+	}
+#define SPIRV_CROSS_SIMD_VEC2(name)                             \
+	friend tvec name(const tvec &a, const tvec &b)              \
+	{                                                           \
+		tvec r;                                                 \
+		for (unsigned i = 0; i < N; i++)                        \
+			r.data()[i].v = name(a.data()[i], b.data()[i]).v;   \
+		return r;                                               \
+	}
+#define SPIRV_CROSS_SIMD_VEC2_SCALAR(name)                 \
+	friend tvec name(const tvec &a, const C &b)            \
+	{                                                      \
+		tvec r;                                            \
+		for (unsigned i = 0; i < N; i++)                   \
+			r.data()[i].v = name(a.data()[i], b).v;        \
+		return r;                                          \
+	}
+#define SPIRV_CROSS_SIMD_VEC3(name)                                          \
+	friend tvec name(const tvec &a, const tvec &b, const tvec &c)            \
+	{                                                                        \
+		tvec r;                                                              \
+		for (unsigned i = 0; i < N; i++)                                     \
+			r.data()[i].v = name(a.data()[i], b.data()[i], c.data()[i]).v;   \
+		return r;                                                            \
+	}
+#define SPIRV_CROSS_SIMD_VEC_OP(op)                                  \
+	friend tvec operator op(const tvec &a, const tvec &b)            \
+	{                                                                \
+		tvec r;                                                      \
+		for (unsigned i = 0; i < N; i++)                             \
+			r.data()[i].v = (a.data()[i] op b.data()[i]).v;          \
+		return r;                                                    \
+	}                                                                \
+	friend tvec operator op(const tvec &a, const C &b)               \
+	{                                                                \
+		tvec r;                                                      \
+		for (unsigned i = 0; i < N; i++)                             \
+			r.data()[i].v = (a.data()[i] op b).v;                    \
+		return r;                                                    \
+	}                                                                \
+	friend tvec operator op(const C &a, const tvec &b)               \
+	{                                                                \
+		tvec r;                                                      \
+		for (unsigned i = 0; i < N; i++)                             \
+			r.data()[i].v = (a op b.data()[i]).v;                    \
+		return r;                                                    \
+	}
+#define SPIRV_CROSS_SIMD_VEC_COMPARE(name, op)                            \
+	friend tvec<bool, N, W> name(const tvec &a, const tvec &b)            \
+	{                                                                     \
+		tvec<bool, N, W> r;                                               \
+		for (unsigned i = 0; i < N; i++)                                  \
+			r.data()[i].v = (a.data()[i] op b.data()[i]).v;               \
+		return r;                                                         \
+	}
+
+// An N component GLSL vector of T: vec3 is tvec<float, 3, W>.
+template <typename T, unsigned N, unsigned W>
+struct tvec : vec_storage<typename component<T, W>::type, N>
+{
+	typedef typename component<T, W>::type C;
+	typedef C component_type;
+	typedef T element_type;
+	static const unsigned size = N;
+	static const unsigned width = W;
+
+	tvec()
+	{
+	}
+
+	tvec(const tvec &) = default;
+	tvec &operator=(const tvec &) = default;
+
+	// Splat: vec4(x).
+	template <typename A, typename std::enable_if<arg_components<A>::value == 1, int>::type = 0>
+	explicit tvec(const A &a)
+	{
+		C c(a);
+		for (unsigned i = 0; i < N; i++)
+			data()[i].v = c.v;
+	}
+
+	// Conversion and truncation: vec3(ivec3), vec2(v4).
+	template <typename U, unsigned M, typename std::enable_if<(M >= N), int>::type = 0>
+	explicit tvec(const tvec<U, M, W> &o)
+	{
+		for (unsigned i = 0; i < N; i++)
+			data()[i].v = C(o.data()[i]).v;
+	}
+
+	// Component lists: vec4(v.xy(), 0.0f, 1.0f).
+	template <typename A0, typename A1, typename... A,
+	          typename std::enable_if<sum_components<A0, A1, A...>::value == N, int>::type = 0>
+	tvec(const A0 &a0, const A1 &a1, const A &... a)
+	{
+		fill(data(), a0, a1, a...);
+	}
+
+	// The members are laid out like C[N]; taking the address of the whole
+	// storage rather than of x keeps GCC's object size checks quiet.
+	C *data()
+	{
+		static_assert(sizeof(vec_storage<C, N>) == N * sizeof(C), "Vector components must be packed.");
+		return reinterpret_cast<C *>(static_cast<vec_storage<C, N> *>(this));
+	}
+
+	const C *data() const
+	{
+		return reinterpret_cast<const C *>(static_cast<const vec_storage<C, N> *>(this));
+	}
+
+	C &operator[](int32_t i)
+	{
+		return data()[i];
+	}
+
+	const C &operator[](int32_t i) const
+	{
+		return data()[i];
+	}
+
+	C &operator[](uint32_t i)
+	{
+		return data()[i];
+	}
+
+	const C &operator[](uint32_t i) const
+	{
+		return data()[i];
+	}
+
+	// A dynamic index picks a different component in every lane.
+	template <typename I>
+	scalar_ref<C> operator[](const lanes<I, W> &i) const
+	{
+		return scalar_ref<C>(addr<W>::of_lanes(data()).advanced(i.clamped_index(N) * uint32_t(sizeof(C))), 0);
+	}
+
+	SPIRV_CROSS_SIMD_SWIZZLE2_ROW(x)
+	SPIRV_CROSS_SIMD_SWIZZLE2_ROW(y)
+	SPIRV_CROSS_SIMD_SWIZZLE2_ROW(z)
+	SPIRV_CROSS_SIMD_SWIZZLE2_ROW(w)
+	SPIRV_CROSS_SIMD_SWIZZLE3_ROW(x)
+	SPIRV_CROSS_SIMD_SWIZZLE3_ROW(y)
+	SPIRV_CROSS_SIMD_SWIZZLE3_ROW(z)
+	SPIRV_CROSS_SIMD_SWIZZLE3_ROW(w)
+	SPIRV_CROSS_SIMD_SWIZZLE4_ROW(x)
+	SPIRV_CROSS_SIMD_SWIZZLE4_ROW(y)
+	SPIRV_CROSS_SIMD_SWIZZLE4_ROW(z)
+	SPIRV_CROSS_SIMD_SWIZZLE4_ROW(w)
+
+	SPIRV_CROSS_SIMD_VEC_OP(+)
+	SPIRV_CROSS_SIMD_VEC_OP(-)
+	SPIRV_CROSS_SIMD_VEC_OP(*)
+	SPIRV_CROSS_SIMD_VEC_OP(/)
+	SPIRV_CROSS_SIMD_VEC_OP(%)
+	SPIRV_CROSS_SIMD_VEC_OP(&)
+	SPIRV_CROSS_SIMD_VEC_OP(|)
+	SPIRV_CROSS_SIMD_VEC_OP(^)
+	SPIRV_CROSS_SIMD_VEC_OP(<<)
+	SPIRV_CROSS_SIMD_VEC_OP(>>)
+
+	friend tvec operator-(const tvec &a)
+	{
+		tvec r;
+		for (unsigned i = 0; i < N; i++)
+			r.data()[i].v = (-a.data()[i]).v;
+		return r;
+	}
+
+	friend tvec operator~(const tvec &a)
+	{
+		tvec r;
+		for (unsigned i = 0; i < N; i++)
+			r.data()[i].v = (~a.data()[i]).v;
+		return r;
+	}
+
+	// not() is spelled !() in C++, which is also what "not" expands to.
+	friend tvec operator!(const tvec &a)
+	{
+		tvec r;
+		for (unsigned i = 0; i < N; i++)
+			r.data()[i].v = (!a.data()[i]).v;
+		return r;
+	}
+
+	SPIRV_CROSS_SIMD_VEC1(abs)
+	SPIRV_CROSS_SIMD_VEC1(sign)
+	SPIRV_CROSS_SIMD_VEC1(floor)
+	SPIRV_CROSS_SIMD_VEC1(ceil)
+	SPIRV_CROSS_SIMD_VEC1(trunc)
+	SPIRV_CROSS_SIMD_VEC1(round)
+	SPIRV_CROSS_SIMD_VEC1(roundEven)
+	SPIRV_CROSS_SIMD_VEC1(fract)
+	SPIRV_CROSS_SIMD_VEC1(sqrt)
+	SPIRV_CROSS_SIMD_VEC1(inversesqrt)
+	SPIRV_CROSS_SIMD_VEC1(exp)
+	SPIRV_CROSS_SIMD_VEC1(exp2)
+	SPIRV_CROSS_SIMD_VEC1(log)
+	SPIRV_CROSS_SIMD_VEC1(log2)
+	SPIRV_CROSS_SIMD_VEC1(sin)
+	SPIRV_CROSS_SIMD_VEC1(cos)
+	SPIRV_CROSS_SIMD_VEC1(tan)
+	SPIRV_CROSS_SIMD_VEC1(asin)
+	SPIRV_CROSS_SIMD_VEC1(acos)
+	SPIRV_CROSS_SIMD_VEC1(atan)
+	SPIRV_CROSS_SIMD_VEC1(sinh)
+	SPIRV_CROSS_SIMD_VEC1(cosh)
+	SPIRV_CROSS_SIMD_VEC1(tanh)
+	SPIRV_CROSS_SIMD_VEC1(asinh)
+	SPIRV_CROSS_SIMD_VEC1(acosh)
+	SPIRV_CROSS_SIMD_VEC1(atanh)
+	SPIRV_CROSS_SIMD_VEC1(radians)
+	SPIRV_CROSS_SIMD_VEC1(degrees)
+	SPIRV_CROSS_SIMD_VEC1(bitCount)
+	SPIRV_CROSS_SIMD_VEC1(findLSB)
+	SPIRV_CROSS_SIMD_VEC1(findMSB)
+	SPIRV_CROSS_SIMD_VEC1(bitfieldReverse)
+	SPIRV_CROSS_SIMD_VEC1_TO(isnan, bool)
+	SPIRV_CROSS_SIMD_VEC1_TO(isinf, bool)
+	SPIRV_CROSS_SIMD_VEC1_TO(floatBitsToInt, int32_t)
+	SPIRV_CROSS_SIMD_VEC1_TO(floatBitsToUint, uint32_t)
+	SPIRV_CROSS_SIMD_VEC1_TO(intBitsToFloat, float)
+	SPIRV_CROSS_SIMD_VEC1_TO(uintBitsToFloat, float)
+	SPIRV_CROSS_SIMD_VEC2(min)
+	SPIRV_CROSS_SIMD_VEC2(max)
+	SPIRV_CROSS_SIMD_VEC2(pow)
+	SPIRV_CROSS_SIMD_VEC2(mod)
+	SPIRV_CROSS_SIMD_VEC2(atan)
+	SPIRV_CROSS_SIMD_VEC2(step)
+	SPIRV_CROSS_SIMD_VEC2_SCALAR(min)
+	SPIRV_CROSS_SIMD_VEC2_SCALAR(max)
+	SPIRV_CROSS_SIMD_VEC2_SCALAR(mod)
+	SPIRV_CROSS_SIMD_VEC3(clamp)
+	SPIRV_CROSS_SIMD_VEC3(mix)
+	SPIRV_CROSS_SIMD_VEC3(smoothstep)
+	SPIRV_CROSS_SIMD_VEC3(fma)
+	SPIRV_CROSS_SIMD_VEC_COMPARE(lessThan, <)
+	SPIRV_CROSS_SIMD_VEC_COMPARE(lessThanEqual, <=)
+	SPIRV_CROSS_SIMD_VEC_COMPARE(greaterThan, >)
+	SPIRV_CROSS_SIMD_VEC_COMPARE(greaterThanEqual, >=)
+	SPIRV_CROSS_SIMD_VEC_COMPARE(equal, ==)
+	SPIRV_CROSS_SIMD_VEC_COMPARE(notEqual, !=)
+
+	friend tvec clamp(const tvec &x, const C &lo, const C &hi)
+	{
+		return clamp(x, tvec(lo), tvec(hi));
+	}
+
+	friend tvec mix(const tvec &x, const tvec &y, const C &a)
+	{
+		return mix(x, y, tvec(a));
+	}
+
+	friend tvec mix(const tvec &x, const tvec &y, const tvec<bool, N, W> &a)
+	{
+		tvec r;
+		for (unsigned i = 0; i < N; i++)
+			r.data()[i].v = mix(x.data()[i], y.data()[i], a.data()[i]).v;
+		return r;
+	}
+
+	friend tvec step(const C &edge, const tvec &x)
+	{
+		return step(tvec(edge), x);
+	}
+
+	friend tvec smoothstep(const C &e0, const C &e1, const tvec &x)
+	{
+		return smoothstep(tvec(e0), tvec(e1), x);
+	}
+
+	friend tvec modf(const tvec &x, tvec &whole)
+	{
+		tvec t = trunc(x);
+		whole = t;
+		return x - t;
+	}
+
+	friend tvec frexp(const tvec &x, tvec<int32_t, N, W> &e)
+	{
+		tvec r;
+		tvec<int32_t, N, W> exponent;
+		for (unsigned i = 0; i < N; i++)
+		{
+			lanes<int32_t, W> ei;
+			r.data()[i].v = frexp(x.data()[i], ei).v;
+			exponent.data()[i].v = ei.v;
+		}
+		e = exponent;
+		return r;
+	}
+
+	friend tvec ldexp(const tvec &x, const tvec<int32_t, N, W> &e)
+	{
+		tvec r;
+		for (unsigned i = 0; i < N; i++)
+			r.data()[i].v = ldexp(x.data()[i], e.data()[i]).v;
+		return r;
+	}
+
+	friend tvec bitfieldExtract(const tvec &a, const lanes<int32_t, W> &offset, const lanes<int32_t, W> &bits)
+	{
+		tvec r;
+		for (unsigned i = 0; i < N; i++)
+			r.data()[i].v = bitfieldExtract(a.data()[i], offset, bits).v;
+		return r;
+	}
+
+	friend tvec bitfieldInsert(const tvec &base, const tvec &insert, const lanes<int32_t, W> &offset,
+	                           const lanes<int32_t, W> &bits)
+	{
+		tvec r;
+		for (unsigned i = 0; i < N; i++)
+			r.data()[i].v = bitfieldInsert(base.data()[i], insert.data()[i], offset, bits).v;
+		return r;
+	}
+
+	friend C dot(const tvec &a, const tvec &b)
+	{
+		C r = a.x * b.x;
+		for (unsigned i = 1; i < N; i++)
+			r.v += (a.data()[i] * b.data()[i]).v;
+		return r;
+	}
+
+	friend C length(const tvec &a)
+	{
+		return sqrt(dot(a, a));
+	}
+
+	friend C distance(const tvec &a, const tvec &b)
+	{
+		return length(a - b);
+	}
+
+	friend tvec normalize(const tvec &a)
+	{
+		return a * inversesqrt(dot(a, a));
+	}
+
+	friend tvec faceforward(const tvec &n, const tvec &i, const tvec &nref)
+	{
+		return mix(n, -n, tvec<bool, N, W>(dot(nref, i) >= T(0)));
+	}
+
+	friend tvec reflect(const tvec &i, const tvec &n)
+	{
+		return i - n * (dot(n, i) * T(2));
+	}
+
+	friend tvec refract(const tvec &i, const tvec &n, const C &eta)
+	{
+		C d = dot(n, i);
+		C k = T(1) - eta * eta * (T(1) - d * d);
+		tvec r = i * eta - n * (eta * d + sqrt(max(k, T(0))));
+		return mix(r, tvec(), tvec<bool, N, W>(k < T(0)));
+	}
+
+	friend C any(const tvec &a)
+	{
+		C r = a.x;
+		for (unsigned i = 1; i < N; i++)
+			r.v |= a.data()[i].v;
+		return r;
+	}
+
+	friend C all(const tvec &a)
+	{
+		C r = a.x;
+		for (unsigned i = 1; i < N; i++)
+			r.v &= a.data()[i].v;
+		return r;
+	}
+
+private:
+	template <typename U, unsigned V>
+	static void put(C *&dst, const lanes<U, V> &a)
+	{
+		(dst++)->v = C(a).v;
+	}
+
+	template <unsigned V>
+	static void put(C *&dst, const bool_lanes<V> &a)
+	{
+		(dst++)->v = C(a).v;
+	}
+
+	template <typename R>
+	static void put(C *&dst, const scalar_ref<R> &a)
+	{
+		put(dst, R(a));
+	}
+
+	template <typename U, unsigned M>
+	static void put(C *&dst, const tvec<U, M, W> &a)
+	{
+		for (unsigned i = 0; i < M; i++)
+			put(dst, a.data()[i]);
+	}
+
+	template <typename A, typename std::enable_if<std::is_arithmetic<A>::value, int>::type = 0>
+	static void put(C *&dst, const A &a)
+	{
+		(dst++)->v = C(a).v;
+	}
+
+	static void fill(C *)
+	{
+	}
+
+	template <typename A, typename... Rest>
+	static void fill(C *dst, const A &a, const Rest &... rest)
+	{
+		put(dst, a);
+		fill(dst, rest...);
+	}
+};
+
+template <unsigned W>
+inline tvec<float, 3, W> cross(const tvec<float, 3, W> &a, const tvec<float, 3, W> &b)
+{
+	return tvec<float, 3, W>(a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y);
+}
+
+#undef SPIRV_CROSS_SIMD_SWIZZLE2
+#undef SPIRV_CROSS_SIMD_SWIZZLE3
+#undef SPIRV_CROSS_SIMD_SWIZZLE4
+#undef SPIRV_CROSS_SIMD_SWIZZLE2_ROW
+#undef SPIRV_CROSS_SIMD_SWIZZLE3_COL
+#undef SPIRV_CROSS_SIMD_SWIZZLE3_ROW
+#undef SPIRV_CROSS_SIMD_SWIZZLE4_LAST
+#undef SPIRV_CROSS_SIMD_SWIZZLE4_COL
+#undef SPIRV_CROSS_SIMD_SWIZZLE4_ROW
+#undef SPIRV_CROSS_SIMD_VEC1
+#undef SPIRV_CROSS_SIMD_VEC1_TO
+#undef SPIRV_CROSS_SIMD_VEC2
+#undef SPIRV_CROSS_SIMD_VEC2_SCALAR
+#undef SPIRV_CROSS_SIMD_VEC3
+#undef SPIRV_CROSS_SIMD_VEC_OP
+#undef SPIRV_CROSS_SIMD_VEC_COMPARE
+
+// Packing functions, one lane at a time.
+namespace detail
+{
+inline uint16_t float_to_half(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+	uint32_t sign = (x >> 16) & 0x8000u;
+	int32_t exponent = int32_t((x >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = x & 0x7fffffu;
+
+	if (((x >> 23) & 0xff) == 0xff)
+		return uint16_t(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+	if (exponent >= 31)
+		return uint16_t(sign | 0x7c00u);
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return uint16_t(sign);
+		mantissa |= 0x800000u;
+		uint32_t shift = uint32_t(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t midpoint = 1u << (shift - 1);
+		if (rest > midpoint || (rest == midpoint && (half & 1)))
+			half++;
+		return uint16_t(sign | half);
+	}
+
+	uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fffu;
+	if (rest > 0x1000u || (rest == 0x1000u && (half & 1)))
+		half++;
+	return uint16_t(half);
+}
+
+inline float half_to_float(uint16_t h)
+{
+	uint32_t sign = uint32_t(h & 0x8000u) << 16;
+	uint32_t exponent = (h >> 10) & 0x1fu;
+	uint32_t mantissa = h & 0x3ffu;
+	uint32_t x;
+
+	if (exponent == 0x1f)
+		x = sign | 0x7f800000u | (mantissa << 13);
+	else if (exponent)
+		x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	else if (mantissa)
+	{
+		exponent = 113;
+		while (!(mantissa & 0x400u))
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		x = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+	}
+	else
+		x = sign;
+
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+inline uint32_t pack_unorm(float f, float scale)
+{
+	return uint32_t(rintf(fminf(fmaxf(f, 0.0f), 1.0f) * scale));
+}
+
+inline uint32_t pack_snorm(float f, float scale, uint32_t bits)
+{
+	int32_t v = int32_t(rintf(fminf(fmaxf(f, -1.0f), 1.0f) * scale));
+	return uint32_t(v) & bits;
+}
+
+inline float unpack_snorm(int32_t v, float scale)
+{
+	return fminf(fmaxf(float(v) / scale, -1.0f), 1.0f);
+}
+}
+
+template <unsigned W>
+inline lanes<uint32_t, W> packHalf2x16(const tvec<float, 2, W> &v)
+{
+	lanes<uint32_t, W> r;
+	for (unsigned i = 0; i < W; i++)
+		r.v[i] = detail::float_to_half(v.x.v[i]) | (uint32_t(detail::float_to_half(v.y.v[i])) << 16);
+	return r;
+}
+
+template <unsigned W>
+inline tvec<float, 2, W> unpackHalf2x16(const lanes<uint32_t, W> &p)
+{
+	tvec<float, 2, W> r;
+	for (unsigned i = 0; i < W; i++)
+	{
+		r.x.v[i] = detail::half_to_float(uint16_t(p.v[i]));
+		r.y.v[i] = detail::half_to_float(uint16_t(p.v[i] >> 16));
+	}
+	return r;
+}
+
+template <unsigned W>
+inline lanes<uint32_t, W> packUnorm4x8(const tvec<float, 4, W> &v)
+{
+	lanes<uint32_t, W> r;
+	for (unsigned i = 0; i < W; i++)
+		for (unsigned c = 0; c < 4; c++)
+			r.v[i] |= detail::pack_unorm(v.data()[c].v[i], 255.0f) << (8 * c);
+	return r;
+}
+
+template <unsigned W>
+inline tvec<float, 4, W> unpackUnorm4x8(const lanes<uint32_t, W> &p)
+{
+	tvec<float, 4, W> r;
+	for (unsigned i = 0; i < W; i++)
+		for (unsigned c = 0; c < 4; c++)
+			r.data()[c].v[i] = float((p.v[i] >> (8 * c)) & 0xffu) / 255.0f;
+	return r;
+}
+
+template <unsigned W>
+inline lanes<uint32_t, W> packSnorm4x8(const tvec<float, 4, W> &v)
+{
+	lanes<uint32_t, W> r;
+	for (unsigned i = 0; i < W; i++)
+		for (unsigned c = 0; c < 4; c++)
+			r.v[i] |= detail::pack_snorm(v.data()[c].v[i], 127.0f, 0xffu) << (8 * c);
+	return r;
+}
+
+template <unsigned W>
+inline tvec<float, 4, W> unpackSnorm4x8(const lanes<uint32_t, W> &p)
+{
+	tvec<float, 4, W> r;
+	for (unsigned i = 0; i < W; i++)
+		for (unsigned c = 0; c < 4; c++)
+			r.data()[c].v[i] = detail::unpack_snorm(int8_t(p.v[i] >> (8 * c)), 127.0f);
+	return r;
+}
+
+template <unsigned W>
+inline lanes<uint32_t, W> packUnorm2x16(const tvec<float, 2, W> &v)
+{
+	lanes<uint32_t, W> r;
+	for (unsigned i = 0; i < W; i++)
+		r.v[i] = detail::pack_unorm(v.x.v[i], 65535.0f) | (detail::pack_unorm(v.y.v[i], 65535.0f) << 16);
+	return r;
+}
+
+template <unsigned W>
+inline tvec<float, 2, W> unpackUnorm2x16(const lanes<uint32_t, W> &p)
+{
+	tvec<float, 2, W> r;
+	for (unsigned i = 0; i < W; i++)
+	{
+		r.x.v[i] = float(p.v[i] & 0xffffu) / 65535.0f;
+		r.y.v[i] = float(p.v[i] >> 16) / 65535.0f;
+	}
+	return r;
+}
+
+template <unsigned W>
+inline lanes<uint32_t, W> packSnorm2x16(const tvec<float, 2, W> &v)
+{
+	lanes<uint32_t, W> r;
+	for (unsigned i = 0; i < W; i++)
+		r.v[i] = detail::pack_snorm(v.x.v[i], 32767.0f, 0xffffu) |
+		         (detail::pack_snorm(v.y.v[i], 32767.0f, 0xffffu) << 16);
+	return r;
+}
+
+template <unsigned W>
+inline tvec<float, 2, W> unpackSnorm2x16(const lanes<uint32_t, W> &p)
+{
+	tvec<float, 2, W> r;
+	for (unsigned i = 0; i < W; i++)
+	{
+		r.x.v[i] = detail::unpack_snorm(int16_t(p.v[i]), 32767.0f);
+		r.y.v[i] = detail::unpack_snorm(int16_t(p.v[i] >> 16), 32767.0f);
+	}
+	return r;
+}
+
+// A float matrix of C columns and R rows, stored as columns like GLSL.
+template <unsigned C, unsigned R, unsigned W>
+struct tmat
+{
+	typedef tvec<float, R, W> column_type;
+	typedef lanes<float, W> scalar_type;
+	static const unsigned columns = C;
+	static const unsigned rows = R;
+	static const unsigned width = W;
+
+	column_type c[C];
+
+	tmat()
+	{
+	}
+
+	tmat(const tmat &) = default;
+	tmat &operator=(const tmat &) = default;
+
+	// mat4(1.0f) is the identity times the scalar.
+	explicit tmat(const scalar_type &s)
+	{
+		for (unsigned i = 0; i < C; i++)
+			for (unsigned j = 0; j < R; j++)
+				c[i].data()[j].v = i == j ? s.v : scalar_type().v;
+	}
+
+	template <typename... A, typename std::enable_if<sizeof...(A) == C, int>::type = 0>
+	explicit tmat(const A &... columns)
+	{
+		const column_type *list[] = { &columns... };
+		for (unsigned i = 0; i < C; i++)
+			copy_lanes(c[i], *list[i]);
+	}
+
+	// mat3(mat4) keeps the top left corner; new elements come from the identity.
+	template <unsigned C2, unsigned R2, typename std::enable_if<C2 != C || R2 != R, int>::type = 0>
+	explicit tmat(const tmat<C2, R2, W> &o)
+	{
+		for (unsigned i = 0; i < C; i++)
+			for (unsigned j = 0; j < R; j++)
+				c[i].data()[j].v = i < C2 && j < R2 ? o.c[i].data()[j].v : scalar_type(i == j ? 1.0f : 0.0f).v;
+	}
+
+	column_type &operator[](int32_t i)
+	{
+		return c[i];
+	}
+
+	const column_type &operator[](int32_t i) const
+	{
+		return c[i];
+	}
+
+	column_type &operator[](uint32_t i)
+	{
+		return c[i];
+	}
+
+	const column_type &operator[](uint32_t i) const
+	{
+		return c[i];
+	}
+
+	template <typename I>
+	vector_ref<column_type, sizeof(scalar_type)> operator[](const lanes<I, W> &i) const
+	{
+		return vector_ref<column_type, sizeof(scalar_type)>(
+		    addr<W>::of_lanes(c).advanced(i.clamped_index(C) * uint32_t(sizeof(column_type))), 0);
+	}
+
+	friend tmat operator+(const tmat &a, const tmat &b)
+	{
+		tmat r;
+		for (unsigned i = 0; i < C; i++)
+			copy_lanes(r.c[i], a.c[i] + b.c[i]);
+		return r;
+	}
+
+	friend tmat operator-(const tmat &a, const tmat &b)
+	{
+		tmat r;
+		for (unsigned i = 0; i < C; i++)
+			copy_lanes(r.c[i], a.c[i] - b.c[i]);
+		return r;
+	}
+
+	friend tmat operator-(const tmat &a)
+	{
+		tmat r;
+		for (unsigned i = 0; i < C; i++)
+			copy_lanes(r.c[i], -a.c[i]);
+		return r;
+	}
+
+	friend tmat operator*(const tmat &a, const scalar_type &s)
+	{
+		tmat r;
+		for (unsigned i = 0; i < C; i++)
+			copy_lanes(r.c[i], a.c[i] * s);
+		return r;
+	}
+
+	friend tmat operator*(const scalar_type &s, const tmat &a)
+	{
+		return a * s;
+	}
+
+	friend tmat operator/(const tmat &a, const scalar_type &s)
+	{
+		tmat r;
+		for (unsigned i = 0; i < C; i++)
+			copy_lanes(r.c[i], a.c[i] / s);
+		return r;
+	}
+
+	friend column_type operator*(const tmat &m, const tvec<float, C, W> &v)
+	{
+		column_type r = m.c[0] * v.x;
+		for (unsigned i = 1; i < C; i++)
+			copy_lanes(r, r + m.c[i] * v.data()[i]);
+		return r;
+	}
+
+	friend tvec<float, C, W> operator*(const tvec<float, R, W> &v, const tmat &m)
+	{
+		tvec<float, C, W> r;
+		for (unsigned i = 0; i < C; i++)
+			r.data()[i].v = dot(v, m.c[i]).v;
+		return r;
+	}
+
+	template <unsigned C2>
+	friend tmat<C2, R, W> operator*(const tmat &a, const tmat<C2, C, W> &b)
+	{
+		tmat<C2, R, W> r;
+		for (unsigned i = 0; i < C2; i++)
+			copy_lanes(r.c[i], a * b.c[i]);
+		return r;
+	}
+
+	friend tmat matrixCompMult(const tmat &a, const tmat &b)
+	{
+		tmat r;
+		for (unsigned i = 0; i < C; i++)
+			copy_lanes(r.c[i], a.c[i] * b.c[i]);
+		return r;
+	}
+
+	friend tmat<R, C, W> transpose(const tmat &m)
+	{
+		tmat<R, C, W> r;
+		for (unsigned i = 0; i < C; i++)
+			for (unsigned j = 0; j < R; j++)
+				r.c[j].data()[i].v = m.c[i].data()[j].v;
+		return r;
+	}
+};
+
+template <unsigned C, unsigned R, unsigned W>
+inline tmat<C, R, W> outerProduct(const tvec<float, R, W> &a, const tvec<float, C, W> &b)
+{
+	tmat<C, R, W> r;
+	for (unsigned i = 0; i < C; i++)
+		copy_lanes(r.c[i], a * b.data()[i]);
+	return r;
+}
+
+// determinant() and inverse() work on one lane at a time with the usual
+// cofactor expansion.
+namespace detail
+{
+template <unsigned N>
+inline float det(const float (&m)[N][N]);
+
+template <>
+inline float det<2>(const float (&m)[2][2])
+{
+	return m[0][0] * m[1][1] - m[1][0] * m[0][1];
+}
+
+template <unsigned N>
+inline float det(const float (&m)[N][N])
+{
+	float r = 0.0f;
+	for (unsigned col = 0; col < N; col++)
+	{
+		float minor[N - 1][N - 1];
+		for (unsigned i = 1; i < N; i++)
+			for (unsigned j = 0, k = 0; j < N; j++)
+				if (j != col)
+					minor[k++][i - 1] = m[j][i];
+		float term = m[col][0] * det<N - 1>(minor);
+		r += col & 1 ? -term : term;
+	}
+	return r;
+}
+
+template <unsigned N>
+inline void invert(const float (&m)[N][N], float (&r)[N][N])
+{
+	float d = det<N>(m);
+	for (unsigned col = 0; col < N; col++)
+		for (unsigned row = 0; row < N; row++)
+		{
+			// Cofactor of element (row, col), transposed into (col, row).
+			float minor[N - 1][N - 1];
+			for (unsigned i = 0, mi = 0; i < N; i++)
+			{
+				if (i == col)
+					continue;
+				for (unsigned j = 0, mj = 0; j < N; j++)
+					if (j != row)
+						minor[mi][mj++] = m[i][j];
+				mi++;
+			}
+			float cof = det<N - 1>(minor);
+			r[row][col] = ((row + col) & 1 ? -cof : cof) / d;
+		}
+}
+
+template <>
+inline void invert<2>(const float (&m)[2][2], float (&r)[2][2])
+{
+	float d = det<2>(m);
+	r[0][0] = m[1][1] / d;
+	r[0][1] = -m[0][1] / d;
+	r[1][0] = -m[1][0] / d;
+	r[1][1] = m[0][0] / d;
+}
+}
+
+template <unsigned N, unsigned W>
+inline lanes<float, W> determinant(const tmat<N, N, W> &m)
+{
+	lanes<float, W> r;
+	for (unsigned l = 0; l < W; l++)
+	{
+		float a[N][N];
+		for (unsigned i = 0; i < N; i++)
+			for (unsigned j = 0; j < N; j++)
+				a[i][j] = m.c[i].data()[j].v[l];
+		r.v[l] = detail::det<N>(a);
+	}
+	return r;
+}
+
+template <unsigned N, unsigned W>
+inline tmat<N, N, W> inverse(const tmat<N, N, W> &m)
+{
+	tmat<N, N, W> r;
+	for (unsigned l = 0; l < W; l++)
+	{
+		float a[N][N], b[N][N];
+		for (unsigned i = 0; i < N; i++)
+			for (unsigned j = 0; j < N; j++)
+				a[i][j] = m.c[i].data()[j].v[l];
+		detail::invert<N>(a, b);
+		for (unsigned i = 0; i < N; i++)
+			for (unsigned j = 0; j < N; j++)
+				r.c[i].data()[j].v[l] = b[i][j];
+	}
+	return r;
+}
+
+template <typename T>
+struct register_ref;
+
+// A GLSL array of SoA values, T elems[N] with GLSL indexing. This is an
+// aggregate, so the generated code can brace initialize it.
+template <typename T, unsigned N>
+struct varray
+{
+	T elems[N];
+
+	T &operator[](int32_t i)
+	{
+		return elems[i];
+	}
+
+	const T &operator[](int32_t i) const
+	{
+		return elems[i];
+	}
+
+	T &operator[](uint32_t i)
+	{
+		return elems[i];
+	}
+
+	const T &operator[](uint32_t i) const
+	{
+		return elems[i];
+	}
+
+	// A dynamic index picks a different element in every lane. Indices
+	// outside the array are clamped to it.
+	template <typename I, unsigned W>
+	typename register_ref<T>::type operator[](const lanes<I, W> &i) const
+	{
+		return typename register_ref<T>::type(
+		    addr<W>::of_lanes(elems).advanced(i.clamped_index(N) * uint32_t(sizeof(T))), 0);
+	}
+
+	int32_t length() const
+	{
+		return int32_t(N);
+	}
+};
+
+// Where a value lives in memory: a byte offset for every lane from base, and
+// how many bytes can be read from base. Memory roots start out uniform, so
+// loads with constant indices are a single scalar load. Values in registers
+// are addressed the same way, which is how dynamic indexing of local arrays
+// and vectors works: lane i of a SoA scalar is 4 * i bytes into it.
+template <unsigned W>
+struct addr
+{
+	uint8_t *base;
+	size_t size;
+	uvector<W> offsets;
+	bool uniform;
+
+	static addr of_memory(void *base, size_t size)
+	{
+		addr a;
+		a.base = static_cast<uint8_t *>(base);
+		a.size = base ? size : 0;
+		a.offsets = uvector<W>{};
+		a.uniform = true;
+		return a;
+	}
+
+	static addr of_lanes(const void *p)
+	{
+		addr a;
+		a.base = static_cast<uint8_t *>(const_cast<void *>(p));
+		a.size = SIZE_MAX;
+		a.offsets = lane_index<W>() * 4u;
+		a.uniform = false;
+		return a;
+	}
+
+	addr advanced(const uvector<W> &by) const
+	{
+		addr a = *this;
+		a.offsets += by;
+		a.uniform = false;
+		return a;
+	}
+};
+
+// Loads are gathers which read zero outside the bound resource. Stores only
+// write the active lanes; when several of them hit the same address, the
+// highest lane wins.
+template <typename T, unsigned W>
+inline typename vector_of<T, W>::type load_lanes(const addr<W> &a, uint32_t offset)
+{
+	typename vector_of<T, W>::type r = {};
+	if (a.uniform)
+	{
+		size_t o = size_t(a.offsets[0]) + offset;
+		if (o + sizeof(T) <= a.size)
+		{
+			T s;
+			memcpy(&s, a.base + o, sizeof(T));
+			r += s;
+		}
+		return r;
+	}
+
+	for (unsigned i = 0; i < W; i++)
+	{
+		size_t o = size_t(a.offsets[i]) + offset;
+		if (o + sizeof(T) <= a.size)
+		{
+			T s;
+			memcpy(&s, a.base + o, sizeof(T));
+			r[i] = s;
+		}
+	}
+	return r;
+}
+
+template <typename T, unsigned W>
+inline void store_lanes(const addr<W> &a, uint32_t offset, const typename vector_of<T, W>::type &v)
+{
+	const mask<W> &m = exec_state<W>::active;
+	for (unsigned i = 0; i < W; i++)
+	{
+		size_t o = size_t(a.offsets[i]) + offset;
+		if (m.v[i] && o + sizeof(T) <= a.size)
+		{
+			T s = v[i];
+			memcpy(a.base + o, &s, sizeof(T));
+		}
+	}
+}
+
+template <typename T, unsigned W>
+inline void load_value(lanes<T, W> &r, const addr<W> &a, uint32_t offset)
+{
+	r.v = load_lanes<T, W>(a, offset);
+}
+
+template <unsigned W>
+inline void load_value(bool_lanes<W> &r, const addr<W> &a, uint32_t offset)
+{
+	r.v = load_lanes<int32_t, W>(a, offset) != 0;
+}
+
+template <typename T, unsigned W>
+inline void store_value(const addr<W> &a, uint32_t offset, const lanes<T, W> &v)
+{
+	store_lanes<T, W>(a, offset, v.v);
+}
+
+template <unsigned W>
+inline void store_value(const addr<W> &a, uint32_t offset, const bool_lanes<W> &v)
+{
+	store_lanes<int32_t, W>(a, offset, v.v);
+}
+
+// Read-modify-write of one 32-bit word for every active lane in turn.
+template <typename T, unsigned W, typename Op>
+inline lanes<T, W> atomic_lanes(const addr<W> &a, uint32_t offset, Op op)
+{
+	lanes<T, W> r;
+	const mask<W> &m = exec_state<W>::active;
+	for (unsigned i = 0; i < W; i++)
+	{
+		size_t o = size_t(a.offsets[i]) + offset;
+		if (m.v[i] && o + sizeof(T) <= a.size)
+			r.v[i] = op(reinterpret_cast<T *>(a.base + o), i);
+	}
+	return r;
+}
+
+template <typename T, typename F>
+inline T atomic_update(T *p, F f)
+{
+	T old = __atomic_load_n(p, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(p, &old, f(old), true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		;
+	return old;
+}
+
+// The ref types below stand for a location, like a GLSL l-value. They read
+// through a conversion to the value type and write through a const
+// operator=, and are indexed the same way as the values they refer to.
+template <typename V>
+struct scalar_ref
+{
+	typedef V value_type;
+	typedef typename V::element_type T;
+	static const unsigned W = V::width;
+
+	addr<W> a;
+	uint32_t offset;
+
+	scalar_ref(const addr<W> &a_, uint32_t offset_)
+	    : a(a_)
+	    , offset(offset_)
+	{
+	}
+
+	operator V() const
+	{
+		V r;
+		load_value(r, a, offset);
+		return r;
+	}
+
+	const scalar_ref &operator=(const V &v) const
+	{
+		store_value(a, offset, v);
+		return *this;
+	}
+
+	const scalar_ref &operator=(const scalar_ref &o) const
+	{
+		return *this = V(o);
+	}
+
+	friend V atomicAdd(const scalar_ref &r, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset,
+		                          [&](T *p, unsigned i) { return __atomic_fetch_add(p, v.v[i], __ATOMIC_SEQ_CST); });
+	}
+
+	friend V atomicAnd(const scalar_ref &r, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset,
+		                          [&](T *p, unsigned i) { return __atomic_fetch_and(p, v.v[i], __ATOMIC_SEQ_CST); });
+	}
+
+	friend V atomicOr(const scalar_ref &r, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset,
+		                          [&](T *p, unsigned i) { return __atomic_fetch_or(p, v.v[i], __ATOMIC_SEQ_CST); });
+	}
+
+	friend V atomicXor(const scalar_ref &r, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset,
+		                          [&](T *p, unsigned i) { return __atomic_fetch_xor(p, v.v[i], __ATOMIC_SEQ_CST); });
+	}
+
+	friend V atomicExchange(const scalar_ref &r, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset,
+		                          [&](T *p, unsigned i) { return __atomic_exchange_n(p, v.v[i], __ATOMIC_SEQ_CST); });
+	}
+
+	friend V atomicMin(const scalar_ref &r, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset, [&](T *p, unsigned i) {
+			T x = v.v[i];
+			return atomic_update(p, [x](T old) { return x < old ? x : old; });
+		});
+	}
+
+	friend V atomicMax(const scalar_ref &r, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset, [&](T *p, unsigned i) {
+			T x = v.v[i];
+			return atomic_update(p, [x](T old) { return x > old ? x : old; });
+		});
+	}
+
+	friend V atomicCompSwap(const scalar_ref &r, const V &compare, const V &v)
+	{
+		return atomic_lanes<T, W>(r.a, r.offset, [&](T *p, unsigned i) {
+			T expected = compare.v[i];
+			__atomic_compare_exchange_n(p, &expected, v.v[i], false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+			return expected;
+		});
+	}
+};
+
+// A vector whose components are ElemStride bytes apart.
+template <typename V, uint32_t ElemStride>
+struct vector_ref
+{
+	typedef V value_type;
+	typedef typename V::component_type C;
+	static const unsigned W = V::width;
+	static const unsigned N = V::size;
+
+	addr<W> a;
+	uint32_t offset;
+
+	vector_ref(const addr<W> &a_, uint32_t offset_)
+	    : a(a_)
+	    , offset(offset_)
+	{
+	}
+
+	operator V() const
+	{
+		V r;
+		for (unsigned i = 0; i < N; i++)
+			load_value(r.data()[i], a, offset + i * ElemStride);
+		return r;
+	}
+
+	const vector_ref &operator=(const V &v) const
+	{
+		for (unsigned i = 0; i < N; i++)
+			store_value(a, offset + i * ElemStride, v.data()[i]);
+		return *this;
+	}
+
+	const vector_ref &operator=(const vector_ref &o) const
+	{
+		return *this = V(o);
+	}
+
+	scalar_ref<C> operator[](int32_t i) const
+	{
+		return scalar_ref<C>(a, offset + uint32_t(i) * ElemStride);
+	}
+
+	scalar_ref<C> operator[](uint32_t i) const
+	{
+		return scalar_ref<C>(a, offset + i * ElemStride);
+	}
+
+	template <typename I>
+	scalar_ref<C> operator[](const lanes<I, W> &i) const
+	{
+		return scalar_ref<C>(a.advanced(i.clamped_index(N) * ElemStride), offset);
+	}
+};
+
+// A matrix with columns ColStride bytes apart and elements of a column
+// ElemStride bytes apart. Row major layouts swap the two.
+template <typename M, uint32_t ColStride, uint32_t ElemStride>
+struct matrix_ref
+{
+	typedef M value_type;
+	typedef typename M::column_type column_type;
+	static const unsigned W = M::width;
+
+	addr<W> a;
+	uint32_t offset;
+
+	matrix_ref(const addr<W> &a_, uint32_t offset_)
+	    : a(a_)
+	    , offset(offset_)
+	{
+	}
+
+	operator M() const
+	{
+		M r;
+		for (unsigned i = 0; i < M::columns; i++)
+			for (unsigned j = 0; j < M::rows; j++)
+				load_value(r.c[i].data()[j], a, offset + i * ColStride + j * ElemStride);
+		return r;
+	}
+
+	const matrix_ref &operator=(const M &m) const
+	{
+		for (unsigned i = 0; i < M::columns; i++)
+			for (unsigned j = 0; j < M::rows; j++)
+				store_value(a, offset + i * ColStride + j * ElemStride, m.c[i].data()[j]);
+		return *this;
+	}
+
+	const matrix_ref &operator=(const matrix_ref &o) const
+	{
+		return *this = M(o);
+	}
+
+	vector_ref<column_type, ElemStride> operator[](int32_t i) const
+	{
+		return vector_ref<column_type, ElemStride>(a, offset + uint32_t(i) * ColStride);
+	}
+
+	vector_ref<column_type, ElemStride> operator[](uint32_t i) const
+	{
+		return vector_ref<column_type, ElemStride>(a, offset + i * ColStride);
+	}
+
+	template <typename I>
+	vector_ref<column_type, ElemStride> operator[](const lanes<I, W> &i) const
+	{
+		return vector_ref<column_type, ElemStride>(a.advanced(i.clamped_index(M::columns) * ColStride), offset);
+	}
+};
+
+// An array of Count elements Stride bytes apart, where E is the ref type of
+// an element. A Count of zero is a runtime sized array, which runs to the
+// end of the resource; its indices are only bounds checked, not clamped.
+template <typename E, uint32_t Stride, uint32_t Count>
+struct array_ref
+{
+	typedef varray<typename E::value_type, Count ? Count : 1> value_type;
+	static const unsigned W = E::W;
+
+	addr<W> a;
+	uint32_t offset;
+
+	array_ref(const addr<W> &a_, uint32_t offset_)
+	    : a(a_)
+	    , offset(offset_)
+	{
+	}
+
+	operator value_type() const
+	{
+		value_type r;
+		for (uint32_t i = 0; i < Count; i++)
+			copy_lanes(r.elems[i], typename E::value_type((*this)[i]));
+		return r;
+	}
+
+	const array_ref &operator=(const value_type &v) const
+	{
+		for (uint32_t i = 0; i < Count; i++)
+			(*this)[i] = v.elems[i];
+		return *this;
+	}
+
+	const array_ref &operator=(const array_ref &o) const
+	{
+		return *this = value_type(o);
+	}
+
+	E operator[](int32_t i) const
+	{
+		return E(a, offset + uint32_t(i) * Stride);
+	}
+
+	E operator[](uint32_t i) const
+	{
+		return E(a, offset + i * Stride);
+	}
+
+	template <typename I>
+	E operator[](const lanes<I, W> &i) const
+	{
+		uvector<W> index = Count ? i.clamped_index(Count) : (uvector<W>)i.v;
+		return E(a.advanced(index * Stride), offset);
+	}
+
+	uint32_t length() const
+	{
+		if (Count)
+			return Count;
+		size_t o = size_t(a.offsets[0]) + offset;
+		return o < a.size ? uint32_t((a.size - o) / Stride) : 0u;
+	}
+};
+
+// The ref type for dynamic indexing into a value held in registers.
+template <typename T, unsigned W>
+struct register_ref<lanes<T, W>>
+{
+	typedef scalar_ref<lanes<T, W>> type;
+};
+
+template <unsigned W>
+struct register_ref<bool_lanes<W>>
+{
+	typedef scalar_ref<bool_lanes<W>> type;
+};
+
+template <typename T, unsigned N, unsigned W>
+struct register_ref<tvec<T, N, W>>
+{
+	typedef vector_ref<tvec<T, N, W>, sizeof(typename tvec<T, N, W>::component_type)> type;
+};
+
+template <unsigned C, unsigned R, unsigned W>
+struct register_ref<tmat<C, R, W>>
+{
+	typedef matrix_ref<tmat<C, R, W>, sizeof(tvec<float, R, W>), sizeof(lanes<float, W>)> type;
+};
+
+template <typename T, unsigned N>
+struct register_ref<varray<T, N>>
+{
+	typedef array_ref<typename register_ref<T>::type, sizeof(T), N> type;
+};
+}
+}
+
+#endif
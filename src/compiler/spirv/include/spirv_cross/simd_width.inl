@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Included once per width by simd_internal_interface.hpp, with
+// SPIRV_CROSS_SIMD_WIDTH and SPIRV_CROSS_SIMD_NAMESPACE defined. Generated
+// code picks its width with "using namespace spirv_cross::simd::w8;".
+
+namespace spirv_cross
+{
+namespace simd
+{
+namespace SPIRV_CROSS_SIMD_NAMESPACE
+{
+static const unsigned spv_width = SPIRV_CROSS_SIMD_WIDTH;
+
+typedef lanes<float, spv_width> vfloat;
+typedef lanes<int32_t, spv_width> vint;
+typedef lanes<uint32_t, spv_width> vuint;
+typedef bool_lanes<spv_width> vbool;
+
+typedef tvec<float, 2, spv_width> vec2;
+typedef tvec<float, 3, spv_width> vec3;
+typedef tvec<float, 4, spv_width> vec4;
+typedef tvec<int32_t, 2, spv_width> ivec2;
+typedef tvec<int32_t, 3, spv_width> ivec3;
+typedef tvec<int32_t, 4, spv_width> ivec4;
+typedef tvec<uint32_t, 2, spv_width> uvec2;
+typedef tvec<uint32_t, 3, spv_width> uvec3;
+typedef tvec<uint32_t, 4, spv_width> uvec4;
+typedef tvec<bool, 2, spv_width> bvec2;
+typedef tvec<bool, 3, spv_width> bvec3;
+typedef tvec<bool, 4, spv_width> bvec4;
+
+typedef tmat<2, 2, spv_width> mat2;
+typedef tmat<3, 3, spv_width> mat3;
+typedef tmat<4, 4, spv_width> mat4;
+typedef tmat<2, 2, spv_width> mat2x2;
+typedef tmat<2, 3, spv_width> mat2x3;
+typedef tmat<2, 4, spv_width> mat2x4;
+typedef tmat<3, 2, spv_width> mat3x2;
+typedef tmat<3, 3, spv_width> mat3x3;
+typedef tmat<3, 4, spv_width> mat3x4;
+typedef tmat<4, 2, spv_width> mat4x2;
+typedef tmat<4, 3, spv_width> mat4x3;
+typedef tmat<4, 4, spv_width> mat4x4;
+
+typedef mask<spv_width> spv_mask;
+typedef addr<spv_width> spv_addr;
+typedef simd::shader_state spv_shader_state;
+typedef simd::ComputeResources<spv_width> ComputeResources;
+typedef simd::FragmentResources<spv_width> FragmentResources;
+
+template <typename Impl, typename Res, unsigned X, unsigned Y, unsigned Z, bool Barriers = false>
+using ComputeShader = simd::ComputeShader<Impl, Res, spv_width, X, Y, Z, Barriers>;
+
+template <typename Impl, typename Res>
+using FragmentShader = simd::FragmentShader<Impl, Res, spv_width>;
+
+namespace internal = simd::internal;
+
+using simd::varray;
+using simd::scalar_ref;
+using simd::vector_ref;
+using simd::matrix_ref;
+using simd::array_ref;
+
+// The lanes which run the current statement.
+inline spv_mask &spv_exec()
+{
+	return exec_state<spv_width>::active;
+}
+
+// The lanes which have not been discarded.
+inline spv_mask &spv_alive()
+{
+	return exec_state<spv_width>::alive;
+}
+
+inline bool spv_any(const spv_mask &m)
+{
+	return any_lane(m);
+}
+
+inline spv_mask spv_to_mask(const vbool &b)
+{
+	spv_mask m;
+	m.v = b.v;
+	return m;
+}
+
+inline spv_mask spv_to_mask(bool b)
+{
+	spv_mask m;
+	m.v = ivector<spv_width>{} + (b ? -1 : 0);
+	return m;
+}
+
+inline void spv_discard()
+{
+	spv_alive() = spv_alive() & ~spv_exec();
+	spv_exec() = spv_mask();
+}
+
+// Memory barriers order this thread's buffer accesses against other
+// workgroups. The batches of a workgroup share a thread, so shared memory
+// needs no more than that.
+inline void memoryBarrier()
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+inline void memoryBarrierShared()
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Waits for the other batches of the workgroup, which run on the same
+// thread and so overwrite the execution masks.
+inline void barrier()
+{
+	spv_mask active = spv_exec();
+	spv_mask alive = spv_alive();
+	workgroup_fibers::barrier();
+	spv_exec() = active;
+	spv_alive() = alive;
+}
+}
+}
+}
@@ -23,14 +23,20 @@ using namespace std;
 
 namespace spirv_cross
 {
+// Below this many blocks, walking up the dominator tree is cheaper than
+// building the LCA table. Measured with spirv_cfg_bench.cpp.
+static const size_t default_lca_table_min_blocks = 256;
+
 CFG::CFG(Compiler &compiler_, const SPIRFunction &func_)
     : compiler(compiler_)
     , func(func_)
+    , lca_table_min_blocks(default_lca_table_min_blocks)
 {
 	preceding_edges.resize(compiler.get_current_id_bound());
 	succeeding_edges.resize(compiler.get_current_id_bound());
 	visit_order.resize(compiler.get_current_id_bound());
 	immediate_dominators.resize(compiler.get_current_id_bound());
+	pre_order_index.resize(compiler.get_current_id_bound());
 
 	build_post_order_visit_order();
 	build_immediate_dominators();
@@ -38,6 +44,25 @@ CFG::CFG(Compiler &compiler_, const SPIRFunction &func_)
 
 uint32_t CFG::find_common_dominator(uint32_t a, uint32_t b) const
 {
+	if (pre_order.size() >= lca_table_min_blocks)
+	{
+		if (!lca)
+			build_dominator_tree_lca();
+
+		uint32_t l = lca->first[pre_order_index[a]];
+		uint32_t r = lca->first[pre_order_index[b]];
+		if (l > r)
+			swap(l, r);
+
+		uint32_t level = 0;
+		while ((2u << level) <= r - l + 1)
+			level++;
+
+		uint32_t x = lca->table[level][l];
+		uint32_t y = lca->table[level][r + 1 - (1u << level)];
+		return pre_order[lca->depth[x] <= lca->depth[y] ? x : y];
+	}
+
 	while (a != b)
 	{
 		if (visit_order[a] < visit_order[b])
@@ -48,38 +73,131 @@ uint32_t CFG::find_common_dominator(uint32_t a, uint32_t b) const
 	return a;
 }
 
-uint32_t CFG::update_common_dominator(uint32_t a, uint32_t b)
+void CFG::build_dominator_tree_lca() const
 {
-	auto dominator = find_common_dominator(immediate_dominators[a], immediate_dominators[b]);
-	immediate_dominators[a] = dominator;
-	immediate_dominators[b] = dominator;
-	return dominator;
+	lca.reset(new DominatorTreeLCA);
+	size_t count = pre_order.size();
+
+	// Children of each node in the dominator tree, by preorder index.
+	vector<vector<uint32_t>> children(count);
+	for (size_t i = 1; i < count; i++)
+		children[pre_order_index[immediate_dominators[pre_order[i]]]].push_back(uint32_t(i));
+
+	// Euler tour, recording each node on the way down and after each child.
+	vector<uint32_t> tour;
+	tour.reserve(2 * count);
+	lca->first.resize(count);
+	lca->depth.resize(count);
+
+	struct Frame
+	{
+		uint32_t node;
+		uint32_t next_child;
+	};
+	vector<Frame> stack = { { 0, 0 } };
+	lca->first[0] = 0;
+	tour.push_back(0);
+
+	while (!stack.empty())
+	{
+		auto &frame = stack.back();
+		if (frame.next_child < children[frame.node].size())
+		{
+			uint32_t child = children[frame.node][frame.next_child++];
+			lca->depth[child] = lca->depth[frame.node] + 1;
+			lca->first[child] = uint32_t(tour.size());
+			tour.push_back(child);
+			stack.push_back({ child, 0 });
+		}
+		else
+		{
+			stack.pop_back();
+			if (!stack.empty())
+				tour.push_back(stack.back().node);
+		}
+	}
+
+	// Sparse table: table[k][i] is the shallowest node in tour[i, i + 2^k).
+	auto &depth = lca->depth;
+	auto &table = lca->table;
+	table.push_back(move(tour));
+	for (size_t width = 2; width <= table[0].size(); width *= 2)
+	{
+		auto &prev = table.back();
+		vector<uint32_t> level(table[0].size() - width + 1);
+		for (size_t i = 0; i < level.size(); i++)
+		{
+			uint32_t x = prev[i];
+			uint32_t y = prev[i + width / 2];
+			level[i] = depth[x] <= depth[y] ? x : y;
+		}
+		table.push_back(move(level));
+	}
 }
 
 void CFG::build_immediate_dominators()
 {
-	// Traverse the post-order in reverse and build up the immediate dominator tree.
+	// Semi-NCA: compute semidominators with Lengauer-Tarjan's path compressed
+	// forest, then find each immediate dominator as the nearest common
+	// ancestor of its DFS parent and semidominator. All the work is done on
+	// preorder indices, and back edges are not part of preceding_edges.
 	fill(begin(immediate_dominators), end(immediate_dominators), 0);
-	immediate_dominators[func.entry_block] = func.entry_block;
 
-	for (auto i = post_order.size(); i; i--)
+	const uint32_t none = ~0u;
+	uint32_t count = uint32_t(pre_order.size());
+	vector<uint32_t> semi(count);
+	vector<uint32_t> label(count);
+	vector<uint32_t> ancestor(count, none);
+	vector<uint32_t> idom(count);
+	vector<uint32_t> path;
+
+	for (uint32_t i = 0; i < count; i++)
 	{
-		uint32_t block = post_order[i - 1];
-		auto &pred = preceding_edges[block];
-		if (pred.empty()) // This is for the entry block, but we've already set up the dominators.
-			continue;
+		semi[i] = i;
+		label[i] = i;
+	}
+
+	const auto eval = [&](uint32_t v) -> uint32_t {
+		if (ancestor[v] == none)
+			return v;
+
+		path.clear();
+		for (uint32_t x = v; ancestor[ancestor[x]] != none; x = ancestor[x])
+			path.push_back(x);
+
+		// Compress from the top of the path down.
+		for (auto itr = path.rbegin(); itr != path.rend(); ++itr)
+		{
+			uint32_t x = *itr;
+			uint32_t a = ancestor[x];
+			if (semi[label[a]] < semi[label[x]])
+				label[x] = label[a];
+			ancestor[x] = ancestor[a];
+		}
+		return label[v];
+	};
 
-		for (auto &edge : pred)
+	for (uint32_t i = count; i-- > 1;)
+	{
+		for (auto pred : preceding_edges[pre_order[i]])
 		{
-			if (immediate_dominators[block])
-			{
-				assert(immediate_dominators[edge]);
-				immediate_dominators[block] = update_common_dominator(block, edge);
-			}
-			else
-				immediate_dominators[block] = edge;
+			uint32_t s = semi[eval(pre_order_index[pred])];
+			if (s < semi[i])
+				semi[i] = s;
 		}
+		ancestor[i] = dfs_parent[i];
+	}
+
+	for (uint32_t i = 1; i < count; i++)
+	{
+		uint32_t d = dfs_parent[i];
+		while (d > semi[i])
+			d = idom[d];
+		idom[i] = d;
 	}
+
+	for (uint32_t i = 0; i < count; i++)
+		immediate_dominators[pre_order[i]] = pre_order[idom[i]];
 }
 
 bool CFG::is_back_edge(uint32_t to) const
@@ -89,60 +207,92 @@ bool CFG::is_back_edge(uint32_t to) const
 	return visit_order[to] == 0;
 }
 
-bool CFG::post_order_visit(uint32_t block_id)
+// Returns the index'th branch target of block, in the order they are visited.
+static bool get_successor(const SPIRBlock &block, uint32_t index, uint32_t &succ)
 {
-	// If we have already branched to this block (back edge), stop recursion.
-	// If our branches are back-edges, we do not record them.
-	// We have to record crossing edges however.
-	if (visit_order[block_id] >= 0)
-		return !is_back_edge(block_id);
-
-	// Block back-edges from recursively revisiting ourselves.
-	visit_order[block_id] = 0;
-
-	// First visit our branch targets.
-	auto &block = compiler.get<SPIRBlock>(block_id);
 	switch (block.terminator)
 	{
 	case SPIRBlock::Direct:
-		if (post_order_visit(block.next_block))
-			add_branch(block_id, block.next_block);
-		break;
+		if (index != 0)
+			return false;
+		succ = block.next_block;
+		return true;
 
 	case SPIRBlock::Select:
-		if (post_order_visit(block.true_block))
-			add_branch(block_id, block.true_block);
-		if (post_order_visit(block.false_block))
-			add_branch(block_id, block.false_block);
-		break;
+		if (index > 1)
+			return false;
+		succ = index == 0 ? block.true_block : block.false_block;
+		return true;
 
 	case SPIRBlock::MultiSelect:
-		for (auto &target : block.cases)
-		{
-			if (post_order_visit(target.block))
-				add_branch(block_id, target.block);
-		}
-		if (block.default_block && post_order_visit(block.default_block))
-			add_branch(block_id, block.default_block);
-		break;
+		if (index < block.cases.size())
+			succ = block.cases[index].block;
+		else if (index == block.cases.size() && block.default_block)
+			succ = block.default_block;
+		else
+			return false;
+		return true;
 
 	default:
-		break;
+		return false;
 	}
-
-	// Then visit ourselves. Start counting at one, to let 0 be a magic value for testing back vs. crossing edges.
-	visit_order[block_id] = ++visit_count;
-	post_order.push_back(block_id);
-	return true;
 }
 
 void CFG::build_post_order_visit_order()
 {
-	uint32_t block = func.entry_block;
 	visit_count = 0;
 	fill(begin(visit_order), end(visit_order), -1);
 	post_order.clear();
-	post_order_visit(block);
+	pre_order.clear();
+	dfs_parent.clear();
+
+	// Depth first search with an explicit stack, so huge functions can't
+	// overflow the native one.
+	struct Frame
+	{
+		uint32_t block;
+		uint32_t next_successor;
+	};
+	vector<Frame> stack;
+
+	const auto enter = [&](uint32_t block) {
+		// Block back-edges from revisiting blocks we are still inside of.
+		visit_order[block] = 0;
+		pre_order_index[block] = uint32_t(pre_order.size());
+		dfs_parent.push_back(stack.empty() ? 0 : pre_order_index[stack.back().block]);
+		pre_order.push_back(block);
+		stack.push_back({ block, 0 });
+	};
+
+	enter(func.entry_block);
+	while (!stack.empty())
+	{
+		auto &frame = stack.back();
+		uint32_t succ;
+		if (get_successor(compiler.get<SPIRBlock>(frame.block), frame.next_successor, succ))
+		{
+			frame.next_successor++;
+
+			// If our branches are back-edges, we do not record them.
+			// We have to record crossing edges however.
+			// Tree edges are recorded once the target is done.
+			if (visit_order[succ] < 0)
+				enter(succ);
+			else if (!is_back_edge(succ))
+				add_branch(frame.block, succ);
+		}
+		else
+		{
+			// Then visit ourselves. Start counting at one, to let 0 be a magic value for testing back vs. crossing edges.
+			uint32_t block = frame.block;
+			visit_order[block] = ++visit_count;
+			post_order.push_back(block);
+
+			stack.pop_back();
+			if (!stack.empty())
+				add_branch(stack.back().block, block);
+		}
+	}
 }
 
 void CFG::add_branch(uint32_t from, uint32_t to)
@@ -67,12 +67,29 @@ public:
 		return succeeding_edges[block];
 	}
 
+	// Calls op once for every block reachable from block, including itself.
 	template <typename Op>
 	void walk_from(uint32_t block, const Op &op) const
 	{
-		op(block);
-		for (auto b : succeeding_edges[block])
-			walk_from(b, op);
+		std::vector<bool> seen(succeeding_edges.size());
+		std::vector<uint32_t> stack = { block };
+		seen[block] = true;
+
+		while (!stack.empty())
+		{
+			uint32_t b = stack.back();
+			stack.pop_back();
+			op(b);
+
+			for (auto succ : succeeding_edges[b])
+			{
+				if (!seen[succ])
+				{
+					seen[succ] = true;
+					stack.push_back(succ);
+				}
+			}
+		}
 	}
 
 private:
@@ -84,14 +101,36 @@ private:
 	std::vector<int> visit_order;
 	std::vector<uint32_t> post_order;
 
+	// Reachable blocks in DFS preorder, each block's index in it, and the
+	// preorder index of each block's DFS tree parent.
+	std::vector<uint32_t> pre_order;
+	std::vector<uint32_t> pre_order_index;
+	std::vector<uint32_t> dfs_parent;
+
 	void add_branch(uint32_t from, uint32_t to);
 	void build_post_order_visit_order();
 	void build_immediate_dominators();
-	bool post_order_visit(uint32_t block);
 	uint32_t visit_count = 0;
 
-	uint32_t update_common_dominator(uint32_t a, uint32_t b);
 	bool is_back_edge(uint32_t to) const;
+
+	// Constant time common dominator queries for large functions: an Euler
+	// tour of the dominator tree with a sparse table for range minimum
+	// queries over it. Built on first use.
+	struct DominatorTreeLCA
+	{
+		std::vector<uint32_t> first;
+		std::vector<uint32_t> depth;
+		std::vector<std::vector<uint32_t>> table;
+	};
+	mutable std::unique_ptr<DominatorTreeLCA> lca;
+	void build_dominator_tree_lca() const;
+
+	// Functions with at least this many reachable blocks answer
+	// find_common_dominator() from the table, smaller ones walk up the
+	// dominator tree. Only spirv_cfg_bench.cpp changes it, to time both.
+	size_t lca_table_min_blocks;
+	friend struct CFGBenchAccess;
 };
 
 class DominatorBuilder
@@ -0,0 +1,249 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Benchmark of CFG construction and common dominator queries.
+//
+// The GLSL input is compiled to SPIR-V with standalone_generate_spirv(), and
+// a CFG is built for every function in the module. Each CFG then answers the
+// same random find_common_dominator() queries twice: once walking up the
+// dominator tree, and once from the Euler tour table, including the cost of
+// building the table. The two must agree. CFG::lca_table_min_blocks picks
+// between them in the compiler, so the cutover is the block count where the
+// table starts to win for a realistic number of queries.
+//
+// This is built like glsl_compiler, with this file in place of main.cpp.
+// gen_bench_shader.py in src/compiler/glsl makes inputs of any size; the
+// number of blocks grows with --statements and --depth:
+//
+//    python gen_bench_shader.py --statements 64 --depth 2 > cfg.frag
+//    spirv_cfg_bench --version 300 --queries 1024 cfg.frag
+
+#include "spirv_cfg.hpp"
+#include "spirv_cross.hpp"
+#include "standalone.h"
+#include "main/mtypes.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace spirv_cross;
+using namespace std;
+
+namespace spirv_cross
+{
+// The only code allowed to move the table cutover of a CFG.
+struct CFGBenchAccess
+{
+	static void set_lca_table_min_blocks(CFG &cfg, size_t blocks)
+	{
+		cfg.lca_table_min_blocks = blocks;
+	}
+};
+}
+
+namespace
+{
+struct BenchOptions
+{
+	int glsl_version = 330;
+	unsigned queries = 0;
+	unsigned iterations = 20;
+};
+
+// Keeps the query loops from being optimized away.
+volatile uint32_t query_sink;
+
+double microseconds(chrono::steady_clock::time_point start, unsigned iterations)
+{
+	chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count() / iterations;
+}
+
+// Only needs the parsed module, so it never compiles anything.
+class CFGBench : public Compiler
+{
+public:
+	CFGBench(vector<uint32_t> ir, const BenchOptions &options_)
+	    : Compiler(move(ir))
+	    , options(options_)
+	{
+	}
+
+	bool run()
+	{
+		bool ok = true;
+		for (uint32_t id = 0; id < get_current_id_bound(); id++)
+			if (ids[id].get_type() == TypeFunction)
+				ok = run_function(get<SPIRFunction>(id)) && ok;
+		return ok;
+	}
+
+private:
+	const BenchOptions &options;
+
+	bool run_function(const SPIRFunction &func)
+	{
+		auto start = chrono::steady_clock::now();
+		for (unsigned i = 0; i < options.iterations; i++)
+			CFG cfg(*this, func);
+		double build_time = microseconds(start, options.iterations);
+
+		CFG walk_cfg(*this, func);
+		vector<uint32_t> blocks;
+		walk_cfg.walk_from(func.entry_block, [&](uint32_t block) { blocks.push_back(block); });
+		if (blocks.size() < 2)
+			return true;
+
+		// Fixed seed so every run asks the same questions.
+		unsigned count = options.queries ? options.queries : unsigned(4 * blocks.size());
+		vector<pair<uint32_t, uint32_t>> queries(count);
+		uint32_t seed = 1;
+		for (auto &q : queries)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			q.first = blocks[(seed >> 8) % blocks.size()];
+			seed = seed * 1664525u + 1013904223u;
+			q.second = blocks[(seed >> 8) % blocks.size()];
+		}
+
+		CFGBenchAccess::set_lca_table_min_blocks(walk_cfg, SIZE_MAX);
+		vector<uint32_t> walk_answers;
+		for (auto &q : queries)
+			walk_answers.push_back(walk_cfg.find_common_dominator(q.first, q.second));
+
+		start = chrono::steady_clock::now();
+		uint32_t sink = 0;
+		for (unsigned i = 0; i < options.iterations; i++)
+			for (auto &q : queries)
+				sink += walk_cfg.find_common_dominator(q.first, q.second);
+		double walk_time = microseconds(start, options.iterations);
+		query_sink = sink;
+
+		// The table is built on the first query, so each iteration needs a
+		// fresh CFG; its construction is subtracted afterwards.
+		double table_time = 0.0;
+		for (unsigned i = 0; i < options.iterations; i++)
+		{
+			CFG table_cfg(*this, func);
+			CFGBenchAccess::set_lca_table_min_blocks(table_cfg, 0);
+
+			start = chrono::steady_clock::now();
+			for (size_t j = 0; j < queries.size(); j++)
+			{
+				uint32_t answer = table_cfg.find_common_dominator(queries[j].first, queries[j].second);
+				if (i == 0 && answer != walk_answers[j])
+				{
+					fprintf(stderr, "function %u: table and walk disagree on %u, %u\n", func.self,
+					        queries[j].first, queries[j].second);
+					return false;
+				}
+				sink += answer;
+			}
+			table_time += microseconds(start, 1);
+		}
+		table_time /= options.iterations;
+		query_sink = sink;
+
+		printf("function %u: %zu blocks, %u queries\n", func.self, blocks.size(), count);
+		printf("   %-24s %10.1f us\n", "CFG build:", build_time);
+		printf("   %-24s %10.1f us\n", "walk:", walk_time);
+		printf("   %-24s %10.1f us (%.0f%% of walk)\n", "table, including build:", table_time,
+		       walk_time > 0 ? table_time * 100 / walk_time : 0.0);
+		return true;
+	}
+};
+
+void usage_fail(const char *name)
+{
+	printf("usage: %s [--version N] [--queries N] [--iterations N] <file.vert | file.frag>\n", name);
+	exit(EXIT_FAILURE);
+}
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	const char *file = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--version") && i + 1 < argc)
+			options.glsl_version = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--queries") && i + 1 < argc)
+			options.queries = unsigned(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+			options.iterations = unsigned(max(1, atoi(argv[++i])));
+		else if (!file && argv[i][0] != '-')
+			file = argv[i];
+		else
+			usage_fail(argv[0]);
+	}
+
+	if (!file)
+		usage_fail(argv[0]);
+
+	const char *ext = strrchr(file, '.');
+	unsigned shader_type;
+	if (ext && !strcmp(ext, ".vert"))
+		shader_type = GL_VERTEX_SHADER;
+	else if (ext && !strcmp(ext, ".frag"))
+		shader_type = GL_FRAGMENT_SHADER;
+	else if (ext && !strcmp(ext, ".comp"))
+		shader_type = GL_COMPUTE_SHADER;
+	else
+		usage_fail(argv[0]);
+
+	ifstream stream(file, ios::binary);
+	if (!stream)
+	{
+		fprintf(stderr, "File \"%s\" does not exist.\n", file);
+		return EXIT_FAILURE;
+	}
+	stringstream source;
+	source << stream.rdbuf();
+	string text = source.str();
+
+	// The module is never larger than a few words per source byte.
+	struct standalone_options compile_options = {};
+	compile_options.glsl_version = options.glsl_version;
+	vector<uint32_t> spirv(max<size_t>(65536, text.size() * 4));
+	unsigned bytes = standalone_generate_spirv(&compile_options, shader_type, text.c_str(),
+	                                           unsigned(spirv.size() * sizeof(uint32_t)), (char *)spirv.data());
+	if (bytes == unsigned(-1) || bytes == 0)
+	{
+		fprintf(stderr, "%s: compilation failed\n", file);
+		return EXIT_FAILURE;
+	}
+	spirv.resize(bytes / sizeof(uint32_t));
+
+	CFGBench bench(move(spirv), options);
+	return bench.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+extern "C" void _mesa_error_no_memory(const char *)
+{
+}
@@ -19,11 +19,15 @@
 
 #include "spirv.hpp"
 
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <locale>
 #include <memory>
+#include <new>
 #include <sstream>
 #include <stack>
 #include <stdexcept>
@@ -75,27 +79,317 @@ public:
 #define SPIRV_CROSS_DEPRECATED(reason)
 #endif
 
+// Append-only string builder used in place of std::ostringstream.
+// Text goes to an inline buffer first and then to heap blocks of growing
+// size, so appending never moves what has already been written and str()
+// assembles the result with a single allocation. Formatting is independent of
+// the global locale and matches what the default stream formatting produces.
+template <size_t InlineSize = 4096, size_t BlockSize = 4096>
+class StringStream
+{
+public:
+	StringStream()
+	{
+		current.data = inline_buffer;
+		current.offset = 0;
+		current.size = InlineSize;
+	}
+
+	~StringStream()
+	{
+		reset();
+	}
+
+	StringStream(const StringStream &) = delete;
+	void operator=(const StringStream &) = delete;
+
+	StringStream &operator<<(const std::string &s)
+	{
+		append(s.data(), s.size());
+		return *this;
+	}
+
+	StringStream &operator<<(const char *s)
+	{
+		append(s, strlen(s));
+		return *this;
+	}
+
+	StringStream &operator<<(char c)
+	{
+		append(&c, 1);
+		return *this;
+	}
+
+	StringStream &operator<<(signed char c)
+	{
+		return *this << char(c);
+	}
+
+	StringStream &operator<<(unsigned char c)
+	{
+		return *this << char(c);
+	}
+
+	StringStream &operator<<(bool v)
+	{
+		return *this << (v ? '1' : '0');
+	}
+
+	StringStream &operator<<(short v)
+	{
+		return append_signed(v);
+	}
+
+	StringStream &operator<<(unsigned short v)
+	{
+		return append_unsigned(v);
+	}
+
+	StringStream &operator<<(int v)
+	{
+		return append_signed(v);
+	}
+
+	StringStream &operator<<(unsigned v)
+	{
+		return append_unsigned(v);
+	}
+
+	StringStream &operator<<(long v)
+	{
+		return append_signed(v);
+	}
+
+	StringStream &operator<<(unsigned long v)
+	{
+		return append_unsigned(v);
+	}
+
+	StringStream &operator<<(long long v)
+	{
+		return append_signed(v);
+	}
+
+	StringStream &operator<<(unsigned long long v)
+	{
+		return append_unsigned(v);
+	}
+
+	StringStream &operator<<(float v)
+	{
+		return *this << double(v);
+	}
+
+	StringStream &operator<<(double v)
+	{
+		// Same as the default precision of std::ostream.
+		char buf[64];
+		int len = snprintf(buf, sizeof(buf), "%g", v);
+		append(buf, size_t(len));
+		return *this;
+	}
+
+	size_t size() const
+	{
+		size_t total = current.offset;
+		for (auto &block : saved)
+			total += block.offset;
+		return total;
+	}
+
+	std::string str() const
+	{
+		std::string ret;
+		ret.reserve(size());
+		for (auto &block : saved)
+			ret.append(block.data, block.offset);
+		ret.append(current.data, current.offset);
+		return ret;
+	}
+
+	void reset()
+	{
+		for (auto &block : saved)
+			if (block.data != inline_buffer)
+				free(block.data);
+		if (current.data != inline_buffer)
+			free(current.data);
+
+		saved.clear();
+		current.data = inline_buffer;
+		current.offset = 0;
+		current.size = InlineSize;
+	}
+
+private:
+	struct Block
+	{
+		char *data;
+		size_t offset;
+		size_t size;
+	};
+
+	void append(const char *s, size_t len)
+	{
+		size_t avail = current.size - current.offset;
+		if (len > avail)
+		{
+			memcpy(current.data + current.offset, s, avail);
+			current.offset += avail;
+			s += avail;
+			len -= avail;
+
+			// Double the block size until it reaches 1 MiB.
+			size_t target = current.size < BlockSize ? BlockSize : current.size;
+			if (target < (size_t(1) << 20))
+				target *= 2;
+			if (target < len)
+				target = len;
+
+			saved.push_back(current);
+			current.data = static_cast<char *>(malloc(target));
+			if (!current.data)
+				SPIRV_CROSS_THROW("Out of memory.");
+			current.offset = 0;
+			current.size = target;
+		}
+
+		memcpy(current.data + current.offset, s, len);
+		current.offset += len;
+	}
+
+	template <typename T>
+	StringStream &append_unsigned(T v)
+	{
+		char buf[24];
+		char *end = buf + sizeof(buf);
+		char *p = end;
+		do
+		{
+			*--p = char('0' + v % 10);
+			v /= 10;
+		} while (v);
+		append(p, size_t(end - p));
+		return *this;
+	}
+
+	template <typename T>
+	StringStream &append_signed(T v)
+	{
+		if (v < 0)
+		{
+			*this << '-';
+			// Negate in the unsigned domain so the minimum value works too.
+			return append_unsigned(0ull - static_cast<unsigned long long>(v));
+		}
+		return append_unsigned(static_cast<unsigned long long>(v));
+	}
+
+	Block current;
+	std::vector<Block> saved;
+	char inline_buffer[InlineSize];
+};
+
 namespace inner
 {
-template <typename T>
-void join_helper(std::ostringstream &stream, T &&t)
+template <typename Stream, typename T>
+void join_helper(Stream &stream, T &&t)
 {
 	stream << std::forward<T>(t);
 }
 
-template <typename T, typename... Ts>
-void join_helper(std::ostringstream &stream, T &&t, Ts &&... ts)
+template <typename Stream, typename T, typename... Ts>
+void join_helper(Stream &stream, T &&t, Ts &&... ts)
 {
 	stream << std::forward<T>(t);
 	join_helper(stream, std::forward<Ts>(ts)...);
 }
+
+// Formats a value like "%.32g" followed by the ".0" convert_to_string() adds,
+// provided its binary fraction has a short exact decimal expansion, e.g. 2.0 or
+// 0.375. Returns false when the value needs the general printf() path.
+inline bool format_exact_float(double v, char *buf)
+{
+	if (v == 0.0 || v != v || v - v != 0.0)
+		return false;
+
+	int exp2;
+	double m = frexp(v < 0.0 ? -v : v, &exp2);
+	uint64_t mant = uint64_t(ldexp(m, 53));
+	exp2 -= 53;
+	while (!(mant & 1))
+	{
+		mant >>= 1;
+		exp2++;
+	}
+
+	// The value is mant * 2^exp2, i.e. (mant * 5^k) / 10^k with k = -exp2.
+	uint64_t digits_value;
+	int frac_digits;
+	if (exp2 >= 0)
+	{
+		if (exp2 >= 64 || mant > (UINT64_MAX >> exp2))
+			return false;
+		digits_value = mant << exp2;
+		frac_digits = 0;
+	}
+	else
+	{
+		frac_digits = -exp2;
+		if (frac_digits > 27)
+			return false;
+		for (int i = 0; i < frac_digits; i++)
+		{
+			if (mant > UINT64_MAX / 5)
+				return false;
+			mant *= 5;
+		}
+		digits_value = mant;
+	}
+
+	char digits[24];
+	int len = 0;
+	do
+	{
+		digits[len++] = char('0' + digits_value % 10);
+		digits_value /= 10;
+	} while (digits_value);
+
+	// %g switches to exponent notation below 1e-4.
+	if (len - 1 - frac_digits < -4)
+		return false;
+
+	char *p = buf;
+	if (v < 0.0)
+		*p++ = '-';
+
+	if (len > frac_digits)
+	{
+		for (int i = len - 1; i >= frac_digits; i--)
+			*p++ = digits[i];
+	}
+	else
+		*p++ = '0';
+
+	*p++ = '.';
+	if (frac_digits == 0)
+		*p++ = '0';
+	else
+	{
+		for (int i = frac_digits - 1; i >= 0; i--)
+			*p++ = i < len ? digits[i] : '0';
+	}
+	*p = '\0';
+	return true;
+}
 }
 
 // Helper template to avoid lots of nasty string temporary munging.
 template <typename... Ts>
 std::string join(Ts &&... ts)
 {
-	std::ostringstream stream;
+	StringStream<256> stream;
 	inner::join_helper(stream, std::forward<Ts>(ts)...);
 	return stream.str();
 }
@@ -121,6 +415,7 @@ inline std::string convert_to_string(T &&t)
 // Allow implementations to set a convenient standard precision
 #ifndef SPIRV_CROSS_FLT_FMT
 #define SPIRV_CROSS_FLT_FMT "%.32g"
+#define SPIRV_CROSS_FLT_FMT_EXACT
 #endif
 
 #ifdef _MSC_VER
@@ -133,6 +428,10 @@ inline std::string convert_to_string(float t)
 	// std::to_string for floating point values is broken.
 	// Fallback to something more sane.
 	char buf[64];
+#ifdef SPIRV_CROSS_FLT_FMT_EXACT
+	if (inner::format_exact_float(t, buf))
+		return buf;
+#endif
 	sprintf(buf, SPIRV_CROSS_FLT_FMT, t);
 	// Ensure that the literal is float.
 	if (!strchr(buf, '.') && !strchr(buf, 'e'))
@@ -145,6 +444,10 @@ inline std::string convert_to_string(double t)
 	// std::to_string for floating point values is broken.
 	// Fallback to something more sane.
 	char buf[64];
+#ifdef SPIRV_CROSS_FLT_FMT_EXACT
+	if (inner::format_exact_float(t, buf))
+		return buf;
+#endif
 	sprintf(buf, SPIRV_CROSS_FLT_FMT, t);
 	// Ensure that the literal is float.
 	if (!strchr(buf, '.') && !strchr(buf, 'e'))
@@ -156,9 +459,179 @@ inline std::string convert_to_string(double t)
 #pragma warning(pop)
 #endif
 
+// Set of ids stored as a bitset over the id range, for sets which are filled
+// in once, e.g. while parsing. Grows on demand past the module bound.
+class IdBitset
+{
+public:
+	void insert(uint32_t id)
+	{
+		if (id / 64 >= bits.size())
+			bits.resize(id / 64 + 1);
+		bits[id / 64] |= 1ull << (id & 63);
+	}
+
+	void erase(uint32_t id)
+	{
+		if (id / 64 < bits.size())
+			bits[id / 64] &= ~(1ull << (id & 63));
+	}
+
+	size_t count(uint32_t id) const
+	{
+		return id / 64 < bits.size() && (bits[id / 64] & (1ull << (id & 63))) != 0;
+	}
+
+	void clear()
+	{
+		bits.clear();
+	}
+
+	// Calls op on every id in the set, in increasing order.
+	template <typename Op>
+	void for_each(const Op &op) const
+	{
+		for (size_t i = 0; i < bits.size(); i++)
+		{
+			for (uint64_t w = bits[i]; w; w &= w - 1)
+				op(uint32_t(i * 64 + lowest_bit(w)));
+		}
+	}
+
+private:
+	static uint32_t lowest_bit(uint64_t w)
+	{
+#if defined(__GNUC__)
+		return uint32_t(__builtin_ctzll(w));
+#else
+		uint32_t bit = 0;
+		while ((w & 1) == 0)
+		{
+			w >>= 1;
+			bit++;
+		}
+		return bit;
+#endif
+	}
+
+	std::vector<uint64_t> bits;
+};
+
+// Map from ids to T for state which is rebuilt often, e.g. once per compile
+// pass. Ids index a flat array which points into a dense vector of values, so
+// lookups never hash, iteration visits only the values in insertion order,
+// and clear() only drops the values rather than touching the whole id range.
+template <typename T>
+class IdMap
+{
+public:
+	typedef std::pair<uint32_t, T> value_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+	T &operator[](uint32_t id)
+	{
+		T *value = find(id);
+		if (value)
+			return *value;
+
+		if (id >= sparse.size())
+			sparse.resize(id + 1);
+		sparse[id] = uint32_t(dense.size());
+		dense.emplace_back(id, T());
+		return dense.back().second;
+	}
+
+	T *find(uint32_t id)
+	{
+		if (id < sparse.size() && sparse[id] < dense.size() && dense[sparse[id]].first == id)
+			return &dense[sparse[id]].second;
+		else
+			return nullptr;
+	}
+
+	const T *find(uint32_t id) const
+	{
+		if (id < sparse.size() && sparse[id] < dense.size() && dense[sparse[id]].first == id)
+			return &dense[sparse[id]].second;
+		else
+			return nullptr;
+	}
+
+	size_t count(uint32_t id) const
+	{
+		return find(id) != nullptr;
+	}
+
+	void clear()
+	{
+		dense.clear();
+	}
+
+	bool empty() const
+	{
+		return dense.empty();
+	}
+
+	size_t size() const
+	{
+		return dense.size();
+	}
+
+	iterator begin()
+	{
+		return dense.begin();
+	}
+
+	iterator end()
+	{
+		return dense.end();
+	}
+
+	const_iterator begin() const
+	{
+		return dense.begin();
+	}
+
+	const_iterator end() const
+	{
+		return dense.end();
+	}
+
+private:
+	std::vector<uint32_t> sparse;
+	std::vector<value_type> dense;
+};
+
+// Set of ids with the same layout and costs as IdMap.
+class IdSet
+{
+public:
+	void insert(uint32_t id)
+	{
+		ids[id];
+	}
+
+	size_t count(uint32_t id) const
+	{
+		return ids.count(id);
+	}
+
+	void clear()
+	{
+		ids.clear();
+	}
+
+private:
+	struct Empty
+	{
+	};
+	IdMap<Empty> ids;
+};
+
 struct Instruction
 {
-	Instruction(const std::vector<uint32_t> &spirv, uint32_t &index);
+	Instruction(const uint32_t *spirv, size_t word_count, uint32_t &index);
 
 	uint16_t op;
 	uint16_t count;
@@ -186,7 +659,8 @@ enum Types
 	TypeExtension,
 	TypeExpression,
 	TypeConstantOp,
-	TypeUndef
+	TypeUndef,
+	TypeCount
 };
 
 struct SPIRUndef : IVariant
@@ -677,6 +1151,50 @@ struct SPIRConstant : IVariant
 		return m.c[col].r[row].f32;
 	}
 
+	// 16-bit literals are stored in the low half of the word.
+	inline float scalar_f16(uint32_t col = 0, uint32_t row = 0) const
+	{
+		return f16_to_f32(uint16_t(m.c[col].r[row].u32 & 0xffffu));
+	}
+
+	static inline float f16_to_f32(uint16_t u16_value)
+	{
+		uint32_t s = uint32_t(u16_value >> 15) & 0x1;
+		int32_t e = (u16_value >> 10) & 0x1f;
+		uint32_t m = u16_value & 0x3ff;
+
+		union {
+			float f32;
+			uint32_t u32;
+		} u;
+
+		if (e == 0)
+		{
+			if (m == 0)
+			{
+				u.u32 = s << 31;
+				return u.f32;
+			}
+
+			// Denormal, normalize it.
+			while ((m & 0x400) == 0)
+			{
+				m <<= 1;
+				e--;
+			}
+			e++;
+			m &= ~0x400u;
+		}
+		else if (e == 31)
+		{
+			u.u32 = (s << 31) | 0x7f800000u | (m << 13);
+			return u.f32;
+		}
+
+		u.u32 = (s << 31) | (uint32_t(e + 127 - 15) << 23) | (m << 13);
+		return u.f32;
+	}
+
 	inline int32_t scalar_i32(uint32_t col = 0, uint32_t row = 0) const
 	{
 		return m.c[col].r[row].i32;
@@ -836,11 +1354,129 @@ struct SPIRConstant : IVariant
 	std::vector<uint32_t> subconstants;
 };
 
+class ObjectPoolBase
+{
+public:
+	virtual ~ObjectPoolBase() = default;
+	virtual void free_opaque(IVariant *ptr) = 0;
+	virtual IVariant *clone_opaque(const IVariant *ptr) = 0;
+};
+
+// Allocates objects of one type from chunks that double in size and recycles
+// freed slots. Objects never move, and all chunks are released together when
+// the pool is destroyed.
+template <typename T>
+class ObjectPool : public ObjectPoolBase
+{
+public:
+	explicit ObjectPool(uint32_t start_object_count_ = 16)
+	    : start_object_count(start_object_count_)
+	{
+	}
+
+	~ObjectPool()
+	{
+		for (auto *chunk : chunks)
+			::free(chunk);
+	}
+
+	ObjectPool(const ObjectPool &) = delete;
+	void operator=(const ObjectPool &) = delete;
+
+	template <typename... P>
+	T *allocate(P &&... p)
+	{
+		if (vacants.empty())
+		{
+			size_t num_objects = size_t(start_object_count) << chunks.size();
+			T *chunk = static_cast<T *>(malloc(num_objects * sizeof(T)));
+			if (!chunk)
+				SPIRV_CROSS_THROW("Out of memory.");
+			chunks.push_back(chunk);
+
+			vacants.reserve(vacants.size() + num_objects);
+			for (size_t i = num_objects; i > 0; i--)
+				vacants.push_back(&chunk[i - 1]);
+		}
+
+		T *ptr = vacants.back();
+		new (ptr) T(std::forward<P>(p)...);
+		vacants.pop_back();
+		return ptr;
+	}
+
+	void free(T *ptr)
+	{
+		ptr->~T();
+		vacants.push_back(ptr);
+	}
+
+	void free_opaque(IVariant *ptr) override
+	{
+		free(static_cast<T *>(ptr));
+	}
+
+	IVariant *clone_opaque(const IVariant *ptr) override
+	{
+		return allocate(*static_cast<const T *>(ptr));
+	}
+
+private:
+	std::vector<T *> vacants;
+	std::vector<T *> chunks;
+	uint32_t start_object_count;
+};
+
+// One pool per variant type, owned by a Compiler.
+struct ObjectPoolGroup
+{
+	ObjectPoolGroup()
+	{
+		pools[TypeType].reset(new ObjectPool<SPIRType>);
+		pools[TypeVariable].reset(new ObjectPool<SPIRVariable>);
+		pools[TypeConstant].reset(new ObjectPool<SPIRConstant>);
+		pools[TypeFunction].reset(new ObjectPool<SPIRFunction>);
+		pools[TypeFunctionPrototype].reset(new ObjectPool<SPIRFunctionPrototype>);
+		pools[TypeBlock].reset(new ObjectPool<SPIRBlock>);
+		pools[TypeExtension].reset(new ObjectPool<SPIRExtension>);
+		pools[TypeExpression].reset(new ObjectPool<SPIRExpression>);
+		pools[TypeConstantOp].reset(new ObjectPool<SPIRConstantOp>);
+		pools[TypeUndef].reset(new ObjectPool<SPIRUndef>);
+	}
+
+	template <typename T>
+	ObjectPool<T> &get()
+	{
+		return static_cast<ObjectPool<T> &>(*pools[T::type]);
+	}
+
+	std::unique_ptr<ObjectPoolBase> pools[TypeCount];
+};
+
 class Variant
 {
 public:
+	explicit Variant(ObjectPoolGroup *group_)
+	    : group(group_)
+	{
+	}
+
+	// Deep copy of other, allocated from our own group.
+	Variant(ObjectPoolGroup *group_, const Variant &other)
+	    : group(group_)
+	    , type(other.type)
+	{
+		if (other.holder)
+			holder = group->pools[type]->clone_opaque(other.holder);
+	}
+
+	~Variant()
+	{
+		if (holder)
+			group->pools[type]->free_opaque(holder);
+	}
+
 	// MSVC 2013 workaround, we shouldn't need these constructors.
-	Variant() = default;
 	Variant(Variant &&other)
 	{
 		*this = std::move(other);
@@ -849,19 +1485,30 @@ public:
 	{
 		if (this != &other)
 		{
-			holder = move(other.holder);
+			if (holder)
+				group->pools[type]->free_opaque(holder);
+			holder = other.holder;
+			group = other.group;
 			type = other.type;
+			other.holder = nullptr;
 			other.type = TypeNone;
 		}
 		return *this;
 	}
 
-	void set(std::unique_ptr<IVariant> val, uint32_t new_type)
+	template <typename T, typename... P>
+	T &emplace(P &&... args)
 	{
-		holder = std::move(val);
-		if (type != TypeNone && type != new_type)
+		if (type != TypeNone && type != uint32_t(T::type))
 			SPIRV_CROSS_THROW("Overwriting a variant with new type.");
-		type = new_type;
+
+		auto &pool = group->get<T>();
+		T *ptr = pool.allocate(std::forward<P>(args)...);
+		if (holder)
+			pool.free(static_cast<T *>(holder));
+		holder = ptr;
+		type = T::type;
+		return *ptr;
 	}
 
 	template <typename T>
@@ -871,7 +1518,7 @@ public:
 			SPIRV_CROSS_THROW("nullptr");
 		if (T::type != type)
 			SPIRV_CROSS_THROW("Bad cast");
-		return *static_cast<T *>(holder.get());
+		return *static_cast<T *>(holder);
 	}
 
 	template <typename T>
@@ -881,7 +1528,7 @@ public:
 			SPIRV_CROSS_THROW("nullptr");
 		if (T::type != type)
 			SPIRV_CROSS_THROW("Bad cast");
-		return *static_cast<const T *>(holder.get());
+		return *static_cast<const T *>(holder);
 	}
 
 	uint32_t get_type() const
@@ -894,12 +1541,15 @@ public:
 	}
 	void reset()
 	{
-		holder.reset();
+		if (holder)
+			group->pools[type]->free_opaque(holder);
+		holder = nullptr;
 		type = TypeNone;
 	}
 
 private:
-	std::unique_ptr<IVariant> holder;
+	ObjectPoolGroup *group = nullptr;
+	IVariant *holder = nullptr;
 	uint32_t type = TypeNone;
 };
 
@@ -918,10 +1568,7 @@ const T &variant_get(const Variant &var)
 template <typename T, typename... P>
 T &variant_set(Variant &var, P &&... args)
 {
-	auto uptr = std::unique_ptr<T>(new T(std::forward<P>(args)...));
-	auto ptr = uptr.get();
-	var.set(std::move(uptr), T::type);
-	return *ptr;
+	return var.emplace<T>(std::forward<P>(args)...);
 }
 
 struct Meta
@@ -30,8 +30,14 @@ void CompilerCPP::emit_buffer_block(const SPIRVariable &var)
 	uint32_t descriptor_set = meta[var.self].decoration.set;
 	uint32_t binding = meta[var.self].decoration.binding;
 
-	emit_block_struct(type);
-	auto buffer_name = to_name(type.self);
+	string buffer_name;
+	if (simd_width)
+		buffer_name = memory_ref_name(type.self);
+	else
+	{
+		emit_block_struct(type);
+		buffer_name = to_name(type.self);
+	}
 
 	statement("internal::Resource<", buffer_name, type_to_array_glsl(type), "> ", instance_name, "__;");
 	statement_no_indent("#define ", instance_name, " __res->", instance_name, "__.get()");
@@ -72,6 +78,23 @@ void CompilerCPP::emit_shared(const SPIRVariable &var)
 	add_resource_name(var.self);
 
 	auto instance_name = to_name(var.self);
+	if (simd_width)
+	{
+		// Lanes index shared variables like buffers, so they live in memory
+		// rather than registers, packed one after the other.
+		auto &type = get<SPIRType>(var.basetype);
+		uint32_t type_id = type.pointer ? type.parent_type : var.basetype;
+		uint32_t matrix_stride = type.columns > 1 ? 4 * type.vecsize : 0;
+		uint32_t size = memory_size(type_id, false, matrix_stride);
+
+		statement("internal::Shared<", memory_ref_type(type_id, false, matrix_stride), "> ", instance_name, "__;");
+		statement_no_indent("#define ", instance_name, " __res->", instance_name, "__.get()");
+		resource_registrations.push_back(
+		    join("s.register_shared(", instance_name, "__", ", ", shared_counter, ", ", size, ");"));
+		shared_counter += size;
+		return;
+	}
+
 	statement(CompilerGLSL::variable_decl(var), ";");
 	statement_no_indent("#define ", instance_name, " __res->", instance_name);
 }
@@ -119,9 +142,18 @@ void CompilerCPP::emit_push_constant_block(const SPIRVariable &var)
 		SPIRV_CROSS_THROW("Push constant blocks cannot be compiled to GLSL with Binding or Set syntax. "
 		                  "Remap to location with reflection API first or disable these decorations.");
 
+	auto instance_name = to_name(var.self);
+	if (simd_width)
+	{
+		statement("internal::PushConstant<", memory_ref_name(type.self), "> ", instance_name, "__;");
+		statement_no_indent("#define ", instance_name, " __res->", instance_name, "__.get()");
+		resource_registrations.push_back(join("s.register_push_constant(", instance_name, "__", ");"));
+		statement("");
+		return;
+	}
+
 	emit_block_struct(type);
 	auto buffer_name = to_name(type.self);
-	auto instance_name = to_name(var.self);
 
 	statement("internal::PushConstant<", buffer_name, type_to_array_glsl(type), "> ", instance_name, ";");
 	statement_no_indent("#define ", instance_name, " __res->", instance_name, ".get()");
@@ -159,6 +191,9 @@ void CompilerCPP::emit_resources()
 		}
 	}
 
+	if (simd_width)
+		emit_memory_refs();
+
 	statement("struct Resources : ", resource_type);
 	begin_scope();
 
@@ -239,10 +274,12 @@ void CompilerCPP::emit_resources()
 		}
 	}
 
+	if (simd_width && shared_counter)
+		statement("static const uint32_t spv_shared_size = ", shared_counter, ";");
 	if (emitted)
 		statement("");
 
-	statement("inline void init(spirv_cross_shader& s)");
+	statement("inline void init(", simd_width ? "spv_shader_state" : "spirv_cross_shader", "& s)");
 	begin_scope();
 	statement(resource_type, "::init(s);");
 	for (auto &reg : resource_registrations)
@@ -254,7 +291,7 @@ void CompilerCPP::emit_resources()
 
 	statement("");
 	statement("Resources* __res;");
-	if (get_entry_point().model == ExecutionModelGLCompute)
+	if (get_entry_point().model == ExecutionModelGLCompute && !simd_width)
 		statement("ComputePrivateResources __priv_res;");
 	statement("");
 
@@ -299,6 +336,16 @@ string CompilerCPP::compile()
 
 	update_active_builtins();
 
+	if (simd_width)
+	{
+		validate_simd();
+		// Struct names are also used as conversions to load them from buffers.
+		backend.explicit_struct_type = false;
+		backend.force_generic_loops = true;
+		backend.vector_component_subscript = true;
+		backend.discard_literal = "spv_discard()";
+	}
+
 	uint32_t pass_count = 0;
 	do
 	{
@@ -306,10 +353,10 @@ string CompilerCPP::compile()
 			SPIRV_CROSS_THROW("Over 3 compilation loops detected. Must be a bug!");
 
 		resource_registrations.clear();
+		shared_counter = 0;
 		reset();
 
-		// Move constructor for this type is broken on GCC 4.9 ...
-		buffer = unique_ptr<ostringstream>(new ostringstream());
+		buffer.reset();
 
 		emit_header();
 		emit_resources();
@@ -325,9 +372,12 @@ string CompilerCPP::compile()
 	end_scope();
 
 	// Emit C entry points
-	emit_c_linkage();
+	if (simd_width)
+		emit_simd_c_linkage();
+	else
+		emit_c_linkage();
 
-	return buffer->str();
+	return buffer.str();
 }
 
 void CompilerCPP::emit_c_linkage()
@@ -415,14 +465,22 @@ string CompilerCPP::argument_decl(const SPIRFunction::Parameter &arg)
 	string variable_name = to_name(var.self);
 	remap_variable_type_name(type, variable_name, base);
 
-	for (uint32_t i = 0; i < type.array.size(); i++)
-		base = join("std::array<", base, ", ", to_array_size(type, i), ">");
+	if (simd_width)
+		base = simd_value_type(type);
+	else
+	{
+		for (uint32_t i = 0; i < type.array.size(); i++)
+			base = join("std::array<", base, ", ", to_array_size(type, i), ">");
+	}
 
 	return join(constref ? "const " : "", base, " &", variable_name);
 }
 
 string CompilerCPP::variable_decl(const SPIRType &type, const string &name)
 {
+	if (simd_width)
+		return join(simd_value_type(type), " ", name);
+
 	string base = type_to_glsl(type);
 	remap_variable_type_name(type, name, base);
 	bool runtime = false;
@@ -448,15 +506,26 @@ void CompilerCPP::emit_header()
 	auto &execution = get_entry_point();
 
 	statement("// This C++ shader is autogenerated by spirv-cross.");
-	statement("#include \"spirv_cross/internal_interface.hpp\"");
-	statement("#include \"spirv_cross/external_interface.h\"");
-	// Needed to properly implement GLSL-style arrays.
-	statement("#include <array>");
-	statement("#include <stdint.h>");
-	statement("");
-	statement("using namespace spirv_cross;");
-	statement("using namespace glm;");
-	statement("");
+	if (simd_width)
+	{
+		statement("#include \"spirv_cross/simd_internal_interface.hpp\"");
+		statement("#include <stdint.h>");
+		statement("");
+		statement("using namespace spirv_cross::simd::w", simd_width, ";");
+		statement("");
+	}
+	else
+	{
+		statement("#include \"spirv_cross/internal_interface.hpp\"");
+		statement("#include \"spirv_cross/external_interface.h\"");
+		// Needed to properly implement GLSL-style arrays.
+		statement("#include <array>");
+		statement("#include <stdint.h>");
+		statement("");
+		statement("using namespace spirv_cross;");
+		statement("using namespace glm;");
+		statement("");
+	}
 
 	statement("namespace Impl");
 	begin_scope();
@@ -496,7 +565,7 @@ void CompilerCPP::emit_header()
 
 	case ExecutionModelGLCompute:
 		impl_type = join("ComputeShader<Impl::Shader, Impl::Shader::Resources, ", execution.workgroup_size.x, ", ",
-		                 execution.workgroup_size.y, ", ", execution.workgroup_size.z, ">");
+		                 execution.workgroup_size.y, ", ", execution.workgroup_size.z, simd_barriers ? ", true>" : ">");
 		resource_type = "ComputeResources";
 		break;
 
@@ -514,3 +583,583 @@ void CompilerCPP::emit_header()
 		SPIRV_CROSS_THROW("Unsupported execution model.");
 	}
 }
+
+void CompilerCPP::emit_simd_c_linkage()
+{
+	statement("");
+	statement("extern \"C\" const struct spirv_cross_simd_interface *",
+	          interface_name.empty() ? string("spirv_cross_simd_get_interface") : interface_name, "(void)");
+	begin_scope();
+	statement("return spirv_cross::simd::get_interface<", impl_type, ">();");
+	end_scope();
+}
+
+static bool is_simd_memory(StorageClass storage)
+{
+	return storage == StorageClassUniform || storage == StorageClassPushConstant ||
+	       storage == StorageClassStorageBuffer || storage == StorageClassWorkgroup;
+}
+
+void CompilerCPP::validate_simd()
+{
+	auto &execution = get_entry_point();
+	uint64_t supported_inputs = 0;
+	uint64_t supported_outputs = 0;
+	simd_barriers = false;
+
+	switch (execution.model)
+	{
+	case ExecutionModelGLCompute:
+		supported_inputs = (1ull << BuiltInGlobalInvocationId) | (1ull << BuiltInLocalInvocationId) |
+		                   (1ull << BuiltInWorkgroupId) | (1ull << BuiltInNumWorkgroups) |
+		                   (1ull << BuiltInWorkgroupSize) | (1ull << BuiltInLocalInvocationIndex);
+		break;
+
+	case ExecutionModelFragment:
+		supported_inputs = (1ull << BuiltInFragCoord) | (1ull << BuiltInFrontFacing);
+		supported_outputs = 1ull << BuiltInFragDepth;
+		break;
+
+	default:
+		SPIRV_CROSS_THROW("SIMD output only supports compute and fragment shaders.");
+	}
+
+	if ((active_input_builtins & ~supported_inputs) || (active_output_builtins & ~supported_outputs))
+		SPIRV_CROSS_THROW("Shader uses a built-in the SIMD runtime does not provide.");
+
+	for (auto &id : ids)
+	{
+		if (id.get_type() == TypeType)
+		{
+			auto &type = id.get<SPIRType>();
+			switch (type.basetype)
+			{
+			case SPIRType::Double:
+			case SPIRType::Int64:
+			case SPIRType::UInt64:
+				SPIRV_CROSS_THROW("SIMD output does not support 64-bit types.");
+
+			case SPIRType::Image:
+			case SPIRType::SampledImage:
+			case SPIRType::Sampler:
+			case SPIRType::AtomicCounter:
+				SPIRV_CROSS_THROW("SIMD output does not support images, samplers or atomic counters.");
+
+			default:
+				break;
+			}
+		}
+		else if (id.get_type() == TypeVariable)
+		{
+			auto &var = id.get<SPIRVariable>();
+			auto &type = get<SPIRType>(var.basetype);
+
+			if (var.storage == StorageClassUniformConstant)
+				SPIRV_CROSS_THROW("SIMD output does not support uniform constants.");
+			if (is_simd_memory(var.storage) && var.storage != StorageClassWorkgroup && !type.array.empty())
+				SPIRV_CROSS_THROW("SIMD output does not support arrays of blocks.");
+			if ((var.storage == StorageClassInput || var.storage == StorageClassOutput) &&
+			    !is_builtin_variable(var) && (type.basetype == SPIRType::Struct || !type.array.empty()))
+				SPIRV_CROSS_THROW("SIMD output only supports scalar, vector and matrix stage inputs and outputs.");
+		}
+		else if (id.get_type() == TypeBlock)
+		{
+			auto &block = id.get<SPIRBlock>();
+			if (block.terminator == SPIRBlock::MultiSelect)
+				SPIRV_CROSS_THROW("SIMD output does not support switch statements.");
+
+			for (auto &op : block.ops)
+			{
+				auto opcode = static_cast<Op>(op.op);
+				if (opcode == OpControlBarrier)
+					simd_barriers = true;
+				if (opcode >= OpDPdx && opcode <= OpFwidthCoarse)
+					SPIRV_CROSS_THROW("SIMD output does not support derivatives.");
+			}
+		}
+	}
+}
+
+string CompilerCPP::type_to_glsl(const SPIRType &type)
+{
+	if (!simd_width)
+		return CompilerGLSL::type_to_glsl(type);
+
+	if (type.vecsize == 1 && type.columns == 1)
+	{
+		switch (type.basetype)
+		{
+		case SPIRType::Boolean:
+			return "vbool";
+		case SPIRType::Int:
+			return "vint";
+		case SPIRType::UInt:
+			return "vuint";
+		case SPIRType::Float:
+			return "vfloat";
+		default:
+			break;
+		}
+	}
+
+	return CompilerGLSL::type_to_glsl(type);
+}
+
+string CompilerCPP::simd_value_type(const SPIRType &type)
+{
+	string base = type_to_glsl(type);
+	for (uint32_t i = 0; i < type.array.size(); i++)
+	{
+		if (!type.array_size_literal[i] || !type.array[i])
+			SPIRV_CROSS_THROW("SIMD output only supports arrays of literal size outside of buffers.");
+		base = join("varray<", base, ", ", type.array[i], ">");
+	}
+	return base;
+}
+
+void CompilerCPP::emit_instruction(const Instruction &instruction)
+{
+	auto ops = stream(instruction);
+	auto opcode = static_cast<Op>(instruction.op);
+	uint32_t length = instruction.length;
+
+	if (simd_width && (opcode == OpAccessChain || opcode == OpInBoundsAccessChain))
+	{
+		// Chains with a non-constant index go through ref types, which
+		// have to be converted to values explicitly when loaded.
+		uint32_t base = ops[2];
+		bool memory = is_simd_memory(expression_type(base).storage);
+		bool dynamic = dynamic_chains.count(base) != 0;
+		const auto *type = &expression_type(base);
+
+		for (uint32_t i = 3; i < length; i++)
+		{
+			uint32_t index = ops[i];
+			bool constant = ids[index].get_type() == TypeConstant;
+			if (!constant)
+				dynamic = true;
+
+			if (!type->array.empty())
+			{
+				if (!constant && !memory && type->basetype == SPIRType::Struct)
+					SPIRV_CROSS_THROW("SIMD output does not support dynamic indexing of local arrays of structs.");
+				type = &get<SPIRType>(type->parent_type);
+			}
+			else if (type->basetype == SPIRType::Struct)
+				type = &get<SPIRType>(type->member_types[get<SPIRConstant>(index).scalar()]);
+			else
+				type = &get<SPIRType>(type->parent_type);
+		}
+
+		if (dynamic)
+			dynamic_chains.insert(ops[1]);
+	}
+
+	// Other batches run at a barrier, so loads from before it must not be
+	// forwarded past it.
+	if (simd_width && opcode == OpControlBarrier)
+		flush_all_active_variables();
+
+	CompilerGLSL::emit_instruction(instruction);
+}
+
+string CompilerCPP::to_load_expression(uint32_t result_type, uint32_t ptr)
+{
+	if (simd_width && (is_simd_memory(expression_type(ptr).storage) || dynamic_chains.count(ptr)))
+		return join(simd_value_type(get<SPIRType>(result_type)), "(", to_expression(ptr), ")");
+	return CompilerGLSL::to_load_expression(result_type, ptr);
+}
+
+void CompilerCPP::emit_mix_op(uint32_t result_type, uint32_t id, uint32_t left, uint32_t right, uint32_t lerp)
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_mix_op(result_type, id, left, right, lerp);
+		return;
+	}
+
+	// There is no ?: for lanes, so selects always become mix().
+	auto &restype = get<SPIRType>(result_type);
+	if (restype.basetype == SPIRType::Struct || !restype.array.empty())
+		SPIRV_CROSS_THROW("SIMD output does not support selecting structs or arrays.");
+
+	string mix_op;
+	if (to_trivial_mix_op(restype, mix_op, left, right, lerp))
+		emit_unary_func_op(result_type, id, lerp, mix_op.c_str());
+	else
+		emit_trinary_func_op(result_type, id, left, right, lerp, "mix");
+}
+
+void CompilerCPP::collect_memory_structs(uint32_t type_id, std::set<uint32_t> &structs)
+{
+	auto &type = get<SPIRType>(type_id);
+	if (!type.array.empty())
+		collect_memory_structs(type.parent_type, structs);
+	else if (type.basetype == SPIRType::Struct && structs.insert(type.self).second)
+	{
+		for (auto member : type.member_types)
+			collect_memory_structs(member, structs);
+	}
+}
+
+const string &CompilerCPP::memory_ref_name(uint32_t type_id)
+{
+	auto itr = memory_ref_names.find(type_id);
+	if (itr == end(memory_ref_names))
+		itr = memory_ref_names.insert(make_pair(type_id, join(to_name(type_id), "_ref"))).first;
+	return itr->second;
+}
+
+string CompilerCPP::memory_ref_type(uint32_t type_id, bool row_major, uint32_t matrix_stride)
+{
+	auto &type = get<SPIRType>(type_id);
+
+	if (!type.array.empty())
+	{
+		auto element = memory_ref_type(type.parent_type, row_major, matrix_stride);
+		uint32_t count = type.array_size_literal.back() ? type.array.back() : 0;
+		return join("array_ref<", element, ", ", memory_array_stride(type_id, row_major, matrix_stride), ", ",
+		            count, ">");
+	}
+	else if (type.basetype == SPIRType::Struct)
+		return memory_ref_name(type.self);
+	else if (type.columns > 1)
+	{
+		if (row_major)
+			return join("matrix_ref<", type_to_glsl(type), ", 4, ", matrix_stride, ">");
+		else
+			return join("matrix_ref<", type_to_glsl(type), ", ", matrix_stride, ", 4>");
+	}
+	else if (type.vecsize > 1)
+		return join("vector_ref<", type_to_glsl(type), ", 4>");
+	else
+		return join("scalar_ref<", type_to_glsl(type), ">");
+}
+
+// Shared variables have no explicit layout, so whatever is not decorated is
+// packed: components are 4 bytes, and columns, array elements and struct
+// members follow each other.
+uint32_t CompilerCPP::memory_size(uint32_t type_id, bool row_major, uint32_t matrix_stride)
+{
+	auto &type = get<SPIRType>(type_id);
+
+	if (!type.array.empty())
+	{
+		if (!type.array_size_literal.back() || !type.array.back())
+			SPIRV_CROSS_THROW("SIMD output only supports shared arrays of literal size.");
+		return memory_array_stride(type_id, row_major, matrix_stride) * type.array.back();
+	}
+	else if (type.basetype == SPIRType::Struct)
+	{
+		uint32_t size = 0;
+		for (uint32_t i = 0; i < uint32_t(type.member_types.size()); i++)
+		{
+			auto &membertype = get<SPIRType>(type.member_types[i]);
+			uint32_t member_stride = membertype.columns > 1 ? memory_matrix_stride(type, i) : 0;
+			uint32_t end = memory_member_offset(type, i) +
+			               memory_size(type.member_types[i], has_member_decoration(type.self, i, DecorationRowMajor),
+			                           member_stride);
+			size = max(size, end);
+		}
+		return size;
+	}
+	else if (type.columns > 1)
+		return (row_major ? type.vecsize : type.columns) * matrix_stride;
+	else
+		return 4 * type.vecsize;
+}
+
+uint32_t CompilerCPP::memory_array_stride(uint32_t type_id, bool row_major, uint32_t matrix_stride)
+{
+	auto &dec = meta[type_id].decoration;
+	if (dec.decoration_flags & (1ull << DecorationArrayStride))
+		return dec.array_stride;
+	return memory_size(get<SPIRType>(type_id).parent_type, row_major, matrix_stride);
+}
+
+uint32_t CompilerCPP::memory_member_offset(const SPIRType &type, uint32_t index)
+{
+	if (has_member_decoration(type.self, index, DecorationOffset))
+		return type_struct_member_offset(type, index);
+
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < index; i++)
+	{
+		auto &membertype = get<SPIRType>(type.member_types[i]);
+		uint32_t member_stride = membertype.columns > 1 ? memory_matrix_stride(type, i) : 0;
+		offset += memory_size(type.member_types[i], false, member_stride);
+	}
+	return offset;
+}
+
+uint32_t CompilerCPP::memory_matrix_stride(const SPIRType &type, uint32_t index)
+{
+	if (has_member_decoration(type.self, index, DecorationMatrixStride))
+		return type_struct_member_matrix_stride(type, index);
+	return 4 * get<SPIRType>(type.member_types[index]).vecsize;
+}
+
+void CompilerCPP::emit_memory_ref(const SPIRType &type)
+{
+	bool is_block = (meta[type.self].decoration.decoration_flags &
+	                 ((1ull << DecorationBlock) | (1ull << DecorationBufferBlock))) != 0;
+	auto &name = memory_ref_name(type.self);
+	uint32_t member_count = uint32_t(type.member_types.size());
+
+	statement("struct ", name);
+	begin_scope();
+	if (!is_block)
+		statement("typedef ", type_to_glsl(type), " value_type;");
+	statement("static const unsigned W = spv_width;");
+	statement("");
+
+	for (uint32_t i = 0; i < member_count; i++)
+	{
+		auto &membertype = get<SPIRType>(type.member_types[i]);
+		bool row_major = has_member_decoration(type.self, i, DecorationRowMajor);
+		uint32_t matrix_stride = 0;
+		if (membertype.columns > 1)
+			matrix_stride = memory_matrix_stride(type, i);
+
+		statement(memory_ref_type(type.member_types[i], row_major, matrix_stride), " ", to_member_name(type, i),
+		          ";");
+	}
+
+	statement("");
+	statement(name, "(const spv_addr &spv_a, uint32_t spv_offset)");
+	for (uint32_t i = 0; i < member_count; i++)
+	{
+		statement(i == 0 ? "    : " : "    , ", to_member_name(type, i), "(spv_a, spv_offset + ",
+		          memory_member_offset(type, i), ")");
+	}
+	begin_scope();
+	end_scope();
+
+	if (!is_block)
+	{
+		statement("");
+		statement("operator value_type() const");
+		begin_scope();
+		string members;
+		for (uint32_t i = 0; i < member_count; i++)
+		{
+			if (i)
+				members += ", ";
+			members += join(simd_value_type(get<SPIRType>(type.member_types[i])), "(", to_member_name(type, i), ")");
+		}
+		statement("return value_type{ ", members, " };");
+		end_scope();
+
+		statement("");
+		statement("const ", name, " &operator=(const value_type &spv_v) const");
+		begin_scope();
+		for (uint32_t i = 0; i < member_count; i++)
+			statement(to_member_name(type, i), " = spv_v.", to_member_name(type, i), ";");
+		statement("return *this;");
+		end_scope();
+	}
+
+	end_scope_decl();
+	statement("");
+}
+
+void CompilerCPP::emit_memory_refs()
+{
+	// Struct ids come after the ids of their members, so walking them in
+	// order declares every ref type before its use.
+	std::set<uint32_t> structs;
+	for (auto &id : ids)
+	{
+		if (id.get_type() == TypeVariable)
+		{
+			auto &var = id.get<SPIRVariable>();
+			if (var.storage != StorageClassFunction && is_simd_memory(var.storage) && !is_hidden_variable(var))
+				collect_memory_structs(var.basetype, structs);
+		}
+	}
+
+	for (auto type_id : structs)
+		emit_memory_ref(get<SPIRType>(type_id));
+}
+
+void CompilerCPP::emit_selection_begin(const string &condition, bool negate)
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_selection_begin(condition, negate);
+		return;
+	}
+
+	// Both sides run in turn, each with the lanes which take it.
+	uint32_t id = mask_counter++;
+	selection_stack.push_back({ id, false });
+
+	begin_scope();
+	statement("const spv_mask spv_outer", id, " = spv_exec();");
+	statement("const spv_mask spv_cond", id, " = spv_outer", id, " & ", negate ? "~" : "", "spv_to_mask(", condition,
+	          ");");
+	statement("spv_exec() = spv_cond", id, ";");
+	statement("if (spv_any(spv_cond", id, "))");
+	begin_scope();
+}
+
+void CompilerCPP::emit_selection_else()
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_selection_else();
+		return;
+	}
+
+	auto &selection = selection_stack.back();
+	selection.has_else = true;
+
+	end_scope();
+	statement("const spv_mask spv_then", selection.id, " = spv_exec();");
+	statement("spv_exec() = spv_outer", selection.id, " & ~spv_cond", selection.id, ";");
+	statement("if (spv_any(spv_exec()))");
+	begin_scope();
+}
+
+void CompilerCPP::emit_selection_end()
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_selection_end();
+		return;
+	}
+
+	auto selection = selection_stack.back();
+	selection_stack.pop_back();
+
+	// Lanes which broke, continued or returned stay off.
+	end_scope();
+	if (selection.has_else)
+		statement("spv_exec() = spv_exec() | spv_then", selection.id, ";");
+	else
+		statement("spv_exec() = spv_exec() | (spv_outer", selection.id, " & ~spv_cond", selection.id, ");");
+	end_scope();
+}
+
+void CompilerCPP::emit_loop_begin()
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_loop_begin();
+		return;
+	}
+
+	// Every path through the body ends in a break, continue or return, so
+	// the loop runs until no lane continues.
+	uint32_t id = mask_counter++;
+	loop_stack.push_back(id);
+
+	begin_scope();
+	statement("spv_mask spv_break", id, " = spv_mask(), spv_continue", id, " = spv_mask();");
+	statement("for (;;)");
+	begin_scope();
+	statement("spv_exec() = spv_exec() | spv_continue", id, ";");
+	statement("spv_continue", id, " = spv_mask();");
+	statement("if (!spv_any(spv_exec()))");
+	begin_scope();
+	statement("break;");
+	end_scope();
+}
+
+void CompilerCPP::emit_loop_end()
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_loop_end();
+		return;
+	}
+
+	uint32_t id = loop_stack.back();
+	loop_stack.pop_back();
+
+	end_scope();
+	statement("spv_exec() = spv_break", id, ";");
+	end_scope();
+}
+
+void CompilerCPP::emit_break()
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_break();
+		return;
+	}
+
+	if (loop_stack.empty())
+		SPIRV_CROSS_THROW("SIMD output can only break out of loops.");
+	uint32_t id = loop_stack.back();
+	statement("spv_break", id, " = spv_break", id, " | spv_exec();");
+	statement("spv_exec() = spv_mask();");
+}
+
+void CompilerCPP::emit_continue()
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_continue();
+		return;
+	}
+
+	if (loop_stack.empty())
+		SPIRV_CROSS_THROW("SIMD output can only continue loops.");
+	uint32_t id = loop_stack.back();
+	statement("spv_continue", id, " = spv_continue", id, " | spv_exec();");
+	statement("spv_exec() = spv_mask();");
+}
+
+void CompilerCPP::emit_return(const string &value)
+{
+	if (!simd_width)
+	{
+		CompilerGLSL::emit_return(value);
+		return;
+	}
+
+	// The lanes wait for the others at the end of the function.
+	if (!value.empty())
+		statement("spv_result = ", value, ";");
+	statement("spv_exec() = spv_mask();");
+}
+
+void CompilerCPP::emit_function_prologue(SPIRFunction &func)
+{
+	if (!simd_width)
+		return;
+
+	mask_counter = 0;
+	selection_stack.clear();
+	loop_stack.clear();
+
+	statement("const spv_mask spv_entry = spv_exec();");
+	auto &return_type = get<SPIRType>(func.return_type);
+	if (return_type.basetype != SPIRType::Void)
+		statement(variable_decl(return_type, "spv_result"), ";");
+
+	// The shader object is reused for every batch, so private globals are
+	// initialized again each time.
+	if (func.self == entry_point)
+	{
+		for (auto global : global_variables)
+		{
+			auto &var = get<SPIRVariable>(global);
+			if (var.storage == StorageClassPrivate && var.initializer)
+				statement(to_name(var.self), " = ", to_expression(var.initializer), ";");
+		}
+	}
+	statement("");
+}
+
+void CompilerCPP::emit_function_epilogue(SPIRFunction &func)
+{
+	if (!simd_width)
+		return;
+
+	statement("spv_exec() = spv_entry & spv_alive();");
+	if (get<SPIRType>(func.return_type).basetype != SPIRType::Void)
+		statement("return spv_result;");
+}
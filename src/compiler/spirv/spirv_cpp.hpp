@@ -18,11 +18,25 @@
 #define SPIRV_CROSS_CPP_HPP
 
 #include "spirv_glsl.hpp"
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 namespace spirv_cross
 {
+// Emits C++ for a shader.
+//
+// By default the output runs one invocation per invoke() call and is written
+// against the scalar spirv-cross runtime (spirv_cross/internal_interface.hpp,
+// spirv_cross/external_interface.h and glm), which is not part of this tree.
+//
+// With set_simd_width(), every GLSL value becomes a structure of arrays with
+// one lane per invocation, and the output runs that many invocations at once
+// against the runtime in include/spirv_cross/simd_*.hpp. Divergent control
+// flow is turned into execution masks, and simd_thread_group.hpp spreads
+// workgroups or fragments over a thread pool.
 class CompilerCPP : public CompilerGLSL
 {
 public:
@@ -36,6 +50,11 @@ public:
 	{
 	}
 
+	CompilerCPP(std::shared_ptr<const ParsedIR> module_)
+	    : CompilerGLSL(move(module_))
+	{
+	}
+
 	std::string compile() override;
 
 	// Sets a custom symbol name that can override
@@ -48,6 +67,21 @@ public:
 		interface_name = std::move(name);
 	}
 
+	// Runs width invocations per call: 4, 8 or 16, or 0 for the scalar output.
+	// Only compute and fragment shaders are supported, and compile() throws
+	// for what the SIMD runtime cannot run: switch, derivatives, images and
+	// samplers, 64-bit types, block or struct stage IO, and dynamic indexing
+	// of local arrays of structs.
+	//
+	// Shared memory is packed where it has no explicit layout. Compute
+	// shaders with barriers run each batch of a workgroup as a fiber.
+	void set_simd_width(uint32_t width)
+	{
+		if (width != 0 && width != 4 && width != 8 && width != 16)
+			SPIRV_CROSS_THROW("SIMD width must be 4, 8 or 16.");
+		simd_width = width;
+	}
+
 private:
 	void emit_header() override;
 	void emit_c_linkage();
@@ -65,6 +99,48 @@ private:
 
 	std::string argument_decl(const SPIRFunction::Parameter &arg);
 
+	std::string type_to_glsl(const SPIRType &type) override;
+	void emit_instruction(const Instruction &instr) override;
+	void emit_mix_op(uint32_t result_type, uint32_t id, uint32_t left, uint32_t right, uint32_t lerp) override;
+	void emit_selection_begin(const std::string &condition, bool negate) override;
+	void emit_selection_else() override;
+	void emit_selection_end() override;
+	void emit_loop_begin() override;
+	void emit_loop_end() override;
+	void emit_break() override;
+	void emit_continue() override;
+	void emit_return(const std::string &value) override;
+	void emit_function_prologue(SPIRFunction &func) override;
+	void emit_function_epilogue(SPIRFunction &func) override;
+	std::string to_load_expression(uint32_t result_type, uint32_t ptr) override;
+
+	void validate_simd();
+	void emit_simd_c_linkage();
+	void emit_memory_refs();
+	void emit_memory_ref(const SPIRType &type);
+	void collect_memory_structs(uint32_t type_id, std::set<uint32_t> &structs);
+	std::string memory_ref_type(uint32_t type_id, bool row_major, uint32_t matrix_stride);
+	uint32_t memory_size(uint32_t type_id, bool row_major, uint32_t matrix_stride);
+	uint32_t memory_array_stride(uint32_t type_id, bool row_major, uint32_t matrix_stride);
+	uint32_t memory_member_offset(const SPIRType &type, uint32_t index);
+	uint32_t memory_matrix_stride(const SPIRType &type, uint32_t index);
+	const std::string &memory_ref_name(uint32_t type_id);
+	std::string simd_value_type(const SPIRType &type);
+
+	struct SIMDSelection
+	{
+		uint32_t id;
+		bool has_else;
+	};
+
+	uint32_t simd_width = 0;
+	bool simd_barriers = false;
+	uint32_t mask_counter = 0;
+	std::vector<SIMDSelection> selection_stack;
+	std::vector<uint32_t> loop_stack;
+	std::unordered_set<uint32_t> dynamic_chains;
+	std::unordered_map<uint32_t, std::string> memory_ref_names;
+
 	std::vector<std::string> resource_registrations;
 	std::string impl_type;
 	std::string resource_type;
@@ -47,7 +47,7 @@ static string ensure_valid_identifier(const string &name)
 	return str;
 }
 
-Instruction::Instruction(const vector<uint32_t> &spirv, uint32_t &index)
+Instruction::Instruction(const uint32_t *spirv, size_t word_count, uint32_t &index)
 {
 	op = spirv[index] & 0xffff;
 	count = (spirv[index] >> 16) & 0xffff;
@@ -60,22 +60,87 @@ Instruction::Instruction(const vector<uint32_t> &spirv, uint32_t &index)
 
 	index += count;
 
-	if (index > spirv.size())
+	if (index > word_count)
 		SPIRV_CROSS_THROW("SPIR-V instruction goes out of bounds.");
 }
 
 Compiler::Compiler(vector<uint32_t> ir)
-    : spirv(move(ir))
+    : Compiler(move(ir), 0)
 {
-	parse();
 }
 
 Compiler::Compiler(const uint32_t *ir, size_t word_count)
-    : spirv(ir, ir + word_count)
+    : Compiler(ir, word_count, 0)
+{
+}
+
+Compiler::Compiler(vector<uint32_t> ir, uint32_t parse_flags)
+    : spirv_storage(move(ir))
+    , pool_group(new ObjectPoolGroup)
+    , declarations_only((parse_flags & ParseDeclarationsOnly) != 0)
 {
+	spirv = spirv_storage.data();
+	spirv_word_count = spirv_storage.size();
+	parse();
+}
+
+Compiler::Compiler(const uint32_t *ir, size_t word_count, uint32_t parse_flags)
+    : pool_group(new ObjectPoolGroup)
+    , declarations_only((parse_flags & ParseDeclarationsOnly) != 0)
+{
+	if (parse_flags & ParseBorrowWords)
+		spirv = ir;
+	else
+	{
+		spirv_storage.assign(ir, ir + word_count);
+		spirv = spirv_storage.data();
+	}
+	spirv_word_count = word_count;
 	parse();
 }
 
+Compiler::Compiler(shared_ptr<const ParsedIR> module_)
+    : module(move(module_))
+    , pool_group(new ObjectPoolGroup)
+{
+	copy_parsed_state(module->parsed);
+}
+
+void Compiler::copy_parsed_state(const Compiler &parsed)
+{
+	// The words and the instructions referring to them are never written to,
+	// so they can be read from the shared module directly.
+	spirv = parsed.spirv;
+	spirv_word_count = parsed.spirv_word_count;
+
+	ids.reserve(parsed.ids.size());
+	for (auto &id : parsed.ids)
+		ids.emplace_back(pool_group.get(), id);
+	meta = parsed.meta;
+
+	global_variables = parsed.global_variables;
+	aliased_variables = parsed.aliased_variables;
+	entry_point = parsed.entry_point;
+	entry_points = parsed.entry_points;
+	source = parsed.source;
+
+	loop_blocks = parsed.loop_blocks;
+	continue_blocks = parsed.continue_blocks;
+	loop_merge_targets = parsed.loop_merge_targets;
+	selection_merge_targets = parsed.selection_merge_targets;
+	multiselect_merge_targets = parsed.multiselect_merge_targets;
+}
+
+shared_ptr<const ParsedIR> ParsedIR::parse(const uint32_t *ir, size_t word_count)
+{
+	return shared_ptr<const ParsedIR>(new ParsedIR(ir, word_count));
+}
+
+shared_ptr<const ParsedIR> ParsedIR::parse(vector<uint32_t> ir)
+{
+	return shared_ptr<const ParsedIR>(new ParsedIR(move(ir)));
+}
+
 string Compiler::compile()
 {
 	// Force a classic "C" locale, reverts when function returns
@@ -570,7 +635,7 @@ unordered_set<uint32_t> Compiler::get_active_interface_variables() const
 	// Traverse the call graph and find all interface variables which are in use.
 	unordered_set<uint32_t> variables;
 	InterfaceVariableAccessHandler handler(*this, variables);
-	traverse_all_reachable_opcodes(get<SPIRFunction>(entry_point), handler);
+	traverse_entry_point_opcodes(handler);
 	return variables;
 }
 
@@ -677,10 +742,10 @@ static inline uint32_t swap_endian(uint32_t v)
 	return ((v >> 24) & 0x000000ffu) | ((v >> 8) & 0x0000ff00u) | ((v << 8) & 0x00ff0000u) | ((v << 24) & 0xff000000u);
 }
 
-static string extract_string(const vector<uint32_t> &spirv, uint32_t offset)
+static string extract_string(const uint32_t *spirv, size_t word_count, uint32_t offset)
 {
 	string ret;
-	for (uint32_t i = offset; i < spirv.size(); i++)
+	for (uint32_t i = offset; i < word_count; i++)
 	{
 		uint32_t w = spirv[i];
 
@@ -713,26 +778,51 @@ static bool is_valid_spirv_version(uint32_t version)
 
 void Compiler::parse()
 {
-	auto len = spirv.size();
+	auto len = spirv_word_count;
 	if (len < 5)
 		SPIRV_CROSS_THROW("SPIRV file too small.");
 
-	auto s = spirv.data();
+	// Endian-swap if we need to. Borrowed words are left alone and swapped
+	// into a copy of our own.
+	if (spirv[0] == swap_endian(MagicNumber))
+	{
+		if (spirv != spirv_storage.data())
+			spirv_storage.assign(spirv, spirv + len);
+		transform(begin(spirv_storage), end(spirv_storage), begin(spirv_storage),
+		          [](uint32_t c) { return swap_endian(c); });
+		spirv = spirv_storage.data();
+	}
 
-	// Endian-swap if we need to.
-	if (s[0] == swap_endian(MagicNumber))
-		transform(begin(spirv), end(spirv), begin(spirv), [](uint32_t c) { return swap_endian(c); });
+	auto s = spirv;
 
 	if (s[0] != MagicNumber || !is_valid_spirv_version(s[1]))
 		SPIRV_CROSS_THROW("Invalid SPIRV format.");
 
 	uint32_t bound = s[3];
-	ids.resize(bound);
-	meta.resize(bound);
+	set_id_bound(bound);
 
+	vector<Instruction> inst;
 	uint32_t offset = 5;
 	while (offset < len)
-		inst.emplace_back(spirv, offset);
+	{
+		inst.emplace_back(spirv, len, offset);
+		if (!declarations_only || inst.back().op != OpFunction)
+			continue;
+
+		// Only remember where the body starts, and skip over it.
+		if (inst.back().length < 2)
+			SPIRV_CROSS_THROW("OpFunction not enough arguments.");
+		function_offsets[spirv[inst.back().offset + 1]] = offset;
+		inst.pop_back();
+
+		for (;;)
+		{
+			if (offset >= len)
+				SPIRV_CROSS_THROW("Function was not terminated.");
+			if (Instruction(spirv, len, offset).op == OpFunctionEnd)
+				break;
+		}
+	}
 
 	for (auto &i : inst)
 		parse(i);
@@ -1180,7 +1270,7 @@ void Compiler::parse(const Instruction &instruction)
 	case OpExtInstImport:
 	{
 		uint32_t id = ops[0];
-		auto ext = extract_string(spirv, instruction.offset + 1);
+		auto ext = extract_string(spirv, spirv_word_count, instruction.offset + 1);
 		if (ext == "GLSL.std.450")
 			set<SPIRExtension>(id, SPIRExtension::GLSL);
 		else
@@ -1195,7 +1285,7 @@ void Compiler::parse(const Instruction &instruction)
 	{
 		auto itr =
 		    entry_points.insert(make_pair(ops[1], SPIREntryPoint(ops[1], static_cast<ExecutionModel>(ops[0]),
-		                                                         extract_string(spirv, instruction.offset + 2))));
+		                                                         extract_string(spirv, spirv_word_count, instruction.offset + 2))));
 		auto &e = itr.first->second;
 
 		// Strings need nul-terminator and consume the whole word.
@@ -1242,7 +1332,7 @@ void Compiler::parse(const Instruction &instruction)
 	case OpName:
 	{
 		uint32_t id = ops[0];
-		set_name(id, extract_string(spirv, instruction.offset + 1));
+		set_name(id, extract_string(spirv, spirv_word_count, instruction.offset + 1));
 		break;
 	}
 
@@ -1250,7 +1340,7 @@ void Compiler::parse(const Instruction &instruction)
 	{
 		uint32_t id = ops[0];
 		uint32_t member = ops[1];
-		set_member_name(id, member, extract_string(spirv, instruction.offset + 2));
+		set_member_name(id, member, extract_string(spirv, spirv_word_count, instruction.offset + 2));
 		break;
 	}
 
@@ -2090,6 +2180,57 @@ bool Compiler::traverse_all_reachable_opcodes(const SPIRFunction &func, OpcodeHa
 	return true;
 }
 
+bool Compiler::traverse_all_reachable_opcodes(uint32_t func, OpcodeHandler &handler,
+                                              unordered_set<uint32_t> &visited) const
+{
+	auto itr = function_offsets.find(func);
+	if (itr == end(function_offsets))
+		SPIRV_CROSS_THROW("Function call to undeclared function.");
+
+	// Unlike the parsed path, don't walk a function twice. The handlers used
+	// here only collect sets, and recursion is invalid anyway.
+	if (!visited.insert(func).second)
+		return true;
+
+	uint32_t offset = itr->second;
+	for (;;)
+	{
+		Instruction i(spirv, spirv_word_count, offset);
+		auto op = static_cast<Op>(i.op);
+		if (op == OpFunctionEnd)
+			break;
+
+		auto ops = stream(i);
+		if (!handler.handle(op, ops, i.length))
+			return false;
+
+		if (op == OpFunctionCall)
+		{
+			if (i.length < 3)
+				SPIRV_CROSS_THROW("OpFunctionCall not enough arguments.");
+			if (!handler.begin_function_scope(ops, i.length))
+				return false;
+			if (!traverse_all_reachable_opcodes(ops[2], handler, visited))
+				return false;
+			if (!handler.end_function_scope(ops, i.length))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool Compiler::traverse_entry_point_opcodes(OpcodeHandler &handler) const
+{
+	if (declarations_only)
+	{
+		unordered_set<uint32_t> visited;
+		return traverse_all_reachable_opcodes(entry_point, handler, visited);
+	}
+	else
+		return traverse_all_reachable_opcodes(get<SPIRFunction>(entry_point), handler);
+}
+
 uint32_t Compiler::type_struct_member_offset(const SPIRType &type, uint32_t index) const
 {
 	// Decoration must be set in valid SPIR-V, otherwise throw.
@@ -2233,7 +2374,7 @@ std::vector<BufferRange> Compiler::get_active_buffer_ranges(uint32_t id) const
 {
 	std::vector<BufferRange> ranges;
 	BufferAccessHandler handler(*this, ranges, id);
-	traverse_all_reachable_opcodes(get<SPIRFunction>(entry_point), handler);
+	traverse_entry_point_opcodes(handler);
 	return ranges;
 }
 
@@ -2243,11 +2384,17 @@ uint32_t Compiler::increase_bound_by(uint32_t incr_amount)
 {
 	auto curr_bound = ids.size();
 	auto new_bound = curr_bound + incr_amount;
-	ids.resize(new_bound);
-	meta.resize(new_bound);
+	set_id_bound(uint32_t(new_bound));
 	return uint32_t(curr_bound);
 }
 
+void Compiler::set_id_bound(uint32_t bound)
+{
+	while (ids.size() < bound)
+		ids.emplace_back(pool_group.get());
+	meta.resize(bound);
+}
+
 bool Compiler::types_are_logically_equivalent(const SPIRType &a, const SPIRType &b) const
 {
 	if (a.basetype != b.basetype)
@@ -2807,10 +2954,10 @@ const SPIRConstant &Compiler::get_constant(uint32_t id) const
 	return get<SPIRConstant>(id);
 }
 
-static bool exists_unaccessed_path_to_return(const CFG &cfg, uint32_t block, const unordered_set<uint32_t> &blocks)
+static bool exists_unaccessed_path_to_return(const CFG &cfg, uint32_t block, const vector<uint32_t> &blocks)
 {
 	// This block accesses the variable.
-	if (blocks.find(block) != end(blocks))
+	if (find(begin(blocks), end(blocks), block) != end(blocks))
 		return false;
 
 	// We are at the end of the CFG.
@@ -2826,7 +2973,7 @@ static bool exists_unaccessed_path_to_return(const CFG &cfg, uint32_t block, con
 }
 
 void Compiler::analyze_parameter_preservation(
-    SPIRFunction &entry, const CFG &cfg, const unordered_map<uint32_t, unordered_set<uint32_t>> &variable_to_blocks)
+    SPIRFunction &entry, const CFG &cfg, const IdMap<vector<uint32_t>> &variable_to_blocks)
 {
 	for (auto &arg : entry.arguments)
 	{
@@ -2854,8 +3001,8 @@ void Compiler::analyze_parameter_preservation(
 		if (!potential_preserve)
 			continue;
 
-		auto itr = variable_to_blocks.find(arg.id);
-		if (itr == end(variable_to_blocks))
+		auto *blocks = variable_to_blocks.find(arg.id);
+		if (!blocks)
 		{
 			// Variable is never accessed.
 			continue;
@@ -2867,7 +3014,7 @@ void Compiler::analyze_parameter_preservation(
 		// void foo(int &var) { if (cond) var = 10; }
 		// Using read/write counts, we will think it's just an out variable, but it really needs to be inout,
 		// because if we don't write anything whatever we put into the function must return back to the caller.
-		if (exists_unaccessed_path_to_return(cfg, entry.entry_block, itr->second))
+		if (exists_unaccessed_path_to_return(cfg, entry.entry_block, *blocks))
 			arg.read_count++;
 	}
 }
@@ -2900,7 +3047,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 				auto &next = compiler.get<SPIRBlock>(to);
 				for (auto &phi : next.phi_variables)
 					if (phi.parent == block.self)
-						accessed_variables_to_block[phi.function_variable].insert(block.self);
+						add_access(phi.function_variable, block.self);
 			};
 
 			switch (block.terminator)
@@ -2938,7 +3085,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 				uint32_t ptr = args[0];
 				auto *var = compiler.maybe_get_backing_variable(ptr);
 				if (var && var->storage == StorageClassFunction)
-					accessed_variables_to_block[var->self].insert(current_block->self);
+					add_access(var->self, current_block->self);
 				break;
 			}
 
@@ -2951,7 +3098,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 				uint32_t ptr = args[2];
 				auto *var = compiler.maybe_get<SPIRVariable>(ptr);
 				if (var && var->storage == StorageClassFunction)
-					accessed_variables_to_block[var->self].insert(current_block->self);
+					add_access(var->self, current_block->self);
 				break;
 			}
 
@@ -2964,11 +3111,11 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 				uint32_t rhs = args[1];
 				auto *var = compiler.maybe_get_backing_variable(lhs);
 				if (var && var->storage == StorageClassFunction)
-					accessed_variables_to_block[var->self].insert(current_block->self);
+					add_access(var->self, current_block->self);
 
 				var = compiler.maybe_get_backing_variable(rhs);
 				if (var && var->storage == StorageClassFunction)
-					accessed_variables_to_block[var->self].insert(current_block->self);
+					add_access(var->self, current_block->self);
 				break;
 			}
 
@@ -2979,7 +3126,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 
 				auto *var = compiler.maybe_get_backing_variable(args[2]);
 				if (var && var->storage == StorageClassFunction)
-					accessed_variables_to_block[var->self].insert(current_block->self);
+					add_access(var->self, current_block->self);
 				break;
 			}
 
@@ -2990,7 +3137,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 				uint32_t ptr = args[2];
 				auto *var = compiler.maybe_get_backing_variable(ptr);
 				if (var && var->storage == StorageClassFunction)
-					accessed_variables_to_block[var->self].insert(current_block->self);
+					add_access(var->self, current_block->self);
 				break;
 			}
 
@@ -3005,7 +3152,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 				{
 					auto *var = compiler.maybe_get_backing_variable(args[i]);
 					if (var && var->storage == StorageClassFunction)
-						accessed_variables_to_block[var->self].insert(current_block->self);
+						add_access(var->self, current_block->self);
 				}
 				break;
 			}
@@ -3016,7 +3163,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 					return false;
 
 				// Phi nodes are implemented as function variables, so register an access here.
-				accessed_variables_to_block[args[1]].insert(current_block->self);
+				add_access(args[1], current_block->self);
 				break;
 			}
 
@@ -3029,8 +3176,17 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 			return true;
 		}
 
+		void add_access(uint32_t var, uint32_t block)
+		{
+			// Blocks are visited one at a time, so repeated accesses from
+			// the same block are always adjacent.
+			auto &blocks = accessed_variables_to_block[var];
+			if (blocks.empty() || blocks.back() != block)
+				blocks.push_back(block);
+		}
+
 		Compiler &compiler;
-		std::unordered_map<uint32_t, std::unordered_set<uint32_t>> accessed_variables_to_block;
+		IdMap<std::vector<uint32_t>> accessed_variables_to_block;
 		const SPIRBlock *current_block = nullptr;
 	} handler(*this);
 
@@ -3044,17 +3200,24 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 	// Analyze if there are parameters which need to be implicitly preserved with an "in" qualifier.
 	analyze_parameter_preservation(entry, cfg, handler.accessed_variables_to_block);
 
-	unordered_map<uint32_t, uint32_t> potential_loop_variables;
+	IdMap<uint32_t> potential_loop_variables;
 
-	// For each variable which is statically accessed.
+	// Visit variables in id order, as it decides the order they are declared in.
+	vector<uint32_t> accessed_variables;
+	accessed_variables.reserve(handler.accessed_variables_to_block.size());
 	for (auto &var : handler.accessed_variables_to_block)
+		accessed_variables.push_back(var.first);
+	sort(begin(accessed_variables), end(accessed_variables));
+
+	// For each variable which is statically accessed.
+	for (auto var : accessed_variables)
 	{
 		DominatorBuilder builder(cfg);
-		auto &blocks = var.second;
-		auto &type = this->expression_type(var.first);
+		auto &blocks = *handler.accessed_variables_to_block.find(var);
+		auto &type = this->expression_type(var);
 
 		// Figure out which block is dominating all accesses of those variables.
-		for (auto &block : blocks)
+		for (auto block : blocks)
 		{
 			// If we're accessing a variable inside a continue block, this variable might be a loop variable.
 			// We can only use loop variables with scalars, as we cannot track static expressions for vectors.
@@ -3062,7 +3225,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 			{
 				// The variable is used in multiple continue blocks, this is not a loop
 				// candidate, signal that by setting block to -1u.
-				auto &potential = potential_loop_variables[var.first];
+				auto &potential = potential_loop_variables[var];
 
 				if (potential == 0)
 					potential = block;
@@ -3081,8 +3244,8 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 		if (dominating_block)
 		{
 			auto &block = this->get<SPIRBlock>(dominating_block);
-			block.dominated_variables.push_back(var.first);
-			this->get<SPIRVariable>(var.first).dominator = dominating_block;
+			block.dominated_variables.push_back(var);
+			this->get<SPIRVariable>(var).dominator = dominating_block;
 		}
 	}
 
@@ -3104,15 +3267,10 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 		uint32_t header = 0;
 
 		// Find the loop header for this block.
-		for (auto b : this->loop_blocks)
-		{
-			auto &potential_header = this->get<SPIRBlock>(b);
-			if (potential_header.continue_block == block)
-			{
+		this->loop_blocks.for_each([&](uint32_t b) {
+			if (!header && this->get<SPIRBlock>(b).continue_block == block)
 				header = b;
-				break;
-			}
-		}
+		});
 
 		assert(header);
 		auto &header_block = this->get<SPIRBlock>(header);
@@ -3151,7 +3309,7 @@ void Compiler::analyze_variable_scope(SPIRFunction &entry)
 		auto &blocks = handler.accessed_variables_to_block[loop_variable.first];
 		cfg.walk_from(header_block.merge_block, [&](uint32_t walk_block) {
 			// We found a block which accesses the variable outside the loop.
-			if (blocks.find(walk_block) != end(blocks))
+			if (find(begin(blocks), end(blocks), walk_block) != end(blocks))
 				static_loop_init = false;
 		});
 
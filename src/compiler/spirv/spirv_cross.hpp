@@ -23,6 +23,7 @@
 namespace spirv_cross
 {
 class CFG;
+class ParsedIR;
 struct Resource
 {
 	// Resources are identified with their SPIR-V ID.
@@ -108,6 +109,10 @@ public:
 	Compiler(std::vector<uint32_t> ir);
 	Compiler(const uint32_t *ir, size_t word_count);
 
+	// Reuses a module parsed up front with ParsedIR::parse() instead of parsing
+	// again. Only the state mutated while compiling is copied.
+	Compiler(std::shared_ptr<const ParsedIR> module);
+
 	virtual ~Compiler() = default;
 
 	// After parsing, API users can modify the SPIR-V via reflection and call this
@@ -336,15 +341,23 @@ protected:
 		if (!instr.length)
 			return nullptr;
 
-		if (instr.offset + instr.length > spirv.size())
+		if (instr.offset + instr.length > spirv_word_count)
 			SPIRV_CROSS_THROW("Compiler::stream() out of range.");
 		return &spirv[instr.offset];
 	}
-	std::vector<uint32_t> spirv;
 
-	std::vector<Instruction> inst;
+	// The SPIR-V words are read in place. They live in spirv_storage, in the
+	// shared module, or in the caller's buffer for a borrowed ParsedIR.
+	const uint32_t *spirv = nullptr;
+	size_t spirv_word_count = 0;
+	std::vector<uint32_t> spirv_storage;
+	std::shared_ptr<const ParsedIR> module;
+
+	// Storage for everything in ids; must outlive it.
+	std::unique_ptr<ObjectPoolGroup> pool_group;
 	std::vector<Variant> ids;
 	std::vector<Meta> meta;
+	void set_id_bound(uint32_t bound);
 
 	SPIRFunction *current_function = nullptr;
 	SPIRBlock *current_block = nullptr;
@@ -409,11 +422,11 @@ protected:
 		Source() = default;
 	} source;
 
-	std::unordered_set<uint32_t> loop_blocks;
-	std::unordered_set<uint32_t> continue_blocks;
-	std::unordered_set<uint32_t> loop_merge_targets;
-	std::unordered_set<uint32_t> selection_merge_targets;
-	std::unordered_set<uint32_t> multiselect_merge_targets;
+	IdBitset loop_blocks;
+	IdBitset continue_blocks;
+	IdBitset loop_merge_targets;
+	IdBitset selection_merge_targets;
+	IdBitset multiselect_merge_targets;
 
 	virtual std::string to_name(uint32_t id, bool allow_alias = true) const;
 	bool is_builtin_variable(const SPIRVariable &var) const;
@@ -433,19 +446,17 @@ protected:
 
 	inline bool is_continue(uint32_t next) const
 	{
-		return continue_blocks.find(next) != end(continue_blocks);
+		return continue_blocks.count(next) != 0;
 	}
 
 	inline bool is_break(uint32_t next) const
 	{
-		return loop_merge_targets.find(next) != end(loop_merge_targets) ||
-		       multiselect_merge_targets.find(next) != end(multiselect_merge_targets);
+		return loop_merge_targets.count(next) || multiselect_merge_targets.count(next);
 	}
 
 	inline bool is_conditional(uint32_t next) const
 	{
-		return selection_merge_targets.find(next) != end(selection_merge_targets) &&
-		       multiselect_merge_targets.find(next) == end(multiselect_merge_targets);
+		return selection_merge_targets.count(next) && !multiselect_merge_targets.count(next);
 	}
 
 	// Dependency tracking for temporaries read from variables.
@@ -455,7 +466,7 @@ protected:
 	void flush_all_aliased_variables();
 	void register_global_read_dependencies(const SPIRBlock &func, uint32_t id);
 	void register_global_read_dependencies(const SPIRFunction &func, uint32_t id);
-	std::unordered_set<uint32_t> invalid_expressions;
+	IdSet invalid_expressions;
 
 	void update_name_cache(std::unordered_set<std::string> &cache, std::string &name);
 
@@ -491,8 +502,24 @@ protected:
 	void analyze_variable_scope(SPIRFunction &function);
 
 protected:
+	enum ParseFlagBits
+	{
+		// Read the words in place rather than copying them.
+		ParseBorrowWords = 1 << 0,
+		// Skip function bodies, leaving only the declarations reflection needs.
+		ParseDeclarationsOnly = 1 << 1
+	};
+	Compiler(std::vector<uint32_t> ir, uint32_t parse_flags);
+	Compiler(const uint32_t *ir, size_t word_count, uint32_t parse_flags);
+	bool declarations_only = false;
+
+	// For ParseDeclarationsOnly, the word offset of the first instruction
+	// after each OpFunction, so skipped bodies can still be walked.
+	std::unordered_map<uint32_t, uint32_t> function_offsets;
+
 	void parse();
 	void parse(const Instruction &i);
+	void copy_parsed_state(const Compiler &parsed);
 
 	// Used internally to implement various traversals for queries.
 	struct OpcodeHandler
@@ -590,6 +617,13 @@ protected:
 
 	bool traverse_all_reachable_opcodes(const SPIRBlock &block, OpcodeHandler &handler) const;
 	bool traverse_all_reachable_opcodes(const SPIRFunction &block, OpcodeHandler &handler) const;
+
+	// Walks the raw words of a function body skipped by ParseDeclarationsOnly.
+	// Calls are always followed, so follow_function_call() and
+	// set_current_block() are not invoked.
+	bool traverse_all_reachable_opcodes(uint32_t func, OpcodeHandler &handler,
+	                                    std::unordered_set<uint32_t> &visited) const;
+	bool traverse_entry_point_opcodes(OpcodeHandler &handler) const;
 	// This must be an ordered data structure so we always pick the same type aliases.
 	std::vector<uint32_t> global_struct_cache;
 
@@ -610,7 +644,65 @@ protected:
 
 	void analyze_parameter_preservation(
 	    SPIRFunction &entry, const CFG &cfg,
-	    const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &variable_to_blocks);
+	    const IdMap<std::vector<uint32_t>> &variable_to_blocks);
+
+	friend class ParsedIR;
+};
+
+// Reflection without code generation, for loaders which only need to query
+// resources and decorations. Types, constants, variables, decorations, names
+// and entry points are parsed as usual, but function bodies are skipped.
+// get_active_interface_variables() and get_active_buffer_ranges() walk the
+// skipped bodies straight from the words instead.
+class CompilerReflection : public Compiler
+{
+public:
+	CompilerReflection(std::vector<uint32_t> ir)
+	    : Compiler(move(ir), ParseDeclarationsOnly)
+	{
+	}
+
+	CompilerReflection(const uint32_t *ir, size_t word_count)
+	    : Compiler(ir, word_count, ParseDeclarationsOnly)
+	{
+	}
+
+	std::string compile() override
+	{
+		SPIRV_CROSS_THROW("CompilerReflection cannot generate code.");
+	}
+};
+
+// A parsed SPIR-V module. It is never modified after parse() returns, so one
+// instance can back any number of compilers, including compilers running on
+// different threads, each of which only owns its own emission state.
+class ParsedIR
+{
+public:
+	// Parses words owned by the caller without copying them. They must stay
+	// alive and unchanged for as long as the module or any compiler built from
+	// it. Big-endian input is the exception and is swapped into a private copy.
+	static std::shared_ptr<const ParsedIR> parse(const uint32_t *ir, size_t word_count);
+
+	// Parses words that the module takes ownership of.
+	static std::shared_ptr<const ParsedIR> parse(std::vector<uint32_t> ir);
+
+private:
+	friend class Compiler;
+
+	explicit ParsedIR(std::vector<uint32_t> ir)
+	    : parsed(std::move(ir))
+	{
+	}
+
+	ParsedIR(const uint32_t *ir, size_t word_count)
+	    : parsed(ir, word_count, Compiler::ParseBorrowWords)
+	{
+	}
+
+	// The base class does no code generation, so a plain Compiler is exactly
+	// the parsed module plus its reflection state.
+	Compiler parsed;
 };
 }
 
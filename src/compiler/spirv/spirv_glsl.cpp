@@ -175,6 +175,9 @@ void CompilerGLSL::reset()
 	// but just in case the SPIR-V is rather weird, recompile until it's happy.
 	// This typically only means one extra pass.
 	force_recompile = false;
+	recompile_all = false;
+	dirty_functions.clear();
+	function_ranges.clear();
 
 	// Clear invalid expression tracking.
 	invalid_expressions.clear();
@@ -302,6 +305,358 @@ void CompilerGLSL::find_static_extensions()
 		require_extension("GL_EXT_shader_pixel_local_storage");
 }
 
+// Minified output is produced from the final text. The emitter decides where to
+// enclose expressions by looking for spaces and parentheses in the strings it
+// builds, so whitespace and redundant parentheses can only go once it is done.
+struct MinifyToken
+{
+	enum Kind
+	{
+		Word,
+		Number,
+		Punctuator,
+		Directive
+	};
+
+	MinifyToken(Kind kind_, string text_)
+	    : kind(kind_)
+	    , text(move(text_))
+	{
+	}
+
+	Kind kind;
+	string text;
+
+	// How loosely the token binds when used as an operator, 0 for everything else.
+	uint32_t precedence = 0;
+
+	// True for tokens after which an operand ends, e.g. names, literals and closing brackets.
+	bool ends_operand = false;
+	bool removed = false;
+};
+
+static const uint32_t PrecedencePostfix = 1;
+static const uint32_t PrecedenceUnary = 2;
+static const uint32_t PrecedenceTernary = 14;
+static const uint32_t PrecedenceAssignment = 15;
+static const uint32_t PrecedenceComma = 16;
+static const uint32_t PrecedenceStatement = 17;
+
+static uint32_t binary_operator_precedence(const string &op)
+{
+	// clang-format off
+	static const unordered_map<string, uint32_t> precedence = {
+		{ "*", 3 }, { "/", 3 }, { "%", 3 }, { "+", 4 }, { "-", 4 }, { "<<", 5 }, { ">>", 5 },
+		{ "<", 6 }, { ">", 6 }, { "<=", 6 }, { ">=", 6 }, { "==", 7 }, { "!=", 7 }, { "&", 8 },
+		{ "^", 9 }, { "|", 10 }, { "&&", 11 }, { "^^", 12 }, { "||", 13 }, { "?", PrecedenceTernary },
+		{ ":", PrecedenceTernary }, { "=", PrecedenceAssignment }, { "+=", PrecedenceAssignment },
+		{ "-=", PrecedenceAssignment }, { "*=", PrecedenceAssignment }, { "/=", PrecedenceAssignment },
+		{ "%=", PrecedenceAssignment }, { "<<=", PrecedenceAssignment }, { ">>=", PrecedenceAssignment },
+		{ "&=", PrecedenceAssignment }, { "^=", PrecedenceAssignment }, { "|=", PrecedenceAssignment },
+		{ ",", PrecedenceComma }, { ";", PrecedenceStatement }
+	};
+	// clang-format on
+
+	auto itr = precedence.find(op);
+	return itr != end(precedence) ? itr->second : 0;
+}
+
+// Keywords which may directly precede an expression, so a parenthesis after them
+// is a grouping rather than a call or a control statement.
+static bool is_expression_keyword(const string &word)
+{
+	return word == "return" || word == "case" || word == "else" || word == "do";
+}
+
+static bool is_control_keyword(const string &word)
+{
+	return word == "if" || word == "for" || word == "while" || word == "switch";
+}
+
+static vector<MinifyToken> tokenize_glsl(const string &source)
+{
+	static const char *const punctuators[] = { "<<=", ">>=", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&",
+		                                       "||",  "^^",  "+=", "-=", "*=", "/=", "%=", "&=", "^=", "|=" };
+
+	vector<MinifyToken> tokens;
+	bool line_start = true;
+	size_t i = 0;
+	while (i < source.size())
+	{
+		char c = source[i];
+		if (c == '\n')
+		{
+			line_start = true;
+			i++;
+		}
+		else if (isspace(c))
+			i++;
+		else if (c == '#' && line_start)
+		{
+			size_t line_end = source.find('\n', i);
+			if (line_end == string::npos)
+				line_end = source.size();
+			size_t text_end = line_end;
+			while (text_end > i && isspace(source[text_end - 1]))
+				text_end--;
+			tokens.push_back({ MinifyToken::Directive, source.substr(i, text_end - i) });
+			i = line_end;
+		}
+		else if (c == '/' && i + 1 < source.size() && source[i + 1] == '/')
+		{
+			i = source.find('\n', i);
+			if (i == string::npos)
+				i = source.size();
+		}
+		else if (c == '/' && i + 1 < source.size() && source[i + 1] == '*')
+		{
+			i = source.find("*/", i + 2);
+			i = i == string::npos ? source.size() : i + 2;
+		}
+		else if (isalpha(c) || c == '_')
+		{
+			size_t begin = i;
+			while (i < source.size() && (isalnum(source[i]) || source[i] == '_'))
+				i++;
+			line_start = false;
+			tokens.push_back({ MinifyToken::Word, source.substr(begin, i - begin) });
+		}
+		else if (isdigit(c) || (c == '.' && i + 1 < source.size() && isdigit(source[i + 1])))
+		{
+			size_t begin = i;
+			bool hex = c == '0' && i + 1 < source.size() && (source[i + 1] == 'x' || source[i + 1] == 'X');
+			while (i < source.size())
+			{
+				char n = source[i];
+				if (isalnum(n) || n == '.' || n == '_')
+					i++;
+				else if ((n == '+' || n == '-') && !hex && (source[i - 1] == 'e' || source[i - 1] == 'E'))
+					i++;
+				else
+					break;
+			}
+			line_start = false;
+			tokens.push_back({ MinifyToken::Number, source.substr(begin, i - begin) });
+		}
+		else
+		{
+			size_t length = 1;
+			for (auto *p : punctuators)
+			{
+				size_t n = strlen(p);
+				if (source.compare(i, n, p) == 0)
+				{
+					length = n;
+					break;
+				}
+			}
+			line_start = false;
+			tokens.push_back({ MinifyToken::Punctuator, source.substr(i, length) });
+			i += length;
+		}
+	}
+
+	// Classify operators. Whether an operator is unary or binary only depends on whether
+	// an operand ended right before it, which dropping redundant parentheses never changes.
+	vector<bool> control_paren;
+	const MinifyToken *prev = nullptr;
+	for (auto &token : tokens)
+	{
+		bool after_operand = prev && prev->ends_operand;
+		if (token.kind == MinifyToken::Word)
+			token.ends_operand = !is_expression_keyword(token.text);
+		else if (token.kind == MinifyToken::Number)
+			token.ends_operand = true;
+		else if (token.kind == MinifyToken::Punctuator)
+		{
+			auto &t = token.text;
+			if (t == "(")
+				control_paren.push_back(prev && prev->kind == MinifyToken::Word && is_control_keyword(prev->text));
+			else if (t == ")")
+			{
+				// The statement after if (...) does not continue an expression.
+				token.ends_operand = control_paren.empty() || !control_paren.back();
+				if (!control_paren.empty())
+					control_paren.pop_back();
+			}
+			else if (t == "]")
+				token.ends_operand = true;
+			else if (t == "." || t == "[")
+				token.precedence = PrecedencePostfix;
+			else if (t == "++" || t == "--")
+			{
+				token.precedence = after_operand ? PrecedencePostfix : PrecedenceUnary;
+				token.ends_operand = after_operand;
+			}
+			else if (!after_operand && (t == "-" || t == "+" || t == "!" || t == "~"))
+				token.precedence = PrecedenceUnary;
+			else
+				token.precedence = binary_operator_precedence(t);
+		}
+		prev = &token;
+	}
+
+	return tokens;
+}
+
+static bool token_is(const MinifyToken *token, const char *text)
+{
+	return token && token->kind == MinifyToken::Punctuator && token->text == text;
+}
+
+// Returns true if the parentheses at tokens[open] and tokens[close] can be dropped
+// without changing how the expression parses.
+static bool parentheses_are_redundant(const vector<MinifyToken> &tokens, size_t open, size_t close)
+{
+	const MinifyToken *prev = nullptr;
+	for (size_t i = open; i-- > 0;)
+	{
+		if (!tokens[i].removed)
+		{
+			prev = &tokens[i];
+			break;
+		}
+	}
+	const MinifyToken *next = close + 1 < tokens.size() ? &tokens[close + 1] : nullptr;
+
+	// Calls, constructors and control statements keep their parentheses.
+	if (!prev || prev->kind == MinifyToken::Directive || !next || next->kind == MinifyToken::Directive)
+		return false;
+	if (prev->kind == MinifyToken::Number || token_is(prev, ")") || token_is(prev, "]"))
+		return false;
+	if (prev->kind == MinifyToken::Word && !is_expression_keyword(prev->text))
+		return false;
+
+	// Find the loosest binding operator at the top level inside the parentheses.
+	uint32_t inner = 0;
+	uint32_t depth = 0;
+	const MinifyToken *last = nullptr;
+	for (size_t i = open + 1; i < close; i++)
+	{
+		auto &token = tokens[i];
+		if (token.removed)
+			continue;
+		last = &token;
+
+		if (token_is(&token, "(") || token_is(&token, "["))
+		{
+			if (depth == 0 && token.precedence)
+				inner = max(inner, token.precedence);
+			depth++;
+		}
+		else if (token_is(&token, ")") || token_is(&token, "]"))
+			depth--;
+		else if (depth == 0)
+			inner = max(inner, token.precedence);
+	}
+
+	// The inner expression must bind tighter than the operator to its left ...
+	uint32_t left_limit;
+	if (prev->kind == MinifyToken::Word || token_is(prev, "(") || token_is(prev, "[") || token_is(prev, ",") ||
+	    token_is(prev, ";") || token_is(prev, "{") || token_is(prev, "}") || token_is(prev, "?"))
+		left_limit = PrecedenceComma;
+	else if (token_is(prev, ":"))
+		left_limit = PrecedenceAssignment;
+	else if (prev->precedence == PrecedenceUnary)
+		left_limit = PrecedenceUnary + 1;
+	else if (prev->precedence == PrecedenceAssignment)
+		left_limit = PrecedenceComma;
+	else if (prev->precedence)
+		left_limit = prev->precedence;
+	else
+		return false;
+
+	// ... and at least as tight as the one to its right, since GLSL binary operators
+	// are left associative.
+	uint32_t right_limit;
+	if (token_is(next, ")") || token_is(next, "]") || token_is(next, ",") || token_is(next, ";") ||
+	    token_is(next, "}") || token_is(next, ":"))
+		right_limit = PrecedenceAssignment;
+	else if (token_is(next, "?"))
+		right_limit = PrecedenceTernary - 1;
+	else if (next->precedence == PrecedenceAssignment || next->precedence == PrecedencePostfix)
+		right_limit = PrecedencePostfix;
+	else if (next->precedence && next->precedence != PrecedenceUnary)
+		right_limit = next->precedence;
+	else
+		return false;
+
+	// 1.0.x would not lex as a member access.
+	if (token_is(next, ".") && last && last->kind == MinifyToken::Number)
+		return false;
+
+	return inner < left_limit && inner <= right_limit;
+}
+
+// Two adjacent operators need a space if they would otherwise lex as a different token.
+static bool punctuators_need_space(const string &a, const string &b)
+{
+	static const char *const pairs[] = { "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "^^",
+		                                 "+=", "-=", "*=", "/=", "%=", "&=", "^=", "|=", "//", "/*" };
+	char joined[3] = { a.back(), b.front(), '\0' };
+	for (auto *p : pairs)
+		if (strcmp(joined, p) == 0)
+			return true;
+	return false;
+}
+
+static string minify_glsl_source(const string &source)
+{
+	auto tokens = tokenize_glsl(source);
+
+	// Parentheses are resolved inside out so every decision sees the parentheses
+	// which are left around the operators inside it.
+	vector<size_t> open_parens;
+	for (size_t i = 0; i < tokens.size(); i++)
+	{
+		if (token_is(&tokens[i], "("))
+			open_parens.push_back(i);
+		else if (token_is(&tokens[i], ")") && !open_parens.empty())
+		{
+			size_t open = open_parens.back();
+			open_parens.pop_back();
+			if (parentheses_are_redundant(tokens, open, i))
+				tokens[open].removed = tokens[i].removed = true;
+		}
+	}
+
+	string result;
+	result.reserve(source.size());
+	const MinifyToken *prev = nullptr;
+	for (auto &token : tokens)
+	{
+		if (token.removed)
+			continue;
+
+		if (token.kind == MinifyToken::Directive)
+		{
+			if (!result.empty() && result.back() != '\n')
+				result += '\n';
+			result += token.text;
+			result += '\n';
+			prev = nullptr;
+			continue;
+		}
+
+		if (prev)
+		{
+			bool prev_word = prev->kind == MinifyToken::Word || prev->kind == MinifyToken::Number;
+			bool word = token.kind == MinifyToken::Word || token.kind == MinifyToken::Number;
+			if ((prev_word && word) || (prev->kind == MinifyToken::Punctuator &&
+			                            token.kind == MinifyToken::Punctuator &&
+			                            punctuators_need_space(prev->text, token.text)))
+				result += ' ';
+		}
+
+		result += token.text;
+		prev = &token;
+	}
+
+	if (!result.empty() && result.back() != '\n')
+		result += '\n';
+	return result;
+}
+
 string CompilerGLSL::compile()
 {
 	// Force a classic "C" locale, reverts when function returns
@@ -312,7 +667,13 @@ string CompilerGLSL::compile()
 	fixup_image_load_store_access();
 	update_active_builtins();
 
+	unused_declarations.clear();
+	if (options.minify)
+		prepare_minified_output();
+
 	uint32_t pass_count = 0;
+	bool full_pass = true;
+	function_text.clear();
 	do
 	{
 		if (pass_count >= 3)
@@ -320,23 +681,84 @@ string CompilerGLSL::compile()
 
 		reset();
 
-		// Move constructor for this type is broken on GCC 4.9 ...
-		buffer = unique_ptr<ostringstream>(new ostringstream());
+		buffer.reset();
+
+		if (full_pass)
+		{
+			function_text.clear();
+
+			emit_header();
+			emit_resources();
 
-		emit_header();
-		emit_resources();
+			// Anything requested this early may change the preamble.
+			if (force_recompile)
+				recompile_all = true;
+
+			preamble_size = buffer.size();
+			preamble_resource_names = resource_names;
+		}
+		else
+		{
+			buffer << preamble_text;
+			resource_names = preamble_resource_names;
+		}
 
 		emit_function(get<SPIRFunction>(entry_point), 0);
 
 		pass_count++;
+
+		full_pass = recompile_all;
+		if (force_recompile && !full_pass)
+			prepare_incremental_recompile();
 	} while (force_recompile);
 
-	return buffer->str();
+	function_text.clear();
+	preamble_text.clear();
+
+	if (options.minify)
+		return minify_glsl_source(buffer.str());
+	return buffer.str();
+}
+
+void CompilerGLSL::prepare_incremental_recompile()
+{
+	auto text = buffer.str();
+	preamble_text = text.substr(0, preamble_size);
+
+	// Callers pick qualifiers and out-argument handling from the callee's
+	// parameters, so they have to be emitted again along with it.
+	unordered_set<uint32_t> recompile = dirty_functions;
+	for (auto &range : function_ranges)
+	{
+		if (recompile.count(range.id))
+			continue;
+
+		auto &func = get<SPIRFunction>(range.id);
+		for (auto block : func.blocks)
+		{
+			for (auto &i : get<SPIRBlock>(block).ops)
+			{
+				if (static_cast<Op>(i.op) == OpFunctionCall && dirty_functions.count(stream(i)[2]))
+				{
+					recompile.insert(range.id);
+					break;
+				}
+			}
+		}
+	}
+
+	for (auto &range : function_ranges)
+	{
+		if (recompile.count(range.id))
+			function_text.erase(range.id);
+		else
+			function_text[range.id] = text.substr(range.begin, range.end - range.begin);
+	}
 }
 
 std::string CompilerGLSL::get_partial_source()
 {
-	return buffer->str();
+	return buffer.str();
 }
 
 void CompilerGLSL::emit_header()
@@ -1319,7 +1741,8 @@ void CompilerGLSL::emit_specialization_constant(const SPIRConstant &constant)
 	          variable_decl(type, name), " = ", constant_expression(constant), ";");
 }
 
-void CompilerGLSL::replace_illegal_names()
+// Identifiers which are reserved in GLSL and cannot be used as names.
+static const unordered_set<string> &glsl_keywords()
 {
 	// clang-format off
 	static const unordered_set<string> keywords = {
@@ -1347,6 +1770,12 @@ void CompilerGLSL::replace_illegal_names()
 		"while", "writeonly"
 	};
 	// clang-format on
+	return keywords;
+}
+
+void CompilerGLSL::replace_illegal_names()
+{
+	auto &keywords = glsl_keywords();
 
 	for (auto &id : ids)
 	{
@@ -1363,6 +1792,219 @@ void CompilerGLSL::replace_illegal_names()
 	}
 }
 
+bool CompilerGLSL::IdReferenceHandler::handle(Op, const uint32_t *args, uint32_t length)
+{
+	// Literal operands are counted too, which at worst keeps a declaration
+	// or gives a name a longer spelling than it needed.
+	for (uint32_t i = 0; i < length; i++)
+		add_reference(args[i]);
+	return true;
+}
+
+bool CompilerGLSL::IdReferenceHandler::follow_function_call(const SPIRFunction &func)
+{
+	// Functions are emitted once no matter how often they are called.
+	if (functions.count(func.self))
+		return false;
+	functions.insert(func.self);
+	return true;
+}
+
+void CompilerGLSL::IdReferenceHandler::set_current_block(const SPIRBlock &block)
+{
+	add_reference(block.condition);
+	add_reference(block.return_value);
+}
+
+void CompilerGLSL::IdReferenceHandler::add_reference(uint32_t id)
+{
+	if (id != 0 && id < compiler.ids.size())
+		counts[id]++;
+}
+
+void CompilerGLSL::prepare_minified_output()
+{
+	IdMap<uint32_t> counts;
+	IdReferenceHandler handler(*this, counts);
+	handler.functions.insert(entry_point);
+	traverse_entry_point_opcodes(handler);
+
+	// Private and workgroup variables which no reachable code refers to are not declared.
+	for (auto global : global_variables)
+		if (get<SPIRVariable>(global).storage != StorageClassOutput && !counts.count(global))
+			unused_declarations.insert(global);
+
+	// Neither are struct types which nothing left in the shader refers to.
+	vector<uint32_t> pending;
+	for (uint32_t id = 0; id < ids.size(); id++)
+	{
+		switch (ids[id].get_type())
+		{
+		case TypeType:
+			if (counts.count(id))
+				pending.push_back(id);
+			break;
+
+		case TypeVariable:
+			if (!unused_declarations.count(id))
+				pending.push_back(get<SPIRVariable>(id).basetype);
+			break;
+
+		case TypeConstant:
+			pending.push_back(get<SPIRConstant>(id).constant_type);
+			break;
+
+		case TypeFunction:
+			if (handler.functions.count(id))
+			{
+				auto &func = get<SPIRFunction>(id);
+				pending.push_back(func.return_type);
+				for (auto &arg : func.arguments)
+					pending.push_back(arg.type);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	IdBitset used_types;
+	while (!pending.empty())
+	{
+		auto &type = get<SPIRType>(pending.back());
+		pending.pop_back();
+
+		if (type.type_alias)
+			pending.push_back(type.type_alias);
+		if (type.basetype != SPIRType::Struct || used_types.count(type.self))
+			continue;
+
+		used_types.insert(type.self);
+		for (auto member : type.member_types)
+			pending.push_back(member);
+	}
+
+	for (auto &id : ids)
+	{
+		if (id.get_type() == TypeType)
+		{
+			auto &type = id.get<SPIRType>();
+			if (type.basetype == SPIRType::Struct && !used_types.count(type.self))
+				unused_declarations.insert(type.self);
+		}
+	}
+
+	shorten_identifiers(counts);
+}
+
+// Returns the index-th name of the sequence a, b, ..., Z, aa, ba, ...
+static string minified_name(uint32_t index)
+{
+	static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+	string name(1, alphabet[index % 52]);
+	index /= 52;
+	while (index)
+	{
+		index--;
+		name += alphabet[index % 62];
+		index /= 62;
+	}
+	return name;
+}
+
+void CompilerGLSL::shorten_identifiers(const IdMap<uint32_t> &reference_counts)
+{
+	// Built-in functions and keywords which the generated names must not shadow.
+	// clang-format off
+	static const unordered_set<string> builtins = {
+		"abs", "acos", "acosh", "all", "any", "asin", "asinh", "atan", "atanh", "buffer", "ceil", "clamp", "cos",
+		"cosh", "cross", "dFdx", "dFdy", "degrees", "distance", "dot", "equal", "exp", "exp2", "floor", "fma",
+		"fract", "frexp", "fwidth", "isinf", "isnan", "ldexp", "length", "log", "log2", "main", "max", "min",
+		"mix", "mod", "modf", "not", "pow", "precise", "round", "shared", "sign", "sin", "sinh", "sqrt", "step",
+		"tan", "tanh", "texture", "trunc"
+	};
+	// clang-format on
+
+	auto &keywords = glsl_keywords();
+
+	vector<uint32_t> renamed;
+	unordered_set<string> kept_names;
+	for (uint32_t id = 0; id < ids.size(); id++)
+	{
+		bool rename = false;
+		switch (ids[id].get_type())
+		{
+		case TypeVariable:
+		{
+			auto &var = get<SPIRVariable>(id);
+			auto &type = get<SPIRType>(var.basetype);
+			if (is_builtin_variable(var) || var.remapped_variable)
+				break;
+
+			// Legacy targets and flattened blocks turn the instance name of a uniform block
+			// into the name the API sees.
+			bool block = (meta[type.self].decoration.decoration_flags &
+			              ((1ull << DecorationBlock) | (1ull << DecorationBufferBlock))) != 0;
+			if (var.storage == StorageClassFunction || var.storage == StorageClassPrivate ||
+			    var.storage == StorageClassWorkgroup)
+				rename = true;
+			else if (var.storage == StorageClassUniform && block && !is_legacy() &&
+			         !flattened_buffer_blocks.count(id))
+				rename = true;
+			break;
+		}
+
+		case TypeFunction:
+			rename = id != entry_point;
+			break;
+
+		case TypeConstant:
+			rename = !get<SPIRConstant>(id).specialization && reference_counts.count(id);
+			break;
+
+		case TypeNone:
+		case TypeUndef:
+			rename = reference_counts.count(id) != 0;
+			break;
+
+		default:
+			break;
+		}
+
+		if (rename)
+			renamed.push_back(id);
+		else if (!meta[id].decoration.alias.empty())
+			kept_names.insert(meta[id].decoration.alias);
+
+		for (auto &member : meta[id].members)
+			if (!member.alias.empty())
+				kept_names.insert(member.alias);
+	}
+
+	// The most referenced ids get the shortest names. A result which is only read
+	// once is forwarded into its user, so its name is most likely never printed.
+	auto references = [&](uint32_t id) -> uint32_t {
+		auto *count = reference_counts.find(id);
+		if (!count || (*count < 2 && ids[id].get_type() != TypeVariable))
+			return 0;
+		return *count;
+	};
+	stable_sort(begin(renamed), end(renamed),
+	            [&](uint32_t a, uint32_t b) { return references(a) > references(b); });
+
+	uint32_t index = 0;
+	for (auto id : renamed)
+	{
+		string name;
+		do
+			name = minified_name(index++);
+		while (kept_names.count(name) || keywords.count(name) || builtins.count(name));
+		set_name(id, name);
+	}
+}
+
 void CompilerGLSL::replace_fragment_output(SPIRVariable &var)
 {
 	auto &m = meta[var.self].decoration;
@@ -1546,7 +2188,8 @@ void CompilerGLSL::emit_resources()
 			auto &type = id.get<SPIRType>();
 			if (type.basetype == SPIRType::Struct && type.array.empty() && !type.pointer &&
 			    (meta[type.self].decoration.decoration_flags &
-			     ((1ull << DecorationBlock) | (1ull << DecorationBufferBlock))) == 0)
+			     ((1ull << DecorationBlock) | (1ull << DecorationBufferBlock))) == 0 &&
+			    !unused_declarations.count(type.self))
 			{
 				emit_struct(type);
 			}
@@ -1657,7 +2300,7 @@ void CompilerGLSL::emit_resources()
 	for (auto global : global_variables)
 	{
 		auto &var = get<SPIRVariable>(global);
-		if (var.storage != StorageClassOutput)
+		if (var.storage != StorageClassOutput && !unused_declarations.count(global))
 		{
 			add_resource_name(var.self);
 			statement(variable_decl(var), ";");
@@ -1761,8 +2404,7 @@ string CompilerGLSL::to_enclosed_expression(uint32_t id)
 
 string CompilerGLSL::to_expression(uint32_t id)
 {
-	auto itr = invalid_expressions.find(id);
-	if (itr != end(invalid_expressions))
+	if (invalid_expressions.count(id))
 		handle_invalid_expression(id);
 
 	if (ids[id].get_type() == TypeExpression)
@@ -1780,7 +2422,7 @@ string CompilerGLSL::to_expression(uint32_t id)
 		// and see that we should not forward reads of the original variable.
 		auto &expr = get<SPIRExpression>(id);
 		for (uint32_t dep : expr.expression_dependencies)
-			if (invalid_expressions.find(dep) != end(invalid_expressions))
+			if (invalid_expressions.count(dep))
 				handle_invalid_expression(dep);
 	}
 
@@ -2058,7 +2700,7 @@ string CompilerGLSL::constant_expression_vector(const SPIRConstant &c, uint32_t
 	case SPIRType::Float:
 		if (splat)
 		{
-			res += convert_to_string(c.scalar_f32(vector, 0));
+			res += convert_to_string(type.width == 16 ? c.scalar_f16(vector, 0) : c.scalar_f32(vector, 0));
 			if (backend.float_literal_suffix)
 				res += "f";
 		}
@@ -2066,7 +2708,7 @@ string CompilerGLSL::constant_expression_vector(const SPIRConstant &c, uint32_t
 		{
 			for (uint32_t i = 0; i < c.vector_size(); i++)
 			{
-				res += convert_to_string(c.scalar_f32(vector, i));
+				res += convert_to_string(type.width == 16 ? c.scalar_f16(vector, i) : c.scalar_f32(vector, i));
 				if (backend.float_literal_suffix)
 					res += "f";
 				if (i + 1 < c.vector_size())
@@ -2722,7 +3364,7 @@ void CompilerGLSL::emit_texture_op(const Instruction &i)
 	auto op = static_cast<Op>(i.op);
 	uint32_t length = i.length;
 
-	if (i.offset + length > spirv.size())
+	if (i.offset + length > spirv_word_count)
 		SPIRV_CROSS_THROW("Compiler::parse() opcode out of range.");
 
 	uint32_t result_type = ops[0];
@@ -3505,6 +4147,8 @@ string CompilerGLSL::access_chain_internal(uint32_t base, const uint32_t *indice
 				expr += ".";
 				expr += index_to_swizzle(index);
 			}
+			else if (ids[index].get_type() == TypeConstant && backend.vector_component_subscript)
+				expr += join("[", get<SPIRConstant>(index).scalar(), "]");
 			else if (ids[index].get_type() == TypeConstant)
 			{
 				auto &c = get<SPIRConstant>(index);
@@ -4244,7 +4888,7 @@ void CompilerGLSL::emit_instruction(const Instruction &instruction)
 		else if (is_non_native_row_major_matrix(ptr))
 			need_transpose = true;
 
-		auto expr = to_expression(ptr);
+		auto expr = to_load_expression(result_type, ptr);
 
 		if (ptr_expression)
 			ptr_expression->need_transpose = old_need_transpose;
@@ -5366,7 +6010,7 @@ void CompilerGLSL::emit_instruction(const Instruction &instruction)
 			if (flags & (1ull << DecorationNonReadable))
 			{
 				flags &= ~(1ull << DecorationNonReadable);
-				force_recompile = true;
+				force_full_recompile();
 			}
 		}
 
@@ -5499,7 +6143,7 @@ void CompilerGLSL::emit_instruction(const Instruction &instruction)
 			if (flags & (1ull << DecorationNonWritable))
 			{
 				flags &= ~(1ull << DecorationNonWritable);
-				force_recompile = true;
+				force_full_recompile();
 			}
 		}
 
@@ -6134,7 +6778,7 @@ void CompilerGLSL::require_extension(const string &ext)
 	if (forced_extensions.find(ext) == end(forced_extensions))
 	{
 		forced_extensions.insert(ext);
-		force_recompile = true;
+		force_full_recompile();
 	}
 }
 
@@ -6173,7 +6817,7 @@ bool CompilerGLSL::check_atomic_image(uint32_t id)
 			{
 				flags &= ~(1ull << DecorationNonWritable);
 				flags &= ~(1ull << DecorationNonReadable);
-				force_recompile = true;
+				force_full_recompile();
 			}
 		}
 		return true;
@@ -6271,11 +6915,27 @@ void CompilerGLSL::emit_function(SPIRFunction &func, uint64_t return_flags)
 		}
 	}
 
+	// Reuse the text from the previous pass if nothing it depends on changed.
+	auto text_itr = function_text.find(func.self);
+	if (text_itr != end(function_text))
+	{
+		size_t text_begin = buffer.size();
+		buffer << text_itr->second;
+		function_ranges.push_back({ func.self, text_begin, buffer.size() });
+		return;
+	}
+
+	// Find out whether this function asks for another pass.
+	size_t text_begin = buffer.size();
+	bool recompile_requested = force_recompile;
+	force_recompile = false;
+
 	emit_function_prototype(func, return_flags);
 	begin_scope();
 
 	current_function = &func;
 	auto &entry_block = get<SPIRBlock>(func.entry_block);
+	emit_function_prologue(func);
 
 	if (!func.analyzed_variable_scope)
 	{
@@ -6354,9 +7014,15 @@ void CompilerGLSL::emit_function(SPIRFunction &func, uint64_t return_flags)
 	entry_block.loop_dominator = SPIRBlock::NoDominator;
 	emit_block_chain(entry_block);
 
+	emit_function_epilogue(func);
 	end_scope();
 	processing_entry_point = false;
 	statement("");
+
+	if (force_recompile)
+		dirty_functions.insert(func.self);
+	force_recompile = force_recompile || recompile_requested;
+	function_ranges.push_back({ func.self, text_begin, buffer.size() });
 }
 
 void CompilerGLSL::emit_fixup()
@@ -6393,12 +7059,12 @@ void CompilerGLSL::branch(uint32_t from, uint32_t to)
 	flush_all_active_variables();
 
 	// This is only a continue if we branch to our loop dominator.
-	if (loop_blocks.find(to) != end(loop_blocks) && get<SPIRBlock>(from).loop_dominator == to)
+	if (loop_blocks.count(to) && get<SPIRBlock>(from).loop_dominator == to)
 	{
 		// This can happen if we had a complex continue block which was emitted.
 		// Once the continue block tries to branch to the loop header, just emit continue;
 		// and end the chain here.
-		statement("continue;");
+		emit_continue();
 	}
 	else if (is_continue(to))
 	{
@@ -6433,11 +7099,11 @@ void CompilerGLSL::branch(uint32_t from, uint32_t to)
 			// we can avoid writing out an explicit continue statement.
 			// Similar optimization to return statements if we know we're outside flow control.
 			if (!outside_control_flow)
-				statement("continue;");
+				emit_continue();
 		}
 	}
 	else if (is_break(to))
-		statement("break;");
+		emit_break();
 	else if (!is_conditional(to))
 		emit_block_chain(get<SPIRBlock>(to));
 }
@@ -6450,44 +7116,96 @@ void CompilerGLSL::branch(uint32_t from, uint32_t cond, uint32_t true_block, uin
 
 	if (true_sub)
 	{
-		statement("if (", to_expression(cond), ")");
-		begin_scope();
+		emit_selection_begin(to_expression(cond), false);
 		branch(from, true_block);
-		end_scope();
 
 		if (false_sub)
 		{
-			statement("else");
-			begin_scope();
+			emit_selection_else();
 			branch(from, false_block);
-			end_scope();
 		}
 		else if (flush_phi_required(from, false_block))
 		{
-			statement("else");
-			begin_scope();
+			emit_selection_else();
 			flush_phi(from, false_block);
-			end_scope();
 		}
+		emit_selection_end();
 	}
 	else if (false_sub && !true_sub)
 	{
 		// Only need false path, use negative conditional.
-		statement("if (!", to_expression(cond), ")");
-		begin_scope();
+		emit_selection_begin(to_expression(cond), true);
 		branch(from, false_block);
-		end_scope();
 
 		if (flush_phi_required(from, true_block))
 		{
-			statement("else");
-			begin_scope();
+			emit_selection_else();
 			flush_phi(from, true_block);
-			end_scope();
 		}
+		emit_selection_end();
 	}
 }
 
+void CompilerGLSL::emit_selection_begin(const string &condition, bool negate)
+{
+	statement("if (", negate ? "!" : "", condition, ")");
+	begin_scope();
+}
+
+void CompilerGLSL::emit_selection_else()
+{
+	end_scope();
+	statement("else");
+	begin_scope();
+}
+
+void CompilerGLSL::emit_selection_end()
+{
+	end_scope();
+}
+
+void CompilerGLSL::emit_loop_begin()
+{
+	statement("for (;;)");
+	begin_scope();
+}
+
+void CompilerGLSL::emit_loop_end()
+{
+	end_scope();
+}
+
+void CompilerGLSL::emit_break()
+{
+	statement("break;");
+}
+
+void CompilerGLSL::emit_continue()
+{
+	statement("continue;");
+}
+
+void CompilerGLSL::emit_return(const string &value)
+{
+	if (value.empty())
+		statement("return;");
+	else
+		statement("return ", value, ";");
+}
+
+void CompilerGLSL::emit_function_prologue(SPIRFunction &)
+{
+}
+
+void CompilerGLSL::emit_function_epilogue(SPIRFunction &)
+{
+}
+
+string CompilerGLSL::to_load_expression(uint32_t, uint32_t ptr)
+{
+	return to_expression(ptr);
+}
+
 void CompilerGLSL::propagate_loop_dominators(const SPIRBlock &block)
 {
 	// Propagate down the loop dominator block, so that dominated blocks can back trace.
@@ -6542,7 +7260,7 @@ string CompilerGLSL::emit_continue_block(uint32_t continue_block)
 	redirect_statement = &statements;
 
 	// Stamp out all blocks one after each other.
-	while (loop_blocks.find(block->self) == end(loop_blocks))
+	while (!loop_blocks.count(block->self))
 	{
 		propagate_loop_dominators(*block);
 		// Write out all instructions we have in this block.
@@ -6752,7 +7470,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 		get<SPIRVariable>(var).loop_variable_enable = true;
 
 	// This is the older loop behavior in glslang which branches to loop body directly from the loop header.
-	if (block_is_loop_candidate(block, SPIRBlock::MergeToSelectForLoop))
+	if (!backend.force_generic_loops && block_is_loop_candidate(block, SPIRBlock::MergeToSelectForLoop))
 	{
 		flush_undeclared_variables(block);
 		if (attempt_emit_loop_header(block, SPIRBlock::MergeToSelectForLoop))
@@ -6764,7 +7482,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 	}
 	// This is the newer loop behavior in glslang which branches from Loop header directly to
 	// a new block, which in turn has a OpBranchSelection without a selection merge.
-	else if (block_is_loop_candidate(block, SPIRBlock::MergeToDirectForLoop))
+	else if (!backend.force_generic_loops && block_is_loop_candidate(block, SPIRBlock::MergeToDirectForLoop))
 	{
 		flush_undeclared_variables(block);
 		if (attempt_emit_loop_header(block, SPIRBlock::MergeToDirectForLoop))
@@ -6773,7 +7491,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 			emitted_for_loop_header = true;
 		}
 	}
-	else if (continue_type == SPIRBlock::DoWhileLoop)
+	else if (!backend.force_generic_loops && continue_type == SPIRBlock::DoWhileLoop)
 	{
 		statement("do");
 		begin_scope();
@@ -6788,8 +7506,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 		get<SPIRBlock>(block.continue_block).complex_continue = true;
 		continue_type = SPIRBlock::ComplexLoop;
 
-		statement("for (;;)");
-		begin_scope();
+		emit_loop_begin();
 		for (auto &op : block.ops)
 			emit_instruction(op);
 	}
@@ -6888,7 +7605,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 		{
 			// OpReturnValue can return Undef, so don't emit anything for this case.
 			if (ids.at(block.return_value).get_type() != TypeUndef)
-				statement("return ", to_expression(block.return_value), ";");
+				emit_return(to_expression(block.return_value));
 		}
 		// If this block is the very final block and not called from control flow,
 		// we do not need an explicit return which looks out of place. Just end the function here.
@@ -6896,7 +7613,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 		// but we actually need a return here ...
 		else if (!block_is_outside_flow_control_from_block(get<SPIRBlock>(current_function->entry_block), block) ||
 		         block.loop_dominator != SPIRBlock::NoDominator)
-			statement("return;");
+			emit_return("");
 		break;
 
 	case SPIRBlock::Kill:
@@ -6933,6 +7650,8 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 
 			end_scope_decl(join("while (", to_expression(get<SPIRBlock>(block.continue_block).condition), ")"));
 		}
+		else if (continue_type == SPIRBlock::ComplexLoop)
+			emit_loop_end();
 		else
 			end_scope();
 
@@ -18,7 +18,6 @@
 #define SPIRV_CROSS_GLSL_HPP
 
 #include "spirv_cross.hpp"
-#include <sstream>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -67,6 +66,14 @@ public:
 		// Mostly useful for debugging SPIR-V files.
 		bool vulkan_semantics = false;
 
+		// If true, the output is minified to cut its size and the time drivers spend parsing it.
+		// Indentation, blank lines and redundant parentheses are stripped, unused global
+		// declarations are dropped and identifiers outside the interface are shortened.
+		// Names of stage inputs and outputs, uniforms, blocks, block members and struct types
+		// are kept. The shortened names are set on the compiler, so get_name() returns them
+		// after compile().
+		bool minify = false;
+
 		enum Precision
 		{
 			DontCare,
@@ -109,6 +116,12 @@ public:
 		init();
 	}
 
+	CompilerGLSL(std::shared_ptr<const ParsedIR> module_)
+	    : Compiler(move(module_))
+	{
+		init();
+	}
+
 	const Options &get_options() const
 	{
 		return options;
@@ -184,19 +197,33 @@ protected:
 	virtual void emit_uniform(const SPIRVariable &var);
 	virtual std::string unpack_expression_type(std::string expr_str, const SPIRType &type);
 
-	std::unique_ptr<std::ostringstream> buffer;
+	// Structured control flow. The defaults emit plain if, for (;;), break, continue and return;
+	// backends which run several invocations per thread override them to maintain execution masks.
+	virtual void emit_selection_begin(const std::string &condition, bool negate);
+	virtual void emit_selection_else();
+	virtual void emit_selection_end();
+	virtual void emit_loop_begin();
+	virtual void emit_loop_end();
+	virtual void emit_break();
+	virtual void emit_continue();
+	virtual void emit_return(const std::string &value);
+	virtual void emit_function_prologue(SPIRFunction &func);
+	virtual void emit_function_epilogue(SPIRFunction &func);
+	virtual std::string to_load_expression(uint32_t result_type, uint32_t ptr);
+
+	StringStream<> buffer;
 
 	template <typename T>
 	inline void statement_inner(T &&t)
 	{
-		(*buffer) << std::forward<T>(t);
+		buffer << std::forward<T>(t);
 		statement_count++;
 	}
 
 	template <typename T, typename... Ts>
 	inline void statement_inner(T &&t, Ts &&... ts)
 	{
-		(*buffer) << std::forward<T>(t);
+		buffer << std::forward<T>(t);
 		statement_count++;
 		statement_inner(std::forward<Ts>(ts)...);
 	}
@@ -209,10 +236,10 @@ protected:
 		else
 		{
 			for (uint32_t i = 0; i < indent; i++)
-				(*buffer) << "    ";
+				buffer << "    ";
 
 			statement_inner(std::forward<Ts>(ts)...);
-			(*buffer) << '\n';
+			buffer << '\n';
 		}
 	}
 
@@ -276,6 +303,8 @@ protected:
 		bool use_initializer_list = false;
 		bool native_row_major_matrix = true;
 		bool use_constructor_splatting = true;
+		bool force_generic_loops = false;
+		bool vector_component_subscript = false;
 	} backend;
 
 	void emit_struct(SPIRType &type);
@@ -301,7 +330,7 @@ protected:
 	void flush_undeclared_variables(SPIRBlock &block);
 
 	bool should_forward(uint32_t id);
-	void emit_mix_op(uint32_t result_type, uint32_t id, uint32_t left, uint32_t right, uint32_t lerp);
+	virtual void emit_mix_op(uint32_t result_type, uint32_t id, uint32_t left, uint32_t right, uint32_t lerp);
 	bool to_trivial_mix_op(const SPIRType &type, std::string &op, uint32_t left, uint32_t right, uint32_t lerp);
 	void emit_quaternary_func_op(uint32_t result_type, uint32_t result_id, uint32_t op0, uint32_t op1, uint32_t op2,
 	                             uint32_t op3, const char *op);
@@ -392,10 +421,8 @@ protected:
 
 	uint32_t indent = 0;
 
-	std::unordered_set<uint32_t> emitted_functions;
-
-	std::unordered_set<uint32_t> flattened_buffer_blocks;
-	std::unordered_set<uint32_t> flattened_structs;
+	IdBitset flattened_buffer_blocks;
+	IdBitset flattened_structs;
 
 	std::string load_flattened_struct(SPIRVariable &var);
 	std::string to_flattened_struct_member(const SPIRType &type, uint32_t index);
@@ -403,12 +430,37 @@ protected:
 
 	// Usage tracking. If a temporary is used more than once, use the temporary instead to
 	// avoid AST explosion when SPIRV is generated with pure SSA and doesn't write stuff to variables.
-	std::unordered_map<uint32_t, uint32_t> expression_usage_counts;
+	IdMap<uint32_t> expression_usage_counts;
 	void track_expression_read(uint32_t id);
 
 	std::unordered_set<std::string> forced_extensions;
 	std::vector<std::string> header_lines;
 
+	// Incremental recompilation. When a pass only invalidated state which is
+	// local to some functions, the next pass reuses the text it emitted for
+	// the header, the resources and all other functions.
+	struct FunctionRange
+	{
+		uint32_t id;
+		size_t begin;
+		size_t end;
+	};
+	std::vector<FunctionRange> function_ranges;
+	std::unordered_set<uint32_t> dirty_functions;
+	std::unordered_map<uint32_t, std::string> function_text;
+	std::string preamble_text;
+	size_t preamble_size = 0;
+	std::unordered_set<std::string> preamble_resource_names;
+	bool recompile_all = false;
+
+	// Requests another pass which also regenerates the header and resources.
+	void force_full_recompile()
+	{
+		force_recompile = true;
+		recompile_all = true;
+	}
+	void prepare_incremental_recompile();
+
 	uint32_t statement_count;
 
 	inline bool is_legacy() const
@@ -449,6 +501,29 @@ protected:
 
 	bool type_is_empty(const SPIRType &type);
 
+	// Minified output, see Options::minify.
+	struct IdReferenceHandler : OpcodeHandler
+	{
+		IdReferenceHandler(const CompilerGLSL &compiler_, IdMap<uint32_t> &counts_)
+		    : compiler(compiler_)
+		    , counts(counts_)
+		{
+		}
+
+		bool handle(spv::Op opcode, const uint32_t *args, uint32_t length) override;
+		bool follow_function_call(const SPIRFunction &func) override;
+		void set_current_block(const SPIRBlock &block) override;
+		void add_reference(uint32_t id);
+
+		const CompilerGLSL &compiler;
+		IdMap<uint32_t> &counts;
+		IdBitset functions;
+	};
+
+	IdBitset unused_declarations;
+	void prepare_minified_output();
+	void shorten_identifiers(const IdMap<uint32_t> &reference_counts);
+
 private:
 	void init()
 	{
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Reference for compute.spvasm.
+
+#include "spirv_cross/simd_thread_group.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static float f(float x, int i)
+{
+	if (x < float(i))
+		return x * 2.0f;
+	return x - float(i);
+}
+
+int main()
+{
+	const unsigned N = 1000, groups = (N + 15) / 16 + 2;
+	std::vector<uint32_t> buf(1 + N);
+	buf[0] = N;
+	for (unsigned i = 0; i < N; i++)
+	{
+		float x = float((i * 37) % 23);
+		memcpy(&buf[1 + i], &x, 4);
+	}
+	std::vector<float> out(N + 64, -1.0f);
+	float scale = 0.5f;
+
+	spirv_cross::simd::ThreadGroup g(spirv_cross_simd_get_interface(), 4);
+	g.set_resource(0, 0, buf.data(), buf.size() * 4);
+	g.set_resource(0, 1, out.data(), N * 4);
+	g.set_push_constant(&scale, 4);
+	g.dispatch(groups, 1, 1);
+
+	unsigned bad = 0;
+	for (unsigned id = 0; id < N + 64; id++)
+	{
+		float expect = -1.0f;
+		if (id < N)
+		{
+			float x;
+			memcpy(&x, &buf[1 + id], 4);
+			int lim = int(id % 7);
+			float acc = 0.0f;
+			int i = 0;
+			for (;;)
+			{
+				if (i >= lim)
+					break;
+				i++;
+				if (x > 10.0f && (i & 1) == 1)
+					continue;
+				acc += f(x, i);
+				if (acc > 50.0f)
+					break;
+			}
+			expect = acc * scale;
+		}
+		if (out[id] != expect && bad++ < 10)
+			printf("id %u: got %f expected %f\n", id, out[id], expect);
+	}
+	printf("%s (%u mismatches)\n", bad ? "FAIL" : "OK", bad);
+	return bad != 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Reference for fragment.spvasm.
+
+#include "spirv_cross/simd_thread_group.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct v4
+{
+	float x, y, z, w;
+};
+
+int main()
+{
+	const unsigned N = 1003;
+	std::vector<v4> vc(N), fc(N), o(N, v4{ -1, -1, -1, -1 });
+	std::vector<int> vi(N);
+	for (unsigned i = 0; i < N; i++)
+	{
+		vc[i] = v4{ float(i % 5), float(i % 3) - 1.0f, 0.25f * (i % 7), float(i % 11) };
+		fc[i] = v4{ float(i % 9), float(i / 9), 0.5f, 1.0f };
+		vi[i] = int(i * 13);
+	}
+
+	// mat2 m at 0 (stride 8), Light lights[4] at 16 (stride 16), uint hits at 80.
+	unsigned char lights[84] = {};
+	float m[4] = { 1.0f, 2.0f, -1.0f, 0.5f };
+	memcpy(lights, m, sizeof(m));
+	for (unsigned i = 0; i < 4; i++)
+	{
+		float l[4] = { float(i), 1.0f + i, -0.5f * i, 10.0f + i };
+		memcpy(lights + 16 + 16 * i, l, sizeof(l));
+	}
+
+	spirv_cross::simd::ThreadGroup g(spirv_cross_simd_get_interface(), 3);
+	g.set_resource(0, 0, lights, sizeof(lights));
+	g.set_stage_input(0, vc.data(), sizeof(v4));
+	g.set_stage_input(1, vi.data(), sizeof(int));
+	g.set_stage_output(0, o.data(), sizeof(v4));
+	g.set_builtin(15, fc.data(), sizeof(v4));
+	g.shade(N);
+
+	unsigned bad = 0, alive = 0;
+	for (unsigned i = 0; i < N; i++)
+	{
+		v4 e = { -1, -1, -1, -1 };
+		if (!(fc[i].x < 3.0f))
+		{
+			alive++;
+			int k = vi[i] & 3;
+			float c[4] = { vc[i].x, vc[i].y, vc[i].z, vc[i].w };
+			c[0] = c[k];
+			float w = float(k + 1);
+			const float *l = (const float *)(lights + 16 + 16 * k);
+			float mm[2] = { m[0] * vc[i].x + m[2] * vc[i].y, m[1] * vc[i].x + m[3] * vc[i].y };
+			e.x = l[0] * w + mm[0] + c[0];
+			e.y = l[1] * w + mm[1] + c[1];
+			e.z = l[2] * w + 0.0f + c[2];
+			e.w = l[3] + c[3];
+		}
+		if (memcmp(&e, &o[i], sizeof(e)) && bad++ < 10)
+			printf("%u: got %f %f %f %f expected %f %f %f %f\n", i, o[i].x, o[i].y, o[i].z, o[i].w, e.x, e.y, e.z,
+			       e.w);
+	}
+	unsigned hits;
+	memcpy(&hits, lights + 80, 4);
+	if (hits != alive)
+	{
+		printf("hits %u expected %u\n", hits, alive);
+		bad++;
+	}
+	printf("%s (%u mismatches)\n", bad ? "FAIL" : "OK", bad);
+	return bad != 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Reference for workgroup.spvasm: shared memory, and barriers which the
+// batches of a workgroup have to meet at.
+
+#include "spirv_cross/simd_thread_group.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct v4
+{
+	float x, y, z, w;
+};
+
+static v4 add(const v4 &a, const v4 &b)
+{
+	return v4{ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+}
+
+int main()
+{
+	const unsigned groups_x = 4, groups_y = 3;
+	const unsigned width = 16 * groups_x, height = 4 * groups_y;
+
+	std::vector<v4> texels(width * height), blurred(width * height, v4{ -1, -1, -1, -1 });
+	for (unsigned i = 0; i < width * height; i++)
+		texels[i] = v4{ float(i % 13), float(i % 5) - 2.0f, float(i / 7 % 3), 1.0f };
+
+	spirv_cross::simd::ThreadGroup g(spirv_cross_simd_get_interface(), 3);
+	g.set_resource(0, 0, texels.data(), texels.size() * sizeof(v4));
+	g.set_resource(0, 1, blurred.data(), blurred.size() * sizeof(v4));
+	g.dispatch(groups_x, groups_y, 1);
+
+	unsigned bad = 0;
+	for (unsigned gy = 0; gy < groups_y; gy++)
+	{
+		for (unsigned gx = 0; gx < groups_x; gx++)
+		{
+			v4 tile[64];
+			float sums[64];
+			for (unsigned li = 0; li < 64; li++)
+			{
+				tile[li] = texels[(gy * 4 + li / 16) * width + gx * 16 + li % 16];
+				sums[li] = tile[li].x;
+			}
+
+			for (unsigned s = 32; s > 0; s >>= 1)
+				for (unsigned li = 0; li < s; li++)
+					sums[li] += sums[li + s];
+
+			for (unsigned li = 0; li < 64; li++)
+			{
+				unsigned row = li / 16 * 16, x = li % 16;
+				v4 s = add(add(tile[row + (x > 1 ? x : 1) - 1], tile[li]), tile[row + (x + 1 < 15 ? x + 1 : 15)]);
+				v4 e = { s.x / 3.0f + tile[0].x * sums[0], s.y / 3.0f + tile[0].y * sums[0],
+					     s.z / 3.0f + tile[0].z * sums[0], s.w / 3.0f + tile[0].w * sums[0] };
+
+				unsigned id = (gy * 4 + li / 16) * width + gx * 16 + x;
+				const v4 &o = blurred[id];
+				if (memcmp(&e, &o, sizeof(e)) && bad++ < 10)
+					printf("%u: got %f %f %f %f expected %f %f %f %f\n", id, o.x, o.y, o.z, o.w, e.x, e.y, e.z, e.w);
+			}
+		}
+	}
+
+	printf("%s (%u mismatches)\n", bad ? "FAIL" : "OK", bad);
+	return bad != 0;
+}
@@ -0,0 +1,219 @@
+#
+# Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+"""Run shaders compiled by CompilerCPP with a SIMD width against scalar
+reference implementations.
+
+Every test in tests/simd is a SPIR-V assembly file, <name>.spvasm, and a
+C++ harness, <name>.cpp, which runs the shader through ThreadGroup and
+compares the results with the same computation written in plain C++.
+For each width, the shader is assembled, turned into C++ by spirv_to_cpp
+(built from this directory and the spirv-cross sources), and linked with
+its harness.
+
+The assembler takes the usual "%result = OpName %type operands..." form,
+with enumerants spelled as in spirv.hpp and GLSL.std.450.h, for example
+StorageClassWorkgroup or GLSLstd450UMax.  The front-end cannot produce
+compute shaders, so these are written by hand.
+
+The runtime needs the GCC or Clang vector extensions.  Widths wider than
+the vectors of the target still work, but are split up, and GCC warns
+about their ABI with -Wpsabi; see simd_internal_interface.hpp.
+
+Usage: simd_test.py [--cxx g++] [--cxxflags "-O2 -march=native"]
+                    [--width 4 --width 8 ...] [--keep DIR]
+"""
+
+import argparse
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+SPIRV_DIR = os.path.dirname(TEST_DIR)
+CROSS_SOURCES = ('spirv_cross.cpp', 'spirv_glsl.cpp', 'spirv_cpp.cpp',
+                 'spirv_cfg.cpp')
+NO_RESULT_TYPE = ('OpType', 'OpLabel', 'OpExtInstImport', 'OpString',
+                  'OpDecorationGroup')
+
+
+def read_enumerants():
+    enumerants = {}
+    for header in ('spirv.hpp', 'GLSL.std.450.h'):
+        with open(os.path.join(SPIRV_DIR, header)) as f:
+            text = f.read()
+        for m in re.finditer(r'^\s+(\w+)\s*=\s*(0x[0-9a-fA-F]+|\d+),', text,
+                             re.MULTILINE):
+            enumerants.setdefault(m.group(1), int(m.group(2), 0))
+    return enumerants
+
+
+def assemble(path, enumerants):
+    ids = {}
+
+    def id_of(name):
+        if name not in ids:
+            ids[name] = len(ids) + 1
+        return ids[name]
+
+    float_types = set()
+    words = []
+    with open(path) as f:
+        lines = f.readlines()
+    for line in lines:
+        line = line.split(';')[0].strip()
+        if not line:
+            continue
+        tokens = re.findall(r'"[^"]*"|\S+', line)
+        result = None
+        if len(tokens) > 2 and tokens[1] == '=':
+            result = tokens[0]
+            tokens = tokens[2:]
+        op = tokens[0]
+        args = tokens[1:]
+
+        operands = []
+        if result is not None:
+            if op.startswith(NO_RESULT_TYPE):
+                operands.append(id_of(result))
+            else:
+                operands += [id_of(args[0]), id_of(result)]
+                args = args[1:]
+        if op == 'OpTypeFloat':
+            float_types.add(result)
+        is_float = op in ('OpConstant', 'OpSpecConstant') and \
+            tokens[1] in float_types
+
+        for arg in args:
+            if arg.startswith('%'):
+                operands.append(id_of(arg))
+            elif arg.startswith('"'):
+                data = arg[1:-1].encode() + b'\0'
+                data += b'\0' * (-len(data) % 4)
+                operands += struct.unpack('<%dI' % (len(data) // 4), data)
+            elif is_float:
+                operands.append(struct.unpack('<I', struct.pack('<f', float(arg)))[0])
+            elif re.match(r'^-?\d+$', arg):
+                operands.append(int(arg) & 0xffffffff)
+            elif arg in enumerants:
+                operands.append(enumerants[arg])
+            else:
+                raise ValueError('{}: unknown operand {} in "{}"'.format(
+                    path, arg, line))
+        words.append(((len(operands) + 1) << 16) | enumerants[op])
+        words += operands
+
+    header = [0x07230203, 0x00010000, 0, len(ids) + 1, 0]
+    return struct.pack('<%dI' % (len(header) + len(words)), *(header + words))
+
+
+def run(args, **kwargs):
+    proc = subprocess.Popen(args, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT,
+                            universal_newlines=True, **kwargs)
+    output = proc.communicate()[0]
+    return proc.returncode, output
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--cxx', default='g++')
+    parser.add_argument('--cxxflags', default='-O2 -march=native')
+    parser.add_argument('--width', type=int, action='append',
+                        choices=(4, 8, 16))
+    parser.add_argument('--keep', help='build in this directory and keep it')
+    args = parser.parse_args()
+
+    widths = args.width or [4, 8, 16]
+    flags = args.cxxflags.split()
+    build = args.keep or tempfile.mkdtemp()
+    if args.keep and not os.path.isdir(build):
+        os.makedirs(build)
+
+    try:
+        converter = os.path.join(build, 'spirv_to_cpp')
+        rc, output = run([args.cxx, '-std=c++11', '-O1', '-I', SPIRV_DIR,
+                          '-o', converter,
+                          os.path.join(TEST_DIR, 'spirv_to_cpp.cpp')] +
+                         [os.path.join(SPIRV_DIR, s) for s in CROSS_SOURCES])
+        if rc != 0:
+            print('FAIL building spirv_to_cpp\n' + output)
+            return 1
+
+        enumerants = read_enumerants()
+        passed = 0
+        failed = 0
+        simd_dir = os.path.join(TEST_DIR, 'simd')
+        for name in sorted(os.listdir(simd_dir)):
+            if not name.endswith('.spvasm'):
+                continue
+            test = name[:-len('.spvasm')]
+            spv = os.path.join(build, test + '.spv')
+            with open(spv, 'wb') as f:
+                f.write(assemble(os.path.join(simd_dir, name), enumerants))
+
+            for width in widths:
+                label = '{} (width {})'.format(test, width)
+                shader = os.path.join(build, '{}_w{}.cpp'.format(test, width))
+                binary = os.path.join(build, '{}_w{}'.format(test, width))
+
+                rc, output = run([converter, spv, str(width)])
+                if rc != 0:
+                    print('FAIL {}: spirv_to_cpp failed\n{}'.format(label, output))
+                    failed += 1
+                    continue
+                with open(shader, 'w') as f:
+                    f.write(output)
+
+                # Both sides must round the same way.
+                rc, output = run([args.cxx, '-std=c++11'] + flags +
+                                 ['-ffp-contract=off', '-Wno-psabi',
+                                  '-I', os.path.join(SPIRV_DIR, 'include'),
+                                  '-o', binary, shader,
+                                  os.path.join(simd_dir, test + '.cpp'),
+                                  '-pthread'])
+                if rc != 0:
+                    print('FAIL {}: build failed\n{}'.format(label, output))
+                    failed += 1
+                    continue
+
+                rc, output = run([binary])
+                if rc != 0:
+                    print('FAIL {}\n{}'.format(label, output))
+                    failed += 1
+                else:
+                    print('PASS {}'.format(label))
+                    passed += 1
+
+        print('{} passed, {} failed'.format(passed, failed))
+        return 1 if failed else 0
+    finally:
+        if not args.keep:
+            shutil.rmtree(build, ignore_errors=True)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+// Prints the C++ CompilerCPP generates for a SPIR-V binary, for
+// simd_test.py.
+//
+//    spirv_to_cpp <file.spv> <simd width>
+
+#include "spirv_cpp.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+int main(int argc, char **argv)
+{
+	if (argc != 3)
+	{
+		cerr << "usage: spirv_to_cpp <file.spv> <simd width>" << endl;
+		return 1;
+	}
+
+	ifstream file(argv[1], ios::binary);
+	vector<char> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	if (!file || bytes.size() % 4)
+	{
+		cerr << argv[1] << ": not a SPIR-V binary" << endl;
+		return 1;
+	}
+
+	vector<uint32_t> words(bytes.size() / 4);
+	memcpy(words.data(), bytes.data(), bytes.size());
+
+	try
+	{
+		spirv_cross::CompilerCPP cpp(move(words));
+		cpp.set_simd_width(uint32_t(atoi(argv[2])));
+		cout << cpp.compile();
+	}
+	catch (const exception &e)
+	{
+		cerr << argv[1] << ": " << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -3077,6 +3077,20 @@ struct gl_shader_compiler_options
    GLuint MaxIfDepth;               /**< Maximum nested IF blocks */
    GLuint MaxUnrollIterations;
 
+   /**
+    * \name Function inlining heuristics.
+    *
+    * Only used when EmitNoFunctions is false.  Functions of at most
+    * InlineAlwaysSize IR nodes, or with a single call site, are always
+    * inlined.  Larger functions are kept as calls if inlining them at every
+    * call site would grow the shader by more than InlineGrowthBudget IR
+    * nodes.  A budget of zero inlines everything.
+    */
+   /*@{*/
+   GLuint InlineAlwaysSize;
+   GLuint InlineGrowthBudget;
+   /*@}*/
+
    /**
     * Optimize code for array of structures backends.
     *
@@ -24,10 +24,12 @@
 #include "main/imports.h"
 #include "symbol_table.h"
 #include "../../util/hash_table.h"
+#include "../../util/ralloc.h"
+#include "../../util/string_pool.h"
 
 struct symbol {
-   /** Symbol name. */
-   char *name;
+   /** Symbol name, interned in the table's string pool if it has one. */
+   const char *name;
 
     /**
      * Link to the next symbol in the table with the same name
@@ -79,23 +81,98 @@ struct _mesa_symbol_table {
 
     /** Current scope depth. */
     unsigned depth;
+
+    /** Pool that owns the symbol names, or NULL if they are strdup'ed. */
+    struct string_pool *strings;
+
+    /**
+     * Storage for scopes and symbols
+     *
+     * Nothing allocated from here is freed before the table is destroyed.
+     * Popped scopes and their symbols go on the free lists below and are
+     * handed out again by the next push or add.
+     */
+    void *mem_ctx;
+    void *linalloc;
+    struct scope_level *free_scopes;
+    struct symbol *free_symbols;
 };
 
+
+static struct symbol *
+alloc_symbol(struct _mesa_symbol_table *table)
+{
+   struct symbol *sym = table->free_symbols;
+
+   if (sym != NULL) {
+      table->free_symbols = sym->next_with_same_scope;
+      memset(sym, 0, sizeof(*sym));
+      return sym;
+   }
+
+   return linear_zalloc_child(table->linalloc, sizeof(*sym));
+}
+
+
+static void
+release_symbol(struct _mesa_symbol_table *table, struct symbol *sym)
+{
+   sym->next_with_same_scope = table->free_symbols;
+   table->free_symbols = sym;
+}
+
+
+/**
+ * Find the hash table entry for \p name
+ *
+ * Names interned in the table's pool already carry their hash, so looking
+ * them up does not touch the characters unless two names collide.
+ */
+static struct hash_entry *
+search_name(struct _mesa_symbol_table *table, const char *name)
+{
+   if (table->strings != NULL && _mesa_string_pool_owns(table->strings, name))
+      return _mesa_hash_table_search_pre_hashed(table->ht,
+                                                _mesa_string_pool_hash(name),
+                                                name);
+
+   return _mesa_hash_table_search(table->ht, name);
+}
+
+
+static void
+insert_name(struct _mesa_symbol_table *table, struct symbol *sym)
+{
+   if (table->strings != NULL)
+      _mesa_hash_table_insert_pre_hashed(table->ht,
+                                         _mesa_string_pool_hash(sym->name),
+                                         sym->name, sym);
+   else
+      _mesa_hash_table_insert(table->ht, sym->name, sym);
+}
+
+
+static const char *
+copy_name(struct _mesa_symbol_table *table, const char *name)
+{
+   if (table->strings != NULL)
+      return _mesa_string_pool_intern(table->strings, name);
+
+   return strdup(name);
+}
+
 void
 _mesa_symbol_table_pop_scope(struct _mesa_symbol_table *table)
 {
     struct scope_level *const scope = table->current_scope;
     struct symbol *sym = scope->symbols;
+    struct symbol *last = NULL;
 
     table->current_scope = scope->next;
     table->depth--;
 
-    free(scope);
-
-    while (sym != NULL) {
-        struct symbol *const next = sym->next_with_same_scope;
-        struct hash_entry *hte = _mesa_hash_table_search(table->ht,
-                                                         sym->name);
+    for (/* empty */; sym != NULL; sym = sym->next_with_same_scope) {
+        struct hash_entry *hte = search_name(table, sym->name);
         if (sym->next_with_same_name) {
            /* If there is a symbol with this name in an outer scope update
             * the hash table to point to it.
@@ -104,24 +181,42 @@ _mesa_symbol_table_pop_scope(struct _mesa_symbol_table *table)
            hte->data = sym->next_with_same_name;
         } else {
            _mesa_hash_table_remove(table->ht, hte);
-           free(sym->name);
+           if (table->strings == NULL)
+              free((char *) sym->name);
         }
 
-        free(sym);
-        sym = next;
+        last = sym;
+    }
+
+    /* Hand the whole scope back in one go; its symbols are already chained
+     * through next_with_same_scope.
+     */
+    if (last != NULL) {
+       last->next_with_same_scope = table->free_symbols;
+       table->free_symbols = scope->symbols;
     }
+
+    scope->next = table->free_scopes;
+    table->free_scopes = scope;
 }
 
 
 void
 _mesa_symbol_table_push_scope(struct _mesa_symbol_table *table)
 {
-    struct scope_level *const scope = calloc(1, sizeof(*scope));
-    if (scope == NULL) {
-       _mesa_error_no_memory(__func__);
-       return;
+    struct scope_level *scope = table->free_scopes;
+
+    if (scope != NULL) {
+       table->free_scopes = scope->next;
+    } else {
+       scope = linear_alloc_child(table->linalloc, sizeof(*scope));
+       if (scope == NULL) {
+          _mesa_error_no_memory(__func__);
+          return;
+       }
     }
 
+    scope->symbols = NULL;
     scope->next = table->current_scope;
     table->current_scope = scope;
     table->depth++;
@@ -131,7 +226,7 @@ _mesa_symbol_table_push_scope(struct _mesa_symbol_table *table)
 static struct symbol *
 find_symbol(struct _mesa_symbol_table *table, const char *name)
 {
-   struct hash_entry *entry = _mesa_hash_table_search(table->ht, name);
+   struct hash_entry *entry = search_name(table, name);
    return entry ? (struct symbol *) entry->data : NULL;
 }
 
@@ -181,7 +276,7 @@ _mesa_symbol_table_add_symbol(struct _mesa_symbol_table *table,
    if (sym && sym->depth == table->depth)
       return -1;
 
-   new_sym = calloc(1, sizeof(*sym));
+   new_sym = alloc_symbol(table);
    if (new_sym == NULL) {
       _mesa_error_no_memory(__func__);
       return -1;
@@ -192,9 +287,9 @@ _mesa_symbol_table_add_symbol(struct _mesa_symbol_table *table,
       new_sym->next_with_same_name = sym;
       new_sym->name = sym->name;
    } else {
-      new_sym->name = strdup(name);
+      new_sym->name = copy_name(table, name);
       if (new_sym->name == NULL) {
-         free(new_sym);
+         release_symbol(table, new_sym);
          _mesa_error_no_memory(__func__);
          return -1;
       }
@@ -206,7 +301,7 @@ _mesa_symbol_table_add_symbol(struct _mesa_symbol_table *table,
 
    table->current_scope->symbols = new_sym;
 
-   _mesa_hash_table_insert(table->ht, new_sym->name, new_sym);
+   insert_name(table, new_sym);
 
    return 0;
 }
@@ -250,7 +345,7 @@ _mesa_symbol_table_add_global_symbol(struct _mesa_symbol_table *table,
       /* empty */
    }
 
-   sym = calloc(1, sizeof(*sym));
+   sym = alloc_symbol(table);
    if (sym == NULL) {
       _mesa_error_no_memory(__func__);
       return -1;
@@ -264,9 +359,9 @@ _mesa_symbol_table_add_global_symbol(struct _mesa_symbol_table *table,
 
       sym->name = inner_sym->name;
    } else {
-      sym->name = strdup(name);
+      sym->name = copy_name(table, name);
       if (sym->name == NULL) {
-         free(sym);
+         release_symbol(table, sym);
          _mesa_error_no_memory(__func__);
          return -1;
       }
@@ -277,7 +372,7 @@ _mesa_symbol_table_add_global_symbol(struct _mesa_symbol_table *table,
 
    top_scope->symbols = sym;
 
-   _mesa_hash_table_insert(table->ht, sym->name, sym);
+   insert_name(table, sym);
 
    return 0;
 }
@@ -286,12 +381,22 @@ _mesa_symbol_table_add_global_symbol(struct _mesa_symbol_table *table,
 
 struct _mesa_symbol_table *
 _mesa_symbol_table_ctor(void)
+{
+    return _mesa_symbol_table_ctor_with_pool(NULL);
+}
+
+
+struct _mesa_symbol_table *
+_mesa_symbol_table_ctor_with_pool(struct string_pool *strings)
 {
     struct _mesa_symbol_table *table = calloc(1, sizeof(*table));
 
     if (table != NULL) {
+       table->strings = strings;
        table->ht = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
                                            _mesa_key_string_equal);
+       table->mem_ctx = ralloc_context(NULL);
+       table->linalloc = linear_alloc_parent(table->mem_ctx, 0);
 
        _mesa_symbol_table_push_scope(table);
     }
@@ -303,10 +408,16 @@ _mesa_symbol_table_ctor(void)
 void
 _mesa_symbol_table_dtor(struct _mesa_symbol_table *table)
 {
-   while (table->current_scope != NULL) {
-      _mesa_symbol_table_pop_scope(table);
+   /* Names owned by a string pool need no cleanup, and everything else
+    * goes away with mem_ctx.
+    */
+   if (table->strings == NULL) {
+      while (table->current_scope != NULL) {
+         _mesa_symbol_table_pop_scope(table);
+      }
    }
 
    _mesa_hash_table_destroy(table->ht, NULL);
+   ralloc_free(table->mem_ctx);
    free(table);
 }
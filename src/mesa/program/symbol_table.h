@@ -28,6 +28,7 @@ extern "C" {
 #endif
 
 struct _mesa_symbol_table;
+struct string_pool;
 
 extern void _mesa_symbol_table_push_scope(struct _mesa_symbol_table *table);
 
@@ -53,6 +54,15 @@ extern void *_mesa_symbol_table_find_symbol(struct _mesa_symbol_table *symtab,
 
 extern struct _mesa_symbol_table *_mesa_symbol_table_ctor(void);
 
+/**
+ * Create a symbol table whose names are interned in \p strings
+ *
+ * The pool must outlive the table.  Lookups of names that came from the
+ * pool skip hashing the name.
+ */
+extern struct _mesa_symbol_table *
+_mesa_symbol_table_ctor_with_pool(struct string_pool *strings);
+
 extern void _mesa_symbol_table_dtor(struct _mesa_symbol_table *);
 
 #ifdef __cplusplus
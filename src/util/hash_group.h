@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file hash_group.h
+ *
+ * Control-byte groups shared by the hash table and set implementations.
+ *
+ * Alongside its entries, a table keeps one control byte per slot: either
+ * HASH_CTRL_EMPTY, HASH_CTRL_DELETED, or the top seven bits of the hash of
+ * the key stored there.  Slots are probed HASH_GROUP_SIZE at a time, so one
+ * vector compare of the control bytes rules out almost every slot whose key
+ * would otherwise have to be compared.
+ */
+
+#ifndef _HASH_GROUP_H
+#define _HASH_GROUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bitscan.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_GROUP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HASH_GROUP_NEON 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HASH_GROUP_SIZE 16
+
+#define HASH_CTRL_EMPTY    0x80
+#define HASH_CTRL_DELETED  0xfe
+
+/**
+ * A set of slots within a group.  Slots are popped in increasing order with
+ * hash_group_next().
+ */
+typedef uint64_t hash_group_mask;
+
+/** Control byte for a slot holding a key with the given hash. */
+static inline uint8_t
+hash_ctrl_tag(uint32_t hash)
+{
+   return hash >> 25;
+}
+
+/** Whether a control byte marks a slot that holds a key. */
+static inline bool
+hash_ctrl_is_full(uint8_t ctrl)
+{
+   return (ctrl & 0x80) == 0;
+}
+
+#if defined(HASH_GROUP_SSE2)
+
+/* One bit per slot, straight out of pmovmskb. */
+#define HASH_GROUP_SHIFT 0
+
+static inline hash_group_mask
+hash_group_match(const uint8_t *ctrl, uint8_t tag)
+{
+   const __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+   return (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(group,
+                                                      _mm_set1_epi8(tag)));
+}
+
+static inline hash_group_mask
+hash_group_match_free(const uint8_t *ctrl)
+{
+   /* Empty and deleted slots are the ones with the top bit set. */
+   return (unsigned) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+}
+
+#elif defined(HASH_GROUP_NEON)
+
+/* NEON has no movemask; narrowing the compare result leaves four bits per
+ * slot, of which we keep one.
+ */
+#define HASH_GROUP_SHIFT 2
+
+static inline hash_group_mask
+hash_group_from_neon(uint8x16_t cmp)
+{
+   const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+   return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) &
+          0x8888888888888888ull;
+}
+
+static inline hash_group_mask
+hash_group_match(const uint8_t *ctrl, uint8_t tag)
+{
+   return hash_group_from_neon(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag)));
+}
+
+static inline hash_group_mask
+hash_group_match_free(const uint8_t *ctrl)
+{
+   return hash_group_from_neon(vtstq_u8(vld1q_u8(ctrl), vdupq_n_u8(0x80)));
+}
+
+#else
+
+#define HASH_GROUP_SHIFT 0
+
+static inline hash_group_mask
+hash_group_match(const uint8_t *ctrl, uint8_t tag)
+{
+   hash_group_mask mask = 0;
+
+   for (unsigned i = 0; i < HASH_GROUP_SIZE; i++)
+      mask |= (hash_group_mask) (ctrl[i] == tag) << i;
+
+   return mask;
+}
+
+static inline hash_group_mask
+hash_group_match_free(const uint8_t *ctrl)
+{
+   hash_group_mask mask = 0;
+
+   for (unsigned i = 0; i < HASH_GROUP_SIZE; i++)
+      mask |= (hash_group_mask) (ctrl[i] >> 7) << i;
+
+   return mask;
+}
+
+#endif
+
+/**
+ * Empty slots of the group.  A probe for a key that isn't there stops at the
+ * first group with one.
+ */
+static inline hash_group_mask
+hash_group_match_empty(const uint8_t *ctrl)
+{
+   return hash_group_match(ctrl, HASH_CTRL_EMPTY);
+}
+
+/** Pops the lowest slot out of a non-empty mask. */
+static inline unsigned
+hash_group_next(hash_group_mask *mask)
+{
+   return u_bit_scan64(mask) >> HASH_GROUP_SHIFT;
+}
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* _HASH_GROUP_H */
@@ -33,9 +33,22 @@
  */
 
 /**
- * Implements an open-addressing, linear-reprobing hash table.
+ * Implements an open-addressing hash table with grouped probing.
  *
- * For more information, see:
+ * The table is a power of two in size and split into groups of
+ * HASH_GROUP_SIZE entries.  Each entry has a control byte (see hash_group.h)
+ * telling whether it is empty, deleted, or holding a key with a given seven
+ * bits of hash, so a probe looks at a whole group with a couple of vector
+ * instructions and only compares the keys whose control byte matched.  Groups
+ * are visited in triangular order, which reaches every group of a
+ * power-of-two table.
+ *
+ * Most tables only ever see a handful of keys, so a new table starts out
+ * with HASH_TABLE_INLINE_SIZE entries stored inside struct hash_table and
+ * searched linearly, and only allocates a grouped table once it outgrows
+ * them.
+ *
+ * For more information on the ancestry of this table, see:
  *
  * http://cgit.freedesktop.org/~anholt/hash_table/tree/README
  */
@@ -45,68 +58,73 @@
 #include <assert.h>
 
 #include "hash_table.h"
+#include "hash_group.h"
 #include "ralloc.h"
 #include "macros.h"
 
 static const uint32_t deleted_key_value;
 
-/**
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
-static const struct {
-   uint32_t max_entries, size, rehash;
-} hash_sizes[] = {
-   { 2,			5,		3	  },
-   { 4,			7,		5	  },
-   { 8,			13,		11	  },
-   { 16,		19,		17	  },
-   { 32,		43,		41        },
-   { 64,		73,		71        },
-   { 128,		151,		149       },
-   { 256,		283,		281       },
-   { 512,		571,		569       },
-   { 1024,		1153,		1151      },
-   { 2048,		2269,		2267      },
-   { 4096,		4519,		4517      },
-   { 8192,		9013,		9011      },
-   { 16384,		18043,		18041     },
-   { 32768,		36109,		36107     },
-   { 65536,		72091,		72089     },
-   { 131072,		144409,		144407    },
-   { 262144,		288361,		288359    },
-   { 524288,		576883,		576881    },
-   { 1048576,		1153459,	1153457   },
-   { 2097152,		2307163,	2307161   },
-   { 4194304,		4613893,	4613891   },
-   { 8388608,		9227641,	9227639   },
-   { 16777216,		18455029,	18455027  },
-   { 33554432,		36911011,	36911009  },
-   { 67108864,		73819861,	73819859  },
-   { 134217728,		147639589,	147639587 },
-   { 268435456,		295279081,	295279079 },
-   { 536870912,		590559793,	590559791 },
-   { 1073741824,	1181116273,	1181116271},
-   { 2147483648ul,	2362232233ul,	2362232231ul}
-};
-
-static int
-entry_is_free(const struct hash_entry *entry)
+/* The table is rehashed once 7/8 of it is taken by entries and tombstones. */
+#define MIN_SIZE HASH_GROUP_SIZE
+#define MAX_ENTRIES(size) ((size) - (size) / 8)
+
+static inline uint32_t
+key_hash(const struct hash_table *ht, const void *key)
+{
+   if (ht->key_hash_function == _mesa_hash_pointer)
+      return _mesa_hash_pointer_inline(key);
+
+   return ht->key_hash_function(key);
+}
+
+static inline bool
+key_equals(const struct hash_table *ht, const void *a, const void *b)
 {
-   return entry->key == NULL;
+   if (ht->key_equals_function == _mesa_key_pointer_equal)
+      return a == b;
+   if (ht->key_equals_function == _mesa_key_string_equal)
+      return a == b || strcmp(a, b) == 0;
+
+   return ht->key_equals_function(a, b);
 }
 
-static int
-entry_is_deleted(const struct hash_table *ht, struct hash_entry *entry)
+static bool
+hash_table_is_inline(const struct hash_table *ht)
+{
+   return ht->table == ht->inline_table;
+}
+
+static void
+hash_table_init_inline(struct hash_table *ht)
 {
-   return entry->key == ht->deleted_key;
+   ht->table = ht->inline_table;
+   ht->ctrl = ht->inline_ctrl;
+   ht->size = HASH_TABLE_INLINE_SIZE;
+   ht->max_entries = HASH_TABLE_INLINE_SIZE;
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   memset(ht->ctrl, HASH_CTRL_EMPTY, HASH_TABLE_INLINE_SIZE);
 }
 
-static int
-entry_is_present(const struct hash_table *ht, struct hash_entry *entry)
+static bool
+hash_table_alloc(struct hash_table *ht, uint32_t size)
 {
-   return entry->key != NULL && entry->key != ht->deleted_key;
+   /* The control bytes follow the entries in the same allocation. */
+   struct hash_entry *table =
+      ralloc_size(ht, size * (sizeof(struct hash_entry) + 1));
+
+   if (table == NULL)
+      return false;
+
+   ht->table = table;
+   ht->ctrl = (uint8_t *) (table + size);
+   ht->size = size;
+   ht->max_entries = MAX_ENTRIES(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   memset(ht->ctrl, HASH_CTRL_EMPTY, size);
+
+   return true;
 }
 
 struct hash_table *
@@ -121,21 +139,10 @@ _mesa_hash_table_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct hash_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
-
-   if (ht->table == NULL) {
-      ralloc_free(ht);
-      return NULL;
-   }
+   hash_table_init_inline(ht);
 
    return ht;
 }
@@ -173,31 +180,24 @@ void
 _mesa_hash_table_clear(struct hash_table *ht,
                        void (*delete_function)(struct hash_entry *entry))
 {
-   struct hash_entry *entry;
-
-   for (entry = ht->table; entry != ht->table + ht->size; entry++) {
-      if (entry->key == NULL)
-         continue;
+   if (delete_function != NULL) {
+      struct hash_entry *entry;
 
-      if (delete_function != NULL && entry->key != ht->deleted_key)
+      hash_table_foreach(ht, entry) {
          delete_function(entry);
-
-      entry->key = NULL;
+      }
    }
 
+   memset(ht->ctrl, HASH_CTRL_EMPTY, ht->size);
    ht->entries = 0;
    ht->deleted_entries = 0;
 }
 
 /** Sets the value of the key pointer used for deleted entries in the table.
  *
- * The assumption is that usually keys are actual pointers, so we use a
- * default value of a pointer to an arbitrary piece of storage in the library.
- * But in some cases a consumer wants to store some other sort of value in the
- * table, like a uint32_t, in which case that pointer may conflict with one of
- * their valid keys.  This lets that user select a safe value.
- *
- * This must be called before any keys are actually deleted from the table.
+ * Deleted entries are tracked in the control bytes, so any key value is
+ * safe to store and this is only kept for compatibility.  The key of a
+ * removed entry is still set to deleted_key.
  */
 void
 _mesa_hash_table_set_deleted_key(struct hash_table *ht, const void *deleted_key)
@@ -208,26 +208,40 @@ _mesa_hash_table_set_deleted_key(struct hash_table *ht, const void *deleted_key)
 static struct hash_entry *
 hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
-   uint32_t start_hash_address = hash % ht->size;
-   uint32_t hash_address = start_hash_address;
+   const uint8_t tag = hash_ctrl_tag(hash);
+   uint32_t group_mask, group;
 
-   do {
-      uint32_t double_hash;
+   if (hash_table_is_inline(ht)) {
+      for (uint32_t i = 0; i < HASH_TABLE_INLINE_SIZE; i++) {
+         struct hash_entry *entry = ht->table + i;
 
-      struct hash_entry *entry = ht->table + hash_address;
+         if (ht->ctrl[i] == tag && entry->hash == hash &&
+             key_equals(ht, key, entry->key))
+            return entry;
+      }
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(ht, entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+      return NULL;
+   }
+
+   group_mask = ht->size / HASH_GROUP_SIZE - 1;
+   group = hash & group_mask;
+
+   for (uint32_t stride = 1; stride <= group_mask + 1; stride++) {
+      const uint32_t base = group * HASH_GROUP_SIZE;
+      hash_group_mask match = hash_group_match(ht->ctrl + base, tag);
+
+      while (match) {
+         struct hash_entry *entry = ht->table + base + hash_group_next(&match);
+
+         if (entry->hash == hash && key_equals(ht, key, entry->key))
             return entry;
-         }
       }
 
-      double_hash = 1 + hash % ht->rehash;
+      if (hash_group_match_empty(ht->ctrl + base))
+         return NULL;
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != start_hash_address);
+      group = (group + stride) & group_mask;
+   }
 
    return NULL;
 }
@@ -242,7 +256,7 @@ struct hash_entry *
 _mesa_hash_table_search(struct hash_table *ht, const void *key)
 {
    assert(ht->key_hash_function);
-   return hash_table_search(ht, ht->key_hash_function(key), key);
+   return hash_table_search(ht, key_hash(ht, key), key);
 }
 
 struct hash_entry *
@@ -253,69 +267,103 @@ _mesa_hash_table_search_pre_hashed(struct hash_table *ht, uint32_t hash,
    return hash_table_search(ht, hash, key);
 }
 
-static struct hash_entry *
-hash_table_insert(struct hash_table *ht, uint32_t hash,
-                  const void *key, void *data);
+/* Returns the first slot not holding a key along the probe sequence of
+ * hash.  The load factor guarantees there is one.
+ */
+static uint32_t
+hash_table_find_free(const struct hash_table *ht, uint32_t hash)
+{
+   const uint32_t group_mask = ht->size / HASH_GROUP_SIZE - 1;
+   uint32_t group = hash & group_mask;
+
+   for (uint32_t stride = 1; ; stride++) {
+      const uint32_t base = group * HASH_GROUP_SIZE;
+      hash_group_mask avail = hash_group_match_free(ht->ctrl + base);
+
+      if (avail)
+         return base + hash_group_next(&avail);
+
+      group = (group + stride) & group_mask;
+   }
+}
 
 static void
-_mesa_hash_table_rehash(struct hash_table *ht, unsigned new_size_index)
+_mesa_hash_table_rehash(struct hash_table *ht, uint32_t new_size)
 {
    struct hash_table old_ht;
-   struct hash_entry *table, *entry;
+   struct hash_entry *entry;
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
-
-   table = rzalloc_array(ht, struct hash_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   if (new_size < ht->size)
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!hash_table_alloc(ht, new_size))
+      return;
 
+   /* Keys are known to be distinct, so they only need a free slot. */
    hash_table_foreach(&old_ht, entry) {
-      hash_table_insert(ht, entry->hash, entry->key, entry->data);
+      uint32_t i = hash_table_find_free(ht, entry->hash);
+
+      ht->ctrl[i] = hash_ctrl_tag(entry->hash);
+      ht->table[i] = *entry;
    }
+   ht->entries = old_ht.entries;
 
-   ralloc_free(old_ht.table);
+   if (old_ht.table != ht->inline_table)
+      ralloc_free(old_ht.table);
 }
 
 static struct hash_entry *
 hash_table_insert(struct hash_table *ht, uint32_t hash,
                   const void *key, void *data)
 {
-   uint32_t start_hash_address, hash_address;
+   const uint8_t tag = hash_ctrl_tag(hash);
+   uint32_t group_mask, group;
    struct hash_entry *available_entry = NULL;
 
    assert(key != NULL);
 
-   if (ht->entries >= ht->max_entries) {
-      _mesa_hash_table_rehash(ht, ht->size_index + 1);
+   if (hash_table_is_inline(ht)) {
+      for (uint32_t i = 0; i < HASH_TABLE_INLINE_SIZE; i++) {
+         struct hash_entry *entry = ht->table + i;
+
+         if (!hash_ctrl_is_full(ht->ctrl[i])) {
+            if (available_entry == NULL)
+               available_entry = entry;
+         } else if (ht->ctrl[i] == tag && entry->hash == hash &&
+                    key_equals(ht, key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
+      }
+
+      if (available_entry != NULL) {
+         ht->ctrl[available_entry - ht->table] = tag;
+         available_entry->hash = hash;
+         available_entry->key = key;
+         available_entry->data = data;
+         ht->entries++;
+         return available_entry;
+      }
+
+      /* Out of inline entries, move to a table of our own. */
+      _mesa_hash_table_rehash(ht, MIN_SIZE);
+      if (hash_table_is_inline(ht))
+         return NULL;
+   } else if (ht->entries >= ht->max_entries) {
+      _mesa_hash_table_rehash(ht, ht->size * 2);
    } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
-      _mesa_hash_table_rehash(ht, ht->size_index);
+      _mesa_hash_table_rehash(ht, ht->size);
    }
 
-   start_hash_address = hash % ht->size;
-   hash_address = start_hash_address;
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
-
-      if (!entry_is_present(ht, entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+   group_mask = ht->size / HASH_GROUP_SIZE - 1;
+   group = hash & group_mask;
+
+   for (uint32_t stride = 1; stride <= group_mask + 1; stride++) {
+      const uint32_t base = group * HASH_GROUP_SIZE;
+      hash_group_mask match = hash_group_match(ht->ctrl + base, tag);
 
       /* Implement replacement when another insert happens
        * with a matching key.  This is a relatively common
@@ -328,23 +376,36 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
        * required to avoid memory leaks, perform a search
        * before inserting.
        */
-      if (!entry_is_deleted(ht, entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         entry->data = data;
-         return entry;
+      while (match) {
+         struct hash_entry *entry = ht->table + base + hash_group_next(&match);
+
+         if (entry->hash == hash && key_equals(ht, key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
       }
 
+      /* Stash the first available entry we find */
+      if (available_entry == NULL) {
+         hash_group_mask avail = hash_group_match_free(ht->ctrl + base);
 
-      double_hash = 1 + hash % ht->rehash;
+         if (avail)
+            available_entry = ht->table + base + hash_group_next(&avail);
+      }
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != start_hash_address);
+      if (hash_group_match_empty(ht->ctrl + base))
+         break;
+
+      group = (group + stride) & group_mask;
+   }
 
    if (available_entry) {
-      if (entry_is_deleted(ht, available_entry))
+      uint8_t *ctrl = ht->ctrl + (available_entry - ht->table);
+
+      if (*ctrl == HASH_CTRL_DELETED)
          ht->deleted_entries--;
+      *ctrl = tag;
       available_entry->hash = hash;
       available_entry->key = key;
       available_entry->data = data;
@@ -368,7 +429,7 @@ struct hash_entry *
 _mesa_hash_table_insert(struct hash_table *ht, const void *key, void *data)
 {
    assert(ht->key_hash_function);
-   return hash_table_insert(ht, ht->key_hash_function(key), key, data);
+   return hash_table_insert(ht, key_hash(ht, key), key, data);
 }
 
 struct hash_entry *
@@ -389,12 +450,27 @@ void
 _mesa_hash_table_remove(struct hash_table *ht,
                         struct hash_entry *entry)
 {
+   uint32_t i;
+
    if (!entry)
       return;
 
+   i = entry - ht->table;
+
+   /* No probe ever went past a group that still has an empty slot, so the
+    * slot can go back to being empty instead of leaving a tombstone.
+    * Inline entries aren't probed at all.
+    */
+   if (hash_table_is_inline(ht) ||
+       hash_group_match_empty(ht->ctrl + (i & ~(HASH_GROUP_SIZE - 1)))) {
+      ht->ctrl[i] = HASH_CTRL_EMPTY;
+   } else {
+      ht->ctrl[i] = HASH_CTRL_DELETED;
+      ht->deleted_entries++;
+   }
+
    entry->key = ht->deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -407,15 +483,11 @@ struct hash_entry *
 _mesa_hash_table_next_entry(struct hash_table *ht,
                             struct hash_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
+   uint32_t i = entry == NULL ? 0 : entry - ht->table + 1;
 
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry)) {
-         return entry;
-      }
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -433,21 +505,16 @@ struct hash_entry *
 _mesa_hash_table_random_entry(struct hash_table *ht,
                               bool (*predicate)(struct hash_entry *entry))
 {
-   struct hash_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() & (ht->size - 1);
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
-   }
+   for (uint32_t n = 0; n < ht->size; n++) {
+      uint32_t i = (start + n) & (ht->size - 1);
+      struct hash_entry *entry = ht->table + i;
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(ht, entry) &&
+      if (hash_ctrl_is_full(ht->ctrl[i]) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
@@ -458,33 +525,72 @@ _mesa_hash_table_random_entry(struct hash_table *ht,
 
 
 /**
- * Quick FNV-1a hash implementation based on:
- * http://www.isthe.com/chongo/tech/comp/fnv/
+ * Hashes data eight bytes at a time, multiplying each word in and folding
+ * the high half of the product back down, with a final avalanche step so
+ * that every bit of the result depends on every byte of input.
  *
- * FNV-1a is not be the best hash out there -- Jenkins's lookup3 is supposed
- * to be quite good, and it probably beats FNV.  But FNV has the advantage
- * that it involves almost no code.  For an improvement on both, see Paul
- * Hsieh's http://www.azillionmonkeys.com/qed/hash.html
+ * This used to be FNV-1a, which works on one byte per multiply.  The
+ * _mesa_fnv32_1a_* helpers are still available for callers that want it.
  */
+static inline uint64_t
+hash_mix(uint64_t hash, uint64_t word)
+{
+   hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+   return hash ^ (hash >> 32);
+}
+
 uint32_t
 _mesa_hash_data(const void *data, size_t size)
 {
-   return _mesa_fnv32_1a_accumulate_block(_mesa_fnv32_1a_offset_bias,
-                                          data, size);
+   const uint8_t *bytes = (const uint8_t *) data;
+   uint64_t hash = 0xcbf29ce484222325ull ^ size;
+   uint64_t word;
+
+   while (size >= sizeof(word)) {
+      memcpy(&word, bytes, sizeof(word));
+      hash = hash_mix(hash, word);
+      bytes += sizeof(word);
+      size -= sizeof(word);
+   }
+
+   /* Pick up the tail with fixed-size loads rather than a memcpy() call,
+    * overlapping them where the tail isn't a power of two.
+    */
+   if (size >= 4) {
+      uint32_t lo, hi;
+      memcpy(&lo, bytes, sizeof(lo));
+      memcpy(&hi, bytes + size - 4, sizeof(hi));
+      hash = hash_mix(hash, (uint64_t) hi << 32 | lo);
+   } else if (size != 0) {
+      word = (uint64_t) bytes[0] << 16 | (uint64_t) bytes[size / 2] << 8 |
+             bytes[size - 1];
+      hash = hash_mix(hash, word);
+   }
+
+   hash ^= hash >> 29;
+   hash *= 0xbf58476d1ce4e5b9ull;
+   hash ^= hash >> 32;
+
+   return (uint32_t) hash;
 }
 
-/** FNV-1a string hash implementation */
+/** String hash, over the bytes before the terminator */
 uint32_t
 _mesa_hash_string(const char *key)
 {
-   uint32_t hash = _mesa_fnv32_1a_offset_bias;
+   return _mesa_hash_data(key, strlen(key));
+}
 
-   while (*key != 0) {
-      hash = _mesa_fnv32_1a_accumulate(hash, *key);
-      key++;
-   }
+uint32_t
+_mesa_key_hash_string(const void *key)
+{
+   return _mesa_hash_string((const char *)key);
+}
 
-   return hash;
+uint32_t
+_mesa_hash_pointer(const void *pointer)
+{
+   return _mesa_hash_pointer_inline(pointer);
 }
 
 /**
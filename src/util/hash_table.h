@@ -44,17 +44,26 @@ struct hash_entry {
    void *data;
 };
 
+/**
+ * Number of entries a table holds before it allocates storage of its own.
+ */
+#define HASH_TABLE_INLINE_SIZE 8
+
 struct hash_table {
    struct hash_entry *table;
+   /** One control byte per entry, see hash_group.h */
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    const void *deleted_key;
    uint32_t size;
-   uint32_t rehash;
    uint32_t max_entries;
-   uint32_t size_index;
    uint32_t entries;
    uint32_t deleted_entries;
+
+   /** Storage used until the table outgrows it */
+   struct hash_entry inline_table[HASH_TABLE_INLINE_SIZE];
+   uint8_t inline_ctrl[HASH_TABLE_INLINE_SIZE];
 };
 
 struct hash_table *
@@ -98,14 +107,21 @@ uint32_t _mesa_hash_string(const char *key);
 bool _mesa_key_string_equal(const void *a, const void *b);
 bool _mesa_key_pointer_equal(const void *a, const void *b);
 
-static inline uint32_t _mesa_key_hash_string(const void *key)
-{
-   return _mesa_hash_string((const char *)key);
-}
+uint32_t _mesa_key_hash_string(const void *key);
+uint32_t _mesa_hash_pointer(const void *pointer);
 
-static inline uint32_t _mesa_hash_pointer(const void *pointer)
+/**
+ * Fibonacci hashing of the pointer value: a single multiply, with the well
+ * mixed high bits folded into the result.
+ *
+ * _mesa_hash_pointer() is the out-of-line version to hand to
+ * _mesa_hash_table_create() and _mesa_set_create(), which recognize it and
+ * use this instead of calling through the function pointer.
+ */
+static inline uint32_t _mesa_hash_pointer_inline(const void *pointer)
 {
-   return _mesa_hash_data(&pointer, sizeof(pointer));
+   uint64_t hash = (uint64_t) (uintptr_t) pointer * 0x9e3779b97f4a7c15ull;
+   return (uint32_t) (hash >> 32) ^ (uint32_t) hash;
 }
 
 enum {
@@ -130,9 +146,9 @@ _mesa_fnv32_1a_accumulate_block(uint32_t hash, const void *data, size_t size)
    _mesa_fnv32_1a_accumulate_block(hash, &(expr), sizeof(expr))
 
 /**
- * This foreach function is safe against deletion (which just replaces
- * an entry's data with the deleted marker), but not against insertion
- * (which may rehash the table, making entry a dangling pointer).
+ * This foreach function is safe against deletion (which just marks the
+ * entry's slot as deleted), but not against insertion (which may rehash the
+ * table, making entry a dangling pointer).
  */
 #define hash_table_foreach(ht, entry)                   \
    for (entry = _mesa_hash_table_next_entry(ht, NULL);  \
@@ -40,6 +40,7 @@ _CRTIMP int _vscprintf(const char *format, va_list argptr);
 #endif
 
 #include "ralloc.h"
+#include "u_atomic.h"
 
 #ifndef va_copy
 #ifdef __va_copy
@@ -56,15 +57,15 @@ _CRTIMP int _vscprintf(const char *format, va_list argptr);
  * 64-bit), avoiding performance penalities on x86 and alignment faults on
  * ARM.
  */
-struct
 #ifdef _MSC_VER
- __declspec(align(8))
+#define HEADER_ALIGN __declspec(align(8))
 #elif defined(__LP64__)
- __attribute__((aligned(16)))
+#define HEADER_ALIGN __attribute__((aligned(16)))
 #else
- __attribute__((aligned(8)))
+#define HEADER_ALIGN __attribute__((aligned(8)))
 #endif
-   ralloc_header
+
+struct HEADER_ALIGN ralloc_header
 {
 #ifdef DEBUG
    /* A canary value used to determine whether a pointer is ralloc'd. */
@@ -81,6 +82,9 @@ struct
    struct ralloc_header *next;
 
    void (*destructor)(void *);
+
+   /* The arena this block was carved out of, or NULL if it was malloc'd. */
+   struct ralloc_arena *arena;
 };
 
 typedef struct ralloc_header ralloc_header;
@@ -88,6 +92,15 @@ typedef struct ralloc_header ralloc_header;
 static void unlink_block(ralloc_header *info);
 static void unsafe_free(ralloc_header *info);
 
+static bool stats_enabled;
+static struct ralloc_stats stats;
+
+#define COUNT(field, n)                         \
+   do {                                         \
+      if (unlikely(stats_enabled))              \
+         p_atomic_add(&stats.field, (n));       \
+   } while (0)
+
 static ralloc_header *
 get_header(const void *ptr)
 {
@@ -114,23 +127,252 @@ add_child(ralloc_header *parent, ralloc_header *info)
    }
 }
 
+/* Arena contexts
+ *
+ * Every descendant of an arena context is bump-allocated out of large slabs
+ * owned by the arena instead of being malloc'd on its own.  Freeing such a
+ * node runs its destructor and unlinks it, but its memory is only returned
+ * when the arena itself goes away, which happens once the last node linked
+ * to a parent outside of the arena (a "root", normally just the context
+ * returned by ralloc_arena_context()) is freed.
+ *
+ * The arena keeps enough bookkeeping to know when freeing that last root
+ * would have nothing left to do besides handing back the slabs, in which case
+ * the tree isn't walked at all.
+ */
+#define ARENA_SLAB_SIZE (64 * 1024)
+
+struct HEADER_ALIGN ralloc_slab
+{
+   struct ralloc_slab *next;
+   char *cur;
+   char *end;
+};
+
+/* Arena blocks remember their size, since there is no realloc() to lean on
+ * when resizing them.
+ */
+struct HEADER_ALIGN ralloc_arena_prefix
+{
+   size_t size;
+};
+
+struct ralloc_arena
+{
+   /* The slab allocations are bumped out of comes first. */
+   struct ralloc_slab *slabs;
+
+   /* Nodes of this arena whose parent lives outside of it. */
+   unsigned refs;
+
+   /* Live nodes of this arena with a destructor set. */
+   unsigned destructors;
+
+   /* Nodes from outside this arena whose parent lives inside it. */
+   unsigned foreign;
+};
+
+static size_t
+arena_align(size_t size)
+{
+   const size_t align = sizeof(struct ralloc_arena_prefix);
+   return (size + align - 1) & ~(align - 1);
+}
+
+static struct ralloc_slab *
+arena_new_slab(struct ralloc_arena *arena, size_t need)
+{
+   /* Big blocks get a slab of their own, sized to fit exactly, so that
+    * nothing is left behind in it that would never be bumped out of.
+    */
+   const bool dedicated = need > ARENA_SLAB_SIZE / 4 && arena->slabs != NULL;
+   size_t size = dedicated ? need : MAX2(need, ARENA_SLAB_SIZE);
+   struct ralloc_slab *slab = malloc(sizeof(struct ralloc_slab) + size);
+
+   if (unlikely(slab == NULL))
+      return NULL;
+
+   COUNT(mallocs, 1);
+   COUNT(slabs, 1);
+
+   slab->cur = (char *) (slab + 1);
+   slab->end = slab->cur + size;
+
+   /* Keep bumping out of the current slab rather than throwing its tail
+    * away.
+    */
+   if (dedicated) {
+      slab->next = arena->slabs->next;
+      arena->slabs->next = slab;
+   } else {
+      slab->next = arena->slabs;
+      arena->slabs = slab;
+   }
+
+   return slab;
+}
+
+static ralloc_header *
+arena_block(struct ralloc_arena *arena, size_t size)
+{
+   struct ralloc_slab *slab = arena->slabs;
+   struct ralloc_arena_prefix *prefix;
+   size_t need;
+
+   if (unlikely(size > SIZE_MAX / 2))
+      return NULL;
+
+   need = sizeof(struct ralloc_arena_prefix) + sizeof(ralloc_header) +
+          arena_align(size);
+
+   if (unlikely((size_t) (slab->end - slab->cur) < need)) {
+      slab = arena_new_slab(arena, need);
+      if (unlikely(slab == NULL))
+         return NULL;
+   }
+
+   prefix = (struct ralloc_arena_prefix *) slab->cur;
+   prefix->size = size;
+   slab->cur += need;
+
+   return (ralloc_header *) (prefix + 1);
+}
+
+static ralloc_header *
+arena_resize(ralloc_header *old, size_t size)
+{
+   struct ralloc_arena_prefix *prefix = (struct ralloc_arena_prefix *) old - 1;
+   struct ralloc_slab *slab = old->arena->slabs;
+   char *end = PTR_FROM_HEADER(old) + arena_align(prefix->size);
+   ralloc_header *info;
+
+   if (size <= prefix->size)
+      return old;
+
+   /* The last block bumped out of the current slab can simply grow. */
+   if (end == slab->cur && size <= SIZE_MAX / 2 &&
+       arena_align(size) - arena_align(prefix->size) <=
+       (size_t) (slab->end - slab->cur)) {
+      slab->cur = PTR_FROM_HEADER(old) + arena_align(size);
+      prefix->size = size;
+      return old;
+   }
+
+   info = arena_block(old->arena, size);
+   if (unlikely(info == NULL))
+      return NULL;
+
+   memcpy(info, old, sizeof(ralloc_header) + prefix->size);
+   return info;
+}
+
+static void
+arena_release(struct ralloc_arena *arena)
+{
+   struct ralloc_slab *slab, *next;
+
+   assert(arena->refs > 0);
+   if (--arena->refs > 0)
+      return;
+
+   for (slab = arena->slabs; slab != NULL; slab = next) {
+      next = slab->next;
+      free(slab);
+      COUNT(frees, 1);
+   }
+
+   free(arena);
+}
+
+/* Account for the link between info and its parent, after add_child(). */
+static void
+arena_link(ralloc_header *info)
+{
+   ralloc_header *parent = info->parent;
+
+   if (parent != NULL && parent->arena != NULL && parent->arena != info->arena)
+      parent->arena->foreign++;
+
+   if (info->arena != NULL && (parent == NULL || parent->arena != info->arena))
+      info->arena->refs++;
+}
+
+/* Drop the accounting for the link between info and its parent, before
+ * unlink_block().  Returns whether info held a reference on its arena, which
+ * the caller has to release once it is done with the block.
+ */
+static bool
+arena_unlink(ralloc_header *info)
+{
+   ralloc_header *parent = info->parent;
+
+   if (parent != NULL && parent->arena != NULL && parent->arena != info->arena)
+      parent->arena->foreign--;
+
+   return info->arena != NULL &&
+          (parent == NULL || parent->arena != info->arena);
+}
+
 void *
 ralloc_context(const void *ctx)
 {
    return ralloc_size(ctx, 0);
 }
 
+void *
+ralloc_arena_context(const void *ctx)
+{
+   struct ralloc_arena *arena = calloc(1, sizeof(struct ralloc_arena));
+   ralloc_header *info;
+
+   if (unlikely(arena == NULL))
+      return NULL;
+
+   COUNT(mallocs, 1);
+
+   if (unlikely(arena_new_slab(arena, 0) == NULL)) {
+      free(arena);
+      return NULL;
+   }
+
+   info = arena_block(arena, 0);
+   info->parent = NULL;
+   info->child = NULL;
+   info->prev = NULL;
+   info->next = NULL;
+   info->destructor = NULL;
+   info->arena = arena;
+
+   add_child(ctx != NULL ? get_header(ctx) : NULL, info);
+   arena_link(info);
+
+#ifdef DEBUG
+   info->canary = CANARY;
+#endif
+
+   COUNT(allocations, 1);
+
+   return PTR_FROM_HEADER(info);
+}
+
 void *
 ralloc_size(const void *ctx, size_t size)
 {
-   void *block = malloc(size + sizeof(ralloc_header));
    ralloc_header *info;
    ralloc_header *parent;
 
-   if (unlikely(block == NULL))
+   parent = ctx != NULL ? get_header(ctx) : NULL;
+
+   if (parent != NULL && parent->arena != NULL) {
+      info = arena_block(parent->arena, size);
+   } else {
+      info = malloc(size + sizeof(ralloc_header));
+      COUNT(mallocs, 1);
+   }
+
+   if (unlikely(info == NULL))
       return NULL;
 
-   info = (ralloc_header *) block;
    /* measurements have shown that calloc is slower (because of
     * the multiplication overflow checking?), so clear things
     * manually
@@ -140,8 +382,7 @@ ralloc_size(const void *ctx, size_t size)
    info->prev = NULL;
    info->next = NULL;
    info->destructor = NULL;
-
-   parent = ctx != NULL ? get_header(ctx) : NULL;
+   info->arena = parent != NULL ? parent->arena : NULL;
 
    add_child(parent, info);
 
@@ -149,6 +390,9 @@ ralloc_size(const void *ctx, size_t size)
    info->canary = CANARY;
 #endif
 
+   COUNT(allocations, 1);
+   COUNT(bytes, size);
+
    return PTR_FROM_HEADER(info);
 }
 
@@ -170,7 +414,13 @@ resize(void *ptr, size_t size)
    ralloc_header *child, *old, *info;
 
    old = get_header(ptr);
-   info = realloc(old, size + sizeof(ralloc_header));
+
+   if (old->arena != NULL) {
+      info = arena_resize(old, size);
+   } else {
+      info = realloc(old, size + sizeof(ralloc_header));
+      COUNT(mallocs, 1);
+   }
 
    if (info == NULL)
       return NULL;
@@ -235,13 +485,30 @@ void
 ralloc_free(void *ptr)
 {
    ralloc_header *info;
+   struct ralloc_arena *arena;
+   bool root;
 
    if (ptr == NULL)
       return;
 
    info = get_header(ptr);
+   arena = info->arena;
+   root = arena_unlink(info);
    unlink_block(info);
+
+   /* When this is the only root left and no node needs a destructor or
+    * owns foreign memory, the slabs hold everything there is to free.
+    */
+   if (root && arena->refs == 1 && arena->destructors == 0 &&
+       arena->foreign == 0) {
+      arena_release(arena);
+      return;
+   }
+
    unsafe_free(info);
+
+   if (root)
+      arena_release(arena);
 }
 
 static void
@@ -268,23 +535,44 @@ unsafe_free(ralloc_header *info)
 {
    /* Recursively free any children...don't waste time unlinking them. */
    ralloc_header *temp;
+   struct ralloc_arena *arena;
    while (info->child != NULL) {
       temp = info->child;
       info->child = temp->next;
+      arena = temp->arena;
       unsafe_free(temp);
+
+      /* A child from elsewhere was accounted for on both sides. */
+      if (arena != info->arena) {
+         if (info->arena != NULL)
+            info->arena->foreign--;
+         if (arena != NULL)
+            arena_release(arena);
+      }
    }
 
    /* Free the block itself.  Call the destructor first, if any. */
-   if (info->destructor != NULL)
+   if (info->destructor != NULL) {
       info->destructor(PTR_FROM_HEADER(info));
 
-   free(info);
+      if (info->arena != NULL) {
+         info->destructor = NULL;
+         info->arena->destructors--;
+      }
+   }
+
+   /* Arena blocks go away with their slabs. */
+   if (info->arena == NULL) {
+      free(info);
+      COUNT(frees, 1);
+   }
 }
 
 void
 ralloc_steal(const void *new_ctx, void *ptr)
 {
    ralloc_header *info, *parent;
+   bool root;
 
    if (unlikely(ptr == NULL))
       return;
@@ -292,9 +580,14 @@ ralloc_steal(const void *new_ctx, void *ptr)
    info = get_header(ptr);
    parent = get_header(new_ctx);
 
+   root = arena_unlink(info);
    unlink_block(info);
 
    add_child(parent, info);
+   arena_link(info);
+
+   if (root)
+      arena_release(info->arena);
 }
 
 void
@@ -313,13 +606,20 @@ ralloc_adopt(const void *new_ctx, void *old_ctx)
       return;
 
    /* Set all the children's parent to new_ctx; get a pointer to the last child. */
-   for (child = old_info->child; child->next != NULL; child = child->next) {
+   for (child = old_info->child; ; child = child->next) {
+      bool root = arena_unlink(child);
       child->parent = new_info;
+      arena_link(child);
+
+      if (root)
+         arena_release(child->arena);
+
+      if (child->next == NULL)
+         break;
    }
 
    /* Connect the two lists together; parent them to new_ctx; make old_ctx empty. */
    child->next = new_info->child;
-   child->parent = new_info;
    new_info->child = old_info->child;
    old_info->child = NULL;
 }
@@ -340,9 +640,31 @@ void
 ralloc_set_destructor(const void *ptr, void(*destructor)(void *))
 {
    ralloc_header *info = get_header(ptr);
+
+   if (info->arena != NULL)
+      info->arena->destructors += (destructor != NULL) - (info->destructor != NULL);
+
    info->destructor = destructor;
 }
 
+void
+ralloc_enable_stats(bool enable)
+{
+   stats_enabled = enable;
+}
+
+void
+ralloc_get_stats(struct ralloc_stats *out)
+{
+   *out = stats;
+}
+
+void
+ralloc_reset_stats(void)
+{
+   memset(&stats, 0, sizeof(stats));
+}
+
 char *
 ralloc_strdup(const void *ctx, const char *str)
 {
@@ -49,6 +49,7 @@
 #include <stddef.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "macros.h"
 
@@ -91,6 +92,23 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new ralloc context backed by an arena.
+ *
+ * Everything allocated out of the returned context, or out of any of its
+ * descendants, is bump-allocated from large slabs instead of being malloc'd
+ * one block at a time.  The usual ralloc semantics are kept: blocks can be
+ * resized, stolen and freed individually, and destructors run as before.
+ * Freeing an arena block does not return its memory though; the slabs are
+ * released together once the context (and anything stolen out of it) has
+ * been freed.  When nothing in the tree needs a destructor or owns memory
+ * from elsewhere, that happens without walking the tree at all.
+ *
+ * This suits allocations that share a lifetime, like a single compile.  An
+ * arena is not thread-safe; threads should use arenas of their own.
+ */
+void *ralloc_arena_context(const void *ctx);
+
 /**
  * Allocate memory chained off of the given context.
  *
@@ -398,6 +416,37 @@ bool ralloc_asprintf_append (char **str, const char *fmt, ...)
 bool ralloc_vasprintf_append(char **str, const char *fmt, va_list args);
 /// @}
 
+/// \defgroup stats Allocation Statistics @{
+
+/**
+ * Counters for the work done by ralloc since they were last reset.
+ */
+struct ralloc_stats {
+   uint64_t allocations; /**< Blocks handed out, including contexts */
+   uint64_t bytes;       /**< Bytes requested, excluding bookkeeping */
+   uint64_t mallocs;     /**< Calls into malloc() and realloc() */
+   uint64_t frees;       /**< Calls into free() */
+   uint64_t slabs;       /**< Slabs allocated by arena contexts */
+};
+
+/**
+ * Turn counting on or off.  Counting is off by default, and costs one
+ * atomic add per counter when it is on.
+ */
+void ralloc_enable_stats(bool enable);
+
+/**
+ * Take a snapshot of the counters.
+ */
+void ralloc_get_stats(struct ralloc_stats *stats);
+
+/**
+ * Reset all of the counters to zero.
+ */
+void ralloc_reset_stats(void);
+
+/// @}
+
 /**
  * Declare C++ new and delete operators which use ralloc.
  *
@@ -33,73 +33,84 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "macros.h"
 #include "ralloc.h"
 #include "set.h"
+#include "hash_table.h"
+#include "hash_group.h"
 
 /*
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
+ * The set uses the same grouped probing and inline storage for small sets
+ * as the hash table; see the description at the top of hash_table.c.
  */
 
-uint32_t deleted_key_value;
-const void *deleted_key = &deleted_key_value;
-
-static const struct {
-   uint32_t max_entries, size, rehash;
-} hash_sizes[] = {
-   { 2,            5,            3            },
-   { 4,            7,            5            },
-   { 8,            13,           11           },
-   { 16,           19,           17           },
-   { 32,           43,           41           },
-   { 64,           73,           71           },
-   { 128,          151,          149          },
-   { 256,          283,          281          },
-   { 512,          571,          569          },
-   { 1024,         1153,         1151         },
-   { 2048,         2269,         2267         },
-   { 4096,         4519,         4517         },
-   { 8192,         9013,         9011         },
-   { 16384,        18043,        18041        },
-   { 32768,        36109,        36107        },
-   { 65536,        72091,        72089        },
-   { 131072,       144409,       144407       },
-   { 262144,       288361,       288359       },
-   { 524288,       576883,       576881       },
-   { 1048576,      1153459,      1153457      },
-   { 2097152,      2307163,      2307161      },
-   { 4194304,      4613893,      4613891      },
-   { 8388608,      9227641,      9227639      },
-   { 16777216,     18455029,     18455027     },
-   { 33554432,     36911011,     36911009     },
-   { 67108864,     73819861,     73819859     },
-   { 134217728,    147639589,    147639587    },
-   { 268435456,    295279081,    295279079    },
-   { 536870912,    590559793,    590559791    },
-   { 1073741824,   1181116273,   1181116271   },
-   { 2147483648ul, 2362232233ul, 2362232231ul }
-};
-
-static int
-entry_is_free(struct set_entry *entry)
+static uint32_t deleted_key_value;
+static const void *deleted_key = &deleted_key_value;
+
+/* The set is rehashed once 7/8 of it is taken by entries and tombstones. */
+#define MIN_SIZE HASH_GROUP_SIZE
+#define MAX_ENTRIES(size) ((size) - (size) / 8)
+
+static inline uint32_t
+key_hash(const struct set *ht, const void *key)
 {
-   return entry->key == NULL;
+   if (ht->key_hash_function == _mesa_hash_pointer)
+      return _mesa_hash_pointer_inline(key);
+
+   return ht->key_hash_function(key);
 }
 
-static int
-entry_is_deleted(struct set_entry *entry)
+static inline bool
+key_equals(const struct set *ht, const void *a, const void *b)
+{
+   if (ht->key_equals_function == _mesa_key_pointer_equal)
+      return a == b;
+   if (ht->key_equals_function == _mesa_key_string_equal)
+      return a == b || strcmp(a, b) == 0;
+
+   return ht->key_equals_function(a, b);
+}
+
+static bool
+set_is_inline(const struct set *ht)
+{
+   return ht->table == ht->inline_table;
+}
+
+static void
+set_init_inline(struct set *ht)
 {
-   return entry->key == deleted_key;
+   ht->table = ht->inline_table;
+   ht->ctrl = ht->inline_ctrl;
+   ht->size = SET_INLINE_SIZE;
+   ht->max_entries = SET_INLINE_SIZE;
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   memset(ht->ctrl, HASH_CTRL_EMPTY, SET_INLINE_SIZE);
 }
 
-static int
-entry_is_present(struct set_entry *entry)
+static bool
+set_alloc(struct set *ht, uint32_t size)
 {
-   return entry->key != NULL && entry->key != deleted_key;
+   /* The control bytes follow the entries in the same allocation. */
+   struct set_entry *table =
+      ralloc_size(ht, size * (sizeof(struct set_entry) + 1));
+
+   if (table == NULL)
+      return false;
+
+   ht->table = table;
+   ht->ctrl = (uint8_t *) (table + size);
+   ht->size = size;
+   ht->max_entries = MAX_ENTRIES(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   memset(ht->ctrl, HASH_CTRL_EMPTY, size);
+
+   return true;
 }
 
 struct set *
@@ -114,20 +125,10 @@ _mesa_set_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
+   ht->mem_ctx = mem_ctx;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct set_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
-
-   if (ht->table == NULL) {
-      ralloc_free(ht);
-      return NULL;
-   }
+   set_init_inline(ht);
 
    return ht;
 }
@@ -151,7 +152,8 @@ _mesa_set_destroy(struct set *ht, void (*delete_function)(struct set_entry *entr
          delete_function(entry);
       }
    }
-   ralloc_free(ht->table);
+   if (!set_is_inline(ht))
+      ralloc_free(ht->table);
    ralloc_free(ht);
 }
 
@@ -163,26 +165,40 @@ _mesa_set_destroy(struct set *ht, void (*delete_function)(struct set_entry *entr
 static struct set_entry *
 set_search(const struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
+   const uint8_t tag = hash_ctrl_tag(hash);
+   uint32_t group_mask, group;
 
-   hash_address = hash % ht->size;
-   do {
-      uint32_t double_hash;
+   if (set_is_inline(ht)) {
+      for (uint32_t i = 0; i < SET_INLINE_SIZE; i++) {
+         struct set_entry *entry = ht->table + i;
 
-      struct set_entry *entry = ht->table + hash_address;
+         if (ht->ctrl[i] == tag && entry->hash == hash &&
+             key_equals(ht, key, entry->key))
+            return entry;
+      }
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+      return NULL;
+   }
+
+   group_mask = ht->size / HASH_GROUP_SIZE - 1;
+   group = hash & group_mask;
+
+   for (uint32_t stride = 1; stride <= group_mask + 1; stride++) {
+      const uint32_t base = group * HASH_GROUP_SIZE;
+      hash_group_mask match = hash_group_match(ht->ctrl + base, tag);
+
+      while (match) {
+         struct set_entry *entry = ht->table + base + hash_group_next(&match);
+
+         if (entry->hash == hash && key_equals(ht, key, entry->key))
             return entry;
-         }
       }
 
-      double_hash = 1 + hash % ht->rehash;
+      if (hash_group_match_empty(ht->ctrl + base))
+         return NULL;
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+      group = (group + stride) & group_mask;
+   }
 
    return NULL;
 }
@@ -191,7 +207,7 @@ struct set_entry *
 _mesa_set_search(const struct set *set, const void *key)
 {
    assert(set->key_hash_function);
-   return set_search(set, set->key_hash_function(key), key);
+   return set_search(set, key_hash(set, key), key);
 }
 
 struct set_entry *
@@ -203,42 +219,51 @@ _mesa_set_search_pre_hashed(const struct set *set, uint32_t hash,
    return set_search(set, hash, key);
 }
 
-static struct set_entry *
-set_add(struct set *ht, uint32_t hash, const void *key);
+/* Returns the first slot not holding a key along the probe sequence of
+ * hash.  The load factor guarantees there is one.
+ */
+static uint32_t
+set_find_free(const struct set *ht, uint32_t hash)
+{
+   const uint32_t group_mask = ht->size / HASH_GROUP_SIZE - 1;
+   uint32_t group = hash & group_mask;
+
+   for (uint32_t stride = 1; ; stride++) {
+      const uint32_t base = group * HASH_GROUP_SIZE;
+      hash_group_mask avail = hash_group_match_free(ht->ctrl + base);
+
+      if (avail)
+         return base + hash_group_next(&avail);
+
+      group = (group + stride) & group_mask;
+   }
+}
 
 static void
-set_rehash(struct set *ht, unsigned new_size_index)
+set_rehash(struct set *ht, uint32_t new_size)
 {
    struct set old_ht;
-   struct set_entry *table, *entry;
-
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
+   struct set_entry *entry;
 
-   table = rzalloc_array(ht, struct set_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   if (new_size < ht->size)
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!set_alloc(ht, new_size))
+      return;
 
-   for (entry = old_ht.table;
-        entry != old_ht.table + old_ht.size;
-        entry++) {
-      if (entry_is_present(entry)) {
-         set_add(ht, entry->hash, entry->key);
-      }
+   /* Keys are known to be distinct, so they only need a free slot. */
+   set_foreach(&old_ht, entry) {
+      uint32_t i = set_find_free(ht, entry->hash);
+
+      ht->ctrl[i] = hash_ctrl_tag(entry->hash);
+      ht->table[i] = *entry;
    }
+   ht->entries = old_ht.entries;
 
-   ralloc_free(old_ht.table);
+   if (old_ht.table != ht->inline_table)
+      ralloc_free(old_ht.table);
 }
 
 /**
@@ -250,27 +275,48 @@ set_rehash(struct set *ht, unsigned new_size_index)
 static struct set_entry *
 set_add(struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
+   const uint8_t tag = hash_ctrl_tag(hash);
+   uint32_t group_mask, group;
    struct set_entry *available_entry = NULL;
 
-   if (ht->entries >= ht->max_entries) {
-      set_rehash(ht, ht->size_index + 1);
+   if (set_is_inline(ht)) {
+      for (uint32_t i = 0; i < SET_INLINE_SIZE; i++) {
+         struct set_entry *entry = ht->table + i;
+
+         if (!hash_ctrl_is_full(ht->ctrl[i])) {
+            if (available_entry == NULL)
+               available_entry = entry;
+         } else if (ht->ctrl[i] == tag && entry->hash == hash &&
+                    key_equals(ht, key, entry->key)) {
+            entry->key = key;
+            return entry;
+         }
+      }
+
+      if (available_entry != NULL) {
+         ht->ctrl[available_entry - ht->table] = tag;
+         available_entry->hash = hash;
+         available_entry->key = key;
+         ht->entries++;
+         return available_entry;
+      }
+
+      /* Out of inline entries, move to a set of our own. */
+      set_rehash(ht, MIN_SIZE);
+      if (set_is_inline(ht))
+         return NULL;
+   } else if (ht->entries >= ht->max_entries) {
+      set_rehash(ht, ht->size * 2);
    } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
-      set_rehash(ht, ht->size_index);
+      set_rehash(ht, ht->size);
    }
 
-   hash_address = hash % ht->size;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
-
-      if (!entry_is_present(entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+   group_mask = ht->size / HASH_GROUP_SIZE - 1;
+   group = hash & group_mask;
+
+   for (uint32_t stride = 1; stride <= group_mask + 1; stride++) {
+      const uint32_t base = group * HASH_GROUP_SIZE;
+      hash_group_mask match = hash_group_match(ht->ctrl + base, tag);
 
       /* Implement replacement when another insert happens
        * with a matching key.  This is a relatively common
@@ -282,21 +328,35 @@ set_add(struct set *ht, uint32_t hash, const void *key)
        * If freeing of old keys is required to avoid memory leaks,
        * perform a search before inserting.
        */
-      if (!entry_is_deleted(entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         return entry;
+      while (match) {
+         struct set_entry *entry = ht->table + base + hash_group_next(&match);
+
+         if (entry->hash == hash && key_equals(ht, key, entry->key)) {
+            entry->key = key;
+            return entry;
+         }
       }
 
-      double_hash = 1 + hash % ht->rehash;
+      /* Stash the first available entry we find */
+      if (available_entry == NULL) {
+         hash_group_mask avail = hash_group_match_free(ht->ctrl + base);
+
+         if (avail)
+            available_entry = ht->table + base + hash_group_next(&avail);
+      }
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+      if (hash_group_match_empty(ht->ctrl + base))
+         break;
+
+      group = (group + stride) & group_mask;
+   }
 
    if (available_entry) {
-      if (entry_is_deleted(available_entry))
+      uint8_t *ctrl = ht->ctrl + (available_entry - ht->table);
+
+      if (*ctrl == HASH_CTRL_DELETED)
          ht->deleted_entries--;
+      *ctrl = tag;
       available_entry->hash = hash;
       available_entry->key = key;
       ht->entries++;
@@ -313,7 +373,7 @@ struct set_entry *
 _mesa_set_add(struct set *set, const void *key)
 {
    assert(set->key_hash_function);
-   return set_add(set, set->key_hash_function(key), key);
+   return set_add(set, key_hash(set, key), key);
 }
 
 struct set_entry *
@@ -333,12 +393,27 @@ _mesa_set_add_pre_hashed(struct set *set, uint32_t hash, const void *key)
 void
 _mesa_set_remove(struct set *ht, struct set_entry *entry)
 {
+   uint32_t i;
+
    if (!entry)
       return;
 
+   i = entry - ht->table;
+
+   /* No probe ever went past a group that still has an empty slot, so the
+    * slot can go back to being empty instead of leaving a tombstone.
+    * Inline entries aren't probed at all.
+    */
+   if (set_is_inline(ht) ||
+       hash_group_match_empty(ht->ctrl + (i & ~(HASH_GROUP_SIZE - 1)))) {
+      ht->ctrl[i] = HASH_CTRL_EMPTY;
+   } else {
+      ht->ctrl[i] = HASH_CTRL_DELETED;
+      ht->deleted_entries++;
+   }
+
    entry->key = deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -350,15 +425,11 @@ _mesa_set_remove(struct set *ht, struct set_entry *entry)
 struct set_entry *
 _mesa_set_next_entry(const struct set *ht, struct set_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
+   uint32_t i = entry == NULL ? 0 : entry - ht->table + 1;
 
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry)) {
-         return entry;
-      }
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -368,21 +439,16 @@ struct set_entry *
 _mesa_set_random_entry(struct set *ht,
                        int (*predicate)(struct set_entry *entry))
 {
-   struct set_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() & (ht->size - 1);
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
-   }
+   for (uint32_t n = 0; n < ht->size; n++) {
+      uint32_t i = (start + n) & (ht->size - 1);
+      struct set_entry *entry = ht->table + i;
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(entry) &&
+      if (hash_ctrl_is_full(ht->ctrl[i]) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
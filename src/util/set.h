@@ -40,17 +40,26 @@ struct set_entry {
    const void *key;
 };
 
+/**
+ * Number of entries a set holds before it allocates storage of its own.
+ */
+#define SET_INLINE_SIZE 8
+
 struct set {
    void *mem_ctx;
    struct set_entry *table;
+   /** One control byte per entry, see hash_group.h */
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    uint32_t size;
-   uint32_t rehash;
    uint32_t max_entries;
-   uint32_t size_index;
    uint32_t entries;
    uint32_t deleted_entries;
+
+   /** Storage used until the set outgrows it */
+   struct set_entry inline_table[SET_INLINE_SIZE];
+   uint8_t inline_ctrl[SET_INLINE_SIZE];
 };
 
 struct set *
@@ -0,0 +1,219 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "string_pool.h"
+#include "hash_table.h"
+#include "ralloc.h"
+
+/* Records are carved out of chunks of this size.  A string too long to fit
+ * a fresh chunk comfortably gets a chunk of its own.
+ */
+#define CHUNK_SIZE (16 * 1024)
+#define MIN_SLOTS 256
+
+struct string_pool_chunk {
+   struct string_pool_chunk *next;
+   char *end;
+};
+
+struct string_pool {
+   /** Open-addressed table of interned strings, a power of two in size */
+   const char **slots;
+   uint32_t size;
+   uint32_t entries;
+
+   /** Most recently allocated chunk first */
+   struct string_pool_chunk *chunks;
+   char *cur;
+   char *end;
+};
+
+/* Every record is laid out as
+ *
+ *    uint32_t hash; uint32_t length; char str[length + 1];
+ *
+ * padded so that the next record's header stays aligned.
+ */
+#define RECORD_HEADER (2 * sizeof(uint32_t))
+#define RECORD_SIZE(len) \
+   ((RECORD_HEADER + (len) + 1 + sizeof(uint32_t) - 1) & \
+    ~(sizeof(uint32_t) - 1))
+
+struct string_pool *
+_mesa_string_pool_create(void *mem_ctx)
+{
+   struct string_pool *pool = rzalloc(mem_ctx, struct string_pool);
+   if (pool == NULL)
+      return NULL;
+
+   pool->slots = rzalloc_array(pool, const char *, MIN_SLOTS);
+   if (pool->slots == NULL) {
+      ralloc_free(pool);
+      return NULL;
+   }
+   pool->size = MIN_SLOTS;
+
+   return pool;
+}
+
+void
+_mesa_string_pool_destroy(struct string_pool *pool)
+{
+   ralloc_free(pool);
+}
+
+static const char **
+find_slot(const struct string_pool *pool, uint32_t hash,
+          const char *str, size_t len)
+{
+   const uint32_t mask = pool->size - 1;
+   uint32_t i = hash & mask;
+
+   for (;;) {
+      const char **slot = &pool->slots[i];
+      const char *s = *slot;
+
+      if (s == NULL ||
+          (_mesa_string_pool_hash(s) == hash &&
+           _mesa_string_pool_length(s) == len &&
+           memcmp(s, str, len) == 0))
+         return slot;
+
+      i = (i + 1) & mask;
+   }
+}
+
+static bool
+grow(struct string_pool *pool)
+{
+   const char **old_slots = pool->slots;
+   const uint32_t old_size = pool->size;
+   const char **slots = rzalloc_array(pool, const char *, old_size * 2);
+
+   if (slots == NULL)
+      return false;
+
+   pool->slots = slots;
+   pool->size = old_size * 2;
+
+   for (uint32_t i = 0; i < old_size; i++) {
+      const char *s = old_slots[i];
+      if (s != NULL) {
+         *find_slot(pool, _mesa_string_pool_hash(s), s,
+                    _mesa_string_pool_length(s)) = s;
+      }
+   }
+
+   ralloc_free(old_slots);
+   return true;
+}
+
+static char *
+alloc_record(struct string_pool *pool, size_t size)
+{
+   if ((size_t) (pool->end - pool->cur) < size) {
+      const size_t chunk_size = size > CHUNK_SIZE / 4 ? size : CHUNK_SIZE;
+      struct string_pool_chunk *chunk =
+         ralloc_size(pool, sizeof(*chunk) + chunk_size);
+
+      if (chunk == NULL)
+         return NULL;
+
+      chunk->end = (char *) (chunk + 1) + chunk_size;
+      chunk->next = pool->chunks;
+      pool->chunks = chunk;
+
+      /* Keep filling the current chunk after a one-off large string. */
+      if (chunk_size != CHUNK_SIZE && pool->cur != NULL)
+         return (char *) (chunk + 1);
+
+      pool->cur = (char *) (chunk + 1);
+      pool->end = chunk->end;
+   }
+
+   char *rec = pool->cur;
+   pool->cur += size;
+   return rec;
+}
+
+const char *
+_mesa_string_pool_intern_len(struct string_pool *pool, const char *str,
+                             size_t len)
+{
+   const uint32_t hash = _mesa_hash_data(str, len);
+   const char **slot = find_slot(pool, hash, str, len);
+
+   if (*slot != NULL)
+      return *slot;
+
+   assert(len <= UINT32_MAX);
+
+   char *rec = alloc_record(pool, RECORD_SIZE(len));
+   if (rec == NULL)
+      return NULL;
+
+   uint32_t *header = (uint32_t *) rec;
+   char *s = rec + RECORD_HEADER;
+
+   header[0] = hash;
+   header[1] = (uint32_t) len;
+   memcpy(s, str, len);
+   s[len] = '\0';
+
+   *slot = s;
+   pool->entries++;
+
+   /* Keep the table at most half full so probe sequences stay short. */
+   if (pool->entries * 2 > pool->size)
+      grow(pool);
+
+   return s;
+}
+
+const char *
+_mesa_string_pool_intern(struct string_pool *pool, const char *str)
+{
+   return _mesa_string_pool_intern_len(pool, str, strlen(str));
+}
+
+const char *
+_mesa_string_pool_find(struct string_pool *pool, const char *str)
+{
+   const size_t len = strlen(str);
+   return *find_slot(pool, _mesa_hash_data(str, len), str, len);
+}
+
+bool
+_mesa_string_pool_owns(const struct string_pool *pool, const char *str)
+{
+   for (const struct string_pool_chunk *chunk = pool->chunks; chunk != NULL;
+        chunk = chunk->next) {
+      if (str > (const char *) (chunk + 1) && str < chunk->end)
+         return true;
+   }
+
+   return false;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file string_pool.h
+ * Interning of identifier strings.
+ *
+ * A string pool hands out one canonical copy of every distinct string that
+ * is interned in it, so two interned strings are equal exactly when their
+ * pointers are.  The hash of each interned string is computed once, when it
+ * enters the pool, and stored in front of the characters so that hash
+ * tables keyed by \c _mesa_key_hash_string can be searched with
+ * \c _mesa_string_pool_hash instead of rehashing.
+ *
+ * A pool is not thread-safe; it is meant to be owned by a single compile.
+ * Interned strings live as long as the pool's ralloc parent.
+ */
+
+struct string_pool;
+
+struct string_pool *
+_mesa_string_pool_create(void *mem_ctx);
+
+void
+_mesa_string_pool_destroy(struct string_pool *pool);
+
+/**
+ * Return the canonical copy of \p str, adding it to the pool if needed.
+ */
+const char *
+_mesa_string_pool_intern(struct string_pool *pool, const char *str);
+
+/**
+ * Like \c _mesa_string_pool_intern, for the first \p len characters of
+ * \p str, which need not be NUL terminated.
+ */
+const char *
+_mesa_string_pool_intern_len(struct string_pool *pool, const char *str,
+                             size_t len);
+
+/**
+ * Return the canonical copy of \p str if it has been interned, or NULL.
+ */
+const char *
+_mesa_string_pool_find(struct string_pool *pool, const char *str);
+
+/**
+ * Whether \p str points at a string interned in \p pool.
+ *
+ * This only compares \p str against the address ranges owned by the pool;
+ * it never reads through \p str.
+ */
+bool
+_mesa_string_pool_owns(const struct string_pool *pool, const char *str);
+
+/**
+ * The \c _mesa_hash_string value of a string returned by the pool.
+ */
+static inline uint32_t
+_mesa_string_pool_hash(const char *interned)
+{
+   return ((const uint32_t *) interned)[-2];
+}
+
+/**
+ * The length of a string returned by the pool.
+ */
+static inline uint32_t
+_mesa_string_pool_length(const char *interned)
+{
+   return ((const uint32_t *) interned)[-1];
+}
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* STRING_POOL_H */
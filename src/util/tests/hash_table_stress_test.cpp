@@ -0,0 +1,384 @@
+/*
+ * Copyright © 2017 X-LEGEND Entertainment Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file hash_table_stress_test.cpp
+ *
+ * Randomized tests of hash_table and set against std::map and std::set.
+ *
+ * Each test replays a fixed sequence of operations from a seeded generator,
+ * so failures reproduce.  The key counts move the tables from their inline
+ * storage to grouped tables of several sizes and back down through removal,
+ * with both a good hash and one that puts many keys on the same hash.  Run
+ * it under ASan/UBSan to catch stale entries and out-of-bounds probes.
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+#include "util/set.h"
+
+namespace {
+
+const unsigned num_keys = 4096;
+int key_storage[num_keys];
+
+/** xorshift32, so every run sees the same operations. */
+struct random_source {
+   random_source(uint32_t seed) : state(seed ? seed : 1) {}
+
+   uint32_t below(uint32_t n)
+   {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return state % n;
+   }
+
+   uint32_t state;
+};
+
+const void *
+key(unsigned i)
+{
+   return &key_storage[i];
+}
+
+/** Only 32 distinct hashes, so probes run through long chains. */
+uint32_t
+clustered_hash(const void *key)
+{
+   return (uint32_t) (*(const int *) key & 31) * 0x9e3779b9u;
+}
+
+bool
+int_key_equal(const void *a, const void *b)
+{
+   return *(const int *) a == *(const int *) b;
+}
+
+struct hash_functions {
+   const char *name;
+   uint32_t (*hash)(const void *key);
+   bool (*equal)(const void *a, const void *b);
+};
+
+const hash_functions hashes[] = {
+   { "pointer", _mesa_hash_pointer, _mesa_key_pointer_equal },
+   { "clustered", clustered_hash, int_key_equal },
+};
+
+typedef std::map<const void *, void *> table_reference;
+
+class hash_table_stress : public ::testing::Test {
+public:
+   virtual void SetUp()
+   {
+      for (unsigned i = 0; i < num_keys; i++)
+         key_storage[i] = i;
+      mem_ctx = ralloc_context(NULL);
+   }
+
+   virtual void TearDown()
+   {
+      ralloc_free(mem_ctx);
+   }
+
+   void *mem_ctx;
+};
+
+/**
+ * Compares every entry of \c ht with \c ref, both by iterating the table
+ * and by searching for every key of the reference.
+ */
+void
+check_table(struct hash_table *ht, const table_reference &ref)
+{
+   ASSERT_EQ(ref.size(), _mesa_hash_table_num_entries(ht));
+
+   std::set<const void *> seen;
+   struct hash_entry *entry;
+   hash_table_foreach(ht, entry) {
+      table_reference::const_iterator it = ref.find(entry->key);
+      ASSERT_TRUE(it != ref.end());
+      EXPECT_EQ(it->second, entry->data);
+      EXPECT_TRUE(seen.insert(entry->key).second);
+   }
+   EXPECT_EQ(ref.size(), seen.size());
+
+   for (table_reference::const_iterator it = ref.begin(); it != ref.end(); ++it) {
+      entry = _mesa_hash_table_search(ht, it->first);
+      ASSERT_TRUE(entry != NULL);
+      EXPECT_EQ(it->first, entry->key);
+      EXPECT_EQ(it->second, entry->data);
+   }
+}
+
+void
+fill_table(struct hash_table *ht, table_reference &ref,
+           random_source &rnd, unsigned count)
+{
+   while (ref.size() < count) {
+      const void *k = key(rnd.below(num_keys));
+      void *data = (void *) (uintptr_t) (rnd.below(1000) + 1);
+      ASSERT_TRUE(_mesa_hash_table_insert(ht, k, data) != NULL);
+      ref[k] = data;
+   }
+}
+
+unsigned delete_calls;
+
+void
+count_delete(struct hash_entry *entry)
+{
+   (void) entry;
+   delete_calls++;
+}
+
+} /* unnamed namespace */
+
+/**
+ * Inserts, replaces, searches and removes at random while the number of
+ * live keys moves through phases of different sizes, from a few that fit
+ * the inline storage up to thousands.
+ */
+TEST_F(hash_table_stress, random_operations)
+{
+   static const unsigned key_ranges[] = { 6, 9, 64, 600, 4096, 40, 2000, 8 };
+
+   for (unsigned h = 0; h < ARRAY_SIZE(hashes); h++) {
+      SCOPED_TRACE(hashes[h].name);
+      random_source rnd(h + 1);
+      struct hash_table *ht =
+         _mesa_hash_table_create(mem_ctx, hashes[h].hash, hashes[h].equal);
+      table_reference ref;
+
+      EXPECT_TRUE(ht->table == ht->inline_table);
+
+      for (unsigned phase = 0; phase < ARRAY_SIZE(key_ranges); phase++) {
+         const unsigned range = key_ranges[phase];
+
+         for (unsigned op = 0; op < 20000; op++) {
+            const void *k = key(rnd.below(range));
+            struct hash_entry *entry = _mesa_hash_table_search(ht, k);
+            table_reference::iterator it = ref.find(k);
+
+            ASSERT_EQ(it != ref.end(), entry != NULL);
+
+            switch (rnd.below(3)) {
+            case 0:
+            case 1: {
+               void *data = (void *) (uintptr_t) (op + 1);
+               entry = _mesa_hash_table_insert(ht, k, data);
+               ASSERT_TRUE(entry != NULL);
+               EXPECT_EQ(k, entry->key);
+               ref[k] = data;
+               break;
+            }
+            case 2:
+               _mesa_hash_table_remove(ht, entry);
+               if (it != ref.end())
+                  ref.erase(it);
+               break;
+            }
+
+            ASSERT_EQ(ref.size(), _mesa_hash_table_num_entries(ht));
+            if (op % 1024 == 0)
+               check_table(ht, ref);
+         }
+
+         check_table(ht, ref);
+      }
+
+      _mesa_hash_table_destroy(ht, NULL);
+   }
+}
+
+/**
+ * The table moves out of its inline storage on the first insert that does
+ * not fit, and keeps every entry as it keeps growing.
+ */
+TEST_F(hash_table_stress, inline_to_grouped_growth)
+{
+   for (unsigned h = 0; h < ARRAY_SIZE(hashes); h++) {
+      SCOPED_TRACE(hashes[h].name);
+      struct hash_table *ht =
+         _mesa_hash_table_create(mem_ctx, hashes[h].hash, hashes[h].equal);
+      table_reference ref;
+
+      for (unsigned i = 0; i < num_keys; i++) {
+         ASSERT_TRUE(_mesa_hash_table_insert(ht, key(i), &key_storage[i]));
+         ref[key(i)] = &key_storage[i];
+
+         EXPECT_EQ(i < HASH_TABLE_INLINE_SIZE, ht->table == ht->inline_table);
+         if ((i & (i + 1)) == 0 || i == HASH_TABLE_INLINE_SIZE)
+            check_table(ht, ref);
+      }
+
+      check_table(ht, ref);
+      _mesa_hash_table_destroy(ht, NULL);
+   }
+}
+
+/**
+ * Removing entries from inside hash_table_foreach visits every entry once,
+ * and the removed keys can be inserted again afterwards.
+ */
+TEST_F(hash_table_stress, remove_during_iteration)
+{
+   static const unsigned sizes[] = { 5, 8, 9, 100, 3000 };
+   random_source rnd(7);
+
+   for (unsigned h = 0; h < ARRAY_SIZE(hashes); h++) {
+      SCOPED_TRACE(hashes[h].name);
+
+      for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+         struct hash_table *ht =
+            _mesa_hash_table_create(mem_ctx, hashes[h].hash, hashes[h].equal);
+         table_reference ref;
+
+         fill_table(ht, ref, rnd, sizes[s]);
+         check_table(ht, ref);
+
+         table_reference removed;
+         std::set<const void *> visited;
+         struct hash_entry *entry;
+         hash_table_foreach(ht, entry) {
+            EXPECT_TRUE(visited.insert(entry->key).second);
+            if (rnd.below(2)) {
+               removed[entry->key] = entry->data;
+               ref.erase(entry->key);
+               _mesa_hash_table_remove(ht, entry);
+            }
+         }
+         EXPECT_EQ(ref.size() + removed.size(), visited.size());
+         check_table(ht, ref);
+
+         for (table_reference::iterator it = removed.begin();
+              it != removed.end(); ++it) {
+            EXPECT_TRUE(_mesa_hash_table_search(ht, it->first) == NULL);
+            ASSERT_TRUE(_mesa_hash_table_insert(ht, it->first, it->second));
+            ref[it->first] = it->second;
+         }
+         check_table(ht, ref);
+
+         _mesa_hash_table_destroy(ht, NULL);
+      }
+   }
+}
+
+/**
+ * Clearing calls the delete function once per entry, leaves nothing to find
+ * and the table can be filled again.
+ */
+TEST_F(hash_table_stress, clear)
+{
+   static const unsigned sizes[] = { 3, 8, 9, 700 };
+   random_source rnd(11);
+
+   for (unsigned h = 0; h < ARRAY_SIZE(hashes); h++) {
+      SCOPED_TRACE(hashes[h].name);
+
+      for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+         struct hash_table *ht =
+            _mesa_hash_table_create(mem_ctx, hashes[h].hash, hashes[h].equal);
+         table_reference ref;
+
+         for (unsigned round = 0; round < 3; round++) {
+            fill_table(ht, ref, rnd, sizes[s]);
+
+            delete_calls = 0;
+            _mesa_hash_table_clear(ht, count_delete);
+            EXPECT_EQ(ref.size(), delete_calls);
+            EXPECT_EQ(0u, _mesa_hash_table_num_entries(ht));
+            EXPECT_TRUE(_mesa_hash_table_next_entry(ht, NULL) == NULL);
+
+            for (table_reference::iterator it = ref.begin(); it != ref.end(); ++it)
+               EXPECT_TRUE(_mesa_hash_table_search(ht, it->first) == NULL);
+            ref.clear();
+         }
+
+         fill_table(ht, ref, rnd, sizes[s]);
+         check_table(ht, ref);
+         _mesa_hash_table_destroy(ht, NULL);
+      }
+   }
+}
+
+/**
+ * The same random operations on a set, including removal while iterating.
+ */
+TEST_F(hash_table_stress, set_random_operations)
+{
+   static const unsigned key_ranges[] = { 6, 9, 64, 600, 4096, 40, 2000, 8 };
+
+   for (unsigned h = 0; h < ARRAY_SIZE(hashes); h++) {
+      SCOPED_TRACE(hashes[h].name);
+      random_source rnd(h + 21);
+      struct set *set = _mesa_set_create(mem_ctx, hashes[h].hash,
+                                         hashes[h].equal);
+      std::set<const void *> ref;
+
+      for (unsigned phase = 0; phase < ARRAY_SIZE(key_ranges); phase++) {
+         const unsigned range = key_ranges[phase];
+
+         for (unsigned op = 0; op < 20000; op++) {
+            const void *k = key(rnd.below(range));
+            struct set_entry *entry = _mesa_set_search(set, k);
+
+            ASSERT_EQ(ref.count(k) != 0, entry != NULL);
+
+            if (rnd.below(3) < 2) {
+               ASSERT_TRUE(_mesa_set_add(set, k) != NULL);
+               ref.insert(k);
+            } else {
+               _mesa_set_remove(set, entry);
+               ref.erase(k);
+            }
+            ASSERT_EQ(ref.size(), set->entries);
+         }
+
+         /* Drop about half of the keys from inside the iteration. */
+         std::set<const void *> visited;
+         struct set_entry *entry;
+         set_foreach(set, entry) {
+            ASSERT_TRUE(ref.count(entry->key) != 0);
+            EXPECT_TRUE(visited.insert(entry->key).second);
+            if (rnd.below(2)) {
+               ref.erase(entry->key);
+               _mesa_set_remove(set, entry);
+            }
+         }
+
+         ASSERT_EQ(ref.size(), set->entries);
+         for (std::set<const void *>::iterator it = ref.begin();
+              it != ref.end(); ++it)
+            ASSERT_TRUE(_mesa_set_search(set, *it) != NULL);
+      }
+
+      _mesa_set_destroy(set, NULL);
+   }
+}